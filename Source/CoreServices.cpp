@@ -119,7 +119,7 @@ File getRecordingPath()
     return getProcessorGraph()->getRecordNode()->getDataDirectory();
 }
 
-void writeSpike(SpikeObject& spike, int electrodeIndex)
+void writeSpike(const SpikeObject& spike, int electrodeIndex)
 {
     getProcessorGraph()->getRecordNode()->writeSpike(spike, electrodeIndex);
 }
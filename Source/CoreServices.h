@@ -87,7 +87,7 @@ File getRecordingPath();
 
 /* Spike related methods. See record engine documentation */
 
-void writeSpike(SpikeObject& spike, int electrodeIndex);
+void writeSpike(const SpikeObject& spike, int electrodeIndex);
 void registerSpikeSource(GenericProcessor* processor);
 int addSpikeElectrode(SpikeRecordInfo* elec);
 };
@@ -27,7 +27,8 @@
 #include <stdio.h>
 
 ArduinoOutput::ArduinoOutput()
-	: GenericProcessor("Arduino Output"), outputChannel(13), inputChannel(-1), state(true), deviceSelected(false), acquisitionIsActive(false)
+	: GenericProcessor("Arduino Output"), outputChannel(13), inputChannel(-1),
+	  dispatcher("Arduino Output", this, this), state(true), acquisitionIsActive(false), deviceSelected(false)
 {
 
 }
@@ -35,6 +36,8 @@ ArduinoOutput::ArduinoOutput()
 ArduinoOutput::~ArduinoOutput()
 {
 
+    dispatcher.stop();
+
     if (arduino.isInitialized())
         arduino.disconnect();
 
@@ -125,11 +128,11 @@ void ArduinoOutput::handleEvent(int eventType, MidiMessage& event, int sampleNum
             {
                 if (eventId == 0)
                 {
-                    arduino.sendDigital(outputChannel, ARD_LOW);
+                    writeOutput(ARD_LOW, sampleNum);
                 }
                 else
                 {
-                    arduino.sendDigital(outputChannel, ARD_HIGH);
+                    writeOutput(ARD_HIGH, sampleNum);
                 }
             }
         }
@@ -143,7 +146,10 @@ void ArduinoOutput::handleEvent(int eventType, MidiMessage& event, int sampleNum
 void ArduinoOutput::setParameter(int parameterIndex, float newValue)
 {
     // make sure current output channel is off:
-    arduino.sendDigital(outputChannel, ARD_LOW);
+    DeviceCommand command;
+    command.channel = outputChannel;
+    command.value = ARD_LOW;
+    dispatcher.post(command);
 
     if (parameterIndex == 0)
     {
@@ -179,16 +185,45 @@ void ArduinoOutput::setGateChannel(int chan)
 bool ArduinoOutput::enable()
 {
     acquisitionIsActive = true;
-	return deviceSelected;
+
+    if (deviceSelected)
+    {
+        dispatcher.start();
+    }
+
+    return deviceSelected;
 }
 
 bool ArduinoOutput::disable()
 {
+    dispatcher.stop();
+
     arduino.sendDigital(outputChannel, ARD_LOW);
     acquisitionIsActive = false;
 	return true;
 }
 
+void ArduinoOutput::writeOutput(int value, int sampleNum)
+{
+    DeviceCommand command;
+    command.channel = outputChannel;
+    command.value = value;
+    command.ingestionTicks = getIngestionTicks();
+    command.dueTicks = OutputDispatcher::getTicksForSample(command.ingestionTicks, sampleNum, getSampleRate());
+
+    dispatcher.schedule(command);
+}
+
+void ArduinoOutput::execute(const DeviceCommand& command)
+{
+    arduino.sendDigital(command.channel, command.value);
+}
+
+LatencyHistogram* ArduinoOutput::getDispatchJitter()
+{
+    return &dispatcher.getJitter();
+}
+
 void ArduinoOutput::process(AudioSampleBuffer& buffer,
                             MidiBuffer& events)
 {
@@ -28,6 +28,7 @@
 
 #include "../Serial/ofArduino.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "../OutputDispatcher/OutputDispatcher.h"
 
 
 /**
@@ -38,11 +39,15 @@
 
 	Based on Open Frameworks ofArduino class.
 
-	@see GenericProcessor
+	Pin changes are written by an OutputDispatcher thread at the time of
+	the sample that triggered them, never from the audio callback.
+
+	@see GenericProcessor, OutputDispatcher
 
 */
 
-class ArduinoOutput : public GenericProcessor
+class ArduinoOutput : public GenericProcessor,
+    public OutputDispatcher::Device
 {
 public:
 
@@ -68,12 +73,23 @@ public:
     /** Creates the ArduinoOutputEditor. */
     AudioProcessorEditor* createEditor();
 
+    /** Writes a pin; called by the dispatcher. */
+    void execute(const DeviceCommand& command);
+
+    LatencyHistogram* getDispatchJitter();
+
     /** Defines the ArduinoOutput processor as a sink. */
     bool isSink()
     {
         return true;
     }
 
+    /** Pin writes are queued on the dispatcher, so this can run on the acquisition thread. */
+    bool supportsInlineProcessing()
+    {
+        return true;
+    }
+
     void setOutputChannel(int);
     void setInputChannel(int);
     void setGateChannel(int);
@@ -88,6 +104,12 @@ private:
     /** An open-frameworks Arduino object. */
     ofArduino arduino;
 
+    /** Only thread that talks to the Arduino during acquisition */
+    OutputDispatcher dispatcher;
+
+    /** Queues a digital write to the output channel */
+    void writeOutput(int value, int sampleNum = 0);
+
     bool state;
     bool acquisitionIsActive;
     bool deviceSelected;
@@ -24,6 +24,7 @@
 #include "AudioEditor.h"
 #include "../../Audio/AudioComponent.h"
 #include "../../AccessClass.h"
+#include "../Editors/GenericEditor.h" // for UtilityButton
 
 MuteButton::MuteButton()
     : ImageButton("MuteButton")
@@ -115,6 +116,13 @@ AudioEditor::AudioEditor(AudioNode* owner)
                                      false, 0, 0);
     addAndMakeVisible(noiseGateSlider);
 
+    spikeAudioButton = new UtilityButton("SPK", Font("Small Text", 13, Font::plain));
+    spikeAudioButton->setRadius(3.0f);
+    spikeAudioButton->setClickingTogglesState(true);
+    spikeAudioButton->setTooltip("Band-pass the audio monitor to the spike band (300-6000 Hz)");
+    spikeAudioButton->addListener(this);
+    addAndMakeVisible(spikeAudioButton);
+
 
     //acw = new AudioConfigurationWindow(getAudioComponent()->deviceManager, (Button*) audioWindowButton);
 
@@ -131,7 +139,8 @@ void AudioEditor::resized()
     muteButton->setBounds(0,5,30,25);
     volumeSlider->setBounds(35,8,50,getHeight()-5);
     noiseGateSlider->setBounds(85,8,50,getHeight()-5);
-    audioWindowButton->setBounds(140,5,200,getHeight());
+    spikeAudioButton->setBounds(140,8,32,getHeight()-14);
+    audioWindowButton->setBounds(178,5,200,getHeight());
 }
 
 bool AudioEditor::keyPressed(const KeyPress& key)
@@ -186,6 +195,10 @@ void AudioEditor::buttonClicked(Button* button)
             std::cout << "Mute off." << std::endl;
         }
     }
+    else if (button == spikeAudioButton)
+    {
+        getAudioProcessor()->setParameter(3, spikeAudioButton->getToggleState() ? 1.0f : 0.0f);
+    }
     else if (button == audioWindowButton && isEnabled)
     {
         if (audioWindowButton->getToggleState())
@@ -242,6 +255,7 @@ void AudioEditor::saveStateToXml(XmlElement* xml)
     audioEditorState->setAttribute("isMuted",muteButton->getToggleState());
     audioEditorState->setAttribute("volume",volumeSlider->getValue());
     audioEditorState->setAttribute("noiseGate",noiseGateSlider->getValue());
+    audioEditorState->setAttribute("spikeAudio",spikeAudioButton->getToggleState());
 
     // String audioDeviceName = getAudioComponent()->deviceManager.getCurrentAudioDeviceType();
 
@@ -260,6 +274,7 @@ void AudioEditor::loadStateFromXml(XmlElement* xml)
             muteButton->setToggleState(xmlNode->getBoolAttribute("isMuted",false),dontSendNotification);
             volumeSlider->setValue(xmlNode->getDoubleAttribute("volume",0.0f),NotificationType::sendNotification);
             noiseGateSlider->setValue(xmlNode->getDoubleAttribute("noiseGate",0.0f),NotificationType::sendNotification);
+            spikeAudioButton->setToggleState(xmlNode->getBoolAttribute("spikeAudio",false),sendNotification);
 
             //    String audioDeviceName = xmlNode->getStringAttribute("deviceType","");
             //    getAudioComponent()->deviceManager.setCurrentAudioDeviceType(audioDeviceName, true);
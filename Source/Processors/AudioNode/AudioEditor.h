@@ -30,6 +30,7 @@
 
 class AudioNode;
 class AudioComponent;
+class UtilityButton;
 
 /**
 	Toggles audio output on and off.
@@ -133,6 +134,8 @@ private:
     Slider* volumeSlider;
     Slider* noiseGateSlider;
 
+    UtilityButton* spikeAudioButton;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioEditor);
 
 };
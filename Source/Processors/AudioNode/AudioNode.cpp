@@ -26,7 +26,8 @@
 #include "AudioNode.h"
 
 AudioNode::AudioNode()
-    : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f), noiseGateLevel(0.0f)
+    : GenericProcessor("Audio Node"), audioEditor(0), volume(0.00001f), noiseGateLevel(0.0f),
+      spikeAudio(false), destBufferSampleRate(44100.0), estimatedSamples(1024)
 {
 
     settings.numInputs = 4096;
@@ -37,8 +38,6 @@ AudioNode::AudioNode()
 
     nextAvailableChannel = 2; // keep first two channels empty
 
-    tempBuffer = new AudioSampleBuffer(16, 1024);
-
 }
 
 
@@ -132,6 +131,12 @@ void AudioNode::setParameter(int parameterIndex, float newValue)
 
         expander.setThreshold(newValue); // in microVolts
 
+    }
+    else if (parameterIndex == 3)
+    {
+        // spike audio filter on or off; the filters follow in process()
+        spikeAudio = (newValue > 0.0f);
+
     }
     else if (parameterIndex == 100)
     {
@@ -165,35 +170,43 @@ void AudioNode::prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock)
 
 void AudioNode::recreateBuffers()
 {
-	numSamplesExpected.clear();
-    samplesInBackupBuffer.clear();
-    samplesInOverflowBuffer.clear();
-    ratio.clear();
-    filters.clear();
-    bufferA.clear();
-    bufferB.clear();
-    bufferSwap.clear();
+    sources.clear();
+    channelSource.clear();
 
     for (int i = 0; i < channelPointers.size(); i++)
     {
-        // processor sample rate divided by sound card sample rate
-        numSamplesExpected.add((int)(channelPointers[i]->sampleRate/destBufferSampleRate*float(estimatedSamples)) + 1);
-        samplesInBackupBuffer.add(0);
-        samplesInOverflowBuffer.add(0);
-        sourceBufferSampleRate.add(channelPointers[i]->sampleRate);
+        Channel* ch = channelPointers[i];
+        int index = -1;
 
-        filters.add(new Dsp::SmoothedFilterDesign<Dsp::RBJ::Design::LowPass, 1> (1024));
-
-        ratio.add(float(numSamplesExpected[i])/float(estimatedSamples));
-        updateFilter(i);
+        for (int s = 0; s < sources.size(); s++)
+        {
+            if (sources[s]->sourceNodeId == ch->sourceNodeId)
+                index = s;
+        }
 
-        bufferA.add(new AudioSampleBuffer(1,10000));
-        bufferB.add(new AudioSampleBuffer(1,10000));
-        bufferSwap.add(false);
+        if (index < 0)
+        {
+            MonitorSource* source = new MonitorSource();
+            source->sourceNodeId = ch->sourceNodeId;
+            source->sampleRate = ch->sampleRate;
+            source->active = false;
+            source->spikeFilterActive = false;
+            source->spikeFilterUsable = false;
+            source->resampler.prepare(ch->sampleRate, destBufferSampleRate, estimatedSamples);
+            source->spikeFilter = new Dsp::SmoothedFilterDesign
+                                  <Dsp::Butterworth::Design::BandPass   // design type
+                                  <2>,                                  // order
+                                  1,                                    // number of channels (must be const)
+                                  Dsp::DirectFormII>                    // realization
+                                  (1);
+
+            index = sources.size();
+            sources.add(source);
+            updateSpikeFilter(index);
+        }
 
+        channelSource.add(index);
     }
-
-    tempBuffer->setSize(getNumInputs(), 4096);
 }
 
 bool AudioNode::enable()
@@ -202,268 +215,255 @@ bool AudioNode::enable()
 	return true;
 }
 
-void AudioNode::updateFilter(int i)
+void AudioNode::updateSpikeFilter(int s)
 {
+    const double sampleRate = sources[s]->sampleRate;
 
-    double cutoffFreq = (ratio[i] > 1.0) ? 2 * destBufferSampleRate  // downsample
-                        : destBufferSampleRate / 2; // upsample
+    const double lowCut = 300.0;
+    const double highCut = jmin(6000.0, 0.45 * sampleRate);
 
-    double sampleFreq = (ratio[i] > 1.0) ? sourceBufferSampleRate[i] // downsample
-                        : destBufferSampleRate;  // upsample
+    // at rates this low there is no spike band to pass, so monitor unfiltered
+    sources[s]->spikeFilterUsable = highCut > lowCut;
 
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
+    if (!sources[s]->spikeFilterUsable)
+        return;
 
-    filters[i]->setParams(params);
+    Dsp::Params params;
+    params[0] = sampleRate; // sample rate
+    params[1] = 2; // order
+    params[2] = (highCut + lowCut) / 2; // center frequency
+    params[3] = highCut - lowCut; // bandwidth
 
+    sources[s]->spikeFilter->setParams(params);
 }
 
 void AudioNode::process(AudioSampleBuffer& buffer,
                         MidiBuffer& events)
 {
-    float gain;
-    int valuesNeeded = buffer.getNumSamples(); // samples needed to fill out the buffer
-
-    //std::cout << "Buffer size: " << buffer.getNumChannels() << std::endl;
+    const int valuesNeeded = buffer.getNumSamples(); // samples needed to fill out the buffer
 
     // clear the left and right channels
-    buffer.clear(0,0,buffer.getNumSamples());
-    buffer.clear(1,0,buffer.getNumSamples());
+    buffer.clear(0,0,valuesNeeded);
+    buffer.clear(1,0,valuesNeeded);
 
-    if (1)
-    {
+    if (channelPointers.size() == 0 || channelSource.size() != channelPointers.size())
+        return;
 
-        AudioSampleBuffer* overflowBuffer;
-        AudioSampleBuffer* backupBuffer;
+    for (int s = 0; s < sources.size(); s++)
+    {
+        MonitorSource* source = sources[s];
+        float* mix = nullptr;
+        int nSamples = 0;
 
-        if (channelPointers.size() > 0) // we have some channels
+        // mix every monitored channel of this source in a single pass over its samples
+        for (int i = 0; i < buffer.getNumChannels()-2; i++)
         {
+            if (channelSource[i] != s || !channelPointers[i]->isMonitored)
+                continue;
 
-            tempBuffer->clear();
-
-            for (int i = 0; i < buffer.getNumChannels()-2; i++) // cycle through them all
+            if (mix == nullptr)
             {
-
-                if (channelPointers[i]->isMonitored)
+                if (!source->active)
                 {
+                    source->resampler.reset();
+                    source->spikeFilter->reset();
+                    source->active = true;
+                }
+
+                nSamples = numSamples.at(source->sourceNodeId);
+                mix = source->resampler.appendInput(nSamples);
+            }
+
+            // Data are floats in units of microvolts, so dividing by bitVolts and 0x7fff (max value for 16b signed)
+            // rescales to between -1 and +1. Audio output starts So, maximum gain applied to maximum data would be 10.
+            const float gain = volume/(float(0x7fff) * channelPointers[i]->bitVolts);
+
+            FloatVectorOperations::addWithMultiply(mix, buffer.getReadPointer(i+2), gain, nSamples);
+        }
 
-                    //std::cout << "Processing channel " << i << std::endl;
+        if (mix == nullptr)
+        {
+            source->active = false;
+            continue;
+        }
 
-                    if (!bufferSwap[i])
-                    {
-                        overflowBuffer = bufferA[i];
-                        backupBuffer = bufferB[i];
+        const bool filterSpikes = spikeAudio && source->spikeFilterUsable;
 
-                        bufferSwap.set(i,true);
-                    }
-                    else
-                    {
-                        overflowBuffer = bufferB[i];
-                        backupBuffer = bufferA[i];
+        if (filterSpikes != source->spikeFilterActive)
+        {
+            source->spikeFilter->reset();
+            source->spikeFilterActive = filterSpikes;
+        }
 
-                        bufferSwap.set(i,false);
-                    }
+        if (source->spikeFilterActive && nSamples > 0)
+            source->spikeFilter->process(nSamples, &mix);
 
-                    backupBuffer->clear();
+        source->resampler.process(buffer.getWritePointer(0), valuesNeeded);
+    }
+
+    // Simple implementation of a "noise gate" on audio output
+    expander.process(buffer.getWritePointer(0), // expand the left channel
+                     valuesNeeded);
+
+    // copy the signal into the right channel (no stereo audio yet!)
+    buffer.copyFrom(1,    // destChannel
+                    0,  // destSampleOffset
+                    buffer,     // source
+                    0,    // sourceChannel
+                    0,// sourceSampleOffset
+                    valuesNeeded);        // number of samples
+}
 
-                    samplesInOverflowBuffer.set(i,samplesInBackupBuffer[i]); // size of buffer after last round
-                    samplesInBackupBuffer.set(i,0);
+// ==========================================================
 
-                    int orphanedSamples = 0;
+namespace
+{
+// largest relative change of the input step used to follow the clock drift
+const double maxCorrection = 0.005;
+}
 
-                    // 1. copy overflow buffer
+MonitorResampler::MonitorResampler()
+    : numTaps(0), fifoSize(0), numBuffered(0), position(0),
+      nominalStep(1.0), targetFill(0), smoothedFill(0)
+{
+}
 
-                    int samplesToCopyFromOverflowBuffer =
-                        ((samplesInOverflowBuffer[i] <= numSamplesExpected[i]) ?
-                         samplesInOverflowBuffer[i] :
-                         numSamplesExpected[i]);
+void MonitorResampler::prepare(double sourceRate, double destRate, int destBlockSize)
+{
+    nominalStep = sourceRate / destRate;
 
-                    //std::cout << "Copying " << samplesToCopyFromOverflowBuffer << " samples from overflow buffer of " << samplesInOverflowBuffer[i] << " samples." << std::endl;
+    // cut off below the lower Nyquist frequency; downsampling needs proportionally longer kernels
+    const double cutoff = 0.45 * jmin(sourceRate, destRate) / sourceRate; // cycles per input sample
+    numTaps = 4 * jmax(4, int(std::ceil(4.0 * jmax(1.0, nominalStep))));
 
-                    if (samplesToCopyFromOverflowBuffer > 0) // need to re-add samples from backup buffer
-                    {
+    coefficients.malloc(NUM_PHASES * numTaps);
 
-                        tempBuffer->addFrom(i,    // destination channel
-                                            0,                // destination start sample
-                                            *overflowBuffer,  // source
-                                            0,                // source channel
-                                            0,                // source start sample
-                                            samplesToCopyFromOverflowBuffer,    // number of samples
-                                            1.0f              // gain to apply
-                                           );
+    const double halfLength = numTaps / 2.0;
 
-                        int leftoverSamples = samplesInOverflowBuffer[i] - samplesToCopyFromOverflowBuffer;
+    for (int p = 0; p < NUM_PHASES; p++)
+    {
+        float* phase = coefficients + p * numTaps;
+        double sum = 0;
 
-                        // std::cout << "Samples remaining in overflow buffer: " << leftoverSamples << std::endl;
+        for (int k = 0; k < numTaps; k++)
+        {
+            // distance from the output sample, which lies between taps numTaps/2 - 1 and numTaps/2
+            const double d = k - (halfLength - 1.0) - double(p) / NUM_PHASES;
+            const double x = 2.0 * cutoff * d;
+            const double sinc = (std::abs(x) < 1.0e-9) ? 1.0 : std::sin(double_Pi * x) / (double_Pi * x);
+            const double w = (std::abs(d) >= halfLength) ? 0.0 :
+                             0.42 + 0.5 * std::cos(double_Pi * d / halfLength) + 0.08 * std::cos(2.0 * double_Pi * d / halfLength);
+
+            phase[k] = float(sinc * w);
+            sum += phase[k];
+        }
 
-                        if (leftoverSamples > 0) // move remaining samples to the backup buffer
-                        {
+        // unity gain at DC for every phase
+        for (int k = 0; k < numTaps; k++)
+            phase[k] = float(phase[k] / sum);
+    }
 
-                            backupBuffer->addFrom(0, // destination channel
-                                                  0,                     // destination start sample
-                                                  *overflowBuffer,       // source
-                                                  0,                     // source channel
-                                                  samplesToCopyFromOverflowBuffer,         // source start sample
-                                                  leftoverSamples,       // number of samples
-                                                  1.0f                   // gain to apply
-                                                 );
-                        }
+    const int inputPerBlock = int(std::ceil(destBlockSize * nominalStep));
 
-                        samplesInBackupBuffer.set(i,leftoverSamples);
-                    }
+    targetFill = 2.0 * inputPerBlock;
+    fifoSize = numTaps + 16 * inputPerBlock + 16384;
+    fifo.malloc(fifoSize);
 
-                    gain = volume/(float(0x7fff) * channelPointers[i]->bitVolts);
-                    // Data are floats in units of microvolts, so dividing by bitVolts and 0x7fff (max value for 16b signed)
-                    // rescales to between -1 and +1. Audio output starts So, maximum gain applied to maximum data would be 10.
+    reset();
+}
 
-                    int remainingSamples = numSamplesExpected[i] - samplesToCopyFromOverflowBuffer;
+void MonitorResampler::reset()
+{
+    if (fifoSize == 0)
+        return;
 
-                    int samplesAvailable = numSamples.at(channelPointers[i]->sourceNodeId);
+    // one block of silence ahead of the kernel, so the first callback reaches the target fill
+    numBuffered = jmin(fifoSize, numTaps + int(targetFill / 2));
+    FloatVectorOperations::clear(fifo, numBuffered);
 
-                    int samplesToCopyFromIncomingBuffer = ((remainingSamples <= samplesAvailable) ?
-                                                           remainingSamples :
-                                                           samplesAvailable);
+    position = 0;
+    smoothedFill = targetFill;
+}
 
-                    //std::cout << "Copying " << samplesToCopyFromIncomingBuffer << " samples from incoming buffer of " << samplesAvailable << " samples." << std::endl;
+float* MonitorResampler::appendInput(int numSamples)
+{
+    numSamples = jmin(numSamples, fifoSize);
 
+    if (numBuffered + numSamples > fifoSize)
+    {
+        // the audio device stalled; drop the oldest input
+        const int toDrop = numBuffered + numSamples - fifoSize;
 
-                    if (samplesToCopyFromIncomingBuffer > 0)
-                    {
+        memmove(fifo, fifo + toDrop, (numBuffered - toDrop) * sizeof(float));
+        numBuffered -= toDrop;
+        position = jmax(0.0, position - toDrop);
+    }
 
-                        tempBuffer->addFrom(i,       // destination channel
-                                            samplesToCopyFromOverflowBuffer,           // destination start sample
-                                            buffer,      // source
-                                            i+2,           // source channel (add 2 to account for output channels)
-                                            0,           // source start sample
-                                            samplesToCopyFromIncomingBuffer, //  number of samples
-                                            gain       // gain to apply
-                                           );
+    float* start = fifo + numBuffered;
+    FloatVectorOperations::clear(start, numSamples);
+    numBuffered += numSamples;
 
-                        //if (destBufferPos == 0)
-                        //  std::cout << "Temp buffer 0 value: " << *tempBuffer->getReadPointer(i,0) << std::endl;
+    return start;
+}
 
-                    }
+void MonitorResampler::process(float* dest, int numSamples)
+{
+    if (fifoSize == 0)
+        return;
 
-                    orphanedSamples = samplesAvailable - samplesToCopyFromIncomingBuffer;
+    double available = numBuffered - numTaps - position;
 
-                    // std::cout << "Samples remaining in incoming buffer: " << orphanedSamples << std::endl;
+    // after a long gap, skip ahead rather than keep the extra latency
+    if (available > 4.0 * targetFill)
+    {
+        position += available - targetFill;
+        available = targetFill;
+        smoothedFill = targetFill;
+    }
 
-                    if (orphanedSamples > 0 && (samplesInBackupBuffer[i] + orphanedSamples < backupBuffer->getNumSamples()))
-                    {
+    // follow the drift between the two clocks with a slow proportional correction
+    smoothedFill += 0.05 * (available - smoothedFill);
+    const double correction = jlimit(-maxCorrection, maxCorrection, 0.01 * (smoothedFill - targetFill) / targetFill);
+    const double step = nominalStep * (1.0 + correction);
 
-                        backupBuffer->addFrom(0,                            // destination channel
-                                              samplesInBackupBuffer[i],     // destination start sample
-                                              buffer,                       // source
-                                              i+2,                          // source channel (add 2 to account for output channels)
-                                              remainingSamples,             // source start sample
-                                              orphanedSamples,              //  number of samples
-                                              gain                          // gain to apply
-                                             );
+    for (int n = 0; n < numSamples; n++)
+    {
+        const int base = int(position);
 
-                        samplesInBackupBuffer.set(i, samplesInBackupBuffer[i] + orphanedSamples);
+        if (base + numTaps > numBuffered)
+            break; // underrun; the rest of the block stays silent
 
-                    }
+        const int p = int((position - base) * NUM_PHASES);
+        const float* c = coefficients + p * numTaps;
+        const float* x = fifo + base;
 
-                    // now that our tempBuffer is ready, we can filter it and copy it into the
-                    // original buffer
-
-                    //std::cout << "Ratio = " << ratio[i] << ", gain = " << gain << std::endl;
-                    //std::cout << "Values needed = " << valuesNeeded << ", channel = " << i << std::endl;
-
-                    if (ratio[i] > 1.00001)
-                    {
-                        // pre-apply filter before downsampling
-                        float* ptr = tempBuffer->getWritePointer(i);
-                        filters[i]->process(numSamplesExpected[i], &ptr);
-                    }
-
-                    // initialize variables
-                    int sourceBufferPos = 0;
-                    int sourceBufferSize = numSamplesExpected[i];
-                    float subSampleOffset = 0.0;
-                    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-
-                    int destBufferPos;
-
-                    // code modified from "juce_ResamplingAudioSource.cpp":
-
-                    for (destBufferPos = 0; destBufferPos < valuesNeeded; destBufferPos++)
-                    {
-                        float gain = 1.0;
-                        float alpha = (float) subSampleOffset;
-                        float invAlpha = 1.0f - alpha;
-
-                        // std::cout << "Copying sample " << sourceBufferPos << std::endl;
-
-                        buffer.addFrom(0,    // destChannel
-                                       destBufferPos,  // destSampleOffset
-                                       *tempBuffer,     // source
-                                       i,    // sourceChannel
-                                       sourceBufferPos,// sourceSampleOffset
-                                       1,        // number of samples
-                                       invAlpha*gain);      // gain to apply to source
-
-                        buffer.addFrom(0,    // destChannel
-                                       destBufferPos,   // destSampleOffset
-                                       *tempBuffer,     // source
-                                       i,      // sourceChannel
-                                       nextPos,      // sourceSampleOffset
-                                       1,        // number of samples
-                                       alpha*gain);       // gain to apply to source
-
-                        // if (destBufferPos == 0)
-                        //std::cout << "Output buffer 0 value: " << *buffer.getReadPointer(i+2,destBufferPos) << std::endl;
-
-                        subSampleOffset += ratio[i];
+        // four partial sums let the compiler vectorize the dot product
+        float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
 
-                        while (subSampleOffset >= 1.0)
-                        {
-                            if (++sourceBufferPos >= sourceBufferSize)
-                                sourceBufferPos = 0;
-
-                            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-                            subSampleOffset -= 1.0;
-                        }
-                    }
-
-                    if (ratio[i] < 0.99999)
-                    {
-                        // apply the filter after upsampling
-                        float* ptr = buffer.getWritePointer(0);
-                        filters[i]->process(destBufferPos, &ptr);
-                    }
-
-                    // now copy the channel into the output zone
-
-                    // buffer.addFrom(0,    // destChannel
-                    //                0,  // destSampleOffset
-                    //                buffer,     // source
-                    //                 i+2,    // sourceChannel
-                    //                 0,// sourceSampleOffset
-                    //                 valuesNeeded,        // number of samples
-                    //                 1.0);      // gain to apply to source
-
-                } // if channelPointers[i]->isMonitored
-            } // end cycling through channels
-
-            // Simple implementation of a "noise gate" on audio output
-            expander.process(buffer.getWritePointer(0), // expand the left channel
-                             buffer.getNumSamples());
-
-            // copy the signal into the right channel (no stereo audio yet!)
-            buffer.addFrom(1,    // destChannel
-                           0,  // destSampleOffset
-                           buffer,     // source
-                           0,    // sourceChannel
-                           0,// sourceSampleOffset
-                           valuesNeeded,        // number of samples
-                           1.0);      // gain to apply to source
+        for (int k = 0; k < numTaps; k += 4)
+        {
+            s0 += c[k] * x[k];
+            s1 += c[k+1] * x[k+1];
+            s2 += c[k+2] * x[k+2];
+            s3 += c[k+3] * x[k+3];
         }
+
+        dest[n] += (s0 + s1) + (s2 + s3);
+        position += step;
+    }
+
+    // keep only the samples the kernel still needs
+    const int consumed = jmin(int(position), numBuffered);
+
+    if (consumed > 0)
+    {
+        memmove(fifo, fifo + consumed, (numBuffered - consumed) * sizeof(float));
+        numBuffered -= consumed;
+        position -= consumed;
     }
 }
 
+
 // ==========================================================
 
 Expander::Expander()
@@ -79,6 +79,59 @@ private:
 
 };
 
+/**
+
+  Converts the monitor signal of one source from its sample rate to the audio device's.
+
+  A windowed-sinc polyphase filter (NUM_PHASES phases, cutoff at 45% of the lower
+  of the two rates) interpolates the output samples, so it both band-limits and
+  resamples in a single pass. The source and the audio device run on different
+  clocks and deliver varying numbers of samples per callback; the input step is
+  nudged by at most 0.5% to keep the FIFO filled at its target level
+  instead of dropping or repeating samples.
+
+  @see AudioNode
+
+*/
+
+class MonitorResampler
+{
+public:
+    MonitorResampler();
+
+    /** Designs the filter and allocates the FIFO. Not to be called while processing. */
+    void prepare(double sourceRate, double destRate, int destBlockSize);
+
+    /** Empties the FIFO and pre-fills it to the target level with silence. */
+    void reset();
+
+    /** Returns space for numSamples new input samples, cleared, for the caller to mix into. */
+    float* appendInput(int numSamples);
+
+    /** Resamples the buffered input and adds numSamples output samples to dest. */
+    void process(float* dest, int numSamples);
+
+    enum
+    {
+        NUM_PHASES = 256
+    };
+
+private:
+
+    HeapBlock<float> coefficients; // NUM_PHASES x numTaps, phase-major
+    int numTaps;
+
+    HeapBlock<float> fifo;
+    int fifoSize;
+    int numBuffered;
+
+    double position; // of the first tap of the next output sample, in input samples from fifo[0]
+    double nominalStep;
+    double targetFill;
+    double smoothedFill;
+
+};
+
 class AudioNode : public GenericProcessor
 {
 public:
@@ -120,45 +173,49 @@ public:
 
     void prepareToPlay(double sampleRate_, int estimatedSamplesPerBlock);
 
-    void updateFilter(int i);
-
 	bool enable();
 
 private:
 	void recreateBuffers();
 
+    /** Updates the band of the spike audio filter of a source. */
+    void updateSpikeFilter(int source);
+
     Array<int> leftChan;
     Array<int> rightChan;
     float volume;
     float noiseGateLevel; // in microvolts
 
+    /** Band-pass the monitor signal to the spike band (parameter 3) */
+    bool spikeAudio;
+
     /** An array of pointers to the channels that feed into the AudioNode. */
     Array<Channel*> channelPointers;
 
-    OwnedArray<AudioSampleBuffer> bufferA;
-    OwnedArray<AudioSampleBuffer> bufferB;
-
-    Array<int> numSamplesExpected;
+    /** Monitored channels of the same source share a sample rate and sample count,
+        so they are mixed first and then filtered and resampled together.
+    */
+    struct MonitorSource
+    {
+        int sourceNodeId;
+        double sampleRate;
+        bool active;
+        bool spikeFilterActive;
+
+        /** False when the source's Nyquist frequency is below the spike band */
+        bool spikeFilterUsable;
+        MonitorResampler resampler;
+        ScopedPointer<Dsp::Filter> spikeFilter;
+    };
+
+    OwnedArray<MonitorSource> sources;
+    Array<int> channelSource; // index into sources, for each channel
 
-    Array<int> samplesInBackupBuffer;
-    Array<int> samplesInOverflowBuffer;
-    Array<double> sourceBufferSampleRate;
     double destBufferSampleRate;
 	int estimatedSamples;
 
-    Array<bool> bufferSwap;
-
     Expander expander;
 
-    // sample rate, timebase, and ratio info:
-    Array<double> ratio;
-
-    // major objects:
-    OwnedArray<Dsp::Filter> filters;
-
-    // Temporary buffer for data
-    ScopedPointer<AudioSampleBuffer> tempBuffer;
-
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioNode);
 
 };
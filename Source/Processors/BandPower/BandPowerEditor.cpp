@@ -0,0 +1,124 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BandPowerEditor.h"
+#include "BandPowerNode.h"
+
+
+BandPowerEditor::BandPowerEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors=true)
+    : GenericEditor(parentNode, useDefaultParameterEditors)
+
+{
+    desiredWidth = 230;
+
+    bandsLabel = addValueLabel("bands", "Bands (Hz):", 10, 30, 200);
+    bandsLabel->setTooltip("Comma-separated bands, e.g. 4-8, 30-80; add :threshold (uV) to a band "
+                           "to send events when the mean over channels crosses it");
+
+    windowLabel = addValueLabel("window", "Window (ms):", 10, 75, 90);
+    hopLabel = addValueLabel("hop", "Hop (ms):", 120, 75, 90);
+
+    updateSettings();
+
+}
+
+BandPowerEditor::~BandPowerEditor()
+{
+
+}
+
+
+Label* BandPowerEditor::addValueLabel(const String& name, const String& title, int x, int y, int width)
+{
+    Label* titleLabel = new Label(name + " label", title);
+    titleLabel->setBounds(x, y, width, 20);
+    titleLabel->setFont(Font("Small Text", 12, Font::plain));
+    titleLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(titleLabel);
+    titles.add(titleLabel);
+
+    Label* valueLabel = new Label(name + " value", String::empty);
+    valueLabel->setBounds(x + 5, y + 20, width - 10, 18);
+    valueLabel->setFont(Font("Default", 15, Font::plain));
+    valueLabel->setColour(Label::textColourId, Colours::white);
+    valueLabel->setColour(Label::backgroundColourId, Colours::grey);
+    valueLabel->setEditable(true);
+    valueLabel->addListener(this);
+    addAndMakeVisible(valueLabel);
+
+    return valueLabel;
+}
+
+
+void BandPowerEditor::labelTextChanged(Label* label)
+{
+    BandPowerNode* p = (BandPowerNode*) getProcessor();
+
+    if (label == bandsLabel)
+    {
+        String error;
+
+        if (!p->setBands(label->getText(), error))
+            CoreServices::sendStatusMessage(error);
+    }
+    else if (label == windowLabel)
+    {
+        p->setWindowMs(label->getText().getFloatValue());
+    }
+    else if (label == hopLabel)
+    {
+        p->setHopMs(label->getText().getFloatValue());
+    }
+
+    updateSettings();
+
+    CoreServices::updateSignalChain(this);
+}
+
+
+void BandPowerEditor::updateSettings()
+{
+    BandPowerNode* p = (BandPowerNode*) getProcessor();
+
+    bandsLabel->setText(p->getBands(), dontSendNotification);
+    windowLabel->setText(String(p->getWindowMs()), dontSendNotification);
+    hopLabel->setText(String(p->getHopMs()), dontSendNotification);
+}
+
+
+void BandPowerEditor::startAcquisition()
+{
+    bandsLabel->setEnabled(false);
+    windowLabel->setEnabled(false);
+    hopLabel->setEnabled(false);
+    GenericEditor::startAcquisition();
+}
+
+
+void BandPowerEditor::stopAcquisition()
+{
+    bandsLabel->setEnabled(true);
+    windowLabel->setEnabled(true);
+    hopLabel->setEnabled(true);
+    GenericEditor::stopAcquisition();
+}
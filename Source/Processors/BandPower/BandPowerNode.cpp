@@ -0,0 +1,534 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BandPowerNode.h"
+#include "BandPowerEditor.h"
+
+
+BandPowerNode::BandPowerNode()
+    : GenericProcessor("Band Power"), bandsText("4-8, 30-80, 70-150"), windowMs(500.0f), hopMs(50.0f),
+      firstOutput(0), decimation(1), windowSamples(0), hopSamples(1), windowPower(1.0f), ringSize(0),
+      ringPosition(0), ringFill(0), decimationCount(0), hopCount(0), currentBuffer(nullptr),
+      blockSamples(0), hopValues(1, 16), scratchPerWorker(0)
+{
+    parseBands(bandsText, bands);
+}
+
+
+BandPowerNode::~BandPowerNode()
+{
+
+}
+
+
+AudioProcessorEditor* BandPowerNode::createEditor()
+{
+    editor = new BandPowerEditor(this, true);
+    return editor;
+}
+
+
+bool BandPowerNode::parseBands(const String& text, Array<Band>& result)
+{
+    StringArray tokens;
+    tokens.addTokens(text, ",;", String::empty);
+    tokens.trim();
+    tokens.removeEmptyStrings();
+
+    Array<Band> parsed;
+
+    for (int i = 0; i < tokens.size(); i++)
+    {
+        const String range = tokens[i].upToFirstOccurrenceOf(":", false, false);
+
+        if (!range.containsChar('-'))
+            return false;
+
+        Band band;
+        band.low = range.upToFirstOccurrenceOf("-", false, false).trim().getFloatValue();
+        band.high = range.fromFirstOccurrenceOf("-", false, false).trim().getFloatValue();
+        band.threshold = tokens[i].fromFirstOccurrenceOf(":", false, false).trim().getFloatValue();
+        band.firstBin = band.lastBin = 0;
+
+        if (band.low < 0 || band.high <= band.low || band.threshold < 0)
+            return false;
+
+        parsed.add(band);
+    }
+
+    if (parsed.size() == 0 || parsed.size() > MAX_BANDS)
+        return false;
+
+    result.swapWith(parsed);
+    return true;
+}
+
+
+bool BandPowerNode::checkBands(const Array<Band>& bandsToCheck, double sampleRate, String& error)
+{
+    for (int b = 0; b < bandsToCheck.size(); b++)
+    {
+        if (bandsToCheck[b].high > 0.5 * sampleRate)
+        {
+            error = "Band Power: " + String(bandsToCheck[b].low) + "-" + String(bandsToCheck[b].high)
+                    + " Hz is above the Nyquist frequency (" + String(0.5 * sampleRate) + " Hz)";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+double BandPowerNode::getInputSampleRate() const
+{
+    for (int ch = 0; ch < channels.size(); ch++)
+    {
+        if (channels[ch]->type == HEADSTAGE_CHANNEL)
+            return channels[ch]->sampleRate;
+    }
+
+    return 0;
+}
+
+
+bool BandPowerNode::setBands(const String& text, String& error)
+{
+    Array<Band> parsed;
+
+    if (!parseBands(text, parsed))
+    {
+        error = "Bands must look like 4-8, 30-80:20";
+        return false;
+    }
+
+    // without inputs there is nothing to check against yet; updateSettings() checks again
+    const double sampleRate = getInputSampleRate();
+
+    if (sampleRate > 0 && !checkBands(parsed, sampleRate, error))
+        return false;
+
+    bandsText = text.trim();
+    bands.swapWith(parsed);
+    return true;
+}
+
+
+String BandPowerNode::getBands() const
+{
+    return bandsText;
+}
+
+
+void BandPowerNode::setWindowMs(float ms)
+{
+    windowMs = jmax(1.0f, ms);
+}
+
+
+float BandPowerNode::getWindowMs() const
+{
+    return windowMs;
+}
+
+
+void BandPowerNode::setHopMs(float ms)
+{
+    hopMs = jmax(0.1f, ms);
+}
+
+
+float BandPowerNode::getHopMs() const
+{
+    return hopMs;
+}
+
+
+int BandPowerNode::getNumThreads() const
+{
+    // leave a core to the GUI and one to the source
+    return jlimit(0, 7, SystemStats::getNumCpus() - 2);
+}
+
+
+void BandPowerNode::updateSettings()
+{
+
+    inputChannels.clearQuick();
+    firstOutput = channels.size();
+    fft = nullptr;
+
+    for (int ch = 0; ch < channels.size(); ch++)
+    {
+        if (channels[ch]->type == HEADSTAGE_CHANNEL)
+            inputChannels.add(ch);
+    }
+
+    parseBands(bandsText, bands);
+
+    const int numInputs = inputChannels.size();
+
+    if (numInputs == 0)
+        return;
+
+    const double sampleRate = channels[inputChannels[0]]->sampleRate;
+
+    // dropping a band would renumber the band channels and event channels after it,
+    // so bands the input rate can't hold disable the processor until they're changed
+    String error;
+
+    if (!checkBands(bands, sampleRate, error))
+    {
+        CoreServices::sendStatusMessage(error);
+        return;
+    }
+
+    const int numBands = bands.size();
+
+    if (numBands == 0)
+        return;
+
+    float maxHigh = 0;
+
+    for (int b = 0; b < numBands; b++)
+        maxHigh = jmax(maxHigh, bands[b].high);
+
+    // three samples per cycle of the highest band edge keep it below the low-pass corner
+    decimation = jmax(1, int(sampleRate / (3.0 * maxHigh)));
+    const double decimatedRate = sampleRate / decimation;
+
+    // fourth-order Butterworth low-pass at 0.4 of the decimated rate
+    const double q[2] = { 0.5412, 1.3066 };
+
+    for (int s = 0; s < 2; s++)
+    {
+        if (decimation == 1)
+        {
+            lowpass[s][0] = 1.0;
+            lowpass[s][1] = lowpass[s][2] = lowpass[s][3] = lowpass[s][4] = 0.0;
+            continue;
+        }
+
+        const double w0 = 2.0 * double_Pi * 0.4 * decimatedRate / sampleRate;
+        const double alpha = std::sin(w0) / (2.0 * q[s]);
+        const double a0 = 1.0 + alpha;
+
+        lowpass[s][0] = (1.0 - std::cos(w0)) / 2.0 / a0;
+        lowpass[s][1] = (1.0 - std::cos(w0)) / a0;
+        lowpass[s][2] = lowpass[s][0];
+        lowpass[s][3] = -2.0 * std::cos(w0) / a0;
+        lowpass[s][4] = (1.0 - alpha) / a0;
+    }
+
+    windowSamples = jlimit(int(MIN_WINDOW), int(MAX_WINDOW), roundToInt(windowMs * decimatedRate / 1000.0));
+    hopSamples = jmax(1, roundToInt(hopMs * decimatedRate / 1000.0));
+
+    // windows shorter than the transform are padded with zeros
+    ringSize = nextPowerOfTwo(windowSamples);
+    fft = new RealFFT(ringSize);
+
+    for (int b = 0; b < numBands; b++)
+    {
+        Band& band = bands.getReference(b);
+
+        band.firstBin = jmin(ringSize / 2, int(std::ceil(band.low * ringSize / decimatedRate)));
+        band.lastBin = jmin(ringSize / 2, int(std::floor(band.high * ringSize / decimatedRate)));
+
+        // a band narrower than a bin takes the nearest one
+        if (band.lastBin < band.firstBin)
+            band.firstBin = band.lastBin = jmin(ringSize / 2, roundToInt(0.5 * (band.low + band.high) * ringSize / decimatedRate));
+    }
+
+    window.malloc(windowSamples);
+    windowPower = 0;
+
+    for (int n = 0; n < windowSamples; n++)
+    {
+        window[n] = float(0.5 - 0.5 * std::cos(2.0 * double_Pi * n / windowSamples));
+        windowPower += window[n] * window[n];
+    }
+
+    ring.calloc(size_t(numInputs) * 2 * ringSize);
+    filterStates.calloc(4 * numInputs);
+    heldValues.calloc(numInputs * numBands);
+    bandActive.calloc(numBands);
+
+    // windowed input, transform scratch, power spectrum, band values
+    scratchPerWorker = 2 * ringSize + ringSize / 2 + 1 + numBands;
+    workerScratch.calloc(size_t(getNumThreads() + 1) * scratchPerWorker);
+
+    hopValues.setSize(numInputs * numBands, hopValues.getNumSamples());
+
+    // one low-rate channel per input channel and band, after the inputs
+    for (int i = 0; i < numInputs; i++)
+    {
+        for (int b = 0; b < numBands; b++)
+        {
+            Channel* ch = new Channel(*channels[inputChannels[i]]);
+            ch->setType(AUX_CHANNEL);
+            ch->setName(ch->getName() + " " + String(bands[b].low) + "-" + String(bands[b].high) + "Hz");
+            ch->setProcessor(this);
+            ch->nodeIndex = channels.size();
+            ch->mappedIndex = channels.size();
+            restoreChannelState(ch, channels.size());
+            channels.add(ch);
+        }
+    }
+
+    settings.numOutputs = channels.size();
+
+}
+
+
+bool BandPowerNode::enable()
+{
+    if (fft != nullptr)
+    {
+        const int numInputs = inputChannels.size();
+
+        zeromem(ring, size_t(numInputs) * 2 * ringSize * sizeof(float));
+        zeromem(filterStates, 4 * numInputs * sizeof(double));
+        zeromem(heldValues, numInputs * bands.size() * sizeof(float));
+        zeromem(bandActive, bands.size() * sizeof(bool));
+
+        pool.start(numInputs > 1 ? getNumThreads() : 0);
+    }
+
+    ringPosition = ringFill = 0;
+    decimationCount = hopCount = 0;
+
+    return true;
+}
+
+
+bool BandPowerNode::disable()
+{
+    pool.stop();
+
+    return true;
+}
+
+
+void BandPowerNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
+{
+    const int numInputs = inputChannels.size();
+    const int numBands = bands.size();
+
+    if (fft == nullptr || buffer.getNumChannels() < channels.size())
+        return;
+
+    blockSamples = getNumSamples(inputChannels[0]);
+
+    if (blockSamples <= 0)
+        return;
+
+    hopValues.setSize(numInputs * numBands, blockSamples / (decimation * hopSamples) + 1, false, false, true);
+
+    currentBuffer = &buffer;
+    pool.run(this, numInputs);
+
+    // step through the block as the tasks did, to advance the shared counters and place the events
+    int hop = 0;
+
+    for (int n = 0; n < blockSamples; n++)
+    {
+        if (++decimationCount < decimation)
+            continue;
+
+        decimationCount = 0;
+        ringPosition = (ringPosition + 1) & (ringSize - 1);
+        ringFill = jmin(ringFill + 1, ringSize);
+
+        if (++hopCount < hopSamples)
+            continue;
+
+        hopCount = 0;
+
+        if (ringFill >= windowSamples)
+        {
+            for (int b = 0; b < numBands; b++)
+            {
+                if (bands.getReference(b).threshold <= 0)
+                    continue;
+
+                float sum = 0;
+
+                for (int i = 0; i < numInputs; i++)
+                    sum += hopValues.getSample(i * numBands + b, hop);
+
+                const bool active = sum / numInputs > bands.getReference(b).threshold;
+
+                if (active != bandActive[b])
+                {
+                    bandActive[b] = active;
+                    addEvent(events, TTL, n, active ? 1 : 0, b);
+                }
+            }
+        }
+
+        hop++;
+    }
+
+}
+
+
+void BandPowerNode::runTask(int task, int worker)
+{
+    const int numBands = bands.size();
+
+    const float* samples = currentBuffer->getReadPointer(inputChannels.getUnchecked(task));
+    float* history = ring + size_t(task) * 2 * ringSize;
+    double* state = filterStates + 4 * task;
+    float* held = heldValues + task * numBands;
+    float* values = workerScratch + size_t(worker) * scratchPerWorker + 2 * ringSize + ringSize / 2 + 1;
+
+    const double* f = lowpass[0];
+    const double* g = lowpass[1];
+    double s0 = state[0], s1 = state[1], s2 = state[2], s3 = state[3];
+
+    int count = decimationCount;
+    int hops = hopCount;
+    int position = ringPosition;
+    int fill = ringFill;
+    int hop = 0;
+    int written = 0;
+
+    for (int n = 0; n < blockSamples; n++)
+    {
+        // two low-pass sections, transposed direct form II
+        const double x = samples[n];
+
+        const double y1 = f[0] * x + s0;
+        s0 = f[1] * x - f[3] * y1 + s1;
+        s1 = f[2] * x - f[4] * y1;
+
+        const double y2 = g[0] * y1 + s2;
+        s2 = g[1] * y1 - g[3] * y2 + s3;
+        s3 = g[2] * y1 - g[4] * y2;
+
+        if (++count < decimation)
+            continue;
+
+        count = 0;
+        history[position] = history[position + ringSize] = float(y2);
+        position = (position + 1) & (ringSize - 1);
+        fill = jmin(fill + 1, ringSize);
+
+        if (++hops < hopSamples)
+            continue;
+
+        hops = 0;
+
+        if (fill >= windowSamples)
+        {
+            // the newest sample is at position + ringSize - 1
+            computeBands(history + position + ringSize - windowSamples, values, worker);
+
+            for (int b = 0; b < numBands; b++)
+            {
+                float* out = currentBuffer->getWritePointer(firstOutput + task * numBands + b);
+                FloatVectorOperations::fill(out + written, held[b], n - written);
+
+                held[b] = values[b];
+                hopValues.getWritePointer(task * numBands + b)[hop] = values[b];
+            }
+
+            written = n;
+        }
+
+        hop++;
+    }
+
+    for (int b = 0; b < numBands; b++)
+    {
+        float* out = currentBuffer->getWritePointer(firstOutput + task * numBands + b);
+        FloatVectorOperations::fill(out + written, held[b], blockSamples - written);
+    }
+
+    state[0] = s0;
+    state[1] = s1;
+    state[2] = s2;
+    state[3] = s3;
+}
+
+
+void BandPowerNode::computeBands(const float* history, float* values, int worker)
+{
+    const int size = fft->getSize();
+
+    float* windowed = workerScratch + size_t(worker) * scratchPerWorker;
+    float* scratch = windowed + size;
+    float* power = scratch + size;
+
+    FloatVectorOperations::copy(windowed, history, windowSamples);
+    FloatVectorOperations::multiply(windowed, window, windowSamples);
+    FloatVectorOperations::clear(windowed + windowSamples, size - windowSamples);
+
+    fft->computePower(windowed, power, scratch);
+
+    // one-sided power over the band, relative to the window's energy: the band's mean square
+    const float scale = 2.0f / (float(size) * windowPower);
+
+    for (int b = 0; b < bands.size(); b++)
+    {
+        const Band& band = bands.getReference(b);
+        float sum = 0;
+
+        for (int k = band.firstBin; k <= band.lastBin; k++)
+            sum += power[k];
+
+        values[b] = std::sqrt(sum * scale);
+    }
+}
+
+
+void BandPowerNode::saveCustomParametersToXml(XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement("BANDPOWER");
+    mainNode->setAttribute("bands", bandsText);
+    mainNode->setAttribute("window", windowMs);
+    mainNode->setAttribute("hop", hopMs);
+}
+
+
+void BandPowerNode::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement(*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName("BANDPOWER"))
+            {
+                String error;
+
+                if (!setBands(mainNode->getStringAttribute("bands", bandsText), error))
+                    CoreServices::sendStatusMessage(error);
+                setWindowMs(float(mainNode->getDoubleAttribute("window", windowMs)));
+                setHopMs(float(mainNode->getDoubleAttribute("hop", hopMs)));
+            }
+        }
+
+        // the band channels depend on these
+        update();
+    }
+}
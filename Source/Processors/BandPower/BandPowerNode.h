@@ -0,0 +1,173 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef BANDPOWERNODE_H_INCLUDED
+#define BANDPOWERNODE_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/GenericProcessor.h"
+#include "RealFFT.h"
+#include "WorkerPool.h"
+
+/**
+
+  Computes the power of every neural channel in a few frequency bands, for
+  decoders that run inside the GUI.
+
+  Bands are given as text, e.g. "4-8, 30-80, 70-150:20". Each channel is low-pass
+  filtered and decimated to a rate of at least three times the highest band edge,
+  and the decimated samples go into a ring. Every hop, the last window of the
+  ring is Hann-windowed and transformed (see RealFFT), and the power in each band
+  is summed. The ring is written twice, one ring length apart, so that the last
+  window is always a contiguous run of memory.
+
+  Results are added as extra channels after the inputs, one per channel and band,
+  holding the band's RMS amplitude in microvolts from the sample where each hop
+  ends until the next one. A band with a threshold (":20" above) also sends a TTL
+  event on the event channel of its number when the mean over channels rises above
+  the threshold, and an off event when it falls back.
+
+  Channels are spread over a WorkerPool, with the audio thread taking part, and
+  the block is finished before process() returns.
+
+  @see GenericProcessor, BandPowerEditor
+
+*/
+
+class BandPowerNode : public GenericProcessor,
+    public WorkerPool::Job
+{
+public:
+
+    BandPowerNode();
+    ~BandPowerNode();
+
+    AudioProcessorEditor* createEditor();
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events);
+
+    bool enable();
+    bool disable();
+
+    void updateSettings();
+
+    /** Processes one input channel of the current block. */
+    void runTask(int task, int worker) override;
+
+    /** The following settings may only be changed while acquisition is stopped,
+        and take effect at the next update. setBands() returns false, describes the
+        problem and keeps the current bands if the text can't be read or a band is
+        above the Nyquist frequency of the input. */
+    bool setBands(const String& bands, String& error);
+    String getBands() const;
+
+    void setWindowMs(float ms);
+    float getWindowMs() const;
+
+    void setHopMs(float ms);
+    float getHopMs() const;
+
+    void saveCustomParametersToXml(XmlElement* parentElement);
+    void loadCustomParametersFromXml();
+
+private:
+
+    struct Band
+    {
+        float low;
+        float high;
+        float threshold;
+        int firstBin;
+        int lastBin;
+    };
+
+    static bool parseBands(const String& text, Array<Band>& result);
+
+    /** Returns false and describes the first band above the Nyquist frequency. */
+    static bool checkBands(const Array<Band>& bands, double sampleRate, String& error);
+
+    /** The sample rate of the first neural input channel, or 0 if there is none. */
+    double getInputSampleRate() const;
+
+    int getNumThreads() const;
+
+    /** Windows and transforms the last windowSamples of a channel's history and
+        writes the RMS of each band into values. */
+    void computeBands(const float* history, float* values, int worker);
+
+    enum
+    {
+        MAX_BANDS = 16,
+        MIN_WINDOW = 16,
+        MAX_WINDOW = 16384
+    };
+
+    String bandsText;
+    float windowMs;
+    float hopMs;
+
+    Array<Band> bands;
+    Array<int> inputChannels;
+    int firstOutput;
+
+    int decimation;
+    int windowSamples;
+    int hopSamples;
+
+    /** Two low-pass biquads (b0, b1, b2, a1, a2) against aliasing when decimating */
+    double lowpass[2][5];
+
+    ScopedPointer<RealFFT> fft;
+    HeapBlock<float> window;
+    float windowPower;
+
+    /** Per channel: 2 * ringSize decimated samples, the filter states and the band values held */
+    HeapBlock<float> ring;
+    int ringSize;
+    HeapBlock<double> filterStates;
+    HeapBlock<float> heldValues;
+
+    /** All channels are decimated in step, so these are shared */
+    int ringPosition;
+    int ringFill;
+    int decimationCount;
+    int hopCount;
+
+    /** The block being processed, for runTask() */
+    AudioSampleBuffer* currentBuffer;
+    int blockSamples;
+
+    /** Band values at every hop of the block, one row per channel and band */
+    AudioSampleBuffer hopValues;
+    HeapBlock<bool> bandActive;
+
+    WorkerPool pool;
+    HeapBlock<float> workerScratch;
+    int scratchPerWorker;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BandPowerNode);
+
+};
+
+
+#endif  // BANDPOWERNODE_H_INCLUDED
@@ -0,0 +1,139 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RealFFT.h"
+
+
+RealFFT::RealFFT(int size_)
+    : size(size_)
+{
+    jassert(isPowerOfTwo(size) && size >= 4);
+
+    const int half = size / 2;
+
+    bitReversed.malloc(half);
+
+    int bits = 0;
+
+    while ((1 << bits) < half)
+        bits++;
+
+    for (int i = 0; i < half; i++)
+    {
+        int reversed = 0;
+
+        for (int b = 0; b < bits; b++)
+        {
+            if (i & (1 << b))
+                reversed |= 1 << (bits - 1 - b);
+        }
+
+        bitReversed[i] = reversed;
+    }
+
+    cosTable.malloc(half + 1);
+    sinTable.malloc(half + 1);
+
+    for (int k = 0; k <= half; k++)
+    {
+        cosTable[k] = float(std::cos(2.0 * double_Pi * k / size));
+        sinTable[k] = float(std::sin(2.0 * double_Pi * k / size));
+    }
+}
+
+
+RealFFT::~RealFFT()
+{
+
+}
+
+
+int RealFFT::getSize() const
+{
+    return size;
+}
+
+
+void RealFFT::computePower(const float* input, float* power, float* scratch) const
+{
+    const int half = size / 2;
+
+    // pairs of samples become complex values, in bit-reversed order
+    for (int m = 0; m < half; m++)
+    {
+        const int j = bitReversed[m];
+        scratch[2 * j] = input[2 * m];
+        scratch[2 * j + 1] = input[2 * m + 1];
+    }
+
+    // complex transform of size half; its twiddles are every other entry of the tables
+    for (int length = 2; length <= half; length *= 2)
+    {
+        const int step = 2 * (half / length);
+
+        for (int start = 0; start < half; start += length)
+        {
+            for (int j = 0; j < length / 2; j++)
+            {
+                const float wr = cosTable[j * step];
+                const float wi = -sinTable[j * step];
+
+                float* a = scratch + 2 * (start + j);
+                float* b = scratch + 2 * (start + j + length / 2);
+
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+
+    // separate the transforms of the even and odd samples and combine them
+    for (int k = 0; k <= half; k++)
+    {
+        const int i = (k == half) ? 0 : k;
+        const int c = (k == 0) ? 0 : half - k;
+
+        const float zr = scratch[2 * i];
+        const float zi = scratch[2 * i + 1];
+        const float cr = scratch[2 * c];
+        const float ci = -scratch[2 * c + 1];
+
+        const float evenRe = 0.5f * (zr + cr);
+        const float evenIm = 0.5f * (zi + ci);
+        const float oddRe = 0.5f * (zi - ci);
+        const float oddIm = -0.5f * (zr - cr);
+
+        const float wr = cosTable[k];
+        const float wi = -sinTable[k];
+
+        const float xr = evenRe + oddRe * wr - oddIm * wi;
+        const float xi = evenIm + oddRe * wi + oddIm * wr;
+
+        power[k] = xr * xr + xi * xi;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef REALFFT_H_INCLUDED
+#define REALFFT_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Power spectrum of a block of real samples, by a radix-2 FFT.
+
+  The size samples are packed into size / 2 complex values (even samples as the
+  real parts, odd ones as the imaginary parts), transformed, and split back into
+  the spectrum of the real signal, which halves the work of a complex transform.
+  The tables are built once; computePower() only touches the scratch memory it is
+  given, so one RealFFT can be shared by several threads.
+
+  @see BandPowerNode
+
+*/
+
+class RealFFT
+{
+public:
+    /** size must be a power of two, at least 4. */
+    RealFFT(int size);
+    ~RealFFT();
+
+    int getSize() const;
+
+    /** Writes |X[k]|^2 for k = 0 to size / 2 into power; scratch must hold size floats. */
+    void computePower(const float* input, float* power, float* scratch) const;
+
+private:
+
+    const int size;
+
+    HeapBlock<int> bitReversed;
+
+    /** cos and sin of 2 pi k / size, for k = 0 to size / 2 */
+    HeapBlock<float> cosTable;
+    HeapBlock<float> sinTable;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealFFT);
+
+};
+
+
+#endif  // REALFFT_H_INCLUDED
@@ -0,0 +1,137 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "WorkerPool.h"
+
+
+WorkerPool::Worker::Worker(WorkerPool& p, int i)
+    : Thread("Worker " + String(i)), pool(p), index(i)
+{
+
+}
+
+
+void WorkerPool::Worker::run()
+{
+    while (!threadShouldExit())
+    {
+        // the audio thread doesn't wake the workers, as that takes a lock
+        if (!pool.work(index))
+            wait(POLL_MS);
+    }
+}
+
+
+WorkerPool::WorkerPool()
+    : generation(0), currentJob(nullptr)
+{
+    state = 0;
+    numDone = 0;
+}
+
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+
+void WorkerPool::start(int numThreads)
+{
+    stop();
+
+    for (int i = 0; i < numThreads; i++)
+    {
+        Worker* worker = new Worker(*this, i + 1);
+        workers.add(worker);
+        worker->startThread(8);
+    }
+}
+
+
+void WorkerPool::stop()
+{
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i]->signalThreadShouldExit();
+        workers[i]->notify();
+    }
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->stopThread(1000);
+
+    workers.clear();
+}
+
+
+int WorkerPool::getNumWorkers() const
+{
+    return workers.size() + 1;
+}
+
+
+void WorkerPool::run(Job* job, int tasks)
+{
+    if (tasks <= 0)
+        return;
+
+    jassert(tasks <= MAX_TASKS);
+
+    currentJob = job;
+    numDone = 0;
+
+    // every field is set before the job is published
+    Atomic<uint64>::memoryBarrier();
+    generation++;
+    state = (uint64(generation) << 32) | (uint64(tasks) << 16);
+
+    work(0);
+
+    // only tasks a worker has already started are left
+    while (numDone.get() < tasks)
+        Thread::yield();
+}
+
+
+bool WorkerPool::work(int worker)
+{
+    bool worked = false;
+
+    for (;;)
+    {
+        const uint64 current = state.get();
+        const int numTasks = int((current >> 16) & MAX_TASKS);
+        const int task = int(current & MAX_TASKS);
+
+        if (task >= numTasks)
+            return worked;
+
+        if (!state.compareAndSetBool(current + 1, current))
+            continue;
+
+        // the job can't finish, so it can't be replaced, until this task is done
+        currentJob->runTask(task, worker);
+        ++numDone;
+        worked = true;
+    }
+}
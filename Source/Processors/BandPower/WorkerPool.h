@@ -0,0 +1,117 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef WORKERPOOL_H_INCLUDED
+#define WORKERPOOL_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  A fixed set of threads that help the audio thread get through one block.
+
+  run() hands out the tasks of a job one at a time to the workers and to the
+  calling thread, and returns once every task has finished, so the caller can
+  use the results within the same block.
+
+  The caller never locks or allocates: run() only publishes the job through an
+  atomic, without waking anyone, and the workers poll for it, sleeping at most
+  POLL_MS in between. Tasks no worker has claimed are done by the caller itself,
+  so a job never waits for a worker to be scheduled; at the end the caller only
+  yields until the tasks that workers have already started are finished.
+
+  @see BandPowerNode
+
+*/
+
+class WorkerPool
+{
+public:
+
+    class Job
+    {
+    public:
+        virtual ~Job() {}
+
+        /** Called once for every task; worker is 0 for the calling thread and
+            from 1 to getNumWorkers() - 1 for the pool's threads. */
+        virtual void runTask(int task, int worker) = 0;
+    };
+
+    WorkerPool();
+    ~WorkerPool();
+
+    /** Starts numThreads threads; called when acquisition starts. */
+    void start(int numThreads);
+
+    /** Stops the threads; called when acquisition stops. */
+    void stop();
+
+    /** Threads that take part in run(), the caller included */
+    int getNumWorkers() const;
+
+    /** Runs tasks 0 to numTasks - 1 of job and waits for them to finish. */
+    void run(Job* job, int numTasks);
+
+    enum
+    {
+        /** The longest an idle worker sleeps before looking for a job */
+        POLL_MS = 1,
+
+        MAX_TASKS = 0xffff
+    };
+
+private:
+
+    class Worker : public Thread
+    {
+    public:
+        Worker(WorkerPool& pool, int index);
+
+        void run() override;
+
+    private:
+        WorkerPool& pool;
+        const int index;
+    };
+
+    /** Runs tasks of the current job until none is left; returns false if there was none. */
+    bool work(int worker);
+
+    OwnedArray<Worker> workers;
+
+    /** The job's generation (high 32 bits), number of tasks and next task (16 bits each),
+        so that a worker can only claim a task of the job it read */
+    Atomic<uint64> state;
+    uint32 generation;
+
+    /** Only read by a worker that holds a claimed task, so they can't change under it */
+    Job* volatile currentJob;
+    Atomic<int> numDone;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WorkerPool);
+
+};
+
+
+#endif  // WORKERPOOL_H_INCLUDED
@@ -55,6 +55,7 @@ void CAR::setParameter(int parameterIndex, float newValue)
     {
         Parameter& p =  parameters.getReference(parameterIndex);
         p.setValue(newValue, currentChannel);
+        parameterStore.setValue(parameterIndex, currentChannel, float(p[currentChannel]));
     }
 }
 
@@ -63,7 +64,14 @@ void CAR::process(AudioSampleBuffer& buffer,
 {
 	int nChannels = buffer.getNumChannels();
 
-    float gain = -1.0f * float(getParameterVar(0, 0)) / 100.0f; // just use channel 0, since we can't have individual channel settings at the moment
+    const ParameterStore::Block* params = parameterStore.acquire();
+
+    // just use channel 0, since we can't have individual channel settings at the moment;
+    // a change of gain is ramped over the buffer to avoid a step
+    float startGain, endGain;
+    parameterStore.getRamp(params, 0, 0, startGain, endGain);
+    startGain *= -0.01f;
+    endGain *= -0.01f;
 
     avgBuffer.clear();
 
@@ -82,13 +90,12 @@ void CAR::process(AudioSampleBuffer& buffer,
 
     for (int j = 0; j < nChannels; j++)
     {
-        buffer.addFrom(j,           // destChannel 
-                       0,           // destStartSample
-                       avgBuffer,   // source
-                       0,           // sourceChannel
-                       0,           // sourceStartSample
-                       buffer.getNumSamples(), // numSamples
-                       gain); // gain to apply            
+        buffer.addFromWithRamp(j,           // destChannel
+                               0,           // destStartSample
+                               avgBuffer.getReadPointer(0), // source
+                               buffer.getNumSamples(), // numSamples
+                               startGain,   // gain at the first sample
+                               endGain);    // gain at the last sample
     }
 
 }
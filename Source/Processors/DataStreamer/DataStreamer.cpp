@@ -0,0 +1,608 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DataStreamer.h"
+#include "DataStreamerEditor.h"
+#include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
+
+#ifdef ZEROMQ
+#ifdef WIN32
+#include "../../../Resources/windows-libs/ZeroMQ/include/zmq.h"
+#else
+#include <zmq.h>
+#endif
+#endif
+
+#ifndef WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+/** Number of preallocated frames, and the maximum samples per channel in one frame. */
+#define NUM_FRAME_SLOTS 32
+#define MAX_FRAME_SAMPLES 1024
+
+
+DataStreamer::DataStreamer()
+    : GenericProcessor("Data Streamer"),
+      Thread("Data Streamer"),
+      transport(ZMQ_TRANSPORT),
+      zmqEndpoint("tcp://*:5558"),
+      socketPath("/tmp/open-ephys-stream"),
+      sampleFormat(FLOAT32_FORMAT),
+      decimation(1),
+      decimationPhase(0),
+      filteredBlock(1, 1024),
+      frameFifo(NUM_FRAME_SLOTS),
+      slotSize(0),
+      channelTableSize(0),
+      frameNumber(0),
+      zmqContext(nullptr),
+      zmqSocket(nullptr),
+      listenSocket(-1)
+{
+#ifdef ZEROMQ
+    zmqContext = zmq_ctx_new();
+#else
+    transport = UNIX_SOCKET_TRANSPORT;
+#endif
+}
+
+
+DataStreamer::~DataStreamer()
+{
+    stopThread(1000);
+    closeTransport();
+
+#ifdef ZEROMQ
+    if (zmqContext != nullptr)
+        zmq_ctx_destroy(zmqContext);
+#endif
+}
+
+
+AudioProcessorEditor* DataStreamer::createEditor()
+{
+    editor = new DataStreamerEditor(this, true);
+    return editor;
+}
+
+
+void DataStreamer::setTransport(int t)
+{
+    transport = t;
+}
+
+
+int DataStreamer::getTransport() const
+{
+    return transport;
+}
+
+
+void DataStreamer::setEndpoint(int t, const String& endpoint)
+{
+    if (t == ZMQ_TRANSPORT)
+        zmqEndpoint = endpoint;
+    else
+        socketPath = endpoint;
+}
+
+
+String DataStreamer::getEndpoint(int t) const
+{
+    return (t == ZMQ_TRANSPORT) ? zmqEndpoint : socketPath;
+}
+
+
+void DataStreamer::setSampleFormat(int format)
+{
+    sampleFormat = format;
+}
+
+
+int DataStreamer::getSampleFormat() const
+{
+    return sampleFormat;
+}
+
+
+void DataStreamer::setDecimation(int factor)
+{
+    decimation = jlimit(1, 1000, factor);
+}
+
+
+int DataStreamer::getDecimation() const
+{
+    return decimation;
+}
+
+
+int DataStreamer::getNumDroppedFrames() const
+{
+    return droppedFrames.get();
+}
+
+
+bool DataStreamer::enable()
+{
+    streamedChannels.clear();
+
+    Array<int> selected = getEditor()->getActiveChannels();
+
+    for (int i = 0; i < selected.size(); i++)
+    {
+        if (selected[i] < getNumInputs())
+            streamedChannels.add(selected[i]);
+    }
+
+    if (streamedChannels.size() == 0)
+        std::cout << "Data Streamer: no channels selected." << std::endl;
+
+    const int numChannels = streamedChannels.size();
+
+    // bitVolts table, then channel indices padded to a multiple of 4 bytes
+    channelTableSize = numChannels * 4 + ((numChannels * 2 + 3) & ~3);
+    slotSize = FRAME_HEADER_SIZE + channelTableSize + numChannels * MAX_FRAME_SAMPLES * sizeof(float);
+    slotSize = (slotSize + 7) & ~7;
+
+    frameSlots.allocate(slotSize * NUM_FRAME_SLOTS, true);
+    frameSizes.allocate(NUM_FRAME_SLOTS, true);
+
+    // the channel table is identical in every frame, so write it once per slot
+    for (int slot = 0; slot < NUM_FRAME_SLOTS; slot++)
+    {
+        uint8* table = frameSlots + slot * slotSize + FRAME_HEADER_SIZE;
+
+        for (int i = 0; i < numChannels; i++)
+        {
+            float bitVolts = channels[streamedChannels[i]]->bitVolts;
+            uint16 index = (uint16) streamedChannels[i];
+
+            memcpy(table + i * 4, &bitVolts, sizeof(bitVolts));
+            memcpy(table + numChannels * 4 + i * 2, &index, sizeof(index));
+        }
+    }
+
+    // fourth-order Butterworth low-pass at 0.4 of the decimated rate
+    const double q[2] = { 0.5412, 1.3066 };
+
+    for (int s = 0; s < 2; s++)
+    {
+        const double w0 = 2.0 * double_Pi * 0.4 / decimation;
+        const double alpha = std::sin(w0) / (2.0 * q[s]);
+        const double a0 = 1.0 + alpha;
+
+        lowpass[s][0] = (1.0 - std::cos(w0)) / 2.0 / a0;
+        lowpass[s][1] = (1.0 - std::cos(w0)) / a0;
+        lowpass[s][2] = lowpass[s][0];
+        lowpass[s][3] = -2.0 * std::cos(w0) / a0;
+        lowpass[s][4] = (1.0 - alpha) / a0;
+    }
+
+    filterStates.calloc(4 * jmax(1, numChannels));
+    sourceData.calloc(jmax(1, numChannels));
+
+    int maxBlock = filteredBlock.getNumSamples();
+
+    if (AccessClass::getAudioComponent() != nullptr)
+        maxBlock = jmax(maxBlock, AccessClass::getAudioComponent()->getBufferSize());
+
+    filteredBlock.setSize(jmax(1, numChannels), maxBlock);
+
+    frameFifo.reset();
+    decimationPhase = 0;
+    frameNumber = 0;
+    droppedFrames = 0;
+
+    if (!openTransport())
+        CoreServices::sendStatusMessage("Data Streamer could not open " + getEndpoint(transport));
+
+    startThread();
+
+    return true;
+}
+
+
+bool DataStreamer::disable()
+{
+    stopThread(1000);
+    closeTransport();
+
+    return true;
+}
+
+
+void DataStreamer::process(AudioSampleBuffer& buffer, MidiBuffer& events)
+{
+    if (streamedChannels.size() == 0)
+        return;
+
+    const int nSamples = getNumSamples(streamedChannels[0]);
+    const int64 blockTimestamp = getTimestamp(streamedChannels[0]);
+
+    if (decimation > 1)
+    {
+        lowPassBlock(buffer, nSamples);
+    }
+    else
+    {
+        for (int i = 0; i < streamedChannels.size(); i++)
+            sourceData[i] = buffer.getReadPointer(streamedChannels[i]);
+    }
+
+    int firstSample = decimationPhase;
+    int numOutputSamples = 0;
+
+    if (firstSample < nSamples)
+        numOutputSamples = (nSamples - firstSample + decimation - 1) / decimation;
+
+    // carry the decimation phase over to the next block
+    decimationPhase = firstSample + numOutputSamples * decimation - nSamples;
+
+    while (numOutputSamples > 0)
+    {
+        const int numInFrame = jmin(numOutputSamples, MAX_FRAME_SAMPLES);
+
+        queueFrame(firstSample, numInFrame, blockTimestamp + firstSample);
+
+        firstSample += numInFrame * decimation;
+        numOutputSamples -= numInFrame;
+    }
+}
+
+
+void DataStreamer::lowPassBlock(AudioSampleBuffer& buffer, int nSamples)
+{
+    // only a block longer than the device's buffer size makes this grow
+    if (nSamples > filteredBlock.getNumSamples())
+        filteredBlock.setSize(filteredBlock.getNumChannels(), nSamples, false, false, true);
+
+    const double* f = lowpass[0];
+    const double* g = lowpass[1];
+
+    for (int i = 0; i < streamedChannels.size(); i++)
+    {
+        const float* samples = buffer.getReadPointer(streamedChannels[i]);
+        float* filtered = filteredBlock.getWritePointer(i);
+        double* state = filterStates + 4 * i;
+        double s0 = state[0], s1 = state[1], s2 = state[2], s3 = state[3];
+
+        for (int n = 0; n < nSamples; n++)
+        {
+            // two low-pass sections, transposed direct form II
+            const double x = samples[n];
+
+            const double y1 = f[0] * x + s0;
+            s0 = f[1] * x - f[3] * y1 + s1;
+            s1 = f[2] * x - f[4] * y1;
+
+            const double y2 = g[0] * y1 + s2;
+            s2 = g[1] * y1 - g[3] * y2 + s3;
+            s3 = g[2] * y1 - g[4] * y2;
+
+            filtered[n] = float(y2);
+        }
+
+        state[0] = s0;
+        state[1] = s1;
+        state[2] = s2;
+        state[3] = s3;
+
+        sourceData[i] = filtered;
+    }
+}
+
+
+void DataStreamer::queueFrame(int firstSample, int numOutputSamples, int64 timestamp)
+{
+    int start1, size1, start2, size2;
+    frameFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        ++droppedFrames;
+        return;
+    }
+
+    uint8* frame = frameSlots + start1 * slotSize;
+    const int numChannels = streamedChannels.size();
+
+    const uint16 version = FRAME_VERSION;
+    const uint16 format = (uint16) sampleFormat;
+    const uint16 nChans = (uint16) numChannels;
+    const uint16 nSamps = (uint16) numOutputSamples;
+    const float sampleRate = getSampleRate() / float(decimation);
+    const uint16 decim = (uint16) decimation;
+    const uint16 reserved = 0;
+
+    memcpy(frame, "OECD", 4);
+    memcpy(frame + 4, &version, 2);
+    memcpy(frame + 6, &format, 2);
+    memcpy(frame + 8, &nChans, 2);
+    memcpy(frame + 10, &nSamps, 2);
+    memcpy(frame + 12, &frameNumber, 4);
+    memcpy(frame + 16, &timestamp, 8);
+    memcpy(frame + 24, &sampleRate, 4);
+    memcpy(frame + 28, &decim, 2);
+    memcpy(frame + 30, &reserved, 2);
+
+    uint8* data = frame + FRAME_HEADER_SIZE + channelTableSize;
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        const int chan = streamedChannels[i];
+        const float* src = sourceData[i] + firstSample;
+
+        if (sampleFormat == FLOAT32_FORMAT)
+        {
+            float* dest = reinterpret_cast<float*>(data) + i * numOutputSamples;
+
+            if (decimation == 1)
+            {
+                memcpy(dest, src, numOutputSamples * sizeof(float));
+            }
+            else
+            {
+                for (int n = 0; n < numOutputSamples; n++)
+                    dest[n] = src[n * decimation];
+            }
+        }
+        else
+        {
+            int16* dest = reinterpret_cast<int16*>(data) + i * numOutputSamples;
+            const float scale = 1.0f / channels[chan]->bitVolts;
+
+            for (int n = 0; n < numOutputSamples; n++)
+            {
+                const float v = src[n * decimation] * scale;
+                dest[n] = (int16) roundToInt(jlimit(-32768.0f, 32767.0f, v));
+            }
+        }
+    }
+
+    const int bytesPerSample = (sampleFormat == FLOAT32_FORMAT) ? 4 : 2;
+    frameSizes[start1] = FRAME_HEADER_SIZE + channelTableSize + numChannels * numOutputSamples * bytesPerSample;
+
+    frameNumber++;
+    frameFifo.finishedWrite(1);
+}
+
+
+void DataStreamer::run()
+{
+    while (!threadShouldExit())
+    {
+        acceptClients();
+
+        while (frameFifo.getNumReady() > 0)
+        {
+            int start1, size1, start2, size2;
+            frameFifo.prepareToRead(1, start1, size1, start2, size2);
+
+            sendFrame(frameSlots + start1 * slotSize, frameSizes[start1]);
+
+            frameFifo.finishedRead(1);
+        }
+
+        wait(1);
+    }
+}
+
+
+bool DataStreamer::openTransport()
+{
+    closeTransport();
+
+    if (transport == ZMQ_TRANSPORT)
+    {
+#ifdef ZEROMQ
+        zmqSocket = zmq_socket(zmqContext, ZMQ_PUB);
+
+        if (zmqSocket == nullptr)
+        {
+            std::cout << "Failed to create socket: " << zmq_strerror(zmq_errno()) << std::endl;
+            return false;
+        }
+
+        if (0 != zmq_bind(zmqSocket, zmqEndpoint.toRawUTF8()))
+        {
+            std::cout << "Failed to open socket: " << zmq_strerror(zmq_errno()) << std::endl;
+            zmq_close(zmqSocket);
+            zmqSocket = nullptr;
+            return false;
+        }
+
+        return true;
+#endif
+    }
+    else if (transport == UNIX_SOCKET_TRANSPORT)
+    {
+#ifndef WIN32
+        struct sockaddr_un address;
+
+        if (socketPath.getNumBytesAsUTF8() >= sizeof(address.sun_path))
+        {
+            std::cout << "Socket path is too long: " << socketPath << std::endl;
+            return false;
+        }
+
+        listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (listenSocket < 0)
+        {
+            std::cout << "Failed to create socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, socketPath.toRawUTF8());
+
+        unlink(address.sun_path);
+
+        if (bind(listenSocket, (struct sockaddr*) &address, sizeof(address)) != 0 ||
+            listen(listenSocket, 4) != 0)
+        {
+            std::cout << "Failed to open socket: " << strerror(errno) << std::endl;
+            close(listenSocket);
+            listenSocket = -1;
+            return false;
+        }
+
+        // new clients are picked up by the sending thread without blocking
+        fcntl(listenSocket, F_SETFL, fcntl(listenSocket, F_GETFL) | O_NONBLOCK);
+
+        return true;
+#endif
+    }
+
+    return false;
+}
+
+
+void DataStreamer::closeTransport()
+{
+#ifdef ZEROMQ
+    if (zmqSocket != nullptr)
+    {
+        zmq_close(zmqSocket);
+        zmqSocket = nullptr;
+    }
+#endif
+
+#ifndef WIN32
+    for (int i = 0; i < clientSockets.size(); i++)
+        close(clientSockets[i]);
+
+    clientSockets.clear();
+
+    if (listenSocket >= 0)
+    {
+        close(listenSocket);
+        listenSocket = -1;
+        unlink(socketPath.toRawUTF8());
+    }
+#endif
+}
+
+
+void DataStreamer::acceptClients()
+{
+#ifndef WIN32
+    if (listenSocket < 0)
+        return;
+
+    int client;
+
+    while ((client = accept(listenSocket, nullptr, nullptr)) >= 0)
+    {
+        // a client that stops reading is dropped instead of stalling the stream
+        struct timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 100000;
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+#ifdef SO_NOSIGPIPE
+        int noSigPipe = 1;
+        setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+        clientSockets.add(client);
+    }
+#endif
+}
+
+
+void DataStreamer::sendFrame(const uint8* data, int numBytes)
+{
+#ifdef ZEROMQ
+    if (zmqSocket != nullptr)
+    {
+        if (-1 == zmq_send(zmqSocket, data, numBytes, 0))
+            std::cout << "Failed to send frame: " << zmq_strerror(zmq_errno()) << std::endl;
+    }
+#endif
+
+#ifndef WIN32
+    for (int i = clientSockets.size(); --i >= 0;)
+    {
+        int sent = 0;
+
+        while (sent < numBytes)
+        {
+            ssize_t n = send(clientSockets[i], data + sent, numBytes - sent, MSG_NOSIGNAL);
+
+            if (n <= 0)
+                break;
+
+            sent += (int) n;
+        }
+
+        if (sent < numBytes)
+        {
+            close(clientSockets[i]);
+            clientSockets.remove(i);
+        }
+    }
+#endif
+}
+
+
+void DataStreamer::saveCustomParametersToXml(XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement("DATASTREAMER");
+    mainNode->setAttribute("transport", transport);
+    mainNode->setAttribute("zmqEndpoint", zmqEndpoint);
+    mainNode->setAttribute("socketPath", socketPath);
+    mainNode->setAttribute("format", sampleFormat);
+    mainNode->setAttribute("decimation", decimation);
+}
+
+
+void DataStreamer::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement(*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName("DATASTREAMER"))
+            {
+                setTransport(mainNode->getIntAttribute("transport", transport));
+                setEndpoint(ZMQ_TRANSPORT, mainNode->getStringAttribute("zmqEndpoint", zmqEndpoint));
+                setEndpoint(UNIX_SOCKET_TRANSPORT, mainNode->getStringAttribute("socketPath", socketPath));
+                setSampleFormat(mainNode->getIntAttribute("format", sampleFormat));
+                setDecimation(mainNode->getIntAttribute("decimation", decimation));
+            }
+        }
+    }
+}
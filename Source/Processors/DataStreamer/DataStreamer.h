@@ -0,0 +1,183 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DATASTREAMER_H_INCLUDED
+#define DATASTREAMER_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/GenericProcessor.h"
+
+/**
+
+  Streams continuous data out of the signal chain in real time.
+
+  The channels selected in the editor's channel selector are copied (optionally
+  decimated and converted to int16) into a pool of preallocated frames inside
+  process(). Before decimating, each channel goes through a fourth-order
+  Butterworth low-pass at 0.4 of the decimated rate, so that the stream isn't
+  aliased; the graph's own buffer is left untouched. A background thread publishes the frames either on a ZeroMQ PUB
+  socket or to every client connected to a Unix domain stream socket.
+
+  Place the streamer after a filter for filtered data, or after a Splitter
+  directly behind the source for raw data.
+
+  Every frame is self-describing and uses the following little-endian layout:
+
+    Frame header (32 bytes)
+      char    magic[4]      "OECD"
+      uint16  version       currently 1
+      uint16  sampleFormat  0 = int16, 1 = float32
+      uint16  numChannels
+      uint16  numSamples    samples per channel in this frame
+      uint32  frameNumber   incremented for every frame since acquisition started
+      int64   timestamp     source sample number of the first sample in the frame
+      float32 sampleRate    rate of the samples in this frame (source rate / decimation)
+      uint16  decimation
+      uint16  reserved
+
+    float32 bitVolts[numChannels]      microvolts per int16 step for each channel
+    uint16  channelIndex[numChannels]  index of each channel in the streamer's input,
+                                       followed by 2 zero bytes if numChannels is odd
+
+    Sample data, channel-major:  numChannels blocks of numSamples int16 or float32
+    values (in microvolts for float32, in bitVolts steps for int16).
+
+  On a Unix socket, frames are written back to back on the stream; readers can use
+  the header to determine the size of each frame.
+
+  @see GenericProcessor, EventBroadcaster
+
+*/
+
+class DataStreamer : public GenericProcessor, public Thread
+{
+public:
+
+    DataStreamer();
+    ~DataStreamer();
+
+    AudioProcessorEditor* createEditor();
+
+    bool isSink()
+    {
+        return true;
+    }
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events);
+
+    bool enable();
+    bool disable();
+
+    /** Publishing thread: sends queued frames and accepts new socket clients. */
+    void run();
+
+    enum Transport
+    {
+        ZMQ_TRANSPORT = 0,
+        UNIX_SOCKET_TRANSPORT = 1
+    };
+
+    enum SampleFormat
+    {
+        INT16_FORMAT = 0,
+        FLOAT32_FORMAT = 1
+    };
+
+    /** The following settings may only be changed while acquisition is stopped. */
+    void setTransport(int transport);
+    int getTransport() const;
+
+    /** ZeroMQ endpoint (e.g. "tcp://0.0.0.0:5558") or Unix socket path, depending on the transport. */
+    void setEndpoint(int transport, const String& endpoint);
+    String getEndpoint(int transport) const;
+
+    void setSampleFormat(int format);
+    int getSampleFormat() const;
+
+    void setDecimation(int factor);
+    int getDecimation() const;
+
+    /** Returns the number of frames dropped because the sending thread fell behind. */
+    int getNumDroppedFrames() const;
+
+    void saveCustomParametersToXml(XmlElement* parentElement);
+    void loadCustomParametersFromXml();
+
+    enum
+    {
+        FRAME_HEADER_SIZE = 32,
+        FRAME_VERSION = 1
+    };
+
+private:
+
+    /** Copies (and decimates) up to one frame's worth of samples into a free slot. */
+    void queueFrame(int firstSample, int numOutputSamples, int64 timestamp);
+
+    /** Runs the anti-aliasing low-pass over a block of every streamed channel into filteredBlock. */
+    void lowPassBlock(AudioSampleBuffer& buffer, int nSamples);
+
+    bool openTransport();
+    void closeTransport();
+    void acceptClients();
+    void sendFrame(const uint8* data, int numBytes);
+
+    int transport;
+    String zmqEndpoint;
+    String socketPath;
+    int sampleFormat;
+    int decimation;
+
+    /** Input channels being streamed, fixed at the start of acquisition. */
+    Array<int> streamedChannels;
+
+    /** Offset of the next decimated sample within the next incoming block. */
+    int decimationPhase;
+
+    /** Two low-pass biquads (b0, b1, b2, a1, a2) against aliasing when decimating */
+    double lowpass[2][5];
+
+    /** Per streamed channel: the filter states, the filtered block and where frames read from */
+    HeapBlock<double> filterStates;
+    AudioSampleBuffer filteredBlock;
+    HeapBlock<const float*> sourceData;
+
+    AbstractFifo frameFifo;
+    HeapBlock<uint8> frameSlots;
+    HeapBlock<int> frameSizes;
+    int slotSize;
+    int channelTableSize;
+    uint32 frameNumber;
+    Atomic<int> droppedFrames;
+
+    void* zmqContext;
+    void* zmqSocket;
+    int listenSocket;
+    Array<int> clientSockets;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataStreamer);
+
+};
+
+
+#endif  // DATASTREAMER_H_INCLUDED
@@ -0,0 +1,140 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DataStreamerEditor.h"
+#include "DataStreamer.h"
+
+
+DataStreamerEditor::DataStreamerEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor(parentNode, useDefaultParameterEditors)
+
+{
+    desiredWidth = 250;
+
+    DataStreamer* p = (DataStreamer*)getProcessor();
+
+    transportSelector = new ComboBox();
+    transportSelector->setBounds(10,30,110,20);
+#ifdef ZEROMQ
+    transportSelector->addItem("ZeroMQ", DataStreamer::ZMQ_TRANSPORT + 1);
+#endif
+#ifndef WIN32
+    transportSelector->addItem("Unix socket", DataStreamer::UNIX_SOCKET_TRANSPORT + 1);
+#endif
+    transportSelector->setSelectedId(p->getTransport() + 1, dontSendNotification);
+    transportSelector->addListener(this);
+    addAndMakeVisible(transportSelector);
+
+    formatSelector = new ComboBox();
+    formatSelector->setBounds(130,30,110,20);
+    formatSelector->addItem("int16", DataStreamer::INT16_FORMAT + 1);
+    formatSelector->addItem("float32", DataStreamer::FLOAT32_FORMAT + 1);
+    formatSelector->setSelectedId(p->getSampleFormat() + 1, dontSendNotification);
+    formatSelector->addListener(this);
+    addAndMakeVisible(formatSelector);
+
+    endpointLabel = new Label("Endpoint", p->getEndpoint(p->getTransport()));
+    endpointLabel->setBounds(10,60,230,18);
+    endpointLabel->setFont(Font("Default", 15, Font::plain));
+    endpointLabel->setColour(Label::textColourId, Colours::white);
+    endpointLabel->setColour(Label::backgroundColourId, Colours::grey);
+    endpointLabel->setEditable(true);
+    endpointLabel->addListener(this);
+    addAndMakeVisible(endpointLabel);
+
+    decimationTitleLabel = new Label("Decimation", "Decimation:");
+    decimationTitleLabel->setBounds(10,88,90,20);
+    addAndMakeVisible(decimationTitleLabel);
+
+    decimationLabel = new Label("Decimation", String(p->getDecimation()));
+    decimationLabel->setBounds(100,90,50,18);
+    decimationLabel->setFont(Font("Default", 15, Font::plain));
+    decimationLabel->setColour(Label::textColourId, Colours::white);
+    decimationLabel->setColour(Label::backgroundColourId, Colours::grey);
+    decimationLabel->setEditable(true);
+    decimationLabel->addListener(this);
+    addAndMakeVisible(decimationLabel);
+}
+
+
+void DataStreamerEditor::comboBoxChanged(ComboBox* comboBox)
+{
+    DataStreamer* p = (DataStreamer*)getProcessor();
+
+    if (comboBox == transportSelector)
+    {
+        p->setTransport(comboBox->getSelectedId() - 1);
+        endpointLabel->setText(p->getEndpoint(p->getTransport()), dontSendNotification);
+    }
+    else if (comboBox == formatSelector)
+    {
+        p->setSampleFormat(comboBox->getSelectedId() - 1);
+    }
+}
+
+
+void DataStreamerEditor::labelTextChanged(Label* label)
+{
+    DataStreamer* p = (DataStreamer*)getProcessor();
+
+    if (label == endpointLabel)
+    {
+        p->setEndpoint(p->getTransport(), label->getText());
+    }
+    else if (label == decimationLabel)
+    {
+        p->setDecimation(label->getText().getIntValue());
+        label->setText(String(p->getDecimation()), dontSendNotification);
+    }
+}
+
+
+void DataStreamerEditor::updateSettings()
+{
+    DataStreamer* p = (DataStreamer*)getProcessor();
+
+    transportSelector->setSelectedId(p->getTransport() + 1, dontSendNotification);
+    formatSelector->setSelectedId(p->getSampleFormat() + 1, dontSendNotification);
+    endpointLabel->setText(p->getEndpoint(p->getTransport()), dontSendNotification);
+    decimationLabel->setText(String(p->getDecimation()), dontSendNotification);
+}
+
+
+void DataStreamerEditor::startAcquisition()
+{
+    transportSelector->setEnabled(false);
+    formatSelector->setEnabled(false);
+    endpointLabel->setEnabled(false);
+    decimationLabel->setEnabled(false);
+    GenericEditor::startAcquisition();
+}
+
+
+void DataStreamerEditor::stopAcquisition()
+{
+    transportSelector->setEnabled(true);
+    formatSelector->setEnabled(true);
+    endpointLabel->setEnabled(true);
+    decimationLabel->setEnabled(true);
+    GenericEditor::stopAcquisition();
+}
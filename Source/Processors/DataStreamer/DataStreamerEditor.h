@@ -0,0 +1,68 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DATASTREAMEREDITOR_H_INCLUDED
+#define DATASTREAMEREDITOR_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Editors/GenericEditor.h"
+
+/**
+
+  User interface for the DataStreamer.
+
+  Channels to stream are chosen with the channel selector.
+
+  @see DataStreamer
+
+*/
+
+class DataStreamerEditor : public GenericEditor,
+    public ComboBox::Listener,
+    public Label::Listener
+{
+public:
+    DataStreamerEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors);
+
+    void comboBoxChanged(ComboBox* comboBox);
+    void labelTextChanged(Label* label);
+
+    void updateSettings();
+
+    void startAcquisition();
+    void stopAcquisition();
+
+private:
+
+    ScopedPointer<ComboBox> transportSelector;
+    ScopedPointer<ComboBox> formatSelector;
+    ScopedPointer<Label> endpointLabel;
+    ScopedPointer<Label> decimationTitleLabel;
+    ScopedPointer<Label> decimationLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DataStreamerEditor);
+
+};
+
+
+#endif  // DATASTREAMEREDITOR_H_INCLUDED
@@ -28,6 +28,7 @@ DataBuffer::DataBuffer(int chans, int size)
 {
     timestampBuffer.malloc(size);
     eventCodeBuffer.malloc(size);
+    ingestionBuffer.malloc(size);
 
 }
 
@@ -45,6 +46,7 @@ void DataBuffer::resize(int chans, int size)
     buffer.setSize(chans, size);
     timestampBuffer.malloc(size);
     eventCodeBuffer.malloc(size);
+    ingestionBuffer.malloc(size);
 
     numChans = chans;
 }
@@ -66,17 +68,62 @@ void DataBuffer::addToBuffer(float* data, int64* timestamps, uint64* eventCodes,
 
     *(timestampBuffer + startIndex1) = *timestamps;
     *(eventCodeBuffer + startIndex1) = *eventCodes;
+    *(ingestionBuffer + startIndex1) = Time::getHighResolutionTicks();
 
     abstractFifo.finishedWrite(numItems);
 }
 
+int DataBuffer::addToBuffer(const AudioSampleBuffer& data, int numItems, int64 firstTimestamp,
+                            const uint64* eventCodes, int64 ingestionTicks)
+{
+    int startIndex[2], blockSize[2];
+    abstractFifo.prepareToWrite(numItems, startIndex[0], blockSize[0], startIndex[1], blockSize[1]);
+
+    const int numChannels = jmin(numChans, data.getNumChannels());
+    int sourceIndex = 0;
+
+    for (int part = 0; part < 2; part++)
+    {
+        if (blockSize[part] <= 0)
+            continue;
+
+        for (int chan = 0; chan < numChannels; chan++)
+            buffer.copyFrom(chan, startIndex[part], data, chan, sourceIndex, blockSize[part]);
+
+        for (int i = 0; i < blockSize[part]; i++)
+        {
+            timestampBuffer[startIndex[part] + i] = firstTimestamp + sourceIndex + i;
+            ingestionBuffer[startIndex[part] + i] = ingestionTicks;
+        }
+
+        memcpy(eventCodeBuffer + startIndex[part], eventCodes + sourceIndex, blockSize[part] * 8);
+
+        sourceIndex += blockSize[part];
+    }
+
+    abstractFifo.finishedWrite(sourceIndex);
+
+    return sourceIndex;
+}
+
 int DataBuffer::getNumSamples()
 {
     return abstractFifo.getNumReady();
 }
 
+int DataBuffer::getFreeSpace()
+{
+    return abstractFifo.getFreeSpace();
+}
 
-int DataBuffer::readAllFromBuffer(AudioSampleBuffer& data, uint64* timestamp, uint64* eventCodes, int maxSize)
+int DataBuffer::getNumChannels() const
+{
+    return numChans;
+}
+
+
+int DataBuffer::readAllFromBuffer(AudioSampleBuffer& data, uint64* timestamp, uint64* eventCodes, int maxSize,
+                                  int64* ingestionTicks)
 {
     // check to see if the maximum size is smaller than the total number of available ints
 
@@ -106,10 +153,16 @@ int DataBuffer::readAllFromBuffer(AudioSampleBuffer& data, uint64* timestamp, ui
 
         memcpy(timestamp, timestampBuffer+startIndex1, 8);
         memcpy(eventCodes, eventCodeBuffer+startIndex1, blockSize1*8);
+
+        if (ingestionTicks != nullptr)
+            *ingestionTicks = ingestionBuffer[startIndex1];
     }
     else
     {
         memcpy(timestamp, timestampBuffer+startIndex2, 8);
+
+        if (ingestionTicks != nullptr)
+            *ingestionTicks = (blockSize2 > 0) ? ingestionBuffer[startIndex2] : 0;
     }
 
     if (blockSize2 > 0)
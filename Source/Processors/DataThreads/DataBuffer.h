@@ -47,11 +47,24 @@ public:
     /** Add an array of floats to the buffer.*/
     void addToBuffer(float* data, int64* ts, uint64* eventCodes, int numItems);
 
+    /** Adds the first numItems samples of a block with consecutive timestamps, all
+        ingested at the given tick count. Returns the number of samples that fitted.*/
+    int addToBuffer(const AudioSampleBuffer& data, int numItems, int64 firstTimestamp,
+                    const uint64* eventCodes, int64 ingestionTicks);
+
+    /** Returns the number of samples that can be added before the buffer is full.*/
+    int getFreeSpace();
+
+    int getNumChannels() const;
+
     /** Returns the number of samples currently available in the buffer.*/
     int getNumSamples();
 
-    /** Copies as many samples as possible from the DataBuffer to an AudioSampleBuffer.*/
-    int readAllFromBuffer(AudioSampleBuffer& data, uint64* ts, uint64* eventCodes, int maxSize);
+    /** Copies as many samples as possible from the DataBuffer to an AudioSampleBuffer.
+        If ingestionTicks is given, it receives the high-resolution tick count at which the
+        oldest of the copied samples was added, or 0 if nothing was copied.*/
+    int readAllFromBuffer(AudioSampleBuffer& data, uint64* ts, uint64* eventCodes, int maxSize,
+                          int64* ingestionTicks = nullptr);
 
     /** Resizes the data buffer */
     void resize(int chans, int size);
@@ -62,6 +75,7 @@ private:
 
     HeapBlock<int64> timestampBuffer;
     HeapBlock<uint64> eventCodeBuffer;
+    HeapBlock<int64> ingestionBuffer;
 
     int numChans;
 
@@ -47,7 +47,11 @@ void DataThread::run()
     while (!threadShouldExit())
     {
 
-        if (!updateBuffer())
+        if (updateBuffer())
+        {
+            sn->processInlineChain();
+        }
+        else
         {
 
             const MessageManagerLock mmLock(Thread::getCurrentThread());
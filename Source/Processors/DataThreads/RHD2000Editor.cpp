@@ -559,7 +559,7 @@ RHD2000Editor::RHD2000Editor(GenericProcessor* parentNode,
     : VisualizerEditor(parentNode, useDefaultParameterEditors), board(board_)
 {
     canvas = nullptr;
-    desiredWidth = 340;
+    desiredWidth = 410;
     tabText = "FPGA";
     measureWhenRecording = false;
     saveImpedances = false;
@@ -713,6 +713,35 @@ RHD2000Editor::RHD2000Editor(GenericProcessor* parentNode,
     dacHPFcombo->setSelectedId(1, sendNotification);
     addAndMakeVisible(dacHPFcombo);
 
+    captureButton = new UtilityButton("CAPTURE", Font("Small Text", 13, Font::plain));
+    captureButton->setRadius(3.0f);
+    captureButton->setBounds(335,25,65,18);
+    captureButton->addListener(this);
+    captureButton->setClickingTogglesState(true);
+    captureButton->setTooltip("Record raw USB blocks to a capture file");
+    addAndMakeVisible(captureButton);
+
+    replayButton = new UtilityButton("REPLAY", Font("Small Text", 13, Font::plain));
+    replayButton->setRadius(3.0f);
+    replayButton->setBounds(335,50,65,18);
+    replayButton->addListener(this);
+    replayButton->setClickingTogglesState(true);
+    replayButton->setTooltip("Acquire from a capture file instead of the board");
+    addAndMakeVisible(replayButton);
+
+    replayRealTimeButton = new UtilityButton("REAL TIME", Font("Small Text", 13, Font::plain));
+    replayRealTimeButton->setRadius(3.0f);
+    replayRealTimeButton->setBounds(335,75,65,18);
+    replayRealTimeButton->addListener(this);
+    replayRealTimeButton->setClickingTogglesState(true);
+    replayRealTimeButton->setTooltip("Replay at the recorded sample rate instead of as fast as possible");
+    replayRealTimeButton->setToggleState(board->getReplayRealTime(), dontSendNotification);
+    addAndMakeVisible(replayRealTimeButton);
+
+    usbPipelineInterface = new UsbPipelineInterface(board);
+    usbPipelineInterface->setBounds(335,98,70,28);
+    addAndMakeVisible(usbPipelineInterface);
+
 }
 
 RHD2000Editor::~RHD2000Editor()
@@ -860,6 +889,68 @@ void RHD2000Editor::buttonEvent(Button* button)
 	{
 		board->enableBoardLeds(button->getToggleState());
 	}
+    else if (button == captureButton && !acquisitionIsActive)
+    {
+        if (button->getToggleState())
+        {
+            FileChooser chooser("Capture raw USB blocks to...",
+                                File::getSpecialLocation(File::userHomeDirectory).getChildFile("rhd2000.rhdcap"),
+                                "*.rhdcap");
+
+            if (chooser.browseForFileToSave(true))
+            {
+                board->setCaptureFile(chooser.getResult());
+                button->setTooltip("Capturing to " + chooser.getResult().getFullPathName());
+            }
+            else
+            {
+                button->setToggleState(false, dontSendNotification);
+            }
+        }
+        else
+        {
+            board->setCaptureFile(File::nonexistent);
+            button->setTooltip("Record raw USB blocks to a capture file");
+        }
+    }
+    else if (button == replayButton && !acquisitionIsActive)
+    {
+        if (button->getToggleState())
+        {
+            FileChooser chooser("Replay capture file...",
+                                File::getSpecialLocation(File::userHomeDirectory),
+                                "*.rhdcap");
+
+            if (chooser.browseForFileToOpen() && board->startReplay(chooser.getResult()))
+            {
+                button->setTooltip("Replaying " + chooser.getResult().getFullPathName());
+            }
+            else
+            {
+                button->setToggleState(false, dontSendNotification);
+                CoreServices::sendStatusMessage("Could not open capture file.");
+                return;
+            }
+        }
+        else
+        {
+            board->stopReplay();
+            button->setTooltip("Acquire from a capture file instead of the board");
+        }
+
+        getProcessor()->enabledState(board->foundInputSource());
+
+        for (int i = 0; i < 4; i++)
+        {
+            headstageOptionsInterfaces[i]->checkEnabledState();
+        }
+
+        CoreServices::updateSignalChain(this);
+    }
+    else if (button == replayRealTimeButton)
+    {
+        board->setReplayRealTime(button->getToggleState());
+    }
 	else
 	{
 		VisualizerEditor::buttonEvent(button);
@@ -891,6 +982,9 @@ void RHD2000Editor::startAcquisition()
     rescanButton->setEnabledState(false);
     adcButton->setEnabledState(false);
     dspoffsetButton-> setEnabledState(false);
+    captureButton->setEnabledState(false);
+    replayButton->setEnabledState(false);
+    usbPipelineInterface->startAcquisition();
     acquisitionIsActive = true;
 	if (canvas != nullptr)
 		canvas->channelList->disableAll();
@@ -905,6 +999,9 @@ void RHD2000Editor::stopAcquisition()
     rescanButton->setEnabledState(true);
     adcButton->setEnabledState(true);
     dspoffsetButton-> setEnabledState(true);
+    captureButton->setEnabledState(true);
+    replayButton->setEnabledState(true);
+    usbPipelineInterface->stopAcquisition();
 
     acquisitionIsActive = false;
 	if (canvas != nullptr)
@@ -1490,6 +1587,42 @@ void ClockDivideInterface::paint(Graphics& g)
     g.drawText("Ratio: ", 0, 10, 200, 20, Justification::left, false);
 }
 
+// USB Pipeline --------------------------------------------------------------------
+
+UsbPipelineInterface::UsbPipelineInterface(RHD2000Thread* board_) :
+    board(board_), fifoPercent(0), peakFifoPercent(0), queuedBlocks(0), readerStalls(0)
+{
+    setInterceptsMouseClicks(false, false);
+}
+
+void UsbPipelineInterface::startAcquisition()
+{
+    startTimer(250);
+}
+
+void UsbPipelineInterface::stopAcquisition()
+{
+    stopTimer();
+    timerCallback(); // keep the final values on display
+}
+
+void UsbPipelineInterface::timerCallback()
+{
+    board->getUsbPipelineStats(fifoPercent, peakFifoPercent, queuedBlocks, readerStalls);
+    repaint();
+}
+
+void UsbPipelineInterface::paint(Graphics& g)
+{
+    // the board FIFO fills up when the host falls behind, so warn well before it overflows
+    g.setColour(peakFifoPercent > 10.0f || readerStalls > 0 ? Colours::darkred : Colours::darkgrey);
+    g.setFont(Font("Small Text",9,Font::plain));
+    g.drawText("FIFO " + String(fifoPercent, 1) + "/" + String(peakFifoPercent, 1) + "%",
+               0, 0, getWidth(), 14, Justification::left, false);
+    g.drawText("Queue " + String(queuedBlocks) + " Stall " + String(readerStalls),
+               0, 14, getWidth(), 14, Justification::left, false);
+}
+
 // DSP Options --------------------------------------------------------------------
 
 DSPInterface::DSPInterface(RHD2000Thread* board_,
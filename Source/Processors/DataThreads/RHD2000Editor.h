@@ -36,6 +36,7 @@ class BandwidthInterface;
 class DSPInterface;
 class AudioInterface;
 class ClockDivideInterface;
+class UsbPipelineInterface;
 class RHD2000Thread;
 
 class UtilityButton;
@@ -206,6 +207,9 @@ private:
     ScopedPointer<UtilityButton> adcButton;
 	ScopedPointer<UtilityButton> ledButton;
 
+    ScopedPointer<UtilityButton> captureButton, replayButton, replayRealTimeButton;
+    ScopedPointer<UsbPipelineInterface> usbPipelineInterface;
+
     ScopedPointer<UtilityButton> dspoffsetButton;
     ScopedPointer<ComboBox> ttlSettleCombo,dacHPFcombo;
 
@@ -396,5 +400,27 @@ private:
     ScopedPointer<Label> divideRatioSelection;
     int actualDivideRatio {1};
 
+};
+
+/** Shows the board FIFO level and decode backlog while acquiring. */
+class UsbPipelineInterface : public Component,
+    public Timer
+{
+public:
+    UsbPipelineInterface(RHD2000Thread*);
+
+    void paint(Graphics& g);
+    void timerCallback();
+
+    void startAcquisition();
+    void stopAcquisition();
+
+private:
+
+    RHD2000Thread* board;
+
+    float fifoPercent, peakFifoPercent;
+    int queuedBlocks, readerStalls;
+
 };
 #endif  // __RHD2000EDITOR_H_2AD3C591__
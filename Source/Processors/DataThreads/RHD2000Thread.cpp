@@ -87,9 +87,13 @@ RHD2000Thread::RHD2000Thread(SourceNode* sn) : DataThread(sn),
     savedSampleRateIndex(16),
     cableLengthPortA(0.914f), cableLengthPortB(0.914f), cableLengthPortC(0.914f), cableLengthPortD(0.914f), // default is 3 feet (0.914 m),
     audioOutputL(-1), audioOutputR(-1) ,numberingScheme(1),
-	newScan(true), ledsEnabled(true)
+	newScan(true), ledsEnabled(true),
+    captureBlockBytes(0), replayBlockBytes(0), replayDataStart(0), replayUsb3(false),
+    replayRealTime(true), replayFinished(false), replayStartTicks(0), replayBlocksRead(0),
+    usbBufferBytes(0), usbBlockFifo(NUM_USB_BUFFERS)
 {
 	impedanceThread = new RHDImpedanceMeasure(this);
+    usbReader = new RHDUsbReader(this);
 	memset(auxBuffer, 0, sizeof(auxBuffer));
 	memset(auxSamples, 0, sizeof(auxSamples));
 
@@ -169,6 +173,8 @@ RHD2000Thread::~RHD2000Thread()
 
     std::cout << "RHD2000 interface destroyed." << std::endl;
 
+    usbReader->stopThread(500);
+
     if (deviceFound)
     {
         int ledArray[8] = {0, 0, 0, 0, 0, 0, 0, 0};
@@ -434,7 +440,7 @@ void RHD2000Thread::initializeBoard()
 
 void RHD2000Thread::scanPorts()
 {
-	if (!deviceFound) //Safety to avoid crashes if board not present
+	if (!deviceFound || isReplaying()) //Safety to avoid crashes if board not present
 	{
 		return;
 	}
@@ -932,6 +938,9 @@ int RHD2000Thread::getNumEventChannels()
 
 float RHD2000Thread::getSampleRate()
 {
+    if (isReplaying())
+        return boardSampleRate;
+
     return evalBoard->getSampleRate();
 }
 
@@ -1036,7 +1045,7 @@ int RHD2000Thread::setNoiseSlicerLevel(int level)
 bool RHD2000Thread::foundInputSource()
 {
 
-    return deviceFound;
+    return deviceFound || isReplaying();
 
 }
 
@@ -1115,7 +1124,7 @@ bool RHD2000Thread::isHeadstageEnabled(int hsNum)
 
 bool RHD2000Thread::isReady()
 {
-	return deviceFound && (getNumChannels() > 0);
+	return (deviceFound || isReplaying()) && (getNumChannels() > 0);
 }
 
 int RHD2000Thread::getActiveChannelsInHeadstage(int hsNum)
@@ -1168,6 +1177,9 @@ void RHD2000Thread::setSampleRate(int sampleRateIndex, bool isTemporary)
         savedSampleRateIndex = sampleRateIndex;
     }
 
+    if (isReplaying()) // the rate is fixed by the capture file
+        return;
+
     int numUsbBlocksToRead = 0; // placeholder - make this change the number of blocks that are read in RHD2000Thread::updateBuffer()
 
     Rhd2000EvalBoard::AmplifierSampleRate sampleRate; // just for local use
@@ -1393,6 +1405,23 @@ void RHD2000Thread::setCableLength(int hsNum, float length)
 bool RHD2000Thread::startAcquisition()
 {
 	impedanceThread->waitSafely();
+
+    if (isReplaying())
+    {
+        std::cout << "Replaying " << replayStream->getFile().getFullPathName() << std::endl;
+
+        replayStream->setPosition(replayDataStart);
+        replayFinished = false;
+        replayBlocksRead = 0;
+        replayStartTicks = Time::getHighResolutionTicks();
+
+        startThread();
+
+        isTransmitting = true;
+
+        return true;
+    }
+
     dataBlock = new Rhd2000DataBlock(evalBoard->getNumEnabledDataStreams(), evalBoard->isUSB3());
 
     std::cout << "Expecting " << getNumChannels() << " channels." << std::endl;
@@ -1426,7 +1455,33 @@ bool RHD2000Thread::startAcquisition()
     blockSize = dataBlock->calculateDataBlockSizeInWords(evalBoard->getNumEnabledDataStreams(), evalBoard->isUSB3());
 	std::cout << "Expecting blocksize of " << blockSize << " for " << evalBoard->getNumEnabledDataStreams() << " streams" << std::endl;
 	//evalBoard->printFIFOmetrics();
+
+    if (captureFile != File::nonexistent)
+    {
+        File target = captureFile.existsAsFile() ? captureFile.getNonexistentSibling() : captureFile;
+
+        captureStream = target.createOutputStream(1 << 20);
+
+        if (captureStream != nullptr)
+        {
+            std::cout << "Capturing raw USB blocks to " << target.getFullPathName() << std::endl;
+            writeCaptureHeader();
+        }
+        else
+        {
+            CoreServices::sendStatusMessage("Could not create capture file " + target.getFileName());
+        }
+    }
+
+    usbBufferBytes = 2 * blockSize;
+    usbBufferPool.malloc(NUM_USB_BUFFERS * usbBufferBytes);
+    usbBlockFifo.reset();
+    usbFifoWords = 0;
+    usbPeakFifoWords = 0;
+    usbReaderStalls = 0;
+
     startThread();
+    usbReader->startThread(8);
 
 
     isTransmitting = true;
@@ -1440,6 +1495,9 @@ bool RHD2000Thread::stopAcquisition()
     //  isTransmitting = false;
     std::cout << "RHD2000 data thread stopping acquisition." << std::endl;
 
+    // stop reading from the board before the decoder goes away
+    usbReader->stopThread(500);
+
     if (isThreadRunning())
     {
         signalThreadShouldExit();
@@ -1455,7 +1513,9 @@ bool RHD2000Thread::stopAcquisition()
         std::cout << "Thread failed to exit, continuing anyway..." << std::endl;
     }
 
-    if (deviceFound)
+    captureStream = nullptr;
+
+    if (deviceFound && !isReplaying())
     {
         evalBoard->setContinuousRunMode(false);
         evalBoard->setMaxTimeStep(0);
@@ -1489,234 +1549,479 @@ bool RHD2000Thread::updateBuffer()
 {
 	//int chOffset;
 	unsigned char* bufferPtr;
-    //cout << "Number of 16-bit words in FIFO: " << evalBoard->numWordsInFifo() << endl;
-    //cout << "Block size: " << blockSize << endl;
-   
-	//std::cout << "Current number of words: " <<  evalBoard->numWordsInFifo() << " for " << blockSize << std::endl;
-    if (evalBoard->isUSB3() || evalBoard->numWordsInFifo() >= blockSize)
+
+    if (isReplaying())
     {
-		bool return_code;
+        if (readReplayBlock())
+            decodeDataBlock(replayBlock, Rhd2000DataBlock::getSamplesPerDataBlock(replayUsb3));
 
-		return_code = evalBoard->readRawDataBlock(&bufferPtr);
+        // there is no board to update
+        return true;
+    }
 
-		int index = 0;
-		int auxIndex, chanIndex;
-		int numStreams = enabledStreams.size();
-		int nSamps = Rhd2000DataBlock::getSamplesPerDataBlock(evalBoard->isUSB3());
-		
-		//evalBoard->printFIFOmetrics();
-        for (int samp = 0; samp < nSamps; samp++)
+    // blocks are read by the RHDUsbReader thread; decode them in the order they arrived
+    int start1, size1, start2, size2;
+    usbBlockFifo.prepareToRead(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+    {
+        wait(5); // woken up by the reader as soon as a block is available
+        return true;
+    }
+
+    bufferPtr = usbBufferPool + start1 * usbBufferBytes;
+
+    if (captureStream != nullptr)
+        captureStream->write(bufferPtr, captureBlockBytes);
+
+    decodeDataBlock(bufferPtr, Rhd2000DataBlock::getSamplesPerDataBlock(evalBoard->isUSB3()));
+
+    usbBlockFifo.finishedRead(1);
+
+    return true;
+
+}
+
+void RHD2000Thread::updateDacOutputs()
+{
+    if (dacOutputShouldChange)
+    {
+		std::cout << "DAC" << std::endl;
+        for (int k=0; k<8; k++)
         {
-            int channel = -1;
+            if (dacChannelsToUpdate[k])
+            {
+                dacChannelsToUpdate[k] = false;
+                if (dacChannels[k] >= 0)
+                {
+                    evalBoard->enableDac(k, true);
+                    evalBoard->selectDacDataStream(k, dacStream[k]);
+                    evalBoard->selectDacDataChannel(k, dacChannels[k]);
+                    evalBoard->setDacThreshold(k, (int)abs((dacThresholds[k]/0.195) + 32768),dacThresholds[k] >= 0);
+                   // evalBoard->setDacThresholdVoltage(k, (int) dacThresholds[k]);
+                }
+                else
+                {
+                    evalBoard->enableDac(k, false);
+                }
+            }
+        }
 
-			if (!Rhd2000DataBlock::checkUsbHeader(bufferPtr, index))
+        evalBoard->setTtlMode(ttlMode ? 1 : 0);
+        evalBoard->enableExternalFastSettle(fastTTLSettleEnabled);
+        evalBoard->setExternalFastSettleChannel(fastSettleTTLChannel);
+        evalBoard->setDacHighpassFilter(desiredDAChpf);
+        evalBoard->enableDacHighpassFilter(desiredDAChpfState);
+		evalBoard->enableBoardLeds(ledsEnabled);
+        evalBoard->setClockDivider(clockDivideFactor);
+
+        dacOutputShouldChange = false;
+    }
+}
+
+void RHD2000Thread::getUsbPipelineStats(float& fifoPercent, float& peakFifoPercent, int& queuedBlocks, int& readerStalls)
+{
+    fifoPercent = 100.0f * usbFifoWords.get() / FIFO_CAPACITY_WORDS;
+    peakFifoPercent = 100.0f * usbPeakFifoWords.get() / FIFO_CAPACITY_WORDS;
+    queuedBlocks = usbBlockFifo.getNumReady();
+    readerStalls = usbReaderStalls.get();
+}
+
+void RHD2000Thread::decodeDataBlock(unsigned char* bufferPtr, int nSamps)
+{
+	int index = 0;
+	int auxIndex, chanIndex;
+	int numStreams = enabledStreams.size();
+	
+	//evalBoard->printFIFOmetrics();
+    for (int samp = 0; samp < nSamps; samp++)
+    {
+        int channel = -1;
+
+		if (!Rhd2000DataBlock::checkUsbHeader(bufferPtr, index))
+		{
+			cerr << "Error in Rhd2000EvalBoard::readDataBlock: Incorrect header." << endl;
+			break;
+		}
+
+		index += 8;
+		timestamp = Rhd2000DataBlock::convertUsbTimeStamp(bufferPtr,index);
+		index += 4;
+		auxIndex = index;
+		//skip the aux channels
+		index += numStreams * 6;
+		// do the neural data channels first
+		for (int dataStream = 0; dataStream < numStreams; dataStream++)
+		{
+			int nChans = numChannelsPerDataStream[dataStream];
+			chanIndex = index + 2*dataStream;
+			if ((chipId[dataStream] == CHIP_ID_RHD2132) && (nChans == 16)) //RHD2132 16ch. headstage
 			{
-				cerr << "Error in Rhd2000EvalBoard::readDataBlock: Incorrect header." << endl;
-				break;
+				chanIndex += 2 * RHD2132_16CH_OFFSET*numStreams;
 			}
-
-			index += 8;
-			timestamp = Rhd2000DataBlock::convertUsbTimeStamp(bufferPtr,index);
-			index += 4;
-			auxIndex = index;
-			//skip the aux channels
-			index += numStreams * 6;
-			// do the neural data channels first
-			for (int dataStream = 0; dataStream < numStreams; dataStream++)
+			for (int chan = 0; chan < nChans; chan++)
 			{
-				int nChans = numChannelsPerDataStream[dataStream];
-				chanIndex = index + 2*dataStream;
-				if ((chipId[dataStream] == CHIP_ID_RHD2132) && (nChans == 16)) //RHD2132 16ch. headstage
+				channel++;
+				thisSample[channel] = float(*(uint16*)(bufferPtr + chanIndex) - 32768)*0.195f;
+				chanIndex += 2*numStreams;
+			}
+		}
+		index += 64 * numStreams;
+		//now we can do the aux channels
+		auxIndex += 2*numStreams;
+		for (int dataStream = 0; dataStream < numStreams; dataStream++)
+		{
+			if (chipId[dataStream] != CHIP_ID_RHD2164_B)
+			{
+				int auxNum = (samp+3) % 4;
+				if (auxNum < 3)
 				{
-					chanIndex += 2 * RHD2132_16CH_OFFSET*numStreams;
+					auxSamples[dataStream][auxNum] = float(*(uint16*)(bufferPtr + auxIndex) - 32768)*0.0000374;
 				}
-				for (int chan = 0; chan < nChans; chan++)
+				for (int chan = 0; chan < 3; chan++)
 				{
 					channel++;
-					thisSample[channel] = float(*(uint16*)(bufferPtr + chanIndex) - 32768)*0.195f;
-					chanIndex += 2*numStreams;
-				}
-			}
-			index += 64 * numStreams;
-			//now we can do the aux channels
-			auxIndex += 2*numStreams;
-			for (int dataStream = 0; dataStream < numStreams; dataStream++)
-			{
-				if (chipId[dataStream] != CHIP_ID_RHD2164_B)
-				{
-					int auxNum = (samp+3) % 4;
-					if (auxNum < 3)
-					{
-						auxSamples[dataStream][auxNum] = float(*(uint16*)(bufferPtr + auxIndex) - 32768)*0.0000374;
-					}
-					for (int chan = 0; chan < 3; chan++)
+					if (auxNum == 3)
 					{
-						channel++;
-						if (auxNum == 3)
-						{
-							auxBuffer[channel] = auxSamples[dataStream][chan];
-						}
-						thisSample[channel] = auxBuffer[channel];
+						auxBuffer[channel] = auxSamples[dataStream][chan];
 					}
+					thisSample[channel] = auxBuffer[channel];
 				}
-				auxIndex += 2;
-
 			}
-			index += 2 * numStreams;
-			if (acquireAdcChannels)
-			{
-				for (int adcChan = 0; adcChan < 8; ++adcChan)
-				{
+			auxIndex += 2;
 
-					channel++;
-					// ADC waveform units = volts
-					thisSample[channel] =
-						//0.000050354 * float(dataBlock->boardAdcData[adcChan][samp]);
-						0.00015258789 * float(*(uint16*)(bufferPtr + index)) - 5 - 0.4096; // account for +/-5V input range and DC offset
-					index += 2;
-				}
-			}
-			else
+		}
+		index += 2 * numStreams;
+		if (acquireAdcChannels)
+		{
+			for (int adcChan = 0; adcChan < 8; ++adcChan)
 			{
-				index += 16;
+
+				channel++;
+				// ADC waveform units = volts
+				thisSample[channel] =
+					//0.000050354 * float(dataBlock->boardAdcData[adcChan][samp]);
+					0.00015258789 * float(*(uint16*)(bufferPtr + index)) - 5 - 0.4096; // account for +/-5V input range and DC offset
+				index += 2;
 			}
-			eventCode = *(uint16*)(bufferPtr + index);
-			index += 4;
-			dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
+		}
+		else
+		{
+			index += 16;
+		}
+		eventCode = *(uint16*)(bufferPtr + index);
+		index += 4;
+		dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
 #if 0
-            // do the neural data channels first
-            for (int dataStream = 0; dataStream < enabledStreams.size(); dataStream++)
+        // do the neural data channels first
+        for (int dataStream = 0; dataStream < enabledStreams.size(); dataStream++)
+        {
+			if ((chipId[dataStream] == CHIP_ID_RHD2132) && (numChannelsPerDataStream[dataStream] == 16)) //RHD2132 16ch. headstage
+				chOffset = RHD2132_16CH_OFFSET;
+			else
+				chOffset = 0;
+            for (int chan = 0; chan < numChannelsPerDataStream[dataStream]; chan++)
             {
-				if ((chipId[dataStream] == CHIP_ID_RHD2132) && (numChannelsPerDataStream[dataStream] == 16)) //RHD2132 16ch. headstage
-					chOffset = RHD2132_16CH_OFFSET;
-				else
-					chOffset = 0;
-                for (int chan = 0; chan < numChannelsPerDataStream[dataStream]; chan++)
-                {
 
-                    //  std::cout << "reading sample stream " << streamNumber << " chan " << chan << " sample "<< samp << std::endl;
+                //  std::cout << "reading sample stream " << streamNumber << " chan " << chan << " sample "<< samp << std::endl;
 
-                    channel++;
+                channel++;
 
-                    int value = dataBlock->amplifierData[dataStream][chan+chOffset][samp];
+                int value = dataBlock->amplifierData[dataStream][chan+chOffset][samp];
 
-                    thisSample[channel] = float(value-32768)*0.195f;
-                }
+                thisSample[channel] = float(value-32768)*0.195f;
+            }
 
 
-            }
+        }
 
 
-            // then do the Intan AUX channels
-            for (int dataStream = 0; dataStream < enabledStreams.size(); dataStream++)
+        // then do the Intan AUX channels
+        for (int dataStream = 0; dataStream < enabledStreams.size(); dataStream++)
+        {
+            if (chipId[dataStream] != CHIP_ID_RHD2164_B) //Channel B of 2164 shouldn't be copied
             {
-                if (chipId[dataStream] != CHIP_ID_RHD2164_B) //Channel B of 2164 shouldn't be copied
+                if (samp % 4 == 1)   // every 4th sample should have auxiliary input data
                 {
-                    if (samp % 4 == 1)   // every 4th sample should have auxiliary input data
-                    {
 
-                        // std::cout << "reading sample stream " << streamNumber << " aux ADCs " << std::endl;
+                    // std::cout << "reading sample stream " << streamNumber << " aux ADCs " << std::endl;
 
-                        channel++;
-						thisSample[channel] = 0.0000374 *
-							float(dataBlock->auxiliaryData[dataStream][1][samp + 0] - 32768);
-                        // constant offset keeps the values visible in the LFP Viewer
+                    channel++;
+					thisSample[channel] = 0.0000374 *
+						float(dataBlock->auxiliaryData[dataStream][1][samp + 0] - 32768);
+                    // constant offset keeps the values visible in the LFP Viewer
 
-                        auxBuffer[channel] = thisSample[channel];
+                    auxBuffer[channel] = thisSample[channel];
 
-                        channel++;
-						thisSample[channel] = 0.0000374 *
-							float(dataBlock->auxiliaryData[dataStream][1][samp + 1] - 32768);
-                        // constant offset keeps the values visible in the LFP Viewer
+                    channel++;
+					thisSample[channel] = 0.0000374 *
+						float(dataBlock->auxiliaryData[dataStream][1][samp + 1] - 32768);
+                    // constant offset keeps the values visible in the LFP Viewer
 
-                        auxBuffer[channel] = thisSample[channel];
+                    auxBuffer[channel] = thisSample[channel];
 
 
-                        channel++;
-						thisSample[channel] = 0.0000374 *
-							float(dataBlock->auxiliaryData[dataStream][1][samp + 2] - 32768);
-                        // constant offset keeps the values visible in the LFP Viewer
+                    channel++;
+					thisSample[channel] = 0.0000374 *
+						float(dataBlock->auxiliaryData[dataStream][1][samp + 2] - 32768);
+                    // constant offset keeps the values visible in the LFP Viewer
 
-                        auxBuffer[channel] = thisSample[channel];
+                    auxBuffer[channel] = thisSample[channel];
 
-                    }
-                    else    // repeat last values from buffer
-                    {
+                }
+                else    // repeat last values from buffer
+                {
 
-                        //std::cout << "reading sample stream " << streamNumber << " aux ADCs " << std::endl;
+                    //std::cout << "reading sample stream " << streamNumber << " aux ADCs " << std::endl;
 
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                    }
+                    channel++;
+                    thisSample[channel] = auxBuffer[channel];
+                    channel++;
+                    thisSample[channel] = auxBuffer[channel];
+                    channel++;
+                    thisSample[channel] = auxBuffer[channel];
                 }
-
             }
 
-            // finally, loop through acquisition board ADC channels if necessary
-            if (acquireAdcChannels)
+        }
+
+        // finally, loop through acquisition board ADC channels if necessary
+        if (acquireAdcChannels)
+        {
+            for (int adcChan = 0; adcChan < 8; ++adcChan)
             {
-                for (int adcChan = 0; adcChan < 8; ++adcChan)
-                {
 
-                    channel++;
-                    // ADC waveform units = volts
-                    thisSample[channel] =
-                        //0.000050354 * float(dataBlock->boardAdcData[adcChan][samp]);
-                        0.00015258789 * float(dataBlock->boardAdcData[adcChan][samp]) - 5 - 0.4096; // account for +/-5V input range and DC offset
-                }
+                channel++;
+                // ADC waveform units = volts
+                thisSample[channel] =
+                    //0.000050354 * float(dataBlock->boardAdcData[adcChan][samp]);
+                    0.00015258789 * float(dataBlock->boardAdcData[adcChan][samp]) - 5 - 0.4096; // account for +/-5V input range and DC offset
             }
-            // std::cout << channel << std::endl;
+        }
+        // std::cout << channel << std::endl;
 
-            timestamp = dataBlock->timeStamp[samp];
-            //timestamp = timestamp;
-            eventCode = dataBlock->ttlIn[samp];
-            dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
+        timestamp = dataBlock->timeStamp[samp];
+        //timestamp = timestamp;
+        eventCode = dataBlock->ttlIn[samp];
+        dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
 #endif
-        }
+    }
+}
+
+/* Capture files start with a little-endian header describing the stream layout,
+   followed by the raw USB blocks exactly as read from the board:
+
+     char   magic[8]            "OERHDCAP"
+     int32  version             currently 1
+     int32  usb3
+     double sampleRate
+     int32  acquireAdcChannels
+     int32  blockBytes          size of every raw block
+     int32  numStreams
+     numStreams x  { int32 dataSource, int32 chipId, int32 numChannels }
+     MAX_NUM_HEADSTAGES x  { int32 numStreams, int32 channelsPerStream,
+                             int32 streamIndex, int32 halfChannels }
+*/
+
+#define CAPTURE_FILE_VERSION 1
+
+void RHD2000Thread::writeCaptureHeader()
+{
+    captureBlockBytes = 2 * blockSize;
+
+    captureStream->write("OERHDCAP", 8);
+    captureStream->writeInt(CAPTURE_FILE_VERSION);
+    captureStream->writeInt(evalBoard->isUSB3() ? 1 : 0);
+    captureStream->writeDouble(boardSampleRate);
+    captureStream->writeInt(acquireAdcChannels ? 1 : 0);
+    captureStream->writeInt(captureBlockBytes);
+    captureStream->writeInt(enabledStreams.size());
 
+    for (int i = 0; i < enabledStreams.size(); i++)
+    {
+        captureStream->writeInt(enabledStreams[i]);
+        captureStream->writeInt(chipId[i]);
+        captureStream->writeInt(numChannelsPerDataStream[i]);
     }
 
-	
-    if (dacOutputShouldChange)
+    for (int hs = 0; hs < MAX_NUM_HEADSTAGES; hs++)
     {
-		std::cout << "DAC" << std::endl;
-        for (int k=0; k<8; k++)
+        RHDHeadstage* headstage = headstagesArray[hs];
+
+        captureStream->writeInt(headstage->getNumStreams());
+        captureStream->writeInt(headstage->getNumStreams() > 0 ? headstage->getNumChannels() / headstage->getNumStreams() : 32);
+        captureStream->writeInt(headstage->getStreamIndex(0));
+        captureStream->writeInt(headstage->getNumActiveChannels() != headstage->getNumChannels() ? 1 : 0);
+    }
+}
+
+void RHD2000Thread::setCaptureFile(const File& file)
+{
+    captureFile = file;
+}
+
+File RHD2000Thread::getCaptureFile() const
+{
+    return captureFile;
+}
+
+bool RHD2000Thread::startReplay(const File& file)
+{
+    impedanceThread->stopThreadSafely();
+
+    ScopedPointer<FileInputStream> stream = file.createInputStream();
+
+    if (stream == nullptr)
+        return false;
+
+    char magic[8];
+
+    if (stream->read(magic, 8) != 8 || memcmp(magic, "OERHDCAP", 8) != 0 || stream->readInt() != CAPTURE_FILE_VERSION)
+    {
+        std::cout << file.getFullPathName() << " is not an RHD2000 capture file." << std::endl;
+        return false;
+    }
+
+    const bool usb3 = stream->readInt() != 0;
+    const double sampleRate = stream->readDouble();
+    const bool adcs = stream->readInt() != 0;
+    const int blockBytes = stream->readInt();
+    const int numStreams = stream->readInt();
+
+    if (numStreams <= 0 || numStreams > MAX_NUM_DATA_STREAMS_USB3 ||
+        blockBytes != 2 * (int) Rhd2000DataBlock::calculateDataBlockSizeInWords(numStreams, usb3))
+    {
+        std::cout << "Invalid stream configuration in " << file.getFullPathName() << std::endl;
+        return false;
+    }
+
+    enabledStreams.clear();
+    chipId.clear();
+    numChannelsPerDataStream.clear();
+
+    for (int i = 0; i < numStreams; i++)
+    {
+        enabledStreams.add(static_cast<Rhd2000EvalBoard::BoardDataSource>(stream->readInt()));
+        chipId.add(stream->readInt());
+        numChannelsPerDataStream.add(jlimit(0, 32, stream->readInt()));
+    }
+
+    for (int hs = 0; hs < MAX_NUM_HEADSTAGES; hs++)
+    {
+        const int nStreams = stream->readInt();
+        const int channelsPerStream = stream->readInt();
+        const int streamIndex = stream->readInt();
+        const bool half = stream->readInt() != 0;
+
+        headstagesArray[hs]->setNumStreams(nStreams);
+        headstagesArray[hs]->setChannelsPerStream(channelsPerStream, streamIndex);
+        headstagesArray[hs]->setHalfChannels(half);
+    }
+
+    replayUsb3 = usb3;
+    replayBlockBytes = blockBytes;
+    replayBlock.malloc(replayBlockBytes);
+    replayDataStart = stream->getPosition();
+    replayStream = stream.release();
+
+    boardSampleRate = sampleRate;
+    acquireAdcChannels = adcs;
+    newScan = true;
+
+    dataBuffer->resize(getNumChannels(), 10000);
+
+    std::cout << "Replaying " << numStreams << " data streams at " << boardSampleRate
+              << " Hz from " << file.getFullPathName() << std::endl;
+
+    return true;
+}
+
+void RHD2000Thread::stopReplay()
+{
+    if (!isReplaying())
+        return;
+
+    replayStream = nullptr;
+
+    enabledStreams.clear();
+    chipId.clear();
+    numChannelsPerDataStream.clear();
+
+    for (int hs = 0; hs < MAX_NUM_HEADSTAGES; hs++)
+        headstagesArray[hs]->setNumStreams(0);
+
+    // restore the configuration of the real board, if there is one
+    if (deviceFound)
+        scanPorts();
+
+    dataBuffer->resize(getNumChannels(), 10000);
+}
+
+bool RHD2000Thread::isReplaying() const
+{
+    return replayStream != nullptr;
+}
+
+void RHD2000Thread::setReplayRealTime(bool realTime)
+{
+    replayRealTime = realTime;
+}
+
+bool RHD2000Thread::getReplayRealTime() const
+{
+    return replayRealTime;
+}
+
+bool RHD2000Thread::readReplayBlock()
+{
+    if (replayFinished)
+    {
+        wait(10);
+        return false;
+    }
+
+    const int nSamps = Rhd2000DataBlock::getSamplesPerDataBlock(replayUsb3);
+
+    if (replayRealTime)
+    {
+        // wait until the board would have delivered this block
+        const double due = (replayBlocksRead + 1) * nSamps / boardSampleRate;
+
+        while (!threadShouldExit())
         {
-            if (dacChannelsToUpdate[k])
-            {
-                dacChannelsToUpdate[k] = false;
-                if (dacChannels[k] >= 0)
-                {
-                    evalBoard->enableDac(k, true);
-                    evalBoard->selectDacDataStream(k, dacStream[k]);
-                    evalBoard->selectDacDataChannel(k, dacChannels[k]);
-                    evalBoard->setDacThreshold(k, (int)abs((dacThresholds[k]/0.195) + 32768),dacThresholds[k] >= 0);
-                   // evalBoard->setDacThresholdVoltage(k, (int) dacThresholds[k]);
-                }
-                else
-                {
-                    evalBoard->enableDac(k, false);
-                }
-            }
+            const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - replayStartTicks);
+
+            if (elapsed >= due)
+                break;
+
+            wait(jmax(1, int((due - elapsed) * 1000.0)));
+        }
+    }
+    else
+    {
+        // as fast as possible, but without overrunning the data buffer
+        while (dataBuffer->getNumSamples() > 10000 - 4 * nSamps && !threadShouldExit())
+        {
+            sn->processInlineChain(); // with inline processors, this is what empties the buffer
+            wait(1);
         }
+    }
 
-        evalBoard->setTtlMode(ttlMode ? 1 : 0);
-        evalBoard->enableExternalFastSettle(fastTTLSettleEnabled);
-        evalBoard->setExternalFastSettleChannel(fastSettleTTLChannel);
-        evalBoard->setDacHighpassFilter(desiredDAChpf);
-        evalBoard->enableDacHighpassFilter(desiredDAChpfState);
-		evalBoard->enableBoardLeds(ledsEnabled);
-        evalBoard->setClockDivider(clockDivideFactor);
+    if (replayStream->read(replayBlock, replayBlockBytes) != replayBlockBytes)
+    {
+        replayFinished = true;
 
-        dacOutputShouldChange = false;
+        const double seconds = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - replayStartTicks);
+
+        std::cout << "Replay finished: " << replayBlocksRead << " blocks in " << seconds << " s ("
+                  << (replayBlocksRead * nSamps / jmax(seconds, 1e-6)) << " samples/s)" << std::endl;
+
+        return false;
     }
-	
-    return true;
 
+    replayBlocksRead++;
+
+    return true;
 }
 
 int RHD2000Thread::getChannelFromHeadstage(int hs, int ch)
@@ -1912,6 +2217,62 @@ bool RHDHeadstage::isPlugged()
     return (numStreams > 0);
 }
 
+RHDUsbReader::RHDUsbReader(RHD2000Thread* b) : Thread("RHD2000 USB reader"), board(b)
+{
+}
+
+RHDUsbReader::~RHDUsbReader()
+{
+}
+
+void RHDUsbReader::run()
+{
+	Rhd2000EvalBoard* evalBoard = board->evalBoard;
+	const bool usb3 = evalBoard->isUSB3();
+	int blocksSinceLevelCheck = 0;
+
+	while (!threadShouldExit())
+	{
+		// the board is only ever accessed from this thread while acquiring
+		board->updateDacOutputs();
+
+		// USB2 transfers must not be started before a whole block is in the FIFO;
+		// with USB3 the level is only sampled now and then for the statistics
+		if (!usb3 || ++blocksSinceLevelCheck >= 16)
+		{
+			const unsigned int words = evalBoard->numWordsInFifo();
+			blocksSinceLevelCheck = 0;
+
+			board->usbFifoWords = (int) words;
+			if ((int) words > board->usbPeakFifoWords.get())
+				board->usbPeakFifoWords = (int) words;
+
+			if (!usb3 && words < board->blockSize)
+			{
+				Thread::yield();
+				continue;
+			}
+		}
+
+		int start1, size1, start2, size2;
+		board->usbBlockFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+		if (size1 == 0)
+		{
+			// every buffer is still waiting to be decoded
+			++board->usbReaderStalls;
+			wait(1);
+			continue;
+		}
+
+		if (!evalBoard->readRawDataBlockToBuffer(board->usbBufferPool + start1 * board->usbBufferBytes))
+			continue;
+
+		board->usbBlockFifo.finishedWrite(1);
+		board->notify();
+	}
+}
+
 /***********************************/
 /* Below is code for impedance measurements */
 
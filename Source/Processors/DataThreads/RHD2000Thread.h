@@ -47,6 +47,7 @@
 class SourceNode;
 class RHDHeadstage;
 class RHDImpedanceMeasure;
+class RHDUsbReader;
 
 struct ImpedanceData
 {
@@ -61,6 +62,10 @@ struct ImpedanceData
 
   Communicates with the RHD2000 Evaluation Board from Intan Technologies
 
+  During acquisition, an RHDUsbReader thread reads raw USB blocks into a ring of
+  preallocated buffers while this thread decodes them into the DataBuffer, so a
+  slow decode never delays the next USB transfer.
+
   @see DataThread, SourceNode
 
 */
@@ -68,6 +73,7 @@ struct ImpedanceData
 class RHD2000Thread : public DataThread, public Timer
 {
 	friend class RHDImpedanceMeasure;
+	friend class RHDUsbReader;
 public:
     RHD2000Thread(SourceNode* sn);
     ~RHD2000Thread();
@@ -131,6 +137,28 @@ public:
 	void enableBoardLeds(bool enable);
 	int setClockDivider(int divide_ratio);
 
+    /** Records the raw USB blocks of the following acquisitions to a capture file,
+        preceded by the stream and chip configuration. An existing file is not
+        overwritten; a numbered sibling is created instead. Pass File() to stop capturing. */
+    void setCaptureFile(const File& file);
+    File getCaptureFile() const;
+
+    /** Takes the stream configuration from a capture file and feeds its blocks
+        through the normal decoding path instead of reading from the board. */
+    bool startReplay(const File& file);
+    void stopReplay();
+    bool isReplaying() const;
+
+    /** Replays at the recorded sample rate if true, otherwise as fast as the
+        signal chain consumes the data. */
+    void setReplayRealTime(bool realTime);
+    bool getReplayRealTime() const;
+
+    /** Health of the USB pipeline during acquisition: the current and highest level
+        of the board's FIFO (in percent of its capacity), the number of blocks waiting
+        to be decoded, and how often the reader found all buffers still in use. */
+    void getUsbPipelineStats(float& fifoPercent, float& peakFifoPercent, int& queuedBlocks, int& readerStalls);
+
 private:
 
     bool enableHeadstage(int hsNum, bool enabled, int nStr = 1, int strChans = 32);
@@ -190,6 +218,16 @@ private:
 
     bool updateBuffer();
 
+    /** Sends pending DAC/TTL settings to the board; called from the USB reader thread. */
+    void updateDacOutputs();
+
+    /** Converts one raw USB block into samples and adds them to the data buffer. */
+    void decodeDataBlock(unsigned char* bufferPtr, int nSamps);
+
+    /** Waits until the next replayed block is due and reads it; returns false at the end of the file. */
+    bool readReplayBlock();
+    void writeCaptureHeader();
+
     double cableLengthPortA, cableLengthPortB, cableLengthPortC, cableLengthPortD;
 
     int audioOutputL, audioOutputR;
@@ -211,6 +249,34 @@ private:
     // Sync ouput divide factor
     uint16 clockDivideFactor;
 
+    File captureFile;
+    ScopedPointer<FileOutputStream> captureStream;
+    unsigned int captureBlockBytes;
+
+    ScopedPointer<FileInputStream> replayStream;
+    HeapBlock<unsigned char> replayBlock;
+    int replayBlockBytes;
+    int64 replayDataStart;
+    bool replayUsb3;
+    bool replayRealTime;
+    bool replayFinished;
+    int64 replayStartTicks;
+    int64 replayBlocksRead;
+
+    enum
+    {
+        NUM_USB_BUFFERS = 32
+    };
+
+    ScopedPointer<RHDUsbReader> usbReader;
+    HeapBlock<unsigned char> usbBufferPool;
+    unsigned int usbBufferBytes;
+    AbstractFifo usbBlockFifo;
+
+    Atomic<int> usbFifoWords;
+    Atomic<int> usbPeakFifoWords;
+    Atomic<int> usbReaderStalls;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHD2000Thread);
 };
 
@@ -237,6 +303,26 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHDHeadstage);
 };
 
+/**
+
+  Reads raw USB blocks from the board into the RHD2000Thread's buffer ring.
+
+  @see RHD2000Thread
+
+*/
+
+class RHDUsbReader : public Thread
+{
+public:
+	RHDUsbReader(RHD2000Thread* b);
+	~RHDUsbReader();
+	void run();
+private:
+	RHD2000Thread* board;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHDUsbReader);
+};
+
 class RHDImpedanceMeasure : public Thread
 {
 public:
@@ -1482,6 +1482,31 @@ bool Rhd2000EvalBoard::readRawDataBlock(unsigned char** bufferPtr, int nSamples)
 	return true;
 }
 
+// Reads one raw USB data block straight into a caller-provided buffer, which must hold
+// 2 * calculateDataBlockSizeInWords(numDataStreams, usb3, nSamples) bytes.
+bool Rhd2000EvalBoard::readRawDataBlockToBuffer(unsigned char* buffer, int nSamples)
+{
+	unsigned int numBytesToRead;
+	long res;
+
+	numBytesToRead = 2 * Rhd2000DataBlock::calculateDataBlockSizeInWords(numDataStreams, usb3, nSamples);
+
+	if (usb3)
+	{
+		res = dev->ReadFromBlockPipeOut(PipeOutData, USB3_BLOCK_SIZE, numBytesToRead, buffer);
+	}
+	else
+	{
+		res = dev->ReadFromPipeOut(PipeOutData, numBytesToRead, buffer);
+	}
+	if (res == ok_Timeout)
+	{
+		cerr << "CRITICAL: Timeout on pipe read. Check block and buffer sizes." << endl;
+		return false;
+	}
+	return true;
+}
+
 // Reads a certain number of USB data blocks, if the specified number is available, and appends them
 // to queue.  Returns true if data blocks were available.
 bool Rhd2000EvalBoard::readDataBlocks(int numBlocks, queue<Rhd2000DataBlock> &dataQueue)
@@ -170,6 +170,7 @@ public:
 	bool isUSB3();
 	void printFIFOmetrics();
 	bool readRawDataBlock(unsigned char** bufferPtr, int nSamples = -1);
+	bool readRawDataBlockToBuffer(unsigned char* buffer, int nSamples = -1);
 
 private:
     okCFrontPanel *dev;
@@ -10,6 +10,7 @@
 
 #include "EventBroadcaster.h"
 #include "EventBroadcasterEditor.h"
+#include "../Visualization/SpikeObject.h"
 
 
 std::shared_ptr<void> EventBroadcaster::getZMQContext() {
@@ -32,17 +33,44 @@ void EventBroadcaster::closeZMQSocket(void* socket)
 }
 
 
+/** Ring and frame sizes, in bytes. */
+#define EVENT_RING_SIZE (1 << 20)
+#define MAX_FRAME_SIZE (1 << 16)
+
 EventBroadcaster::EventBroadcaster()
     : GenericProcessor("Event Broadcaster"),
+      Thread("Event Broadcaster"),
       zmqContext(getZMQContext()),
       zmqSocket(nullptr, &closeZMQSocket),
       listeningPort(0),
-      currentSampleRate(0)
+      currentSampleRate(0),
+      eventFifo(EVENT_RING_SIZE),
+      frameSize(FRAME_HEADER_SIZE),
+      numEventsInFrame(0),
+      frameIngestionTicks(0),
+      frameNumber(0),
+      blockElectrodeSet(nullptr)
 {
+    eventRing.malloc(EVENT_RING_SIZE);
+    frameBuffer.malloc(MAX_FRAME_SIZE);
+    packedSpike.malloc(MAX_SPIKE_BUFFER_LEN);
+
+    for (int i = 0; i < 256; i++)
+        blockTimestamps[i] = 0;
+
+    for (int i = 0; i <= BINARY_MSG; i++)
+        eventTypeEnabled[i] = (i >= TTL);
+
     setListeningPort(5557);
 }
 
 
+EventBroadcaster::~EventBroadcaster()
+{
+    stopThread(1000);
+}
+
+
 AudioProcessorEditor* EventBroadcaster::createEditor()
 {
     editor = new EventBroadcasterEditor(this, true);
@@ -60,6 +88,11 @@ void EventBroadcaster::setListeningPort(int port, bool forceRestart)
 {
     if ((listeningPort != port) || forceRestart)
     {
+        // the socket is owned by the publishing thread while it runs
+        const bool wasRunning = isThreadRunning();
+        if (wasRunning)
+            stopThread(1000);
+
 #ifdef ZEROMQ
         zmqSocket.reset(zmq_socket(zmqContext.get(), ZMQ_PUB));
         if (!zmqSocket)
@@ -77,13 +110,92 @@ void EventBroadcaster::setListeningPort(int port, bool forceRestart)
 #endif
 
         listeningPort = port;
+
+        if (wasRunning)
+            startThread();
+    }
+}
+
+
+void EventBroadcaster::setEventTypeEnabled(int eventType, bool enabled)
+{
+    if (eventType >= TTL && eventType <= BINARY_MSG)
+        eventTypeEnabled[eventType] = enabled;
+}
+
+
+bool EventBroadcaster::isEventTypeEnabled(int eventType) const
+{
+    if (eventType >= TTL && eventType <= BINARY_MSG)
+        return eventTypeEnabled[eventType];
+
+    return false;
+}
+
+
+void EventBroadcaster::setElectrodeFilter(const Array<int>& electrodeIds)
+{
+    ScopedPointer<ElectrodeSet> newSet = new ElectrodeSet();
+
+    electrodeFilter.clear();
+
+    for (int i = 0; i < electrodeIds.size(); i++)
+    {
+        int id = electrodeIds[i];
+
+        if (id >= 0 && id < (int) newSet->allowed.size())
+        {
+            electrodeFilter.addIfNotAlreadyThere(id);
+            newSet->allowed.set(id);
+        }
     }
+
+    if (electrodeFilter.size() == 0)
+        newSet = nullptr;
+
+    electrodeSet.publish(newSet.release());
+}
+
+
+const Array<int>& EventBroadcaster::getElectrodeFilter() const
+{
+    return electrodeFilter;
+}
+
+
+bool EventBroadcaster::enable()
+{
+    eventFifo.reset();
+    droppedEvents = 0;
+    frameNumber = 0;
+    frameSize = FRAME_HEADER_SIZE;
+    numEventsInFrame = 0;
+    frameIngestionTicks = 0;
+
+    startThread();
+
+    return true;
+}
+
+
+bool EventBroadcaster::disable()
+{
+    stopThread(1000);
+
+    return true;
 }
 
 
 void EventBroadcaster::process(AudioSampleBuffer& continuousBuffer, MidiBuffer& eventBuffer)
 {
     currentSampleRate = getSampleRate();
+
+    // one pass over the (small) map per block instead of a lookup per event
+    for (std::map<uint8, int64>::const_iterator it = timestamps.begin(); it != timestamps.end(); ++it)
+        blockTimestamps[it->first] = it->second;
+
+    blockElectrodeSet = electrodeSet.acquire();
+
     checkForEvents(eventBuffer);
 }
 
@@ -96,38 +208,182 @@ bool EventBroadcaster::isSink()
 
 void EventBroadcaster::handleEvent(int eventType, MidiMessage& event, int samplePosition)
 {
-    const uint8_t* buffer = event.getRawData();
-    uint8_t type = buffer[0];
-    int64_t timestamp;
-    
+    const uint8* buffer = event.getRawData();
+    const int rawSize = event.getRawDataSize();
+    uint8 type = buffer[0];
+    int64 timestamp;
+
+    // the raw event bytes without the leading event type byte
+    const uint8* payload = buffer + 1;
+    int payloadSize = rawSize - 1;
+
+    if (type > BINARY_MSG || !eventTypeEnabled[type])
+        return;
+
     switch (type) {
         case TTL:
         case MESSAGE:
-        case BINARY_MSG: {
-            uint8_t nodeID = buffer[1];
-            timestamp = timestamps.at(nodeID) + samplePosition;
+        case BINARY_MSG:
+            timestamp = blockTimestamps[buffer[1]] + samplePosition;
             break;
-        }
-            
+
         case SPIKE:
-            std::copy_n(buffer + 1, sizeof(timestamp), reinterpret_cast<uint8_t *>(&timestamp));
+        {
+            // spike events only refer to a pooled SpikeObject, so serialize it here
+            const SpikeObject* spike = getSpikeFromEvent(event);
+
+            if (spike == nullptr)
+                return;
+
+            if (blockElectrodeSet != nullptr && !blockElectrodeSet->allowed[spike->electrodeID])
+                return;
+
+            timestamp = spike->timestamp;
+
+            payloadSize = packSpike(spike, packedSpike, MAX_SPIKE_BUFFER_LEN) - 1;
+            payload = packedSpike + 1;
             break;
-            
+        }
+
         default:
             // Don't broadcast other event types
             return;
     }
-    
-    double timestampSeconds = double(timestamp) / currentSampleRate;
+
+    const int recordSize = RECORD_HEADER_SIZE + payloadSize;
+
+    if (recordSize > MAX_FRAME_SIZE - FRAME_HEADER_SIZE)
+    {
+        ++droppedEvents;
+        return;
+    }
+
+    uint8 header[RECORD_HEADER_SIZE];
+    uint16 size16 = (uint16) payloadSize;
+    header[0] = type;
+    header[1] = 0;
+    memcpy(header + 2, &size16, sizeof(size16));
+    memcpy(header + 4, &timestamp, sizeof(timestamp));
+
+    const int64 ingestionTicks = getIngestionTicks();
+    const int ringSize = RING_PREFIX_SIZE + recordSize;
+
+    int start1, size1, start2, size2;
+    eventFifo.prepareToWrite(ringSize, start1, size1, start2, size2);
+
+    if (size1 + size2 < ringSize)
+    {
+        // publishing thread has fallen behind; never block the audio thread
+        ++droppedEvents;
+        return;
+    }
+
+    copyToRing(start1, &ingestionTicks, RING_PREFIX_SIZE);
+    copyToRing((start1 + RING_PREFIX_SIZE) % EVENT_RING_SIZE, header, RECORD_HEADER_SIZE);
+    copyToRing((start1 + RING_PREFIX_SIZE + RECORD_HEADER_SIZE) % EVENT_RING_SIZE, payload, payloadSize);
+
+    eventFifo.finishedWrite(ringSize);
+}
+
+
+void EventBroadcaster::copyToRing(int ringIndex, const void* source, int numBytes)
+{
+    const int firstPart = jmin(numBytes, EVENT_RING_SIZE - ringIndex);
+
+    memcpy(eventRing + ringIndex, source, firstPart);
+
+    if (firstPart < numBytes)
+        memcpy(eventRing, static_cast<const uint8*>(source) + firstPart, numBytes - firstPart);
+}
+
+
+void EventBroadcaster::copyFromRing(int ringIndex, void* dest, int numBytes) const
+{
+    const int firstPart = jmin(numBytes, EVENT_RING_SIZE - ringIndex);
+
+    memcpy(dest, eventRing + ringIndex, firstPart);
+
+    if (firstPart < numBytes)
+        memcpy(static_cast<uint8*>(dest) + firstPart, eventRing, numBytes - firstPart);
+}
+
+
+void EventBroadcaster::run()
+{
+    bool exiting = false;
+
+    while (!exiting)
+    {
+        // check before draining, so events queued before disable() still go out
+        exiting = threadShouldExit();
+
+        while (eventFifo.getNumReady() >= RING_PREFIX_SIZE + RECORD_HEADER_SIZE)
+        {
+            int start1, size1, start2, size2;
+            eventFifo.prepareToRead(RING_PREFIX_SIZE + RECORD_HEADER_SIZE, start1, size1, start2, size2);
+
+            int64 ingestionTicks;
+            uint8 header[RECORD_HEADER_SIZE];
+            copyFromRing(start1, &ingestionTicks, RING_PREFIX_SIZE);
+            copyFromRing((start1 + RING_PREFIX_SIZE) % EVENT_RING_SIZE, header, RECORD_HEADER_SIZE);
+
+            uint16 payloadSize;
+            memcpy(&payloadSize, header + 2, sizeof(payloadSize));
+            const int recordSize = RECORD_HEADER_SIZE + payloadSize;
+
+            if (frameSize + recordSize > MAX_FRAME_SIZE)
+                sendFrame();
+
+            // records are committed whole, so the payload is always available here
+            eventFifo.prepareToRead(RING_PREFIX_SIZE + recordSize, start1, size1, start2, size2);
+            copyFromRing((start1 + RING_PREFIX_SIZE) % EVENT_RING_SIZE, frameBuffer + frameSize, recordSize);
+            eventFifo.finishedRead(RING_PREFIX_SIZE + recordSize);
+
+            frameSize += recordSize;
+            numEventsInFrame++;
+
+            if (ingestionTicks != 0 && (frameIngestionTicks == 0 || ingestionTicks < frameIngestionTicks))
+                frameIngestionTicks = ingestionTicks;
+        }
+
+        sendFrame();
+
+        if (!exiting)
+            wait(1);
+    }
+}
+
+
+void EventBroadcaster::sendFrame()
+{
+    if (numEventsInFrame == 0)
+        return;
+
+    const uint16 version = FRAME_VERSION;
+    const uint16 numEvents = (uint16) numEventsInFrame;
+    const uint32 dropped = (uint32) droppedEvents.get();
+    const float sampleRate = currentSampleRate;
+
+    memcpy(frameBuffer, "OEEV", 4);
+    memcpy(frameBuffer + 4, &version, sizeof(version));
+    memcpy(frameBuffer + 6, &numEvents, sizeof(numEvents));
+    memcpy(frameBuffer + 8, &frameNumber, sizeof(frameNumber));
+    memcpy(frameBuffer + 12, &dropped, sizeof(dropped));
+    memcpy(frameBuffer + 16, &sampleRate, sizeof(sampleRate));
 
 #ifdef ZEROMQ
-    if (-1 == zmq_send(zmqSocket.get(), &type, sizeof(type), ZMQ_SNDMORE) ||
-        -1 == zmq_send(zmqSocket.get(), &timestampSeconds, sizeof(timestampSeconds), ZMQ_SNDMORE) ||
-        -1 == zmq_send(zmqSocket.get(), buffer + 1, event.getRawDataSize() - 1, 0) /* Omit event type */)
+    if (zmqSocket && -1 == zmq_send(zmqSocket.get(), frameBuffer, frameSize, 0))
     {
         std::cout << "Failed to send message: " << zmq_strerror(zmq_errno()) << std::endl;
     }
 #endif
+
+    recordOutputLatency(frameIngestionTicks);
+
+    frameNumber++;
+    frameSize = FRAME_HEADER_SIZE;
+    numEventsInFrame = 0;
+    frameIngestionTicks = 0;
 }
 
 
@@ -135,6 +391,16 @@ void EventBroadcaster::saveCustomParametersToXml(XmlElement* parentElement)
 {
     XmlElement* mainNode = parentElement->createNewChildElement("EVENTBROADCASTER");
     mainNode->setAttribute("port", listeningPort);
+    mainNode->setAttribute("ttl", eventTypeEnabled[TTL]);
+    mainNode->setAttribute("message", eventTypeEnabled[MESSAGE]);
+    mainNode->setAttribute("binary", eventTypeEnabled[BINARY_MSG]);
+    mainNode->setAttribute("spike", eventTypeEnabled[SPIKE]);
+
+    StringArray electrodes;
+    for (int i = 0; i < electrodeFilter.size(); i++)
+        electrodes.add(String(electrodeFilter[i]));
+
+    mainNode->setAttribute("electrodes", electrodes.joinIntoString(","));
 }
 
 
@@ -147,6 +413,21 @@ void EventBroadcaster::loadCustomParametersFromXml()
             if (mainNode->hasTagName("EVENTBROADCASTER"))
             {
                 setListeningPort(mainNode->getIntAttribute("port"));
+
+                setEventTypeEnabled(TTL, mainNode->getBoolAttribute("ttl", true));
+                setEventTypeEnabled(MESSAGE, mainNode->getBoolAttribute("message", true));
+                setEventTypeEnabled(BINARY_MSG, mainNode->getBoolAttribute("binary", true));
+                setEventTypeEnabled(SPIKE, mainNode->getBoolAttribute("spike", true));
+
+                StringArray electrodes;
+                electrodes.addTokens(mainNode->getStringAttribute("electrodes"), ",", "");
+                electrodes.removeEmptyStrings();
+
+                Array<int> ids;
+                for (int i = 0; i < electrodes.size(); i++)
+                    ids.add(electrodes[i].getIntValue());
+
+                setElectrodeFilter(ids);
             }
         }
     }
@@ -12,6 +12,7 @@
 #define EVENTBROADCASTER_H_INCLUDED
 
 #include "../GenericProcessor/GenericProcessor.h"
+#include "../Parameter/PublishedObject.h"
 
 #ifdef ZEROMQ
 
@@ -24,34 +25,139 @@
 
 #endif
 #include <memory>
+#include <bitset>
 
-class EventBroadcaster : public GenericProcessor
+/**
+
+ Publishes TTL, message and spike events over a ZeroMQ PUB socket.
+
+ Events are never sent from the audio callback: handleEvent() only copies each
+ event into a preallocated ring buffer, and a dedicated thread drains the ring,
+ coalesces the events into frames and publishes one ZeroMQ message per frame.
+
+ Every frame is a single message part with the following little-endian layout
+ (no padding between fields):
+
+    Frame header (20 bytes)
+      char    magic[4]      "OEEV"
+      uint16  version       currently 1
+      uint16  numEvents     number of event records that follow
+      uint32  frameNumber   incremented for every frame sent since acquisition started
+      uint32  droppedEvents total events dropped so far because the ring was full
+      float32 sampleRate    sample rate used for the event timestamps (Hz)
+
+    Event record (12-byte header + payload), repeated numEvents times
+      uint8   eventType     GenericProcessor::TTL, MESSAGE, BINARY_MSG or SPIKE
+      uint8   reserved      always 0
+      uint16  payloadSize   number of payload bytes following the record header
+      int64   timestamp     event time in samples (divide by sampleRate for seconds)
+      uint8   payload[payloadSize]
+                            the raw event bytes without the leading event type byte;
+                            for spikes this is the packSpike() serialization of the
+                            spike minus its first byte
+
+ Each record is queued together with the ingestion time of its buffer; the
+ publishing thread records the latency of the oldest event in every frame it sends
+ (see GenericProcessor::getOutputLatency()).
+
+ Broadcasting can be restricted to a subset of event types and, for spikes,
+ to a subset of electrode IDs. Filtered events are never copied into the ring.
+
+ @see GenericProcessor, NetworkEvents
+
+*/
+
+class EventBroadcaster : public GenericProcessor, public Thread
 {
 public:
     EventBroadcaster();
+    ~EventBroadcaster();
 
     AudioProcessorEditor* createEditor() override;
 
     int getListeningPort() const;
     void setListeningPort(int port, bool forceRestart = false);
 
+    /** Enables or disables broadcasting of a given event type (TTL, MESSAGE, BINARY_MSG or SPIKE). */
+    void setEventTypeEnabled(int eventType, bool enabled);
+    bool isEventTypeEnabled(int eventType) const;
+
+    /** Restricts spike broadcasting to the given electrode IDs. An empty array broadcasts all electrodes. */
+    void setElectrodeFilter(const Array<int>& electrodeIds);
+    const Array<int>& getElectrodeFilter() const;
+
     void process(AudioSampleBuffer& continuousBuffer, MidiBuffer& eventBuffer) override;
     bool isSink() override;
     void handleEvent(int eventType, MidiMessage& event, int samplePosition = 0) override;
 
+    bool enable() override;
+    bool disable() override;
+
+    /** Publishing thread: drains the event ring and sends coalesced frames. */
+    void run() override;
+
     void saveCustomParametersToXml(XmlElement* parentElement) override;
     void loadCustomParametersFromXml() override;
 
+    enum
+    {
+        FRAME_HEADER_SIZE = 20,
+        RECORD_HEADER_SIZE = 12,
+        FRAME_VERSION = 1
+    };
+
 private:
+    enum
+    {
+        /** Ingestion ticks stored in front of each record in the ring; not sent */
+        RING_PREFIX_SIZE = 8
+    };
+
     static std::shared_ptr<void> getZMQContext();
     static void closeZMQSocket(void* socket);
-    
+
+    /** Copies bytes into / out of the ring, wrapping around its end if needed. */
+    void copyToRing(int ringIndex, const void* source, int numBytes);
+    void copyFromRing(int ringIndex, void* dest, int numBytes) const;
+
+    /** Sends the frame that has been assembled so far, if it holds any events. */
+    void sendFrame();
+
+    /** The electrode IDs whose spikes are broadcast. setElectrodeFilter() builds a new
+        set and publishes it whole; the audio thread acquires the current one once per
+        block. No set means every electrode. */
+    struct ElectrodeSet
+    {
+        std::bitset<65536> allowed;
+    };
+
     const std::shared_ptr<void> zmqContext;
     std::unique_ptr<void, decltype(&closeZMQSocket)> zmqSocket;
     int listeningPort;
-    
+
     float currentSampleRate;
 
+    /** Per-block copy of the 'timestamps' map, indexed by source node ID. */
+    int64 blockTimestamps[256];
+
+    AbstractFifo eventFifo;
+    HeapBlock<uint8> eventRing;
+
+    HeapBlock<uint8> frameBuffer;
+    HeapBlock<uint8> packedSpike;
+    int frameSize;
+    int numEventsInFrame;
+    int64 frameIngestionTicks;
+    uint32 frameNumber;
+    Atomic<int> droppedEvents;
+
+    bool eventTypeEnabled[BINARY_MSG + 1];
+    Array<int> electrodeFilter;
+    PublishedObject<ElectrodeSet> electrodeSet;
+    const ElectrodeSet* blockElectrodeSet;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventBroadcaster);
+
 };
 
 
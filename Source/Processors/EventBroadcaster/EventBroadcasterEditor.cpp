@@ -16,7 +16,7 @@ EventBroadcasterEditor::EventBroadcasterEditor(GenericProcessor* parentNode, boo
     : GenericEditor(parentNode, useDefaultParameterEditors)
 
 {
-    desiredWidth = 180;
+    desiredWidth = 250;
 
     urlLabel = new Label("Port", "Port:");
     urlLabel->setBounds(20,80,140,25);
@@ -37,10 +37,72 @@ EventBroadcasterEditor::EventBroadcasterEditor(GenericProcessor* parentNode, boo
     portLabel->addListener(this);
     addAndMakeVisible(portLabel);
 
+    electrodeTitleLabel = new Label("Electrodes", "Electrodes:");
+    electrodeTitleLabel->setBounds(20,105,80,20);
+    addAndMakeVisible(electrodeTitleLabel);
+
+    electrodeLabel = new Label("Electrodes", getElectrodeFilterText());
+    electrodeLabel->setBounds(100,107,70,18);
+    electrodeLabel->setFont(Font("Default", 15, Font::plain));
+    electrodeLabel->setColour(Label::textColourId, Colours::white);
+    electrodeLabel->setColour(Label::backgroundColourId, Colours::grey);
+    electrodeLabel->setEditable(true);
+    electrodeLabel->addListener(this);
+    addAndMakeVisible(electrodeLabel);
+
+    ttlButton = new UtilityButton("TTL",Font("Default", 12, Font::plain));
+    ttlButton->setBounds(180,45,55,18);
+    ttlButton->setClickingTogglesState(true);
+    ttlButton->setToggleState(p->isEventTypeEnabled(GenericProcessor::TTL), dontSendNotification);
+    ttlButton->addListener(this);
+    addAndMakeVisible(ttlButton);
+
+    messageButton = new UtilityButton("MSG",Font("Default", 12, Font::plain));
+    messageButton->setBounds(180,68,55,18);
+    messageButton->setClickingTogglesState(true);
+    messageButton->setToggleState(p->isEventTypeEnabled(GenericProcessor::MESSAGE), dontSendNotification);
+    messageButton->addListener(this);
+    addAndMakeVisible(messageButton);
+
+    spikeButton = new UtilityButton("SPIKE",Font("Default", 12, Font::plain));
+    spikeButton->setBounds(180,91,55,18);
+    spikeButton->setClickingTogglesState(true);
+    spikeButton->setToggleState(p->isEventTypeEnabled(GenericProcessor::SPIKE), dontSendNotification);
+    spikeButton->addListener(this);
+    addAndMakeVisible(spikeButton);
+
     setEnabledState(false);
 }
 
 
+void EventBroadcasterEditor::updateSettings()
+{
+    EventBroadcaster* p = (EventBroadcaster*)getProcessor();
+
+    portLabel->setText(String(p->getListeningPort()), dontSendNotification);
+    electrodeLabel->setText(getElectrodeFilterText(), dontSendNotification);
+    ttlButton->setToggleState(p->isEventTypeEnabled(GenericProcessor::TTL), dontSendNotification);
+    messageButton->setToggleState(p->isEventTypeEnabled(GenericProcessor::MESSAGE), dontSendNotification);
+    spikeButton->setToggleState(p->isEventTypeEnabled(GenericProcessor::SPIKE), dontSendNotification);
+}
+
+
+String EventBroadcasterEditor::getElectrodeFilterText()
+{
+    EventBroadcaster* p = (EventBroadcaster*)getProcessor();
+    const Array<int>& filter = p->getElectrodeFilter();
+
+    if (filter.size() == 0)
+        return "all";
+
+    StringArray ids;
+    for (int i = 0; i < filter.size(); i++)
+        ids.add(String(filter[i]));
+
+    return ids.joinIntoString(",");
+}
+
+
 void EventBroadcasterEditor::buttonEvent(Button* button)
 {
     if (button == restartConnection)
@@ -48,6 +110,22 @@ void EventBroadcasterEditor::buttonEvent(Button* button)
         EventBroadcaster* p = (EventBroadcaster*)getProcessor();
         p->setListeningPort(p->getListeningPort(), true);
     }
+    else if (button == ttlButton)
+    {
+        EventBroadcaster* p = (EventBroadcaster*)getProcessor();
+        p->setEventTypeEnabled(GenericProcessor::TTL, button->getToggleState());
+    }
+    else if (button == messageButton)
+    {
+        EventBroadcaster* p = (EventBroadcaster*)getProcessor();
+        p->setEventTypeEnabled(GenericProcessor::MESSAGE, button->getToggleState());
+        p->setEventTypeEnabled(GenericProcessor::BINARY_MSG, button->getToggleState());
+    }
+    else if (button == spikeButton)
+    {
+        EventBroadcaster* p = (EventBroadcaster*)getProcessor();
+        p->setEventTypeEnabled(GenericProcessor::SPIKE, button->getToggleState());
+    }
 }
 
 
@@ -60,4 +138,22 @@ void EventBroadcasterEditor::labelTextChanged(juce::Label* label)
         EventBroadcaster* p = (EventBroadcaster*)getProcessor();
         p->setListeningPort(val.getValue());
     }
+    else if (label == electrodeLabel)
+    {
+        StringArray tokens;
+        tokens.addTokens(label->getText(), ", ", "");
+        tokens.removeEmptyStrings();
+
+        Array<int> ids;
+        for (int i = 0; i < tokens.size(); i++)
+        {
+            if (tokens[i].containsOnly("0123456789"))
+                ids.add(tokens[i].getIntValue());
+        }
+
+        EventBroadcaster* p = (EventBroadcaster*)getProcessor();
+        p->setElectrodeFilter(ids);
+
+        label->setText(getElectrodeFilterText(), dontSendNotification);
+    }
 }
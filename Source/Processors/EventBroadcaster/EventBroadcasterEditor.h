@@ -29,12 +29,22 @@ public:
 
     void buttonEvent(Button* button) override;
     void labelTextChanged(juce::Label* label) override;
+    void updateSettings() override;
 
 private:
+    /** Formats the processor's electrode filter for display ("all" when unfiltered). */
+    String getElectrodeFilterText();
+
     ScopedPointer<UtilityButton> restartConnection;
     ScopedPointer<Label> urlLabel;
     ScopedPointer<Label> portLabel;
 
+    ScopedPointer<UtilityButton> ttlButton;
+    ScopedPointer<UtilityButton> messageButton;
+    ScopedPointer<UtilityButton> spikeButton;
+    ScopedPointer<Label> electrodeTitleLabel;
+    ScopedPointer<Label> electrodeLabel;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventBroadcasterEditor);
 
 };
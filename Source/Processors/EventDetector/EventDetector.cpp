@@ -26,13 +26,29 @@
 #include "EventDetector.h"
 //#include "Editors/EventDetectorEditor.h"
 
+// samples since the edge of a channel that has none to debounce
+static const int longAgo = 1 << 30;
+
 
 EventDetector::EventDetector()
-    : GenericProcessor("Event Detector"), threshold(200.0), bufferZone(5.0f), state(false)
+    : GenericProcessor("Event Detector"), numStates(0), eventCode(0)
 
 {
 
-    parameters.add(Parameter("thresh", 0.0, 500.0, 200.0, 0));
+    parameters.add(Parameter("thresh", -500.0, 500.0, 2.5, THRESHOLD));
+    parameters.add(Parameter("hyst", 0.0, 100.0, 0.5, HYSTERESIS));
+    parameters.add(Parameter("debounce (ms)", 0.0, 100.0, 1.0, DEBOUNCE));
+
+    Array<var> polarities;
+    polarities.add(-1);
+    polarities.add(0);
+    polarities.add(1);
+    parameters.add(Parameter("polarity", polarities, 1, POLARITY));
+
+    Array<var> codes;
+    codes.add(0);
+    codes.add(1);
+    parameters.add(Parameter("code", codes, 0, CODE));
 
 }
 
@@ -47,42 +63,159 @@ void EventDetector::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
 
-    Parameter& p =  parameters.getReference(parameterIndex);
-    p.setValue(newValue, 0);
+    if (currentChannel >= 0)
+    {
+        Parameter& p =  parameters.getReference(parameterIndex);
+        p.setValue(newValue, currentChannel);
+        parameterStore.setValue(parameterIndex, currentChannel, float(p[currentChannel]));
+    }
+
+}
+
+void EventDetector::updateSettings()
+{
 
-    threshold = newValue;
+    // channels nobody has set up yet: scan the ADC inputs, leave the rest
+    Parameter& polarity = parameters.getReference(POLARITY);
+
+    for (int ch = 0; ch < channels.size(); ch++)
+    {
+        if (polarity.getValue(ch).isVoid())
+            polarity.setValue(channels[ch]->type == ADC_CHANNEL ? 1.0f : 0.0f, ch);
+    }
 
-    //std::cout << float(p[0]) << std::endl;
+    parameterStore.update(parameters, channels.size());
+
+    numStates = channels.size();
+    states.calloc(jmax(1, numStates));
+    samplesSinceEdge.calloc(jmax(1, numStates));
 
 }
 
+bool EventDetector::enable()
+{
+
+    for (int ch = 0; ch < numStates; ch++)
+    {
+        states[ch] = false;
+        samplesSinceEdge[ch] = longAgo;
+    }
+
+    eventCode = 0;
+
+    return true;
+}
+
 void EventDetector::process(AudioSampleBuffer& buffer,
                             MidiBuffer& events)
 {
 
-    //std::cout << *buffer.getReadPointer(0, 0) << std::endl;
+    const ParameterStore::Block* params = parameterStore.acquire();
 
+    // event channels are a byte wide
+    const int numChannels = jmin(jmin(numStates, params->numChannels, buffer.getNumChannels()), 256);
 
-    for (int i = 0; i < getNumSamples(channels[0]->sourceNodeId); i++)
+    for (int ch = 0; ch < numChannels; ch++)
     {
+        const float polarity = params->get(POLARITY, ch);
 
-        if ((*buffer.getReadPointer(0, i) < -threshold) && !state)
-        {
+        if (polarity == 0)
+            continue;
+
+        const int nSamples = getNumSamples(ch);
+        const float* data = buffer.getReadPointer(ch);
 
-            // generate midi event
-            //std::cout << "Value = " << *buffer.getSampleData(0, i) << std::endl;
-            addEvent(events, TTL, i);
+        // work on polarity * signal, so that a channel always goes on above onLevel
+        const float onLevel = polarity * params->get(THRESHOLD, ch);
+        const float offLevel = onLevel - params->get(HYSTERESIS, ch);
+        const int debounce = int(params->get(DEBOUNCE, ch) * channels[ch]->sampleRate / 1000.0f);
 
-            state = true;
+        const Range<float> range = FloatVectorOperations::findMinAndMax(data, nSamples);
+        const float lowest = (polarity > 0) ? range.getStart() : -range.getEnd();
+        const float highest = (polarity > 0) ? range.getEnd() : -range.getStart();
 
+        if (states[ch] ? lowest >= offLevel : highest <= onLevel)
+        {
+            samplesSinceEdge[ch] = jmin(samplesSinceEdge[ch] + nSamples, longAgo);
+            continue;
         }
-        else if ((*buffer.getReadPointer(0, i) > -threshold + bufferZone)  && state)
+
+        const bool sendCode = params->get(CODE, ch) > 0;
+
+        for (int i = 0; i < nSamples; i++)
         {
-            state = false;
+            const float sample = polarity * data[i];
+
+            if ((states[ch] ? sample < offLevel : sample > onLevel) && samplesSinceEdge[ch] >= debounce)
+            {
+                states[ch] = !states[ch];
+                samplesSinceEdge[ch] = 0;
+
+                if (ch < 64)
+                {
+                    if (states[ch])
+                        eventCode |= (uint64(1) << ch);
+                    else
+                        eventCode &= ~(uint64(1) << ch);
+                }
+
+                if (sendCode)
+                    addEvent(events, TTL, i, states[ch] ? 1 : 0, ch, 8, (uint8*) &eventCode);
+                else
+                    addEvent(events, TTL, i, states[ch] ? 1 : 0, ch);
+            }
+
+            if (samplesSinceEdge[ch] < longAgo)
+                samplesSinceEdge[ch]++;
         }
 
+    }
+
+}
+
+void EventDetector::saveCustomChannelParametersToXml(XmlElement* channelInfo, int channelNumber, bool isEventChannel)
+{
+
+    if (!isEventChannel && channelNumber > -1 && channelNumber < channels.size())
+    {
+        XmlElement* channelParams = channelInfo->createNewChildElement("PARAMETERS");
+
+        for (int i = 0; i < parameters.size(); i++)
+        {
+            Parameter& p = parameters.getReference(i);
+            const var value = p.getValue(channelNumber);
 
+            if (!value.isVoid())
+                channelParams->setAttribute(p.getName().removeCharacters(" ()"), double(value));
+        }
     }
 
+}
+
+void EventDetector::loadCustomChannelParametersFromXml(XmlElement* channelInfo, bool isEventChannel)
+{
+
+    int channelNum = channelInfo->getIntAttribute("number");
+
+    if (!isEventChannel)
+    {
+        forEachXmlChildElement(*channelInfo, subNode)
+        {
+            if (subNode->hasTagName("PARAMETERS"))
+            {
+                for (int i = 0; i < parameters.size(); i++)
+                {
+                    Parameter& p = parameters.getReference(i);
+                    const String name = p.getName().removeCharacters(" ()");
+
+                    if (subNode->hasAttribute(name))
+                    {
+                        p.setValue(float(subNode->getDoubleAttribute(name)), channelNum);
+                        parameterStore.setValue(i, channelNum, float(p[channelNum]));
+                    }
+                }
+            }
+        }
+    }
 
 }
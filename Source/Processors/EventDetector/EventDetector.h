@@ -29,7 +29,22 @@
 
 /**
 
-  Searches for threshold crossings and sends out TTL events.
+  Searches any set of channels for threshold crossings and sends out TTL events.
+
+  Each channel has its own threshold, hysteresis, debounce time and polarity,
+  set through the channel selector (polarity 0 leaves a channel alone; ADC
+  channels are scanned by default). A channel goes on when it crosses its
+  threshold in the direction of its polarity, and off when it returns past the
+  threshold by more than the hysteresis; both edges are sent as TTL events on
+  the event channel with the channel's number, at the sample where they happen.
+  Edges closer than the debounce time to the previous one are ignored.
+
+  Most blocks hold no edge at all, so each channel's range over the block is
+  found first with vector operations, and only channels whose range reaches
+  the next edge are scanned sample by sample.
+
+  With "code" on, a channel's events also carry the states of the first 64
+  channels as a bitfield, like the event codes of a SourceNode.
 
   @see GenericProcessor
 
@@ -46,11 +61,31 @@ public:
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
     void setParameter(int parameterIndex, float newValue);
 
+    bool enable();
+
+    void updateSettings();
+
+    void saveCustomChannelParametersToXml(XmlElement* channelInfo, int channelNumber, bool isEventChannel);
+    void loadCustomChannelParametersFromXml(XmlElement* channelInfo, bool isEventChannel);
+
+    enum ParameterIndex
+    {
+        THRESHOLD = 0,
+        HYSTERESIS,
+        DEBOUNCE,
+        POLARITY,
+        CODE
+    };
+
 private:
 
-    float threshold;
-    float bufferZone;
-    bool state;
+    /** Per channel: whether it is on, and the samples since its last edge */
+    HeapBlock<bool> states;
+    HeapBlock<int> samplesSinceEdge;
+    int numStates;
+
+    /** The states of the first 64 channels, one bit each */
+    uint64 eventCode;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventDetector);
 
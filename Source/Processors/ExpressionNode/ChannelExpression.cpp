@@ -0,0 +1,688 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ChannelExpression.h"
+#include <cmath>
+#include <limits>
+
+
+/** Recursive-descent parser that emits the instructions of an ChannelExpression as it goes. */
+class ChannelExpression::Parser
+{
+public:
+    Parser(ChannelExpression& e, const String& formula, int numChannels_, float sampleRate_)
+        : expression(e), text(formula), pos(0), numChannels(numChannels_), sampleRate(sampleRate_)
+    {
+    }
+
+    bool parse(String& error)
+    {
+        Operand result;
+
+        if (parseSum(result))
+        {
+            skipSpaces();
+
+            if (pos < text.length())
+                fail("unexpected '" + text.substring(pos, pos + 1) + "'");
+        }
+
+        if (message.isNotEmpty())
+        {
+            error = message;
+            return false;
+        }
+
+        expression.resultSlot = result.isConstant ? -1 : result.slot;
+        expression.resultConstant = result.value;
+
+        return true;
+    }
+
+private:
+
+    struct Operand
+    {
+        Operand() : isConstant(true), value(0), slot(-1) {}
+
+        bool isConstant;
+        float value;
+        int slot;
+    };
+
+    bool fail(const String& problem)
+    {
+        if (message.isEmpty())
+            message = problem;
+
+        return false;
+    }
+
+    void skipSpaces()
+    {
+        while (pos < text.length() && CharacterFunctions::isWhitespace(text[pos]))
+            pos++;
+    }
+
+    bool accept(juce_wchar c)
+    {
+        skipSpaces();
+
+        if (pos < text.length() && text[pos] == c)
+        {
+            pos++;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool expect(juce_wchar c)
+    {
+        if (accept(c))
+            return true;
+
+        return fail("expected '" + String::charToString(c) + "'");
+    }
+
+    bool parseSum(Operand& result)
+    {
+        if (!parseProduct(result))
+            return false;
+
+        for (;;)
+        {
+            OpCode op;
+
+            if (accept('+'))
+                op = ADD;
+            else if (accept('-'))
+                op = SUBTRACT;
+            else
+                return true;
+
+            Operand other;
+
+            if (!parseProduct(other))
+                return false;
+
+            result = binary(op, result, other);
+        }
+    }
+
+    bool parseProduct(Operand& result)
+    {
+        if (!parseUnary(result))
+            return false;
+
+        for (;;)
+        {
+            OpCode op;
+
+            if (accept('*'))
+                op = MULTIPLY;
+            else if (accept('/'))
+                op = DIVIDE;
+            else
+                return true;
+
+            Operand other;
+
+            if (!parseUnary(other))
+                return false;
+
+            result = binary(op, result, other);
+        }
+    }
+
+    bool parseUnary(Operand& result)
+    {
+        if (accept('-'))
+        {
+            if (!parseUnary(result))
+                return false;
+
+            result = affine(result, -1.0f, 0.0f);
+            return true;
+        }
+
+        if (!parsePrimary(result))
+            return false;
+
+        if (accept('^'))
+        {
+            Operand exponent;
+
+            if (!parsePrimary(exponent))
+                return false;
+
+            if (!exponent.isConstant || exponent.value != 2.0f)
+                return fail("only ^2 is supported");
+
+            result = unary(SQUARE, result);
+        }
+
+        return true;
+    }
+
+    bool parsePrimary(Operand& result)
+    {
+        skipSpaces();
+
+        if (pos >= text.length())
+            return fail("unexpected end of formula");
+
+        const juce_wchar c = text[pos];
+
+        if (c == '(')
+        {
+            pos++;
+            return parseSum(result) && expect(')');
+        }
+
+        if (CharacterFunctions::isDigit(c) || c == '.')
+        {
+            const int start = pos;
+
+            while (pos < text.length() && (CharacterFunctions::isDigit(text[pos]) || text[pos] == '.'))
+                pos++;
+
+            result.isConstant = true;
+            result.value = text.substring(start, pos).getFloatValue();
+            return true;
+        }
+
+        if (!CharacterFunctions::isLetter(c))
+            return fail("unexpected '" + String::charToString(c) + "'");
+
+        const int start = pos;
+
+        while (pos < text.length() && CharacterFunctions::isLetterOrDigit(text[pos]))
+            pos++;
+
+        const String name = text.substring(start, pos).toLowerCase();
+
+        if (name == "x")
+        {
+            result = source(INPUT_SLOT);
+            return true;
+        }
+
+        Array<Operand> arguments;
+
+        if (!expect('('))
+            return false;
+
+        if (!accept(')'))
+        {
+            do
+            {
+                Operand argument;
+
+                if (!parseSum(argument))
+                    return false;
+
+                arguments.add(argument);
+            }
+            while (accept(','));
+
+            if (!expect(')'))
+                return false;
+        }
+
+        return function(name, arguments, result);
+    }
+
+    bool function(const String& name, const Array<Operand>& arguments, Operand& result)
+    {
+        int numArguments;
+
+        if (name == "abs" || name == "sq" || name == "sqrt" || name == "ch")
+            numArguments = 1;
+        else if (name == "min" || name == "max" || name == "smooth")
+            numArguments = 2;
+        else if (name == "clip")
+            numArguments = 3;
+        else
+            return fail("unknown function '" + name + "'");
+
+        if (arguments.size() != numArguments)
+            return fail(name + "() takes " + String(numArguments) + " argument" + (numArguments > 1 ? "s" : ""));
+
+        const Operand& a = arguments.getReference(0);
+
+        if (name == "abs")
+        {
+            result = unary(ABS, a);
+        }
+        else if (name == "sq")
+        {
+            result = unary(SQUARE, a);
+        }
+        else if (name == "sqrt")
+        {
+            result = unary(SQRT, a);
+        }
+        else if (name == "min")
+        {
+            result = binary(MINIMUM, a, arguments[1]);
+        }
+        else if (name == "max")
+        {
+            result = binary(MAXIMUM, a, arguments[1]);
+        }
+        else if (name == "ch")
+        {
+            const int channel = roundFloatToInt(a.value) - 1;
+
+            if (!a.isConstant || channel < 0 || channel >= numChannels)
+                return fail("ch() needs a channel number from 1 to " + String(numChannels));
+
+            result = source(channel);
+        }
+        else if (name == "clip")
+        {
+            if (!arguments[1].isConstant || !arguments[2].isConstant)
+                return fail("the limits of clip() must be numbers");
+
+            result = clip(a, arguments[1].value, arguments[2].value);
+        }
+        else if (name == "smooth")
+        {
+            if (!arguments[1].isConstant || arguments[1].value < 0)
+                return fail("the time constant of smooth() must be a number of ms");
+
+            const float samples = arguments[1].value * sampleRate / 1000.0f;
+
+            if (samples <= 0 || a.isConstant)
+            {
+                result = a;
+            }
+            else
+            {
+                Instruction instruction = newInstruction(SMOOTH, a.slot);
+                instruction.constant = 1.0f - std::exp(-1.0f / samples);
+                instruction.state = expression.numStates++;
+
+                result = emit(instruction);
+            }
+        }
+
+        return true;
+    }
+
+    Operand source(int channel)
+    {
+        Operand result;
+        result.isConstant = false;
+        result.slot = expression.slotSources.indexOf(channel);
+
+        if (result.slot < 0)
+        {
+            result.slot = expression.slotSources.size();
+            expression.slotSources.add(channel);
+
+            if (channel >= 0)
+                expression.referencedChannels.add(channel);
+        }
+
+        return result;
+    }
+
+    Instruction newInstruction(OpCode op, int a, int b = 0)
+    {
+        Instruction instruction;
+        instruction.op = op;
+        instruction.a = a;
+        instruction.b = b;
+        instruction.constant = 0;
+        instruction.constant2 = 0;
+        instruction.state = -1;
+
+        return instruction;
+    }
+
+    Operand emit(const Instruction& instruction)
+    {
+        Operand result;
+        result.isConstant = false;
+        result.slot = expression.slotSources.size();
+
+        expression.slotSources.add(REGISTER_SLOT);
+        expression.instructionSlots.add(result.slot);
+        expression.instructions.add(instruction);
+
+        return result;
+    }
+
+    /** The last instruction, if it produced a; every result is used once, so it can be changed in place */
+    Instruction* producerOf(const Operand& a)
+    {
+        if (a.isConstant || expression.instructions.size() == 0
+            || expression.instructionSlots.getLast() != a.slot)
+            return nullptr;
+
+        return &expression.instructions.getReference(expression.instructions.size() - 1);
+    }
+
+    /** a * gain + offset */
+    Operand affine(const Operand& a, float gain, float offset)
+    {
+        if (a.isConstant)
+        {
+            Operand result;
+            result.value = a.value * gain + offset;
+            return result;
+        }
+
+        if (Instruction* last = producerOf(a))
+        {
+            if (last->op == MULTIPLY_ADD)
+            {
+                last->constant *= gain;
+                last->constant2 = last->constant2 * gain + offset;
+                return a;
+            }
+        }
+
+        Instruction instruction = newInstruction(MULTIPLY_ADD, a.slot);
+        instruction.constant = gain;
+        instruction.constant2 = offset;
+
+        return emit(instruction);
+    }
+
+    Operand clip(const Operand& a, float low, float high)
+    {
+        high = jmax(low, high);
+
+        if (a.isConstant)
+        {
+            Operand result;
+            result.value = jmin(jmax(a.value, low), high);
+            return result;
+        }
+
+        // clipping a clipped signal clips its limits
+        if (Instruction* last = producerOf(a))
+        {
+            if (last->op == CLIP)
+            {
+                last->constant = jmin(jmax(last->constant, low), high);
+                last->constant2 = jmin(jmax(last->constant2, low), high);
+                return a;
+            }
+        }
+
+        Instruction instruction = newInstruction(CLIP, a.slot);
+        instruction.constant = low;
+        instruction.constant2 = high;
+
+        return emit(instruction);
+    }
+
+    Operand unary(OpCode op, const Operand& a)
+    {
+        if (a.isConstant)
+        {
+            Operand result;
+
+            if (op == ABS)
+                result.value = std::abs(a.value);
+            else if (op == SQUARE)
+                result.value = a.value * a.value;
+            else
+                result.value = std::sqrt(a.value);
+
+            return result;
+        }
+
+        return emit(newInstruction(op, a.slot));
+    }
+
+    Operand binary(OpCode op, const Operand& a, const Operand& b)
+    {
+        const float infinity = std::numeric_limits<float>::infinity();
+
+        if (a.isConstant && b.isConstant)
+        {
+            Operand result;
+
+            switch (op)
+            {
+                case ADD: result.value = a.value + b.value; break;
+                case SUBTRACT: result.value = a.value - b.value; break;
+                case MULTIPLY: result.value = a.value * b.value; break;
+                case DIVIDE: result.value = a.value / b.value; break;
+                case MINIMUM: result.value = jmin(a.value, b.value); break;
+                default: result.value = jmax(a.value, b.value); break;
+            }
+
+            return result;
+        }
+
+        if (b.isConstant)
+        {
+            switch (op)
+            {
+                case ADD: return affine(a, 1.0f, b.value);
+                case SUBTRACT: return affine(a, 1.0f, -b.value);
+                case MULTIPLY: return affine(a, b.value, 0.0f);
+                case DIVIDE: return affine(a, 1.0f / b.value, 0.0f);
+                case MINIMUM: return clip(a, -infinity, b.value);
+                default: return clip(a, b.value, infinity);
+            }
+        }
+
+        if (a.isConstant)
+        {
+            Instruction instruction = newInstruction(op, b.slot);
+            instruction.constant = a.value;
+
+            switch (op)
+            {
+                case SUBTRACT:
+                    return affine(b, -1.0f, a.value);
+                case DIVIDE:
+                    instruction.op = DIVIDE_CONSTANT;
+                    return emit(instruction);
+                default:
+                    return binary(op, b, a);
+            }
+        }
+
+        return emit(newInstruction(op, a.slot, b.slot));
+    }
+
+    ChannelExpression& expression;
+    const String text;
+    int pos;
+    const int numChannels;
+    const float sampleRate;
+    String message;
+};
+
+
+ChannelExpression::ChannelExpression()
+    : numStates(0), resultSlot(-1), resultConstant(0)
+{
+
+}
+
+
+ChannelExpression::~ChannelExpression()
+{
+
+}
+
+
+ChannelExpression* ChannelExpression::compile(const String& formula, int numChannels, float sampleRate, String& error)
+{
+    ScopedPointer<ChannelExpression> expression = new ChannelExpression();
+
+    Parser parser(*expression, formula, numChannels, sampleRate);
+
+    if (!parser.parse(error))
+        return nullptr;
+
+    return expression.release();
+}
+
+
+bool ChannelExpression::isIdentity() const
+{
+    return resultSlot >= 0 && slotSources[resultSlot] == INPUT_SLOT;
+}
+
+
+const Array<int>& ChannelExpression::getReferencedChannels() const
+{
+    return referencedChannels;
+}
+
+
+int ChannelExpression::getNumStates() const
+{
+    return numStates;
+}
+
+
+int ChannelExpression::getScratchSize() const
+{
+    return instructions.size() * CHUNK_SIZE;
+}
+
+
+int ChannelExpression::getNumSlots() const
+{
+    return slotSources.size();
+}
+
+
+void ChannelExpression::run(const float* input, const float* const* channelData, float* output, int numSamples,
+                     float* state, float* scratch, const float** slots) const
+{
+    const int numInstructions = instructions.size();
+
+    // the last instruction writes straight into the output
+    const bool lastWritesOutput = numInstructions > 0 && resultSlot == instructionSlots.getLast();
+
+    for (int offset = 0; offset < numSamples; offset += CHUNK_SIZE)
+    {
+        const int n = jmin(int(CHUNK_SIZE), numSamples - offset);
+
+        for (int s = 0; s < slotSources.size(); s++)
+        {
+            const int channel = slotSources.getUnchecked(s);
+
+            if (channel == INPUT_SLOT)
+                slots[s] = input + offset;
+            else if (channel >= 0)
+                slots[s] = channelData[channel] + offset;
+        }
+
+        for (int k = 0; k < numInstructions; k++)
+        {
+            const Instruction& instruction = instructions.getReference(k);
+
+            float* d = (lastWritesOutput && k == numInstructions - 1) ? output + offset
+                                                                       : scratch + k * CHUNK_SIZE;
+            const float* a = slots[instruction.a];
+            const float* b = slots[instruction.b];
+            const float c = instruction.constant;
+            const float c2 = instruction.constant2;
+
+            switch (instruction.op)
+            {
+                case ADD:
+                    for (int i = 0; i < n; i++)
+                        d[i] = a[i] + b[i];
+                    break;
+                case SUBTRACT:
+                    for (int i = 0; i < n; i++)
+                        d[i] = a[i] - b[i];
+                    break;
+                case MULTIPLY:
+                    for (int i = 0; i < n; i++)
+                        d[i] = a[i] * b[i];
+                    break;
+                case DIVIDE:
+                    for (int i = 0; i < n; i++)
+                        d[i] = a[i] / b[i];
+                    break;
+                case MINIMUM:
+                    for (int i = 0; i < n; i++)
+                        d[i] = jmin(a[i], b[i]);
+                    break;
+                case MAXIMUM:
+                    for (int i = 0; i < n; i++)
+                        d[i] = jmax(a[i], b[i]);
+                    break;
+                case MULTIPLY_ADD:
+                    for (int i = 0; i < n; i++)
+                        d[i] = a[i] * c + c2;
+                    break;
+                case DIVIDE_CONSTANT:
+                    for (int i = 0; i < n; i++)
+                        d[i] = c / a[i];
+                    break;
+                case CLIP:
+                    for (int i = 0; i < n; i++)
+                        d[i] = jmin(jmax(a[i], c), c2);
+                    break;
+                case ABS:
+                    for (int i = 0; i < n; i++)
+                        d[i] = std::abs(a[i]);
+                    break;
+                case SQUARE:
+                    for (int i = 0; i < n; i++)
+                        d[i] = a[i] * a[i];
+                    break;
+                case SQRT:
+                    for (int i = 0; i < n; i++)
+                        d[i] = std::sqrt(a[i]);
+                    break;
+                case SMOOTH:
+                {
+                    float y = state[instruction.state];
+
+                    for (int i = 0; i < n; i++)
+                    {
+                        y += c * (a[i] - y);
+                        d[i] = y;
+                    }
+
+                    state[instruction.state] = y;
+                    break;
+                }
+            }
+
+            slots[instructionSlots.getUnchecked(k)] = d;
+        }
+
+        if (resultSlot < 0)
+            FloatVectorOperations::fill(output + offset, resultConstant, n);
+        else if (!lastWritesOutput && slots[resultSlot] != output + offset)
+            FloatVectorOperations::copy(output + offset, slots[resultSlot], n);
+    }
+}
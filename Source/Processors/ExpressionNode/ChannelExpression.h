@@ -0,0 +1,134 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef CHANNELEXPRESSION_H_INCLUDED
+#define CHANNELEXPRESSION_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  A per-channel formula, compiled into a short list of vector operations.
+
+  x stands for the channel's own signal. A formula combines it with numbers,
+  + - * / and ^2, and the functions:
+
+      abs(a), sq(a), sqrt(a), min(a, b), max(a, b),
+      clip(a, low, high)    low and high are numbers
+      smooth(a, ms)         exponential smoothing with a time constant in ms
+      ch(n)                 the input of channel n (counting from 1)
+
+  e.g. "smooth(abs(x - ch(3)), 20)" or "2.5 * x + 10".
+
+  Operations on a number are folded in while compiling, so chains of gains and
+  offsets become one multiply-add and min/max against numbers become one clip.
+  When it runs, every operation is applied to CHUNK_SIZE samples at a time, and
+  the whole list goes through one chunk before the next, so a block is read and
+  written once however long the formula is and intermediate values stay in cache.
+
+  @see ExpressionNode
+
+*/
+
+class ChannelExpression
+{
+public:
+    ~ChannelExpression();
+
+    /** Compiles a formula for a processor with numChannels inputs at sampleRate.
+        Returns nullptr and describes the problem in error if it can't be compiled. */
+    static ChannelExpression* compile(const String& formula, int numChannels, float sampleRate, String& error);
+
+    /** True for a formula that leaves the signal unchanged, such as "x" */
+    bool isIdentity() const;
+
+    /** The inputs read through ch(n), as channel indices */
+    const Array<int>& getReferencedChannels() const;
+
+    /** Values of smooth() kept from one block to the next */
+    int getNumStates() const;
+
+    /** Size of the scratch memory run() needs, in floats and in pointers */
+    int getScratchSize() const;
+    int getNumSlots() const;
+
+    /** Computes numSamples of output from input; output may be input. channelData holds
+        the inputs of the referenced channels, indexed by channel, and must not be output. */
+    void run(const float* input, const float* const* channelData, float* output, int numSamples,
+             float* state, float* scratch, const float** slots) const;
+
+    enum
+    {
+        CHUNK_SIZE = 64
+    };
+
+private:
+
+    ChannelExpression();
+
+    class Parser;
+
+    enum OpCode
+    {
+        ADD, SUBTRACT, MULTIPLY, DIVIDE, MINIMUM, MAXIMUM,
+        MULTIPLY_ADD,           // a * constant + constant2
+        DIVIDE_CONSTANT,        // constant / a
+        CLIP,                   // a limited to [constant, constant2]
+        ABS, SQUARE, SQRT,
+        SMOOTH                  // a smoothed with coefficient constant
+    };
+
+    struct Instruction
+    {
+        OpCode op;
+        int a;
+        int b;
+        float constant;
+        float constant2;
+        int state;
+    };
+
+    /** What a slot holds: the input, a referenced channel, or an instruction's result */
+    enum
+    {
+        INPUT_SLOT = -1,
+        REGISTER_SLOT = -2
+    };
+
+    Array<Instruction> instructions;
+    Array<int> slotSources;
+    Array<int> instructionSlots;
+    Array<int> referencedChannels;
+
+    int numStates;
+
+    /** The result: a slot, or a constant when resultSlot is -1 */
+    int resultSlot;
+    float resultConstant;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelExpression);
+
+};
+
+
+#endif  // CHANNELEXPRESSION_H_INCLUDED
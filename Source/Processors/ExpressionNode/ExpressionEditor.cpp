@@ -0,0 +1,106 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ExpressionEditor.h"
+#include "ExpressionNode.h"
+
+
+ExpressionEditor::ExpressionEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors=true)
+    : GenericEditor(parentNode, useDefaultParameterEditors)
+
+{
+    desiredWidth = 220;
+
+    formulaLabel = new Label("formula label", "Formula:");
+    formulaLabel->setBounds(10,30,80,20);
+    formulaLabel->setFont(Font("Small Text", 12, Font::plain));
+    formulaLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(formulaLabel);
+
+    formulaValue = new Label("formula value", lastFormulaString);
+    formulaValue->setBounds(15,50,190,18);
+    formulaValue->setFont(Font("Default", 15, Font::plain));
+    formulaValue->setColour(Label::textColourId, Colours::white);
+    formulaValue->setColour(Label::backgroundColourId, Colours::grey);
+    formulaValue->setEditable(true);
+    formulaValue->addListener(this);
+    formulaValue->setTooltip("Formula for the selected channels, in terms of x, numbers, + - * / ^2, "
+                             "abs, sq, sqrt, min, max, clip(a, low, high), smooth(a, ms) and ch(n); "
+                             "leave empty to pass the channels through");
+    addAndMakeVisible(formulaValue);
+
+}
+
+ExpressionEditor::~ExpressionEditor()
+{
+
+}
+
+
+void ExpressionEditor::labelTextChanged(Label* label)
+{
+    ExpressionNode* en = (ExpressionNode*) getProcessor();
+
+    const String formula = label->getText().trim();
+    String error;
+
+    if (formula.isNotEmpty() && !en->checkFormula(formula, error))
+    {
+        CoreServices::sendStatusMessage("Formula error: " + error);
+        label->setText(lastFormulaString, dontSendNotification);
+        return;
+    }
+
+    lastFormulaString = formula;
+
+    Array<int> chans = getActiveChannels();
+
+    for (int n = 0; n < chans.size(); n++)
+        en->setFormula(chans[n], formula);
+
+    CoreServices::updateSignalChain(this);
+
+}
+
+
+void ExpressionEditor::channelChanged(int chan)
+{
+    ExpressionNode* en = (ExpressionNode*) getProcessor();
+
+    lastFormulaString = en->getFormula(chan);
+    formulaValue->setText(lastFormulaString, dontSendNotification);
+}
+
+
+void ExpressionEditor::startAcquisition()
+{
+    formulaValue->setEnabled(false);
+    GenericEditor::startAcquisition();
+}
+
+
+void ExpressionEditor::stopAcquisition()
+{
+    formulaValue->setEnabled(true);
+    GenericEditor::stopAcquisition();
+}
@@ -0,0 +1,66 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef EXPRESSIONEDITOR_H_INCLUDED
+#define EXPRESSIONEDITOR_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Editors/GenericEditor.h"
+
+/**
+
+  User interface for the ExpressionNode processor.
+
+  The formula is applied to the channels chosen with the channel selector.
+
+  @see ExpressionNode
+
+*/
+
+class ExpressionEditor : public GenericEditor,
+    public Label::Listener
+{
+public:
+    ExpressionEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors);
+    virtual ~ExpressionEditor();
+
+    void labelTextChanged(Label* label);
+
+    void channelChanged(int chan);
+
+    void startAcquisition();
+    void stopAcquisition();
+
+private:
+
+    String lastFormulaString;
+
+    ScopedPointer<Label> formulaLabel;
+    ScopedPointer<Label> formulaValue;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ExpressionEditor);
+
+};
+
+
+#endif  // EXPRESSIONEDITOR_H_INCLUDED
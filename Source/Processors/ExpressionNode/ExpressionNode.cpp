@@ -0,0 +1,242 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ExpressionNode.h"
+#include "ExpressionEditor.h"
+#include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
+
+
+ExpressionNode::ExpressionNode()
+    : GenericProcessor("Expression"), numStates(0), referenceBuffer(1, 1024)
+{
+
+}
+
+
+ExpressionNode::~ExpressionNode()
+{
+
+}
+
+
+AudioProcessorEditor* ExpressionNode::createEditor()
+{
+    editor = new ExpressionEditor(this, true);
+    return editor;
+}
+
+
+void ExpressionNode::setFormula(int channel, const String& formula)
+{
+    if (channel < 0)
+        return;
+
+    while (formulas.size() <= channel)
+        formulas.add(String::empty);
+
+    formulas.set(channel, formula.trim());
+}
+
+
+String ExpressionNode::getFormula(int channel) const
+{
+    return formulas[channel];
+}
+
+
+bool ExpressionNode::checkFormula(const String& formula, String& error)
+{
+    ScopedPointer<ChannelExpression> expression = ChannelExpression::compile(formula, getNumInputs(),
+                                                                             getSampleRate(), error);
+
+    return expression != nullptr;
+}
+
+
+void ExpressionNode::updateSettings()
+{
+
+    expressions.clear();
+    channelExpressions.clearQuick();
+    stateOffsets.clearQuick();
+    referencedChannels.clearQuick();
+
+    // smooth() folds the sample rate into the program, so a program is only shared
+    // between channels with the same formula and the same sample rate
+    StringArray compiledFormulas;
+    Array<float> compiledSampleRates;
+    numStates = 0;
+
+    int scratchSize = 0;
+    int numSlots = 0;
+
+    for (int ch = 0; ch < channels.size(); ch++)
+    {
+        const String formula = formulas[ch];
+        const float sampleRate = channels[ch]->sampleRate;
+        int index = -1;
+
+        if (formula.isNotEmpty())
+        {
+            // smoothing states differ between channels, but the program is the same
+            for (int i = 0; i < compiledFormulas.size() && index < 0; i++)
+            {
+                if (compiledFormulas[i] == formula && compiledSampleRates[i] == sampleRate)
+                    index = i;
+            }
+
+            if (index < 0)
+            {
+                String error;
+                ChannelExpression* expression = ChannelExpression::compile(formula, channels.size(),
+                                                                           sampleRate, error);
+
+                if (expression == nullptr)
+                {
+                    std::cout << "Expression: channel " << ch + 1 << ": " << error << std::endl;
+                }
+                else if (!expression->isIdentity())
+                {
+                    index = expressions.size();
+                    expressions.add(expression);
+                    compiledFormulas.add(formula);
+                    compiledSampleRates.add(sampleRate);
+                }
+                else
+                {
+                    delete expression;
+                }
+            }
+        }
+
+        channelExpressions.add(index);
+        stateOffsets.add(numStates);
+
+        if (index >= 0)
+        {
+            const ChannelExpression* expression = expressions[index];
+
+            numStates += expression->getNumStates();
+            scratchSize = jmax(scratchSize, expression->getScratchSize());
+            numSlots = jmax(numSlots, expression->getNumSlots());
+
+            for (int i = 0; i < expression->getReferencedChannels().size(); i++)
+                referencedChannels.addIfNotAlreadyThere(expression->getReferencedChannels()[i]);
+        }
+    }
+
+    states.calloc(jmax(1, numStates));
+    scratch.calloc(jmax(1, scratchSize));
+    slots.calloc(jmax(1, numSlots));
+    channelData.calloc(jmax(1, channels.size()));
+
+    // sized for the device's blocks, so process() only copies into it
+    int maxBlock = referenceBuffer.getNumSamples();
+
+    if (AccessClass::getAudioComponent() != nullptr)
+        maxBlock = jmax(maxBlock, AccessClass::getAudioComponent()->getBufferSize());
+
+    referenceBuffer.setSize(jmax(1, referencedChannels.size()), maxBlock);
+
+    for (int i = 0; i < referencedChannels.size(); i++)
+        channelData[referencedChannels[i]] = referenceBuffer.getReadPointer(i);
+
+}
+
+
+bool ExpressionNode::enable()
+{
+    zeromem(states, jmax(1, numStates) * sizeof(float));
+
+    return true;
+}
+
+
+void ExpressionNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
+{
+    const int numChannels = jmin(channelExpressions.size(), buffer.getNumChannels());
+
+    if (referencedChannels.size() > 0)
+    {
+        // only a block longer than the device's buffer size makes this grow
+        if (buffer.getNumSamples() > referenceBuffer.getNumSamples())
+            referenceBuffer.setSize(referenceBuffer.getNumChannels(), buffer.getNumSamples(), false, false, true);
+
+        for (int i = 0; i < referencedChannels.size(); i++)
+        {
+            const int ch = referencedChannels[i];
+
+            if (ch < buffer.getNumChannels())
+                referenceBuffer.copyFrom(i, 0, buffer, ch, 0, jmin(getNumSamples(ch), buffer.getNumSamples()));
+
+            channelData[ch] = referenceBuffer.getReadPointer(i);
+        }
+    }
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        const int index = channelExpressions.getUnchecked(ch);
+
+        if (index < 0)
+            continue;
+
+        float* samples = buffer.getWritePointer(ch);
+
+        expressions.getUnchecked(index)->run(samples, channelData, samples, getNumSamples(ch),
+                                             states + stateOffsets.getUnchecked(ch), scratch, slots);
+    }
+
+}
+
+
+void ExpressionNode::saveCustomChannelParametersToXml(XmlElement* channelInfo, int channelNumber, bool isEventChannel)
+{
+
+    if (!isEventChannel && formulas[channelNumber].isNotEmpty())
+    {
+        XmlElement* channelParams = channelInfo->createNewChildElement("EXPRESSION");
+        channelParams->setAttribute("formula", formulas[channelNumber]);
+    }
+
+}
+
+
+void ExpressionNode::loadCustomChannelParametersFromXml(XmlElement* channelInfo, bool isEventChannel)
+{
+
+    int channelNum = channelInfo->getIntAttribute("number");
+
+    if (!isEventChannel)
+    {
+        forEachXmlChildElement(*channelInfo, subNode)
+        {
+            if (subNode->hasTagName("EXPRESSION"))
+            {
+                setFormula(channelNum, subNode->getStringAttribute("formula"));
+                updateSettings(); // the channels are known by now
+            }
+        }
+    }
+
+}
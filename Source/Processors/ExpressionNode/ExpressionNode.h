@@ -0,0 +1,97 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef EXPRESSIONNODE_H_INCLUDED
+#define EXPRESSIONNODE_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/GenericProcessor.h"
+#include "ChannelExpression.h"
+
+/**
+
+  Transforms each channel with a formula, such as "abs(x)", "2 * x + 10",
+  "x - ch(3)" or "smooth(sq(x), 20)" (see ChannelExpression for the syntax).
+
+  Formulas are compiled in updateSettings(), so they can only be changed while
+  acquisition is stopped. Each channel then takes a single pass over its block
+  however many operations its formula holds, which replaces a chain of simple
+  processors (rectifier, gain, offset, reference) that would each sweep the data.
+  Channels without a formula, or with just "x", are left alone.
+
+  @see GenericProcessor, ExpressionEditor
+
+*/
+
+class ExpressionNode : public GenericProcessor
+{
+public:
+
+    ExpressionNode();
+    ~ExpressionNode();
+
+    AudioProcessorEditor* createEditor();
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events);
+
+    bool enable();
+
+    void updateSettings();
+
+    /** Sets the formula of a channel; it takes effect at the next updateSettings(). */
+    void setFormula(int channel, const String& formula);
+    String getFormula(int channel) const;
+
+    /** Returns false and describes the problem if a formula can't be compiled for this processor's channels. */
+    bool checkFormula(const String& formula, String& error);
+
+    void saveCustomChannelParametersToXml(XmlElement* channelInfo, int channelNumber, bool isEventChannel);
+    void loadCustomChannelParametersFromXml(XmlElement* channelInfo, bool isEventChannel);
+
+private:
+
+    StringArray formulas;
+
+    /** Compiled formulas, shared by channels with the same formula */
+    OwnedArray<ChannelExpression> expressions;
+
+    /** Per channel: its expression (-1 for none) and the offset of its smoothing states */
+    Array<int> channelExpressions;
+    Array<int> stateOffsets;
+    HeapBlock<float> states;
+    int numStates;
+
+    /** Inputs read by other channels' formulas are copied before any channel is overwritten */
+    Array<int> referencedChannels;
+    AudioSampleBuffer referenceBuffer;
+    HeapBlock<const float*> channelData;
+
+    HeapBlock<float> scratch;
+    HeapBlock<const float*> slots;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ExpressionNode);
+
+};
+
+
+#endif  // EXPRESSIONNODE_H_INCLUDED
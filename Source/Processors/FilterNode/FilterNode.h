@@ -56,6 +56,11 @@ public:
         return true;
     }
 
+    bool supportsInlineProcessing()
+    {
+        return true;
+    }
+
     double getLowCutValueForChannel(int chan);
     double getHighCutValueForChannel(int chan);
     bool getBypassStatusForChannel(int chan);
@@ -31,7 +31,8 @@ GenericProcessor::GenericProcessor(const String& name_) :
     sourceNode(0), destNode(0), isEnabled(true), wasConnected(false),
     nextAvailableChannel(0), saveOrder(-1), loadOrder(-1), currentChannel(-1),
     editor(0), parametersAsXml(nullptr), sendSampleCount(true), name(name_),
-    paramsWereLoaded(false), needsToSendTimestampMessage(false), timestampSet(false)
+    paramsWereLoaded(false), needsToSendTimestampMessage(false), timestampSet(false),
+    blockIngestionTicks(0), runsInline(false), inlineActive(false)
 {
     settings.numInputs = settings.numOutputs = settings.sampleRate = 0;
 
@@ -93,6 +94,7 @@ void GenericProcessor::setParameter(int parameterIndex, float newValue)
     {
         Parameter& p =  parameters.getReference(parameterIndex);
         p.setValue(newValue, currentChannel);
+        parameterStore.setValue(parameterIndex, currentChannel, float(p[currentChannel]));
     }
 
 }
@@ -451,6 +453,8 @@ void GenericProcessor::update()
         settings.numOutputs = 0;
     }
 
+    parameterStore.update(parameters, channels.size());
+
     updateSettings(); // allow processors to change custom settings
 
     // required for the ProcessorGraph to know the
@@ -464,6 +468,15 @@ void GenericProcessor::update()
 
 }
 
+void GenericProcessor::restoreChannelState(Channel* ch, int index) const
+{
+    if (index < recordStatus.size())
+    {
+        ch->setRecordState(recordStatus[index]);
+        ch->isMonitored = monitorStatus[index];
+    }
+}
+
 void GenericProcessor::setAllChannelsToRecord()
 {
 
@@ -598,14 +611,21 @@ int64 GenericProcessor::getTimestamp(int channelNum)
 }
 
 /** Used to set the timestamp for a given buffer, for a given channel. */
-void GenericProcessor::setTimestamp(MidiBuffer& events, int64 timestamp)
+void GenericProcessor::setTimestamp(MidiBuffer& events, int64 timestamp, int64 ingestionTicks)
 {
 
     //std::cout << "Setting timestamp to " << timestamp << std:;endl;
     timestampSet = true;
 
-    uint8 data[8];
+    if (ingestionTicks == 0)
+        ingestionTicks = (blockIngestionTicks != 0) ? blockIngestionTicks : Time::getHighResolutionTicks();
+
+    blockIngestionTicks = ingestionTicks;
+
+    // the ingestion ticks follow the timestamp, so readers of the first 8 bytes are unaffected
+    uint8 data[16];
     memcpy(data, &timestamp, 8);
+    memcpy(data + 8, &ingestionTicks, 8);
 
     // generate timestamp
     addEvent(events,    // MidiBuffer
@@ -613,7 +633,7 @@ void GenericProcessor::setTimestamp(MidiBuffer& events, int64 timestamp)
              0,         // sampleNum
              nodeId,    // eventID
              0,      // eventChannel
-             8,         // numBytes
+             16,        // numBytes
              data,   // data
              true    // isTimestampEvent
             );
@@ -640,6 +660,56 @@ void GenericProcessor::setTimestamp(MidiBuffer& events, int64 timestamp)
     }
 }
 
+int64 GenericProcessor::getIngestionTicks() const
+{
+    return blockIngestionTicks;
+}
+
+void GenericProcessor::recordOutputLatency()
+{
+    recordOutputLatency(blockIngestionTicks);
+}
+
+void GenericProcessor::recordOutputLatency(int64 ingestionTicks)
+{
+    if (ingestionTicks == 0)
+        return;
+
+    static const double microsecondsPerTick = 1.0e6 / double(Time::getHighResolutionTicksPerSecond());
+
+    outputLatency.add(int64((Time::getHighResolutionTicks() - ingestionTicks) * microsecondsPerTick));
+}
+
+LatencyHistogram& GenericProcessor::getOutputLatency()
+{
+    return outputLatency;
+}
+
+LatencyHistogram* GenericProcessor::getDispatchJitter()
+{
+    return nullptr;
+}
+
+bool GenericProcessor::supportsInlineProcessing()
+{
+    return false;
+}
+
+void GenericProcessor::setRunsInline(bool shouldRunInline)
+{
+    runsInline = shouldRunInline && supportsInlineProcessing();
+}
+
+bool GenericProcessor::getRunsInline() const
+{
+    return runsInline;
+}
+
+void GenericProcessor::setInlineActive(bool active)
+{
+    inlineActive = active;
+}
+
 int GenericProcessor::processEventBuffer(MidiBuffer& events)
 {
     //
@@ -653,6 +723,8 @@ int GenericProcessor::processEventBuffer(MidiBuffer& events)
 
     int numRead = 0;
 
+    blockIngestionTicks = 0;
+
     //int numRead = 0;
 
     if (events.getNumEvents() > 0)
@@ -699,6 +771,16 @@ int GenericProcessor::processEventBuffer(MidiBuffer& events)
 
                 timestamps[sourceNodeId] = ts;
 
+                // a merged buffer is as late as its oldest data
+                if (dataSize >= 22)
+                {
+                    int64 ingestion;
+                    memcpy(&ingestion, dataptr + 14, 8);
+
+                    if (ingestion != 0 && (blockIngestionTicks == 0 || ingestion < blockIngestionTicks))
+                        blockIngestionTicks = ingestion;
+                }
+
                 //if (nodeId < 900)
                 //    std::cout << nodeId << " got " << ts << " timestamp for " << (int) sourceNodeId << std::endl;
 
@@ -722,6 +804,24 @@ int GenericProcessor::processEventBuffer(MidiBuffer& events)
     return numRead;
 }
 
+void GenericProcessor::clearSaveFlags(MidiBuffer& events)
+{
+    MidiBuffer::Iterator i(events);
+
+    const uint8* dataptr;
+    int dataSize;
+    int samplePosition;
+
+    while (i.getNextEvent(dataptr, dataSize, samplePosition))
+    {
+        if (isWritableEvent(*dataptr) && getNodeId() < 900 && *(dataptr+4) > 0)
+        {
+            uint8* ptr = const_cast<uint8*>(dataptr);
+            *(ptr + 4) = 0; // the same as processEventBuffer()
+        }
+    }
+}
+
 
 int GenericProcessor::checkForEvents(MidiBuffer& midiMessages)
 {
@@ -804,6 +904,13 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
 void GenericProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& eventBuffer)
 {
 
+    // already processed on the acquisition thread, which owns the processor's state; see InlineChain
+    if (inlineActive)
+    {
+        clearSaveFlags(eventBuffer);
+        return;
+    }
+
     processEventBuffer(eventBuffer); // extract buffer sizes and timestamps,
     // set flag on all TTL events to zero
 
@@ -813,6 +920,15 @@ void GenericProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& event
 
 }
 
+void GenericProcessor::processInline(AudioSampleBuffer& buffer, MidiBuffer& eventBuffer)
+{
+    processEventBuffer(eventBuffer);
+
+    timestampSet = false;
+
+    process(buffer, eventBuffer);
+}
+
 
 /////// ---- LOADING AND SAVING ---- //////////
 
@@ -822,6 +938,9 @@ void GenericProcessor::saveToXml(XmlElement* parentElement)
 
     parentElement->setAttribute("NodeId", nodeId);
 
+    if (runsInline)
+        parentElement->setAttribute("RunInline", true);
+
     saveCustomParametersToXml(parentElement);
 
     // loop through the channels
@@ -934,6 +1053,8 @@ void GenericProcessor::loadFromXml()
 
         if (parametersAsXml != nullptr)
         {
+            setRunsInline(parametersAsXml->getBoolAttribute("RunInline", false));
+
             // use parametersAsXml to restore state
             loadCustomParametersFromXml();
 
@@ -34,6 +34,8 @@ enum ChannelType {HEADSTAGE_CHANNEL = 0, AUX_CHANNEL = 1, ADC_CHANNEL = 2, EVENT
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../Editors/GenericEditor.h"
 #include "../Parameter/Parameter.h"
+#include "../Parameter/ParameterStore.h"
+#include "LatencyHistogram.h"
 #include "../Channel/Channel.h"
 #include "../../CoreServices.h"
 
@@ -279,6 +281,31 @@ public:
     /** Returns trus if a processor generates its own timestamps, false otherwise.*/
     virtual bool generatesTimestamps();
 
+    /** Latencies from data ingestion to output recorded by this processor, in microseconds.
+        Empty for processors that don't call recordOutputLatency().*/
+    LatencyHistogram& getOutputLatency();
+
+    /** For processors that drive devices through an OutputDispatcher: how late their commands
+        were executed. Returns nullptr by default.*/
+    virtual LatencyHistogram* getDispatchJitter();
+
+    /** Returns true if the processor can run on the acquisition thread as part of a source's
+        InlineChain. Such processors must keep their channel count and not rely on the message
+        thread in process(). Returns false by default.*/
+    virtual bool supportsInlineProcessing();
+
+    /** Asks for the processor to run on the acquisition thread. This only takes effect while the
+        processor directly follows its source, or another processor that runs inline.*/
+    void setRunsInline(bool shouldRunInline);
+    bool getRunsInline() const;
+
+    /** Called by the InlineChain on the acquisition thread, in place of processBlock(). */
+    void processInline(AudioSampleBuffer& buffer, MidiBuffer& events);
+
+    /** Set by the InlineChain while it runs this processor; processBlock() then passes the
+        graph's buffer through, since it already holds this processor's output.*/
+    void setInlineActive(bool active);
+
     /** Returns true if a processor is a source, false otherwise.*/
     virtual bool isSource();
 
@@ -432,6 +459,10 @@ public:
     /** An array of parameters that the user can modify.*/
     Array<Parameter> parameters;
 
+    /** Lock-free copy of the parameter values, for reading from process().
+        Rebuilt by update() and kept current by setParameter().*/
+    ParameterStore parameterStore;
+
     /** Initialize Parameters */
     //virtual void initializeParameters();
 
@@ -483,8 +514,28 @@ public:
     /** Used to get the timestamp for a given buffer, for a given channel. */
     int64 getTimestamp(int channelNumber);
 
-    /** Used to set the timestamp for a given buffer, for a given source node. */
-    void setTimestamp(MidiBuffer&, int64 timestamp);
+    /** Used to set the timestamp for a given buffer, for a given source node.
+        The event also carries the high-resolution tick count at which the buffer's data
+        entered the application; if ingestionTicks is 0, the ticks of the current buffer
+        are passed on, or the current time is used if there are none.*/
+    void setTimestamp(MidiBuffer&, int64 timestamp, int64 ingestionTicks = 0);
+
+    /** Returns the earliest ingestion tick count of the sources feeding the current buffer,
+        or 0 if none was received. */
+    int64 getIngestionTicks() const;
+
+    /** Called by processors that act as sinks (writing to disk, sending to the network or
+        driving hardware) once the current buffer has left the application. Adds the time since
+        its ingestion to getOutputLatency(). */
+    void recordOutputLatency();
+
+    /** The same for data that was ingested at the given tick count, for sinks that send it from
+        a thread of their own. Only one thread per processor may record latencies. */
+    void recordOutputLatency(int64 ingestionTicks);
+
+    /** Gives a channel that updateSettings() appends the record and monitor state saved
+        for its index, as update() does for the channels it creates. */
+    void restoreChannelState(Channel* ch, int index) const;
 
     std::map<uint8, int> numSamples;
     std::map<uint8, int64> timestamps;
@@ -505,6 +556,9 @@ private:
     /** Extracts sample counts and timestamps from the MidiBuffer. */
     int processEventBuffer(MidiBuffer&);
 
+    /** Marks the TTL events in the MidiBuffer as saved, as processEventBuffer() does. */
+    void clearSaveFlags(MidiBuffer&);
+
     /** For getInputChannelName() and getOutputChannelName() */
     static const String unusedNameString;
 
@@ -513,6 +567,14 @@ private:
 
     bool timestampSet;
 
+    /** Ingestion ticks of the current buffer, see getIngestionTicks() */
+    int64 blockIngestionTicks;
+
+    bool runsInline;
+    bool inlineActive;
+
+    LatencyHistogram outputLatency;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GenericProcessor);
 
 };
@@ -0,0 +1,155 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LatencyHistogram.h"
+
+
+LatencyHistogram::LatencyHistogram()
+{
+
+}
+
+
+int LatencyHistogram::getBucket(int64 microseconds)
+{
+    if (microseconds < SUB_BUCKETS)
+        return jmax(0, int(microseconds));
+
+    int octave = 0;
+    while ((microseconds >> octave) >= 2 * SUB_BUCKETS)
+        octave++;
+
+    // octave 0 covers [SUB_BUCKETS, 2 * SUB_BUCKETS) in steps of 1
+    const int bucket = (octave + 1) * SUB_BUCKETS + int(microseconds >> octave) - SUB_BUCKETS;
+
+    return jmin(bucket, int(NUM_BUCKETS) - 1);
+}
+
+
+int64 LatencyHistogram::getLowerEdge(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    const int octave = bucket / SUB_BUCKETS - 1;
+
+    return int64(SUB_BUCKETS + bucket % SUB_BUCKETS) << octave;
+}
+
+
+void LatencyHistogram::add(int64 microseconds)
+{
+    ++counts[getBucket(microseconds)];
+    ++total;
+    sum += microseconds;
+
+    // only one thread adds samples, so this can't race with another maximum
+    if (microseconds > maximum.get())
+        maximum = microseconds;
+}
+
+
+void LatencyHistogram::reset()
+{
+    for (int b = 0; b < NUM_BUCKETS; b++)
+        counts[b] = 0;
+
+    total = 0;
+    sum = 0;
+    maximum = 0;
+}
+
+
+int64 LatencyHistogram::getCount() const
+{
+    return total.get();
+}
+
+
+int64 LatencyHistogram::getMaximum() const
+{
+    return maximum.get();
+}
+
+
+double LatencyHistogram::getMean() const
+{
+    const int64 n = total.get();
+
+    return (n > 0) ? double(sum.get()) / n : 0.0;
+}
+
+
+double LatencyHistogram::getPercentile(double fraction) const
+{
+    int64 n = 0;
+
+    for (int b = 0; b < NUM_BUCKETS; b++)
+        n += counts[b].get();
+
+    if (n == 0)
+        return 0.0;
+
+    const int64 target = jmax(int64(1), int64(std::ceil(fraction * n)));
+    int64 cumulative = 0;
+
+    for (int b = 0; b < NUM_BUCKETS; b++)
+    {
+        cumulative += counts[b].get();
+
+        if (cumulative >= target)
+            return double(jmin(getLowerEdge(b + 1), maximum.get()));
+    }
+
+    return double(maximum.get());
+}
+
+
+String LatencyHistogram::getSummary() const
+{
+    String summary;
+
+    summary << String(getCount()) << " samples, mean " << String(getMean() / 1000.0, 3)
+            << " ms, p50 " << String(getPercentile(0.5) / 1000.0, 3)
+            << " ms, p99 " << String(getPercentile(0.99) / 1000.0, 3)
+            << " ms, p99.9 " << String(getPercentile(0.999) / 1000.0, 3)
+            << " ms, max " << String(getMaximum() / 1000.0, 3) << " ms";
+
+    return summary;
+}
+
+
+String LatencyHistogram::toCsv() const
+{
+    String csv;
+
+    for (int b = 0; b < NUM_BUCKETS; b++)
+    {
+        const int count = counts[b].get();
+
+        if (count > 0)
+            csv << String(getLowerEdge(b)) << "," << String(getLowerEdge(b + 1)) << "," << String(count) << "\n";
+    }
+
+    return csv;
+}
@@ -0,0 +1,89 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef LATENCYHISTOGRAM_H_INCLUDED
+#define LATENCYHISTOGRAM_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Histogram of latencies in microseconds, filled by one audio thread and read
+  from the message thread.
+
+  Latencies below SUB_BUCKETS microseconds get a bucket each; above that, every
+  power of two is split into SUB_BUCKETS buckets, so a bucket is never wider than
+  12.5% of the values it holds. The maximum is kept exactly.
+
+  @see GenericProcessor::recordOutputLatency
+
+*/
+
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    /** Called by the thread that measures the latencies. */
+    void add(int64 microseconds);
+
+    /** Clears the counts; samples added at the same time may be lost. */
+    void reset();
+
+    int64 getCount() const;
+    int64 getMaximum() const;
+    double getMean() const;
+
+    /** Returns the latency that the given fraction of the samples did not exceed,
+        rounded up to the upper edge of its bucket.
+    */
+    double getPercentile(double fraction) const;
+
+    /** Count, mean, median, 99th and 99.9th percentile and maximum, in milliseconds. */
+    String getSummary() const;
+
+    /** One "lower_us,upper_us,count" line for every non-empty bucket. */
+    String toCsv() const;
+
+    enum
+    {
+        SUB_BUCKETS = 8,
+        NUM_BUCKETS = SUB_BUCKETS * 25
+    };
+
+private:
+
+    static int getBucket(int64 microseconds);
+    static int64 getLowerEdge(int bucket);
+
+    Atomic<int> counts[NUM_BUCKETS];
+    Atomic<int64> total;
+    Atomic<int64> sum;
+    Atomic<int64> maximum;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LatencyHistogram);
+
+};
+
+
+#endif  // LATENCYHISTOGRAM_H_INCLUDED
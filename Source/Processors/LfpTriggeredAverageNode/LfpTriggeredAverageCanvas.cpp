@@ -26,27 +26,26 @@
 #include <math.h>
 
 LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* processor_) :
-    screenBufferIndex(0), timebase(1.0f), displayGain(1.0f),   timeOffset(0.0f),
-    processor(processor_),
-    displayBufferIndex(0)
+    fullredraw(true), processor(processor_)
 {
 
     nChans = processor->getNumInputs();
     sampleRate = processor->getSampleRate();
     std::cout << "Setting num inputs on LfpTriggeredAverageCanvas to " << nChans << std::endl;
 
-    displayBuffer = processor->getDisplayBufferAddress();
-    displayBufferSize = displayBuffer->getNumSamples();
-    std::cout << "Setting displayBufferSize on LfpTriggeredAverageCanvas to " << displayBufferSize << std::endl;
-
-    screenBuffer = new AudioSampleBuffer(MAX_N_CHAN, MAX_N_SAMP);
-    screenBuffer->clear();
+    for (int i = 0; i < LfpTriggeredAverageNode::MAX_TRIGGERS; i++)
+    {
+        means.add(new AudioSampleBuffer(1, 1));
+        stdDevs.add(new AudioSampleBuffer(1, 1));
+        trialCounts.add(0);
+        lastUpdateCounts.add(-1);
+    }
 
     viewport = new Viewport();
     display = new LfpTriggeredAverageDisplay(this, viewport);
     timescale = new LfpTriggeredAverageTimescale(this);
 
-    timescale->setTimebase(timebase);
+    timescale->setWindow(processor->getPreWindowMs(), processor->getPostWindowMs());
 
     viewport->setViewedComponent(display, false);
     viewport->setScrollBarsShown(true, false);
@@ -68,14 +67,6 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
     voltageRanges.add("2000");
     voltageRanges.add("5000");
 
-    timebases.add("0.2");
-    timebases.add("0.5");
-    timebases.add("1.0");
-    timebases.add("2.0");
-    timebases.add("5.0");
-    timebases.add("10.0");
-
-
     spreads.add("10");
     spreads.add("20");
     spreads.add("30");
@@ -90,13 +81,6 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
     rangeSelection->addListener(this);
     addAndMakeVisible(rangeSelection);
 
-    timebaseSelection = new ComboBox("Timebase");
-    timebaseSelection->addItemList(timebases, 1);
-    timebaseSelection->setSelectedId(3, dontSendNotification);
-    timebaseSelection->addListener(this);
-    addAndMakeVisible(timebaseSelection);
-
-
     spreadSelection = new ComboBox("Spread");
     spreadSelection->addItemList(spreads, 1);
     spreadSelection->setSelectedId(5, dontSendNotification);
@@ -107,7 +91,7 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
     display->setNumChannels(nChans);
     display->setRange(1000.0f);
 
-    // add event display-specific controls (currently just an enable/disable button)
+    // one button per trigger channel to show or hide its averages
     for (int i = 0; i < 8; i++)
     {
 
@@ -115,7 +99,7 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
         LfpTriggeredAverageEventInterface* eventOptions = new LfpTriggeredAverageEventInterface(display, this, i);
         LfpTriggeredAverageEventInterfaces.add(eventOptions);
         addAndMakeVisible(eventOptions);
-        eventOptions->setBounds(500+(floor(i/2)*20), getHeight()-20-(i%2)*20, 40, 20);
+        eventOptions->setBounds(345+(floor(i/2)*20), getHeight()-20-(i%2)*20, 40, 20);
 
         display->setEventDisplayState(i,true);
 
@@ -127,7 +111,6 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
 LfpTriggeredAverageCanvas::~LfpTriggeredAverageCanvas()
 {
 
-    deleteAndZero(screenBuffer);
 }
 
 void LfpTriggeredAverageCanvas::resized()
@@ -139,12 +122,11 @@ void LfpTriggeredAverageCanvas::resized()
     display->setBounds(0,0,getWidth()-scrollBarThickness, getChannelHeight()*nChans);
 
     rangeSelection->setBounds(5,getHeight()-30,100,25);
-    timebaseSelection->setBounds(175,getHeight()-30,100,25);
-    spreadSelection->setBounds(345,getHeight()-30,100,25);
+    spreadSelection->setBounds(175,getHeight()-30,100,25);
 
     for (int i = 0; i < 8; i++)
     {
-        LfpTriggeredAverageEventInterfaces[i]->setBounds(500+(floor(i/2)*20), getHeight()-40+(i%2)*20, 40, 20); // arrange event channel buttons in two rows
+        LfpTriggeredAverageEventInterfaces[i]->setBounds(345+(floor(i/2)*20), getHeight()-40+(i%2)*20, 40, 20); // arrange event channel buttons in two rows
         LfpTriggeredAverageEventInterfaces[i]->repaint();
     }
 
@@ -158,9 +140,10 @@ void LfpTriggeredAverageCanvas::beginAnimation()
 {
     std::cout << "Beginning animation." << std::endl;
 
-    displayBufferSize = displayBuffer->getNumSamples();
+    timescale->setWindow(processor->getPreWindowMs(), processor->getPostWindowMs());
 
-    screenBufferIndex = 0;
+    for (int i = 0; i < lastUpdateCounts.size(); i++)
+        lastUpdateCounts.set(i, -1);
 
     startCallbacks();
 }
@@ -179,8 +162,6 @@ void LfpTriggeredAverageCanvas::update()
 
     std::cout << "Setting num inputs on LfpTriggeredAverageCanvas to " << nChans << std::endl;
 
-    refreshScreenBuffer();
-
     display->setNumChannels(nChans);
 
     // update channel names
@@ -202,11 +183,7 @@ void LfpTriggeredAverageCanvas::update()
 void LfpTriggeredAverageCanvas::comboBoxChanged(ComboBox* cb)
 {
 
-    if (cb == timebaseSelection)
-    {
-        timebase = timebases[cb->getSelectedId()-1].getFloatValue();
-    }
-    else if (cb == rangeSelection)
+    if (cb == rangeSelection)
     {
         display->setRange(voltageRanges[cb->getSelectedId()-1].getFloatValue());
         //std::cout << "Setting range to " << voltageRanges[cb->getSelectedId()-1].getFloatValue() << std::endl;
@@ -220,7 +197,7 @@ void LfpTriggeredAverageCanvas::comboBoxChanged(ComboBox* cb)
         //std::cout << "Setting spread to " << spreads[cb->getSelectedId()-1].getFloatValue() << std::endl;
     }
 
-    timescale->setTimebase(timebase);
+    fullredraw = true;
 }
 
 
@@ -251,136 +228,57 @@ void LfpTriggeredAverageCanvas::setParameter(int param, float val)
 void LfpTriggeredAverageCanvas::refreshState()
 {
     // called when the component's tab becomes visible again
-    displayBufferIndex = processor->getDisplayBufferIndex();
-    screenBufferIndex = 0;
-
+    fullredraw = true;
 }
 
-void LfpTriggeredAverageCanvas::refreshScreenBuffer()
+bool LfpTriggeredAverageCanvas::updateSnapshots()
 {
+    bool changed = false;
 
-    screenBufferIndex = 0;
-
-    screenBuffer->clear();
-
-    // int w = display->getWidth();
-    // //std::cout << "Refreshing buffer size to " << w << "pixels." << std::endl;
-
-    // for (int i = 0; i < w; i++)
-    // {
-    //  float x = float(i);
-
-    //  for (int n = 0; n < nChans; n++)
-    //  {
-    //      waves[n][i*2] = x;
-    //      waves[n][i*2+1] = 0.5f; // line in center of display
-    //  }
-    // }
-
-}
-
-void LfpTriggeredAverageCanvas::updateScreenBuffer()
-{
-
-
-    // copy new samples from the displayBuffer into the screenBuffer (waves)
-    int maxSamples = display->getWidth() - leftmargin;
-
-    if (screenBufferIndex >= maxSamples) // wrap around if we reached right edge before
-        screenBufferIndex = 0;
-
-    lastScreenBufferIndex = screenBufferIndex;
-
-    int index = processor->getDisplayBufferIndex();
-
-    int nSamples =  index - displayBufferIndex; // N new samples to be addeddisplayBufferIndex
-
-    if (nSamples < 0) // buffer has reset to 0
-    {
-        nSamples = (displayBufferSize - displayBufferIndex) + index;
-    }
-
-    float ratio = sampleRate * timebase / float(getWidth() - leftmargin - scrollBarThickness);
-
-    // this number is crucial: converting from samples to values (in px) for the screen buffer
-    int valuesNeeded = (int) float(nSamples) / ratio;
-
-
-    if (screenBufferIndex + valuesNeeded > maxSamples)  // crop number of samples to fit cavas width
+    for (int t = 0; t < LfpTriggeredAverageNode::MAX_TRIGGERS; t++)
     {
-        valuesNeeded = maxSamples - screenBufferIndex;
-    }
-
-    float subSampleOffset = 0.0;
-
-    displayBufferIndex = displayBufferIndex % displayBufferSize; // make sure we're not overshooting
-    int nextPos = (displayBufferIndex + 1) % displayBufferSize; //  position next to displayBufferIndex in display buffer to copy from
+        const int updateCount = processor->getUpdateCount(t);
 
-    if (valuesNeeded > 0 && valuesNeeded < 1000)
-    {
-
-        for (int i = 0; i < valuesNeeded; i++) // also fill one extra sample for line drawing interpolation to match across draws
+        if (updateCount != lastUpdateCounts[t])
         {
-            float gain = 1.0;
-            float alpha = (float) subSampleOffset;
-            float invAlpha = 1.0f - alpha;
-
-            screenBuffer->clear(screenBufferIndex, 1);
-
-            for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
-            {
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getWritePointer(channel, displayBufferIndex), // source
-                                      1, // numSamples
-                                      invAlpha*gain); // gain
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getWritePointer(channel, nextPos), // source
-                                      1, // numSamples
-                                      alpha*gain); // gain
-
-
-            }
-
-            subSampleOffset += ratio;
-
-            while (subSampleOffset >= 1.0)
-            {
-                if (++displayBufferIndex > displayBufferSize)
-                    displayBufferIndex = 0;
+            trialCounts.set(t, processor->copyAverage(t, *means[t], stdDevs[t]));
+            lastUpdateCounts.set(t, updateCount);
+            changed = true;
+        }
+    }
 
-                nextPos = (displayBufferIndex + 1) % displayBufferSize;
-                subSampleOffset -= 1.0;
-            }
+    return changed;
+}
 
-            screenBufferIndex++;
+const float* LfpTriggeredAverageCanvas::getMean(int trigger, int chan)
+{
+    if (trialCounts[trigger] == 0 || chan >= means[trigger]->getNumChannels())
+        return nullptr;
 
-        }
+    return means[trigger]->getReadPointer(chan);
+}
 
+const float* LfpTriggeredAverageCanvas::getStdDev(int trigger, int chan)
+{
+    if (trialCounts[trigger] < 2 || chan >= stdDevs[trigger]->getNumChannels())
+        return nullptr;
 
-    }
-    else
-    {
-        //std::cout << "Skip." << std::endl;
-    }
+    return stdDevs[trigger]->getReadPointer(chan);
 }
 
-float LfpTriggeredAverageCanvas::getXCoord(int chan, int samp)
+int LfpTriggeredAverageCanvas::getTrialCount(int trigger)
 {
-    return samp;
+    return trialCounts[trigger];
 }
 
-int LfpTriggeredAverageCanvas::getNumChannels()
+int LfpTriggeredAverageCanvas::getNumBins()
 {
-    return nChans;
+    return processor->getWindowBins();
 }
 
-float LfpTriggeredAverageCanvas::getYCoord(int chan, int samp)
+int LfpTriggeredAverageCanvas::getNumChannels()
 {
-    return *screenBuffer->getReadPointer(chan, samp);
+    return nChans;
 }
 
 void LfpTriggeredAverageCanvas::paint(Graphics& g)
@@ -406,12 +304,16 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
 
     for (int i = 0; i < 10; i++)
     {
-        if (i == 5 || i == 0)
-            g.drawLine(w/10*i+leftmargin,0,w/10*i+leftmargin,getHeight()-60,3.0f);
-        else
-            g.drawLine(w/10*i+leftmargin,0,w/10*i+leftmargin,getHeight()-60,1.0f);
+        g.drawLine(w/10*i+leftmargin,0,w/10*i+leftmargin,getHeight()-60,1.0f);
     }
 
+    // trigger time
+    const float pre = processor->getPreWindowMs();
+    const float post = processor->getPostWindowMs();
+    const float zero = leftmargin + w * pre / jmax(1.0f, pre + post);
+
+    g.drawLine(zero,0,zero,getHeight()-60,3.0f);
+
     g.drawLine(0,getHeight()-60,getWidth(),getHeight()-60,3.0f);
 
     g.setFont(Font("Default", 16, Font::plain));
@@ -419,10 +321,14 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
     g.setColour(Colour(100,100,100));
 
     g.drawText("Voltage range (uV)",5,getHeight()-55,300,20,Justification::left, false);
-    g.drawText("Timebase (s)",175,getHeight()-55,300,20,Justification::left, false);
-    g.drawText("Spread (px)",345,getHeight()-55,300,20,Justification::left, false);
+    g.drawText("Spread (px)",175,getHeight()-55,300,20,Justification::left, false);
+
+    String triggers = "Triggers (n =";
 
-    g.drawText("Event display",500,getHeight()-55,300,20,Justification::left, false);
+    for (int i = 0; i < trialCounts.size(); i++)
+        triggers += " " + String(trialCounts[i]);
+
+    g.drawText(triggers + ")",345,getHeight()-55,400,20,Justification::left, false);
 
 
 
@@ -430,9 +336,13 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
 
 void LfpTriggeredAverageCanvas::refresh()
 {
-    updateScreenBuffer();
+    if (updateSnapshots())
+    {
+        fullredraw = true;
+        repaint(0, getHeight()-55, getWidth(), 20); // trial counts
+    }
 
-    display->refresh(); // redraws only the new part of the screen buffer
+    display->refresh(); // redraws only if an average or the layout changed
 
     //getPeer()->performAnyPendingRepaintsNow();
 
@@ -445,7 +355,6 @@ void LfpTriggeredAverageCanvas::saveVisualizerParameters(XmlElement* xml)
 
 
     xmlNode->setAttribute("Range",rangeSelection->getSelectedId());
-    xmlNode->setAttribute("Timebase",timebaseSelection->getSelectedId());
     xmlNode->setAttribute("Spread",spreadSelection->getSelectedId());
 
     int eventButtonState = 0;
@@ -472,13 +381,12 @@ void LfpTriggeredAverageCanvas::loadVisualizerParameters(XmlElement* xml)
         if (xmlNode->hasTagName("LfpTriggeredAverageDisplay"))
         {
             rangeSelection->setSelectedId(xmlNode->getIntAttribute("Range"));
-            timebaseSelection->setSelectedId(xmlNode->getIntAttribute("Timebase"));
             spreadSelection->setSelectedId(xmlNode->getIntAttribute("Spread"));
 
             viewport->setViewPosition(xmlNode->getIntAttribute("ScrollX"),
                                       xmlNode->getIntAttribute("ScrollY"));
 
-            int eventButtonState = xmlNode->getIntAttribute("eventButtonState");
+            int eventButtonState = xmlNode->getIntAttribute("EventButtonState", 0xff);
 
             for (int i = 0; i < 8; i++)
             {
@@ -494,7 +402,8 @@ void LfpTriggeredAverageCanvas::loadVisualizerParameters(XmlElement* xml)
 
 // -------------------------------------------------------------
 
-LfpTriggeredAverageTimescale::LfpTriggeredAverageTimescale(LfpTriggeredAverageCanvas* c) : canvas(c)
+LfpTriggeredAverageTimescale::LfpTriggeredAverageTimescale(LfpTriggeredAverageCanvas* c) :
+    canvas(c), preMs(0.0f), postMs(1.0f)
 {
 
     font = Font("Default", 16, Font::plain);
@@ -518,25 +427,26 @@ void LfpTriggeredAverageTimescale::paint(Graphics& g)
 
     for (int i = 1; i < 10; i++)
     {
-        if (i == 5)
-            g.drawLine(getWidth()/10*i,0,getWidth()/10*i,getHeight(),3.0f);
-        else
-            g.drawLine(getWidth()/10*i,0,getWidth()/10*i,getHeight(),1.0f);
+        g.drawLine(getWidth()/10*i,0,getWidth()/10*i,getHeight(),1.0f);
 
         g.drawText(labels[i-1],getWidth()/10*i+3,0,100,getHeight(),Justification::left, false);
     }
 
+    const float zero = getWidth() * preMs / jmax(1.0f, preMs + postMs);
+    g.drawLine(zero,0,zero,getHeight(),3.0f);
+
 }
 
-void LfpTriggeredAverageTimescale::setTimebase(float t)
+void LfpTriggeredAverageTimescale::setWindow(float pre, float post)
 {
-    timebase = t;
+    preMs = pre;
+    postMs = post;
 
     labels.clear();
 
     for (float i = 1.0f; i < 10.0; i++)
     {
-        String labelString = String(timebase/10.0f*1000.0f*i);
+        String labelString = String((preMs+postMs)/10.0f*i - preMs);
 
         labels.add(labelString.substring(0,4));
     }
@@ -681,6 +591,9 @@ void LfpTriggeredAverageDisplay::refresh()
 {
 
 
+    if (!canvas->fullredraw)
+        return;
+
     int topBorder = viewport->getViewPositionY();
     int bottomBorder = viewport->getViewHeight() + topBorder;
 
@@ -693,19 +606,9 @@ void LfpTriggeredAverageDisplay::refresh()
 
         if ((topBorder <= componentBottom && bottomBorder >= componentTop))
         {
-            if (canvas->fullredraw)
-            {
-                channels[i]->fullredraw = true;
-                channels[i]->repaint();
-                channelInfo[i]->repaint();
-
-            }
-            else
-            {
-                channels[i]->repaint(canvas->lastScreenBufferIndex-2, 0, (canvas->screenBufferIndex-canvas->lastScreenBufferIndex)+3, getChildComponent(i)->getHeight());  //repaint only the updated portion
-                // we redraw from -2 to +1 relative to the real redraw window, the -2 makes sure that the lines join nicely, and the +1 draws the vertical update line
-            }
-            //std::cout << i << std::endl;
+            channels[i]->fullredraw = true;
+            channels[i]->repaint();
+            channelInfo[i]->repaint();
         }
 
     }
@@ -878,17 +781,6 @@ LfpTriggeredAverageChannelDisplay::~LfpTriggeredAverageChannelDisplay()
 void LfpTriggeredAverageChannelDisplay::paint(Graphics& g)
 {
 
-    //g.fillAll(Colours::grey);
-
-    g.setColour(Colours::yellow);   // draw most recent drawn sample position
-    g.drawLine(canvas->screenBufferIndex+1, 0, canvas->screenBufferIndex+1, getHeight());
-
-
-
-
-    //g.setColour(Colours::red); // draw oldest drawn sample position
-    //g.drawLine(canvas->lastScreenBufferIndex, 0, canvas->lastScreenBufferIndex, getHeight()-channelOverlap);
-
     int center = getHeight()/2;
 
     if (isSelected)
@@ -905,114 +797,63 @@ void LfpTriggeredAverageChannelDisplay::paint(Graphics& g)
 
     }
 
-
     g.setColour(Colour(40,40,40));
     g.drawLine(0, getHeight()/2, getWidth(), getHeight()/2);
 
-    int stepSize = 1;
-    int from = 0; // for vertical line drawing in the LFP data
-    int to = 0;
+    fullredraw = false;
 
-    //for (int i = 0; i < getWidth()-stepSize; i += stepSize) // redraw entire display
-    int ifrom = canvas->lastScreenBufferIndex - 3; // need to start drawing a bit before the actual redraw windowfor the interpolated line to join correctly
+    const int numBins = canvas->getNumBins();
 
-    if (ifrom < 0)
-        ifrom = 0;
+    if (numBins < 2)
+        return;
 
-    int ito = canvas->screenBufferIndex - 1;
+    const float xScale = float(getWidth() - canvas->leftmargin) / float(numBins - 1);
+    const float yScale = channelHeightFloat / range;
 
-    if (fullredraw)
+    for (int trigger = 0; trigger < LfpTriggeredAverageNode::MAX_TRIGGERS; trigger++)
     {
-        ifrom = 0; //canvas->leftmargin;
-        ito = getWidth()-stepSize;
-        fullredraw = false;
-    }
+        if (!display->getEventDisplayState(trigger))
+            continue;
 
-    for (int i = ifrom; i < ito ; i += stepSize) // redraw only changed portion
-    {
+        const float* mean = canvas->getMean(trigger, chan);
 
-        // draw event markers
-        int rawEventState = canvas->getYCoord(canvas->getNumChannels(), i);// get last channel+1 in buffer (represents events)
-        for (int ev_ch = 0; ev_ch < 8 ; ev_ch++) // for all event channels
-        {
-            if (display->getEventDisplayState(ev_ch))  // check if plotting for this channel is enabled
-            {
-                if (rawEventState & (1 << ev_ch))    // events are  representet by a bit code, so we have to extract the individual bits with a mask
-                {
-                    g.setColour(display->channelColours[ev_ch*2]); // get color from lfp color scheme
-                    g.setOpacity(0.35f);
-                    g.drawLine(i, center-channelHeight/2 , i, center+channelHeight/2);
-                }
-            }
-        }
+        if (mean == nullptr)
+            continue;
 
-        //std::cout << "e " << canvas->getYCoord(canvas->getNumChannels()-1, i) << std::endl;
+        const Colour colour = display->channelColours[trigger*2];
 
-        g.setColour(lineColour);
-        g.setOpacity(1);
+        const float* stdDev = canvas->getStdDev(trigger, chan);
 
-        // drawLine makes for ok anti-aliased plots, but is pretty slow
-        g.drawLine(i,
-                   (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2,
-                   i+stepSize,
-                   (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2);
-
-        if (false) // switched back to line drawing now that we only draw partial updates
+        if (isSelected && stdDev != nullptr)
         {
+            Path envelope;
+            envelope.startNewSubPath(0, (mean[0]+stdDev[0])*yScale+center);
 
-            // // pixel wise line plot has no anti-aliasing, but runs much faster
-            double a = (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2;
-            double b = (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2;
+            for (int i = 1; i < numBins; i++)
+                envelope.lineTo(i*xScale, (mean[i]+stdDev[i])*yScale+center);
 
-            if (a<b)
-            {
-                from = (a);
-                to = (b);
-            }
-            else
-            {
-                from = (b);
-                to = (a);
-            }
+            for (int i = numBins-1; i >= 0; i--)
+                envelope.lineTo(i*xScale, (mean[i]-stdDev[i])*yScale+center);
 
-            if ((to-from) < 40)  // if there is too much vertical range in one pixel, don't draw the full line for speed reasons
-            {
-                for (int j = from; j <= to; j += 1)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else if ((to-from) < 100)
-            {
-                for (int j = from; j <= to; j += 2)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else
-            {
-                g.setPixel(i,to);
-                g.setPixel(i,from);
-            }
+            envelope.closeSubPath();
 
+            g.setColour(colour.withAlpha(0.25f));
+            g.fillPath(envelope);
         }
 
-    }
-
-    // g.setColour(lineColour.withAlpha(0.7f)); // alpha on seems to decrease draw speed
-    // g.setFont(channelFont);
-    //  g.setFont(channelHeightFloat*0.6);
+        Path trace;
+        trace.startNewSubPath(0, mean[0]*yScale+center);
 
-    // g.drawText(String(chan+1), 10, center-channelHeight/2, 200, channelHeight, Justification::left, false);
+        for (int i = 1; i < numBins; i++)
+            trace.lineTo(i*xScale, mean[i]*yScale+center);
 
+        g.setColour(colour);
+        g.strokePath(trace, PathStrokeType(1.0f));
+    }
 
 }
 
 
-
-
-
-
 void LfpTriggeredAverageChannelDisplay::setRange(float r)
 {
     range = r;
@@ -1143,6 +984,9 @@ void LfpTriggeredAverageEventInterface::buttonClicked(Button* button)
         display->setEventDisplayState(channelNumber, true);
     }
 
+    canvas->fullredraw = true;
+    display->refresh();
+
     repaint();
 
 }
@@ -37,7 +37,12 @@ class LfpTriggeredAverageEventInterface;
 
 /**
 
-  Displays multiple channels of continuous data.
+  Displays the triggered averages of every channel.
+
+  The averages of the trigger channels selected at the bottom of the canvas
+  are overlaid, each in its own colour; the selected channel also shows the
+  standard deviation around its averages. The canvas only copies a snapshot
+  from the processor when an average has changed.
 
   @see LfpTriggeredAverageNode, LfpTriggeredAverageDisplayEditor
 
@@ -71,11 +76,11 @@ public:
 
     int getNumChannels();
 
-    float getXCoord(int chan, int samp);
-    float getYCoord(int chan, int samp);
-
-    int screenBufferIndex;
-    int lastScreenBufferIndex;
+    /** Snapshot of the average of a trigger channel, or nullptr if it has no trials. */
+    const float* getMean(int trigger, int chan);
+    const float* getStdDev(int trigger, int chan);
+    int getTrialCount(int trigger);
+    int getNumBins();
 
     void comboBoxChanged(ComboBox* cb);
 
@@ -91,39 +96,29 @@ public:
 private:
 
     float sampleRate;
-    float timebase;
-    float displayGain;
-    float timeOffset;
-    //int spread ; // vertical spacing between channels
-
-    static const int MAX_N_CHAN = 256;  // maximum number of channels
-    static const int MAX_N_SAMP = 5000; // maximum display size in pixels
-    //float waves[MAX_N_CHAN][MAX_N_SAMP*2]; // we need an x and y point for each sample
 
     LfpTriggeredAverageNode* processor;
-    AudioSampleBuffer* displayBuffer;
-    AudioSampleBuffer* screenBuffer;
-    MidiBuffer* eventBuffer;
+
+    // latest snapshot of each trigger channel's average
+    OwnedArray<AudioSampleBuffer> means;
+    OwnedArray<AudioSampleBuffer> stdDevs;
+    Array<int> trialCounts;
+    Array<int> lastUpdateCounts;
 
     ScopedPointer<LfpTriggeredAverageTimescale> timescale;
     ScopedPointer<LfpTriggeredAverageDisplay> display;
     ScopedPointer<Viewport> viewport;
 
-    ScopedPointer<ComboBox> timebaseSelection;
     ScopedPointer<ComboBox> rangeSelection;
     ScopedPointer<ComboBox> spreadSelection;
 
     StringArray voltageRanges;
-    StringArray timebases;
     StringArray spreads; // option for vertical spacing between channels
 
     OwnedArray<LfpTriggeredAverageEventInterface> LfpTriggeredAverageEventInterfaces;
 
-    void refreshScreenBuffer();
-    void updateScreenBuffer();
-
-    int displayBufferIndex;
-    int displayBufferSize;
+    /** Copies the averages that changed since the last call; returns true if any did. */
+    bool updateSnapshots();
 
     int scrollBarThickness;
 
@@ -141,13 +136,14 @@ public:
 
     void paint(Graphics& g);
 
-    void setTimebase(float t);
+    void setWindow(float preMs, float postMs);
 
 private:
 
     LfpTriggeredAverageCanvas* canvas;
 
-    float timebase;
+    float preMs;
+    float postMs;
 
     Font font;
 
@@ -32,6 +32,40 @@ LfpTriggeredAverageEditor::LfpTriggeredAverageEditor(GenericProcessor* parentNod
     tabText = "LFP";
     desiredWidth = 180;
 
+    LfpTriggeredAverageNode* processor = (LfpTriggeredAverageNode*) getProcessor();
+
+    preLabel = new Label("Pre", "Pre (ms):");
+    preLabel->setBounds(10,30,80,20);
+    addAndMakeVisible(preLabel);
+
+    preValue = new Label("Pre", String(processor->getPreWindowMs()));
+    preValue->setBounds(90,32,60,18);
+    preValue->setFont(Font("Default", 15, Font::plain));
+    preValue->setColour(Label::textColourId, Colours::white);
+    preValue->setColour(Label::backgroundColourId, Colours::grey);
+    preValue->setEditable(true);
+    preValue->addListener(this);
+    addAndMakeVisible(preValue);
+
+    postLabel = new Label("Post", "Post (ms):");
+    postLabel->setBounds(10,55,80,20);
+    addAndMakeVisible(postLabel);
+
+    postValue = new Label("Post", String(processor->getPostWindowMs()));
+    postValue->setBounds(90,57,60,18);
+    postValue->setFont(Font("Default", 15, Font::plain));
+    postValue->setColour(Label::textColourId, Colours::white);
+    postValue->setColour(Label::backgroundColourId, Colours::grey);
+    postValue->setEditable(true);
+    postValue->addListener(this);
+    addAndMakeVisible(postValue);
+
+    clearButton = new UtilityButton("CLEAR", Font("Small Text", 13, Font::plain));
+    clearButton->setBounds(10,85,60,20);
+    clearButton->setRadius(3.0f);
+    clearButton->addListener(this);
+    addAndMakeVisible(clearButton);
+
 }
 
 LfpTriggeredAverageEditor::~LfpTriggeredAverageEditor()
@@ -43,23 +77,55 @@ Visualizer* LfpTriggeredAverageEditor::createNewCanvas()
 {
 
     LfpTriggeredAverageNode* processor = (LfpTriggeredAverageNode*) getProcessor();
-    return 0; //new LfpTriggeredAverageCanvas(processor);
+    return new LfpTriggeredAverageCanvas(processor);
 
 }
 
 void LfpTriggeredAverageEditor::buttonCallback(Button* button)
 {
 
-    int gId = button->getRadioGroupId();
-
-    if (gId > 0)
+    if (button == clearButton)
     {
-        if (canvas != 0)
-        {
-            canvas->setParameter(gId-1, button->getName().getFloatValue());
-        }
+        LfpTriggeredAverageNode* processor = (LfpTriggeredAverageNode*) getProcessor();
+        processor->clearAverages();
+    }
+
+}
+
+void LfpTriggeredAverageEditor::labelTextChanged(Label* label)
+{
+    LfpTriggeredAverageNode* processor = (LfpTriggeredAverageNode*) getProcessor();
 
+    if (label == preValue)
+    {
+        processor->setWindow(label->getText().getFloatValue(), processor->getPostWindowMs());
     }
+    else if (label == postValue)
+    {
+        processor->setWindow(processor->getPreWindowMs(), label->getText().getFloatValue());
+    }
+
+    updateSettings();
+}
+
+void LfpTriggeredAverageEditor::updateSettings()
+{
+    LfpTriggeredAverageNode* processor = (LfpTriggeredAverageNode*) getProcessor();
 
+    preValue->setText(String(processor->getPreWindowMs()), dontSendNotification);
+    postValue->setText(String(processor->getPostWindowMs()), dontSendNotification);
 }
 
+void LfpTriggeredAverageEditor::enable()
+{
+    preValue->setEnabled(false);
+    postValue->setEnabled(false);
+    VisualizerEditor::enable();
+}
+
+void LfpTriggeredAverageEditor::disable()
+{
+    preValue->setEnabled(true);
+    postValue->setEnabled(true);
+    VisualizerEditor::disable();
+}
@@ -37,24 +37,39 @@ class Visualizer;
 
 /**
 
-  User interface for the LfpDisplayNode sink.
+  User interface for the LfpTriggeredAverageNode sink.
 
-  @see LfpDisplayNode, LfpDisplayCanvas
+  Sets the window around each trigger and clears the accumulated averages.
+
+  @see LfpTriggeredAverageNode, LfpTriggeredAverageCanvas
 
 */
 
-class LfpTriggeredAverageEditor : public VisualizerEditor
+class LfpTriggeredAverageEditor : public VisualizerEditor,
+    public Label::Listener
 {
 public:
     LfpTriggeredAverageEditor(GenericProcessor*, bool useDefaultParameterEditors);
     ~LfpTriggeredAverageEditor();
 
     void buttonCallback(Button* button);
+    void labelTextChanged(Label* label);
+
+    void updateSettings();
+
+    void enable();
+    void disable();
 
     Visualizer* createNewCanvas();
 
 private:
 
+    ScopedPointer<Label> preLabel;
+    ScopedPointer<Label> preValue;
+    ScopedPointer<Label> postLabel;
+    ScopedPointer<Label> postValue;
+    ScopedPointer<UtilityButton> clearButton;
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpTriggeredAverageEditor);
 
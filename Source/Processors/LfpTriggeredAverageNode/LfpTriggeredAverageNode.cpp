@@ -27,20 +27,15 @@
 
 LfpTriggeredAverageNode::LfpTriggeredAverageNode()
     : GenericProcessor("LFP Trig. Avg."),
-      displayBufferIndex(0), displayGain(1), bufferLength(5.0f),
-      abstractFifo(100), ttlState(0)
+      preWindowMs(100.0f), postWindowMs(400.0f),
+      numChannels(0), samplesPerBin(1), preBins(0), windowBins(0),
+      ringLength(0), binPhase(0), binsWritten(0), samplesReceived(0)
 {
-    std::cout << " LfpTriggeredAverageNode Constructor" << std::endl;
-    displayBuffer = new AudioSampleBuffer(8, 100);
-    eventBuffer = new MidiBuffer();
-
-    arrayOfOnes = new float[5000];
-
-    for (int n = 0; n < 5000; n++)
+    for (int t = 0; t < MAX_TRIGGERS; t++)
     {
-        arrayOfOnes[n] = 1;
+        TriggerAccumulator* acc = accumulators.add(new TriggerAccumulator());
+        acc->count = 0;
     }
-
 }
 
 LfpTriggeredAverageNode::~LfpTriggeredAverageNode()
@@ -61,31 +56,80 @@ void LfpTriggeredAverageNode::updateSettings()
     std::cout << "Setting num inputs on LfpTriggeredAverageNode to " << getNumInputs() << std::endl;
 }
 
-bool LfpTriggeredAverageNode::resizeBuffer()
+void LfpTriggeredAverageNode::setWindow(float preMs, float postMs)
 {
-    int nSamples = (int) getSampleRate()*bufferLength;
-    int nInputs = getNumInputs();
+    preWindowMs = jlimit(0.0f, 10000.0f, preMs);
+    postWindowMs = jlimit(1.0f, 10000.0f, postMs);
+}
 
-    std::cout << "Resizing buffer. Samples: " << nSamples << ", Inputs: " << nInputs << std::endl;
+float LfpTriggeredAverageNode::getPreWindowMs() const
+{
+    return preWindowMs;
+}
 
-    if (nSamples > 0 && nInputs > 0)
-    {
-        abstractFifo.setTotalSize(nSamples);
-        displayBuffer->setSize(nInputs+1, nSamples); // add an extra channel for TTLs
-        return true;
-    }
-    else
-    {
+float LfpTriggeredAverageNode::getPostWindowMs() const
+{
+    return postWindowMs;
+}
+
+int LfpTriggeredAverageNode::getWindowBins() const
+{
+    return windowBins;
+}
+
+bool LfpTriggeredAverageNode::resizeBuffers()
+{
+    const float sampleRate = getSampleRate();
+    const int nInputs = getNumInputs();
+
+    const int preSamples = roundToInt(preWindowMs * sampleRate / 1000.0f);
+    const int windowSamples = preSamples + roundToInt(postWindowMs * sampleRate / 1000.0f);
+
+    if (windowSamples <= 0 || nInputs <= 0)
         return false;
+
+    samplesPerBin = (windowSamples + MAX_WINDOW_BINS - 1) / MAX_WINDOW_BINS;
+    preBins = preSamples / samplesPerBin;
+    windowBins = (windowSamples + samplesPerBin - 1) / samplesPerBin;
+
+    // room for a whole window plus a few large buffers, so completed windows
+    // can wait a buffer or two for the visualizer to release the accumulators
+    ringLength = nextPowerOfTwo(windowBins + 16384 / samplesPerBin + 16);
+
+    const ScopedLock sl(accumulatorLock);
+
+    numChannels = nInputs;
+
+    history.calloc(size_t(numChannels) * ringLength);
+    partialBins.calloc(numChannels);
+    scratchA.malloc(windowBins);
+    scratchB.malloc(windowBins);
+
+    for (int t = 0; t < MAX_TRIGGERS; t++)
+    {
+        TriggerAccumulator* acc = accumulators[t];
+        acc->mean.calloc(size_t(numChannels) * windowBins);
+        acc->m2.calloc(size_t(numChannels) * windowBins);
+        acc->count = 0;
+        ++acc->updateCount;
     }
 
+    std::cout << "LFP triggered average: " << windowBins << " bins of " << samplesPerBin
+              << " samples, " << numChannels << " channels" << std::endl;
+
+    return true;
 }
 
 bool LfpTriggeredAverageNode::enable()
 {
 
-    if (resizeBuffer())
+    if (resizeBuffers())
     {
+        binPhase = 0;
+        binsWritten = 0;
+        samplesReceived = 0;
+        pendingWindows.clearQuick();
+
         LfpTriggeredAverageEditor* editor = (LfpTriggeredAverageEditor*) getEditor();
         editor->enable();
         return true;
@@ -119,209 +163,246 @@ void LfpTriggeredAverageNode::setParameter(int parameterIndex, float newValue)
         ed->canvas->setParameter(parameterIndex, newValue);
 }
 
-void LfpTriggeredAverageNode::handleEvent(int eventType, MidiMessage& event)
+void LfpTriggeredAverageNode::handleEvent(int eventType, MidiMessage& event, int samplePosition)
 {
-    if (eventType == TTL)
-    {
-        const uint8* dataptr = event.getRawData();
+    if (eventType != TTL)
+        return;
 
-        // int eventNodeId = *(dataptr+1);
-        int eventId = *(dataptr+2);
-        int eventChannel = *(dataptr+3);
-        int eventTime = event.getTimeStamp();
+    const uint8* dataptr = event.getRawData();
 
-        int samplesLeft = totalSamples - eventTime;
+    int eventId = *(dataptr+2);
+    int eventChannel = *(dataptr+3);
 
-        //	std::cout << "Received event from " << eventNodeId << ", channel "
-        //	          << eventChannel << ", with ID " << eventId << std::endl;
-        //
-        int bufferIndex = (displayBufferIndex + eventTime);// % displayBuffer->getNumSamples();
+    // only rising edges open a window
+    if (eventId != 1 || eventChannel >= MAX_TRIGGERS || windowBins == 0)
+        return;
 
-        if (eventId == 1)
-        {
-            ttlState |= (1L << eventChannel);
-        }
-        else
-        {
-            ttlState &= ~(1L << eventChannel);
-        }
+    PendingWindow w;
+    w.startBin = (samplesReceived + samplePosition) / samplesPerBin - preBins;
+    w.trigger = eventChannel;
 
-        if (samplesLeft + bufferIndex < displayBuffer->getNumSamples())
-        {
+    if (w.startBin >= 0 && pendingWindows.size() < MAX_PENDING_WINDOWS)
+        pendingWindows.add(w);
+}
 
-            //	std::cout << bufferIndex << " " << samplesLeft << " " << ttlState << std::endl;
+void LfpTriggeredAverageNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
+{
+    if (windowBins == 0)
+        return;
 
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    bufferIndex,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    samplesLeft, 		// numSamples
-                                    float(ttlState));   // gain
-        }
-        else
-        {
+    const int nSamples = getNumSamples(0);
 
-            int block2Size = (samplesLeft + bufferIndex) % displayBuffer->getNumSamples();
-            int block1Size = samplesLeft - block2Size;
+    // event positions are relative to this buffer, so look at them before
+    // samplesReceived moves on
+    checkForEvents(events);
 
-            //std::cout << "OVERFLOW." << std::endl;
+    writeHistory(buffer, nSamples);
 
-            //std::cout << bufferIndex << " " << block1Size << " " << ttlState << std::endl;
+    samplesReceived += nSamples;
 
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    bufferIndex,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    block1Size, 		// numSamples
-                                    float(ttlState));   // gain
+    if (pendingWindows.size() > 0)
+        completeWindows();
+}
 
-            //std::cout << 0 << " " << block2Size << " " << ttlState << std::endl;
+void LfpTriggeredAverageNode::writeHistory(AudioSampleBuffer& buffer, int nSamples)
+{
+    const int mask = ringLength - 1;
+    const int numInputs = jmin(numChannels, buffer.getNumChannels());
+    const float invSamplesPerBin = 1.0f / samplesPerBin;
 
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    0,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    block2Size, 		// numSamples
-                                    float(ttlState));   // gain
+    for (int ch = 0; ch < numInputs; ch++)
+    {
+        const float* src = buffer.getReadPointer(ch);
+        float* ring = history + size_t(ch) * ringLength;
 
+        if (samplesPerBin == 1)
+        {
+            const int start = int(binsWritten & mask);
+            const int firstPart = jmin(nSamples, ringLength - start);
 
+            FloatVectorOperations::copy(ring + start, src, firstPart);
+            FloatVectorOperations::copy(ring, src + firstPart, nSamples - firstPart);
+            continue;
         }
 
+        // sum samples into bins, carrying an unfinished bin over to the next buffer
+        float sum = partialBins[ch];
+        int phase = binPhase;
+        int64 bin = binsWritten;
+        int n = 0;
 
-        // 	std::cout << "ttlState: " << ttlState << std::endl;
+        while (n < nSamples)
+        {
+            const int numToAdd = jmin(samplesPerBin - phase, nSamples - n);
 
-        // std::cout << "Received event from " << eventNodeId <<
-        //              " on channel " << eventChannel <<
-        //             " with value " << eventId <<
-        //             " at timestamp " << event.getTimeStamp() << std::endl;
+            for (int i = 0; i < numToAdd; i++)
+                sum += src[n + i];
 
+            n += numToAdd;
+            phase += numToAdd;
 
-    }
-    else if (eventType == TIMESTAMP)
-    {
+            if (phase == samplesPerBin)
+            {
+                ring[bin & mask] = sum * invSamplesPerBin;
+                bin++;
+                sum = 0;
+                phase = 0;
+            }
+        }
 
-        const uint8* dataptr = event.getRawData();
+        partialBins[ch] = sum;
+    }
 
-        // int eventNodeId = *(dataptr+1);
-        // int eventId = *(dataptr+2);
-        // int eventChannel = *(dataptr+3);
+    const int total = binPhase + nSamples;
+    binsWritten += total / samplesPerBin;
+    binPhase = total % samplesPerBin;
+}
 
-        // update the timestamp for the current buffer:
-        memcpy(&bufferTimestamp, dataptr+4, 4);
+void LfpTriggeredAverageNode::completeWindows()
+{
+    // the visualizer may be copying a snapshot; try again next buffer
+    const ScopedTryLock tl(accumulatorLock);
 
+    if (!tl.isLocked())
+        return;
 
+    for (int i = 0; i < pendingWindows.size(); i++)
+    {
+        const PendingWindow& w = pendingWindows.getReference(i);
 
-        //   	double timeInSeconds = double(ts)/Time::getHighResolutionTicksPerSecond();
-        //   	//int64 timestamp = ts[0] << 32 +
-        //   	//				  ts[1] << 16 +
-        //   	//				  ts[2] << 8 +
-        //   	//				  ts[3];
-        //   	//memcpy(ts, dataptr+4, 1);
+        if (w.startBin + windowBins > binsWritten)
+            continue;
 
-        //   	std::cout << "Time in seconds is " << timeInSeconds << std::endl;
+        if (binsWritten - w.startBin <= ringLength)
+            accumulate(*accumulators[w.trigger], w.startBin);
 
-        // // std::cout << "Received event from " << eventNodeId <<
-        //    	//              " on channel " << eventChannel <<
-        //    	 //             " with value " << eventId <<
-        //    	 //             " for time: " << ts << std::endl;
+        pendingWindows.remove(i--);
     }
 }
 
-void LfpTriggeredAverageNode::initializeEventChannel()
+void LfpTriggeredAverageNode::accumulate(TriggerAccumulator& acc, int64 startBin)
 {
-    if (displayBufferIndex + totalSamples < displayBuffer->getNumSamples())
-    {
+    acc.count++;
 
-        //	std::cout << getNumInputs()+1 << " " << displayBufferIndex << " " << totalSamples << " " << ttlState << std::endl;
-        //
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                displayBufferIndex,		// destStartSample
-                                arrayOfOnes, 		// source
-                                totalSamples, 		// numSamples
-                                float(ttlState));   // gain
-    }
-    else
-    {
+    const float invCount = 1.0f / acc.count;
+    const int start = int(startBin & (ringLength - 1));
+    const int firstPart = jmin(windowBins, ringLength - start);
 
-        int block2Size = (displayBufferIndex + totalSamples) % displayBuffer->getNumSamples();
-        int block1Size = totalSamples - block2Size;
-
-        // std::cout << "OVERFLOW." << std::endl;
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        const float* ring = history + size_t(ch) * ringLength;
+        float* mean = acc.mean + size_t(ch) * windowBins;
+        float* m2 = acc.m2 + size_t(ch) * windowBins;
 
-        // std::cout << bufferIndex << " " << block1Size << " " << ttlState << std::endl;
+        // a window that wraps around the end of the ring is done in two parts
+        updateRunningStats(mean, m2, ring + start, firstPart, invCount);
+        updateRunningStats(mean + firstPart, m2 + firstPart, ring, windowBins - firstPart, invCount);
+    }
 
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                displayBufferIndex,		// destStartSample
-                                arrayOfOnes, 		// source
-                                block1Size, 		// numSamples
-                                float(ttlState));   // gain
-        // std::cout << 0 << " " << block2Size << " " << ttlState << std::endl;
+    ++acc.updateCount;
+}
 
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                0,		// destStartSample
-                                arrayOfOnes, 		// source
-                                block2Size, 		// numSamples
-                                float(ttlState));   // gain
+void LfpTriggeredAverageNode::updateRunningStats(float* mean, float* m2, const float* x, int numValues, float invCount)
+{
+    if (numValues <= 0)
+        return;
+
+    // Welford: delta = x - mean; mean += delta / n; m2 += delta * (x - mean)
+    FloatVectorOperations::copy(scratchA, x, numValues);
+    FloatVectorOperations::subtract(scratchA, mean, numValues);
+    FloatVectorOperations::addWithMultiply(mean, scratchA, invCount, numValues);
+
+    FloatVectorOperations::copy(scratchB, x, numValues);
+    FloatVectorOperations::subtract(scratchB, mean, numValues);
+    FloatVectorOperations::multiply(scratchA, scratchB, numValues);
+    FloatVectorOperations::add(m2, scratchA, numValues);
+}
 
+int LfpTriggeredAverageNode::getUpdateCount(int trigger) const
+{
+    if (trigger < 0 || trigger >= MAX_TRIGGERS)
+        return 0;
 
-    }
+    return accumulators[trigger]->updateCount.get();
 }
 
-void LfpTriggeredAverageNode::process(AudioSampleBuffer& buffer, MidiBuffer& events)
+int LfpTriggeredAverageNode::copyAverage(int trigger, AudioSampleBuffer& mean, AudioSampleBuffer* stdDev)
 {
-    // 1. place any new samples into the displayBuffer
-    //std::cout << "Display node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
+    if (trigger < 0 || trigger >= MAX_TRIGGERS)
+        return 0;
 
-    int nSamples = 100;
+    const ScopedLock sl(accumulatorLock);
 
-    totalSamples = nSamples; //nSamples;
-    displayBufferIndexEvents = displayBufferIndex;
+    TriggerAccumulator* acc = accumulators[trigger];
 
-    initializeEventChannel();
+    if (numChannels == 0 || windowBins == 0)
+        return 0;
 
-    checkForEvents(events); // update timestamp, see if we got any TTL events
+    mean.setSize(numChannels, windowBins);
 
-    int samplesLeft = displayBuffer->getNumSamples() - displayBufferIndex;
+    for (int ch = 0; ch < numChannels; ch++)
+        mean.copyFrom(ch, 0, acc->mean + size_t(ch) * windowBins, windowBins);
 
-    if (nSamples < samplesLeft)
+    if (stdDev != nullptr)
     {
+        stdDev->setSize(numChannels, windowBins);
+        stdDev->clear();
 
-        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+        if (acc->count > 1)
         {
-            displayBuffer->copyFrom(chan,  			// destChannel
-                                    displayBufferIndex, // destStartSample
-                                    buffer, 			// source
-                                    chan, 				// source channel
-                                    0,					// source start sample
-                                    nSamples); 			// numSamples
+            const float scale = 1.0f / (acc->count - 1);
 
-        }
-        displayBufferIndex += (nSamples);
+            for (int ch = 0; ch < numChannels; ch++)
+            {
+                float* dest = stdDev->getWritePointer(ch);
+                FloatVectorOperations::copyWithMultiply(dest, acc->m2 + size_t(ch) * windowBins, scale, windowBins);
 
+                for (int i = 0; i < windowBins; i++)
+                    dest[i] = std::sqrt(jmax(0.0f, dest[i]));
+            }
+        }
     }
-    else
-    {
 
-        int extraSamples = nSamples - samplesLeft;
+    return acc->count;
+}
+
+void LfpTriggeredAverageNode::clearAverages()
+{
+    const ScopedLock sl(accumulatorLock);
+
+    for (int t = 0; t < MAX_TRIGGERS; t++)
+    {
+        TriggerAccumulator* acc = accumulators[t];
 
-        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+        if (acc->mean != nullptr)
         {
-            displayBuffer->copyFrom(chan,  				// destChannel
-                                    displayBufferIndex, // destStartSample
-                                    buffer, 			// source
-                                    chan, 				// source channel
-                                    0,					// source start sample
-                                    samplesLeft); 		// numSamples
-
-            displayBuffer->copyFrom(chan,
-                                    0,
-                                    buffer,
-                                    chan,
-                                    samplesLeft,
-                                    extraSamples);
+            FloatVectorOperations::clear(acc->mean, numChannels * windowBins);
+            FloatVectorOperations::clear(acc->m2, numChannels * windowBins);
         }
 
-        displayBufferIndex = extraSamples;
+        acc->count = 0;
+        ++acc->updateCount;
     }
+}
 
-
-
+void LfpTriggeredAverageNode::saveCustomParametersToXml(XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement("TRIGGEREDAVERAGE");
+    mainNode->setAttribute("preMs", preWindowMs);
+    mainNode->setAttribute("postMs", postWindowMs);
 }
 
+void LfpTriggeredAverageNode::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement(*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName("TRIGGEREDAVERAGE"))
+            {
+                setWindow(mainNode->getDoubleAttribute("preMs", preWindowMs),
+                          mainNode->getDoubleAttribute("postMs", postWindowMs));
+            }
+        }
+    }
+}
@@ -33,9 +33,22 @@ class DataViewport;
 
 /**
 
-  Displays the average of a continuous signal, triggered on a certain event channel.
+  Averages a continuous signal around TTL events.
 
-  @see GenericProcessor, LfpTriggeredAverageEditor, LfpDisplayCanvas
+  Every rising edge on event channels 0-7 opens a window from preMs before to
+  postMs after the event. Windows may overlap. Once a window's last sample has
+  arrived, the running mean and variance of every channel in that window are
+  updated (Welford's method) in the accumulators of the event's channel, so
+  averages are always up to date without keeping individual trials.
+
+  Long windows are averaged in bins of several samples, so that a window never
+  has more than MAX_WINDOW_BINS points.
+
+  The visualizer reads a snapshot of the accumulators with copyAverage(); the
+  audio thread never waits for it and retries a completed window on the next
+  buffer if a snapshot is being taken.
+
+  @see GenericProcessor, LfpTriggeredAverageEditor, LfpTriggeredAverageCanvas
 
 */
 
@@ -63,40 +76,84 @@ public:
     bool enable();
     bool disable();
 
-    void handleEvent(int, MidiMessage&);
+    void handleEvent(int eventType, MidiMessage& event, int samplePosition);
 
-    AudioSampleBuffer* getDisplayBufferAddress()
-    {
-        return displayBuffer;
-    }
-    int getDisplayBufferIndex()
-    {
-        return displayBufferIndex;
-    }
+    /** Window around each trigger; may only be changed while acquisition is stopped. */
+    void setWindow(float preMs, float postMs);
+    float getPreWindowMs() const;
+    float getPostWindowMs() const;
 
-private:
+    /** Number of points per channel in the averages (valid after enable()). */
+    int getWindowBins() const;
 
-    void initializeEventChannel();
+    /** Incremented whenever the average of a trigger channel changes. */
+    int getUpdateCount(int trigger) const;
 
-    ScopedPointer<AudioSampleBuffer> displayBuffer;
-    ScopedPointer<MidiBuffer> eventBuffer;
+    /** Copies the current average of a trigger channel (channels x window bins)
+        and, optionally, its standard deviation. Returns the number of triggers
+        that went into it. */
+    int copyAverage(int trigger, AudioSampleBuffer& mean, AudioSampleBuffer* stdDev);
 
-    int displayBufferIndex;
-    int displayBufferIndexEvents;
+    /** Discards all accumulated trials. */
+    void clearAverages();
 
-    float displayGain; //
-    float bufferLength; // s
+    void saveCustomParametersToXml(XmlElement* parentElement);
+    void loadCustomParametersFromXml();
 
-    AbstractFifo abstractFifo;
+    enum
+    {
+        MAX_TRIGGERS = 8,
+        MAX_WINDOW_BINS = 2048,
+        MAX_PENDING_WINDOWS = 1024
+    };
 
-    int64 bufferTimestamp;
-    int ttlState;
-    float* arrayOfOnes;
-    int totalSamples;
+private:
 
-    //Time timer;
+    struct PendingWindow
+    {
+        int64 startBin;
+        int trigger;
+    };
 
-    bool resizeBuffer();
+    struct TriggerAccumulator
+    {
+        HeapBlock<float> mean; // numChannels x windowBins
+        HeapBlock<float> m2;   // sum of squared differences from the mean
+        int count;
+        Atomic<int> updateCount;
+    };
+
+    bool resizeBuffers();
+
+    /** Appends a block to the history ring, averaging groups of samplesPerBin samples. */
+    void writeHistory(AudioSampleBuffer& buffer, int nSamples);
+
+    /** Adds every pending window whose samples are all in the ring. */
+    void completeWindows();
+    void accumulate(TriggerAccumulator& acc, int64 startBin);
+    void updateRunningStats(float* mean, float* m2, const float* x, int numValues, float invCount);
+
+    float preWindowMs;
+    float postWindowMs;
+
+    int numChannels;
+    int samplesPerBin;
+    int preBins;
+    int windowBins;
+
+    // per-channel history rings of ringLength bins (a power of two)
+    HeapBlock<float> history;
+    int ringLength;
+    HeapBlock<float> partialBins;
+    int binPhase;
+    int64 binsWritten;
+    int64 samplesReceived;
+
+    HeapBlock<float> scratchA, scratchB;
+
+    Array<PendingWindow> pendingWindows;
+    OwnedArray<TriggerAccumulator> accumulators;
+    CriticalSection accumulatorLock;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpTriggeredAverageNode);
 
@@ -0,0 +1,263 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "OutputDispatcher.h"
+#include "../GenericProcessor/GenericProcessor.h"
+
+
+DeviceCommand::DeviceCommand()
+    : type(0), channel(0), value(0), dueTicks(0), ingestionTicks(0), readyTicks(0)
+{
+
+}
+
+
+OutputDispatcher::OutputDispatcher(const String& name, Device* device_, GenericProcessor* owner_,
+                                   int pollIntervalMs_)
+    : Thread(name), device(device_), owner(owner_), pollIntervalMs(pollIntervalMs_),
+      fifo(QUEUE_SIZE)
+{
+    queue.malloc(QUEUE_SIZE);
+    pending.ensureStorageAllocated(QUEUE_SIZE);
+}
+
+
+OutputDispatcher::~OutputDispatcher()
+{
+    stop();
+}
+
+
+void OutputDispatcher::start()
+{
+    if (isThreadRunning())
+        return;
+
+    fifo.reset();
+    pending.clearQuick();
+    jitter.reset();
+    droppedCommands = 0;
+
+    startThread(9); // one below realtime; these threads mostly sleep
+}
+
+
+void OutputDispatcher::stop()
+{
+    if (!isThreadRunning())
+        return;
+
+    signalThreadShouldExit();
+    notify();
+    stopThread(2000);
+}
+
+
+bool OutputDispatcher::isDispatching() const
+{
+    return isThreadRunning();
+}
+
+
+bool OutputDispatcher::schedule(const DeviceCommand& command)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 < 1)
+    {
+        ++droppedCommands;
+        return false;
+    }
+
+    DeviceCommand& queued = queue[size1 > 0 ? start1 : start2];
+    queued = command;
+
+    const int64 now = Time::getHighResolutionTicks();
+
+    if (queued.dueTicks == 0)
+        queued.dueTicks = now;
+
+    queued.readyTicks = jmax(queued.dueTicks, now);
+
+    fifo.finishedWrite(1);
+
+    return true;
+}
+
+
+void OutputDispatcher::post(const DeviceCommand& command)
+{
+    {
+        const ScopedLock sl(postLock);
+
+        if (isThreadRunning())
+        {
+            posted.add(command);
+
+            DeviceCommand& queued = posted.getReference(posted.size() - 1);
+            const int64 now = Time::getHighResolutionTicks();
+
+            if (queued.dueTicks == 0)
+                queued.dueTicks = now;
+
+            queued.readyTicks = jmax(queued.dueTicks, now);
+
+            notify();
+            return;
+        }
+    }
+
+    device->execute(command);
+}
+
+
+int64 OutputDispatcher::getTicksForSample(int64 ingestionTicks, int sampleNum, double sampleRate,
+                                          double delayMs)
+{
+    if (ingestionTicks == 0 || sampleRate <= 0)
+        return Time::getHighResolutionTicks() + int64(delayMs / 1000.0 * Time::getHighResolutionTicksPerSecond());
+
+    const double seconds = sampleNum / sampleRate + delayMs / 1000.0;
+
+    return ingestionTicks + int64(seconds * Time::getHighResolutionTicksPerSecond());
+}
+
+
+LatencyHistogram& OutputDispatcher::getJitter()
+{
+    return jitter;
+}
+
+
+int OutputDispatcher::getNumDroppedCommands() const
+{
+    return droppedCommands.get();
+}
+
+
+void OutputDispatcher::collectCommands()
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    Array<DeviceCommand> incoming;
+
+    for (int i = 0; i < size1; i++)
+        incoming.add(queue[start1 + i]);
+
+    for (int i = 0; i < size2; i++)
+        incoming.add(queue[start2 + i]);
+
+    fifo.finishedRead(size1 + size2);
+
+    {
+        const ScopedLock sl(postLock);
+        incoming.addArray(posted);
+        posted.clearQuick();
+    }
+
+    // keep pending sorted by due time; commands due at the same time keep their order
+    for (int i = 0; i < incoming.size(); i++)
+    {
+        const DeviceCommand& command = incoming.getReference(i);
+
+        int index = pending.size();
+
+        while (index > 0 && pending.getReference(index - 1).dueTicks > command.dueTicks)
+            index--;
+
+        pending.insert(index, command);
+    }
+}
+
+
+void OutputDispatcher::execute(const DeviceCommand& command)
+{
+    static const double microsecondsPerTick = 1.0e6 / double(Time::getHighResolutionTicksPerSecond());
+
+    const int64 sent = Time::getHighResolutionTicks();
+
+    device->execute(command);
+
+    jitter.add(jmax(int64(0), int64((sent - command.readyTicks) * microsecondsPerTick)));
+
+    if (owner != nullptr)
+        owner->recordOutputLatency(command.ingestionTicks);
+}
+
+
+void OutputDispatcher::run()
+{
+    const int64 spinTicks = SPIN_MS * Time::getHighResolutionTicksPerSecond() / 1000;
+
+    while (!threadShouldExit())
+    {
+        collectCommands();
+
+        int64 now = Time::getHighResolutionTicks();
+
+        while (pending.size() > 0 && pending.getReference(0).dueTicks <= now)
+        {
+            execute(pending.getReference(0));
+            pending.remove(0);
+            now = Time::getHighResolutionTicks();
+        }
+
+        if (pollIntervalMs >= 0)
+            device->poll();
+
+        if (pending.size() == 0)
+        {
+            wait(pollIntervalMs >= 0 ? jmin(int(COLLECT_MS), pollIntervalMs) : int(COLLECT_MS));
+        }
+        else
+        {
+            const int64 remaining = pending.getReference(0).dueTicks - Time::getHighResolutionTicks();
+
+            // sleeping is only accurate to about a millisecond, so the last stretch is spent yielding
+            if (remaining > spinTicks)
+            {
+                int sleepMs = int((remaining - spinTicks) * 1000 / Time::getHighResolutionTicksPerSecond());
+                sleepMs = jmin(sleepMs, int(COLLECT_MS));
+
+                if (pollIntervalMs >= 0)
+                    sleepMs = jmin(sleepMs, pollIntervalMs);
+
+                wait(jmax(1, sleepMs));
+            }
+            else
+            {
+                Thread::yield();
+            }
+        }
+    }
+
+    // nothing queued before stop() is lost
+    collectCommands();
+
+    for (int i = 0; i < pending.size(); i++)
+        execute(pending.getReference(i));
+
+    pending.clearQuick();
+}
@@ -0,0 +1,168 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef OUTPUTDISPATCHER_H_INCLUDED
+#define OUTPUTDISPATCHER_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/LatencyHistogram.h"
+
+class GenericProcessor;
+
+/** A command for an external device, queued by OutputDispatcher. The meaning of
+    type, channel and value is up to the device. */
+struct DeviceCommand
+{
+    DeviceCommand();
+
+    int type;
+    int channel;
+    int value;
+
+    /** High-resolution tick count at which the command should be executed; 0 for as soon as possible. */
+    int64 dueTicks;
+
+    /** Ingestion ticks of the data that caused the command, or 0 (see GenericProcessor::getIngestionTicks()). */
+    int64 ingestionTicks;
+
+    /** Set by the dispatcher: the earliest the command could run, its due time or, if it
+        was already overdue when it was queued, the time it was queued. */
+    int64 readyTicks;
+};
+
+/**
+
+  Talks to an external device (serial port, USB, network) from a worker thread of
+  its own, so that slow or stalled device I/O never holds up the audio callback.
+
+  The processor's process() method queues commands with schedule(), which only copies
+  them into a preallocated single-producer FIFO. Waking the worker would take a lock,
+  so schedule() doesn't; instead the worker never sleeps longer than COLLECT_MS
+  before checking the FIFO again. The worker executes each command at its due time, typically the wall-clock time of the sample that triggered it
+  (getTicksForSample()). That time has usually passed by the time the block is processed,
+  so such commands run as soon as the worker collects them; getJitter() records how much
+  later than that each one was sent, and the time from acquisition to the device goes
+  into the owner's output latency. Devices that also produce data can be polled by the
+  worker between commands.
+
+  Commands from the message thread (e.g. from an editor) go through post(), which runs
+  them directly while the dispatcher is stopped, so that only one thread ever talks to
+  the device.
+
+  Any device path the serial classes can open works, so a pseudo-terminal pair
+  (e.g. "socat -d -d pty,raw,echo=0 pty,raw,echo=0") can stand in for an Arduino or
+  Pulse Pal when testing without hardware.
+
+  @see ArduinoOutput, PulsePalOutput, SerialInput, WiFiOutput
+
+*/
+
+class OutputDispatcher : public Thread
+{
+public:
+
+    class Device
+    {
+    public:
+        virtual ~Device() {}
+
+        /** Worker thread (or the caller of post() while stopped): performs one command. */
+        virtual void execute(const DeviceCommand& command) = 0;
+
+        /** Worker thread: called between commands if the dispatcher was created with a
+            poll interval, for devices that read data. */
+        virtual void poll() {}
+    };
+
+    /** If owner is given, the latency of every executed command that carries ingestion
+        ticks is added to the owner's output latency. pollIntervalMs < 0 disables polling. */
+    OutputDispatcher(const String& name, Device* device, GenericProcessor* owner = nullptr,
+                     int pollIntervalMs = -1);
+    ~OutputDispatcher();
+
+    /** Starts the worker; called when acquisition starts. */
+    void start();
+
+    /** Executes everything still queued, whatever its due time, then stops the worker. */
+    void stop();
+
+    bool isDispatching() const;
+
+    /** Audio thread: queues a command without locking or allocating; the worker picks it up
+        within COLLECT_MS. Returns false, and counts the command as dropped, if the queue is full. */
+    bool schedule(const DeviceCommand& command);
+
+    /** Other threads: queues a command while the worker runs, or executes it straight away. */
+    void post(const DeviceCommand& command);
+
+    /** Returns the tick count at which a sample of the current buffer was acquired, given
+        the buffer's ingestion ticks, plus an optional delay. */
+    static int64 getTicksForSample(int64 ingestionTicks, int sampleNum, double sampleRate,
+                                   double delayMs = 0.0);
+
+    /** How much later than they were ready (see DeviceCommand::readyTicks) commands were
+        sent to the device, in microseconds. */
+    LatencyHistogram& getJitter();
+
+    int getNumDroppedCommands() const;
+
+    void run() override;
+
+    enum
+    {
+        QUEUE_SIZE = 1024,
+
+        /** The longest the worker sleeps before checking the FIFO for new commands */
+        COLLECT_MS = 1,
+
+        /** Below this many milliseconds before a due time the worker yields instead of sleeping */
+        SPIN_MS = 2
+    };
+
+private:
+
+    void collectCommands();
+    void execute(const DeviceCommand& command);
+
+    Device* device;
+    GenericProcessor* owner;
+    const int pollIntervalMs;
+
+    AbstractFifo fifo;
+    HeapBlock<DeviceCommand> queue;
+
+    CriticalSection postLock;
+    Array<DeviceCommand> posted;
+
+    /** Collected commands ordered by due time; owned by the worker */
+    Array<DeviceCommand> pending;
+
+    LatencyHistogram jitter;
+    Atomic<int> droppedCommands;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OutputDispatcher);
+
+};
+
+
+#endif  // OUTPUTDISPATCHER_H_INCLUDED
@@ -342,14 +342,11 @@ void PeriStimulusTimeHistogramNode::handleEvent(int eventType, MidiMessage& even
 
     if (eventType == SPIKE)
     {
-        const uint8_t* dataptr = event.getRawData();
+        const SpikeObject* spike = getSpikeFromEvent(event);
 
-        int bufferSize = event.getRawDataSize();
-
-        if (bufferSize > 0)
+        if (spike != nullptr)
         {
-            SpikeObject newSpike;
-            unpackSpike(&newSpike, dataptr, bufferSize);
+            const SpikeObject& newSpike = *spike;
 
             if (newSpike.sortedId > 0)   // drop unsorted spikes
             {
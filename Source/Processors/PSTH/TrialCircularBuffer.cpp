@@ -28,6 +28,7 @@
 #include "../Channel/Channel.h"
 #include <string>
 #include "tictoc.h"
+#include <atomic>
 #ifdef WIN32
 #include <windows.h>
 #else
@@ -100,7 +101,8 @@ void setDefaultColors(uint8& R, uint8& G, uint8& B, int ID)
 
 
 /******************************/
-PSTH::PSTH(int ID, TrialCircularBufferParams params_, bool vis) : conditionID(ID),visible(vis),numTrials(0),params(params_)
+PSTH::PSTH(int ID, TrialCircularBufferParams params_, bool vis) : conditionID(ID),visible(vis),numTrials(0),params(params_),
+    numStoredTrials(0), lastTrialRow(-1)
 {
     // if approximate is on, we won't sample exactly xmin and xmax
     if (params.approximate)
@@ -178,7 +180,9 @@ PSTH::PSTH(const PSTH& c)
     params = c.params;
     numBins = c.numBins;
     avgResponse=c.avgResponse;
-    prevTrials = c.prevTrials;
+    trialHistory = c.trialHistory;
+    numStoredTrials = c.numStoredTrials;
+    lastTrialRow = c.lastTrialRow;
     numDataPoints=c.numDataPoints;
     timeSpanSecs = c.timeSpanSecs;
     binTime = c.binTime;
@@ -214,26 +218,15 @@ void PSTH::clear()
 
 }
 
-void PSTH::updatePSTH(SmartSpikeCircularBuffer* spikeBuffer, Trial* trial)
+int PSTH::binTrialSpikes(SmartSpikeCircularBuffer* spikeBuffer, Trial* trial, float* spikeCounts, float& lastUpdateTS) const
 {
+    const float ticksPerSec = Time::getHighResolutionTicksPerSecond();
 
-    tictoc.Tic(16);
-    Time t;
-    float ticksPerSec =t.getHighResolutionTicksPerSecond();
-
-    tictoc.Tic(30);
     std::vector<int64> alignedSpikes = spikeBuffer->getAlignedSpikes(trial, mod_pre_sec, mod_post_sec);
-    tictoc.Toc(31);
 
-    tictoc.Tic(32);
-    std::vector<float> instantaneousSpikesRate;
-    instantaneousSpikesRate.resize(numBins);
-    for (int k = 0; k < numBins; k++)
-    {
-        instantaneousSpikesRate[k] = 0;
-    }
+    FloatVectorOperations::clear(spikeCounts, numBins);
 
-    //std::cout << "Received " << alignedSpikes.size() << " spikes." << std::endl;
+    const float binsPerSec = numBins / timeSpanSecs;
 
     for (int k = 0; k < alignedSpikes.size(); k++)
     {
@@ -241,47 +234,28 @@ void PSTH::updatePSTH(SmartSpikeCircularBuffer* spikeBuffer, Trial* trial)
         // convert ticks back to seconds, then to bins.
         float spikeTimeSec = float(alignedSpikes[k]) / ticksPerSec;
 
-        if (k == 0 || k == alignedSpikes.size() - 1)
-        {
-            //std::cout << "Spike time = " << spikeTimeSec << std::endl;
-        }
-
-        int binIndex = (spikeTimeSec + mod_pre_sec) / timeSpanSecs * numBins;
+        int binIndex = (spikeTimeSec + mod_pre_sec) * binsPerSec;
 
         if (binIndex >= 0 && binIndex < numBins)
         {
-            instantaneousSpikesRate[binIndex] += 1.0;
+            spikeCounts[binIndex] += 1.0;
         }
     }
 
-    float lastUpdateTS = float(trial->endTS-trial->alignTS) / ticksPerSec + mod_post_sec;
-    int lastBinIndex = (int)((lastUpdateTS + mod_pre_sec) / timeSpanSecs * numBins);
+    lastUpdateTS = float(trial->endTS-trial->alignTS) / ticksPerSec + mod_post_sec;
+
+    return jlimit(0, numBins, (int)((lastUpdateTS + mod_pre_sec) * binsPerSec));
+}
 
+void PSTH::updatePSTH(const float* spikeCounts, int numBinsToUpdate, float lastUpdateTS)
+{
     xmax = MAX(xmax,lastUpdateTS);
 
     numTrials++;
-    // Update average firing rate, up to when the trial ended.
-    ymax = -1e10;
-    ymin = 1e10;
-
-    float scale = 1000.0;
-    for (int k = 0; k < lastBinIndex; k++)
-    {
-        numDataPoints[k]++;
-        avgResponse[k] = ((numDataPoints[k] - 1) * avgResponse[k] + scale*instantaneousSpikesRate[k]) / numDataPoints[k];
-        ymax = MAX(ymax,avgResponse[k]);
-        ymin = MIN(ymin,avgResponse[k]);
-    }
-    tictoc.Toc(32);
-
-    // keep existing trial
-    if (prevTrials.size()+1 > params.maxTrialsInMemory)
-    {
-        prevTrials.pop_back();
-    }
-    prevTrials.push_front(instantaneousSpikesRate);
-    tictoc.Toc(16);
 
+    // Update average firing rate, up to when the trial ended.
+    accumulate(spikeCounts, numBinsToUpdate, 1000.0f);
+    storeTrial(spikeCounts);
 }
 
 void PSTH::getRange(float& xMin, float& xMax, float& yMin, float& yMax)
@@ -292,54 +266,74 @@ void PSTH::getRange(float& xMin, float& xMax, float& yMin, float& yMax)
     yMin = ymin;
 }
 
-void PSTH::updatePSTH(std::vector<float> alignedLFP,std::vector<bool> valid)
+void PSTH::updatePSTH(const float* alignedLFP, int numValidBins)
 {
-
     numTrials++;
 
-    ymax = -1e10;
-    ymin = 1e10;
     xmin = -mod_pre_sec;
     xmax = 0;
 
-    // Update average firing rate, up to when the trial ended.
-    for (int k = 0; k < valid.size(); k++)
+    if (numValidBins < numBins)
+        xmax = MAX(xmax, binTime[numValidBins]);
+
+    accumulate(alignedLFP, numValidBins, 1.0f);
+    storeTrial(alignedLFP);
+}
+
+void PSTH::accumulate(const float* trialResponse, int numBinsToUpdate, float scale)
+{
+    ymax = -1e10;
+    ymin = 1e10;
+
+    if (numBinsToUpdate <= 0)
+        return;
+
+    int* counts = &numDataPoints[0];
+    float* avg = &avgResponse[0];
+
+    // incremental running mean, avg_n = avg_(n-1) + (x_n - avg_(n-1)) / n
+    for (int k = 0; k < numBinsToUpdate; k++)
     {
-        if (!valid[k])
-        {
-            xmax = MAX(xmax, binTime[k]);
-            break;
-        }
-        numDataPoints[k]++;
-        avgResponse[k] = ((numDataPoints[k] - 1) * avgResponse[k] + alignedLFP[k]) / numDataPoints[k];
-        ymax = MAX(ymax, avgResponse[k]);
-        ymin = MIN(ymin, avgResponse[k]);
+        const int n = ++counts[k];
+        avg[k] += (scale * trialResponse[k] - avg[k]) / n;
     }
 
-    // keep existing trial
-    if (prevTrials.size()+1 > params.maxTrialsInMemory)
+    Range<float> range = FloatVectorOperations::findMinAndMax(avg, numBinsToUpdate);
+    ymin = range.getStart();
+    ymax = range.getEnd();
+}
+
+void PSTH::storeTrial(const float* trialResponse)
+{
+    const int maxTrials = params.maxTrialsInMemory;
+
+    if (maxTrials <= 0)
+        return;
+
+    // rows are only allocated as trials arrive, then reused oldest first
+    if (numStoredTrials < maxTrials)
     {
-        prevTrials.pop_back();
+        numStoredTrials++;
+        trialHistory.resize(numStoredTrials * numBins);
     }
-    prevTrials.push_front(alignedLFP);
 
+    lastTrialRow = (lastTrialRow + 1) % numStoredTrials;
+
+    FloatVectorOperations::copy(&trialHistory[lastTrialRow * numBins], trialResponse, numBins);
 }
 
 std::vector<float> PSTH::getAverageTrialResponse()
 {
-    std::vector<float> tmp;
-
-    tmp = avgResponse;
-
-    return tmp;
+    return avgResponse;
 }
 
 std::vector<float> PSTH::getLastTrial()
 {
     std::vector<float> tmp;
-    if (prevTrials.size() > 0)
+    if (numStoredTrials > 0)
     {
-        tmp = prevTrials.front();
+        const float* row = &trialHistory[lastTrialRow * numBins];
+        tmp.assign(row, row + numBins);
     }
     return tmp;
 }
@@ -493,7 +487,7 @@ ChannelPSTHs::ChannelPSTHs(int ID, TrialCircularBufferParams params_) : channelI
     numTrials = 0;
 }
 
-void ChannelPSTHs::updateConditionsWithLFP(std::vector<int> conditionsNeedUpdating, std::vector<float> alignedLFP, std::vector<bool> valid, Trial* trial)
+void ChannelPSTHs::updateConditionsWithLFP(const std::vector<int>& conditionsNeedUpdating, const float* alignedLFP, int numValidBins, Trial* trial)
 {
     numTrials++;
     if (conditionsNeedUpdating.size() == 0)
@@ -507,7 +501,8 @@ void ChannelPSTHs::updateConditionsWithLFP(std::vector<int> conditionsNeedUpdati
             if (conditionPSTHs[k].conditionID == conditionsNeedUpdating[j])
             {
                 // this condition needs to be updated.
-                conditionPSTHs[k].updatePSTH(alignedLFP,valid);
+                conditionPSTHs[k].updatePSTH(alignedLFP, numValidBins);
+                break;
             }
         }
     }
@@ -535,7 +530,7 @@ void ChannelPSTHs::updateConditionsWithLFP(std::vector<int> conditionsNeedUpdati
             }
         }
         // now update
-        trialPSTHs[modifiedTrialType].updatePSTH(alignedLFP,valid);
+        trialPSTHs[modifiedTrialType].updatePSTH(alignedLFP, numValidBins);
     }
 }
 
@@ -659,24 +654,28 @@ void UnitPSTHs::getRange(float& xmin, float& xmax, float& ymin, float& ymax)
 }
 
 
-void UnitPSTHs::updateConditionsWithSpikes(std::vector<int> conditionsNeedUpdating, Trial* trial)
+void UnitPSTHs::updateConditionsWithSpikes(const std::vector<int>& conditionsNeedUpdating, Trial* trial)
 {
     redrawNeeded = true;
     numTrials++;
-    if (conditionsNeedUpdating.size() == 0)
+    if (conditionsNeedUpdating.size() == 0 || conditionPSTHs.size() == 0)
         return ;
 
-    tictoc.Tic(14);
+    // all PSTHs of a unit share the same binning, so the trial's spikes are
+    // aligned and binned once and then added to every matching condition.
+    trialSpikeCounts.resize(conditionPSTHs[0].numBins);
+    float lastUpdateTS;
+    const int numBinsToUpdate = conditionPSTHs[0].binTrialSpikes(&spikeBuffer, trial, &trialSpikeCounts[0], lastUpdateTS);
 
     for (int k=0; k<conditionPSTHs.size(); k++)
     {
-        //std::cout << k << std::endl;
         for (int j=0; j<conditionsNeedUpdating.size(); j++)
         {
             if (conditionPSTHs[k].conditionID == conditionsNeedUpdating[j])
             {
                 // this condition needs to be updated.
-                conditionPSTHs[k].updatePSTH(&spikeBuffer, trial);
+                conditionPSTHs[k].updatePSTH(&trialSpikeCounts[0], numBinsToUpdate, lastUpdateTS);
+                break;
             }
         }
     }
@@ -684,7 +683,6 @@ void UnitPSTHs::updateConditionsWithSpikes(std::vector<int> conditionsNeedUpdati
 
     if (params.buildTrialsPSTH)
     {
-        tictoc.Tic(15);
         // update individual trial PSTH
         int modifiedTrialType;
         if (trial->type >= TTL_TRIAL_OFFSET)
@@ -705,10 +703,8 @@ void UnitPSTHs::updateConditionsWithSpikes(std::vector<int> conditionsNeedUpdati
             }
         }
         // now update
-        trialPSTHs[modifiedTrialType].updatePSTH(&spikeBuffer, trial);
-        tictoc.Toc(15);
+        trialPSTHs[modifiedTrialType].updatePSTH(&trialSpikeCounts[0], numBinsToUpdate, lastUpdateTS);
     }
-    tictoc.Toc(14);
 }
 
 /********************/
@@ -735,73 +731,36 @@ Trial::Trial(const Trial& t)
 /***************************/
 ElectrodePSTH::ElectrodePSTH()
 {
-    threadpool = nullptr;
 }
 
 ElectrodePSTH::ElectrodePSTH(int ID, String name) : electrodeID(ID), electrodeName(name)
 {
-    /*
-    // create a thread pool
-    int numCpus = SystemStats::getNumCpus();
-    // create a thead pool to analyze incoming trials
-    threadpool = new ThreadPool(numCpus);
-    */
 }
 
 ElectrodePSTH::~ElectrodePSTH()
 {
-    /*
-    delete threadpool;
-    threadpool = nullptr;
-    */
-}
-
-ElectrodePSTHlfpJob::ElectrodePSTHlfpJob(ElectrodePSTH* psth_, int ch_, std::vector<int>* conditionsNeedUpdate_, Trial* trial_, std::vector<float>* alignedLFP_, std::vector<bool>* valid_) : ThreadPoolJob("LFPjob"),
-    psth(psth_),ch(ch_),conditionsNeedUpdate(conditionsNeedUpdate_),trial(trial_),alignedLFP(alignedLFP_),valid(valid_)
-{
-}
-
-juce::ThreadPoolJob::JobStatus ElectrodePSTHlfpJob::runJob()
-{
-    psth->UpdateChannelConditionWithLFP(ch,conditionsNeedUpdate,trial,alignedLFP,valid);
-    return jobHasFinished;
 }
 
-void ElectrodePSTH::UpdateChannelConditionWithLFP(int ch, std::vector<int>* conditionsNeedUpdate, Trial* trial, std::vector<float>* alignedLFP,std::vector<bool>* valid)
+void ElectrodePSTH::updateChannelsConditionsWithLFP(const std::vector<int>& conditionsNeedUpdate, Trial* trial, SmartContinuousCircularBuffer* lfpBuffer)
 {
-    channelsPSTHs[ch].updateConditionsWithLFP(*conditionsNeedUpdate, *alignedLFP, *valid, trial);
-}
+    if (channelsPSTHs.size() == 0 || channelsPSTHs[0].conditionPSTHs.size() == 0)
+        return;
 
+    const std::vector<float>& binTime = channelsPSTHs[0].conditionPSTHs[0].binTime;
 
-void ElectrodePSTH::updateChannelsConditionsWithLFP(std::vector<int> conditionsNeedUpdate, Trial* trial, SmartContinuousCircularBuffer* lfpBuffer)
-{
     // compute trial aligned lfp for all channels
+    int numValidBins;
+    bool success = lfpBuffer->getAlignedData(channels,trial,binTime,
+                                             channelsPSTHs[0].params, alignedLFP,numValidBins);
 
-    std::vector<bool> valid;
-    std::vector<std::vector<float> > alignedLFP;
-
-    tictoc.Tic(6);
-    // resample all electrode channels
-
-    tictoc.Tic(18);
-    bool success = lfpBuffer->getAlignedData(channels,trial,&channelsPSTHs[0].conditionPSTHs[0].binTime,
-                                             channelsPSTHs[0].params, alignedLFP,valid);
+    if (!success)
+        return;
 
-    tictoc.Toc(18);
     // now we can average data
-    tictoc.Tic(7);
-    if (success)
+    for (int ch=0; ch<channelsPSTHs.size() && ch<channels.size(); ch++)
     {
-        for (int ch=0; ch<channelsPSTHs.size(); ch++)
-        {
-            channelsPSTHs[ch].updateConditionsWithLFP(conditionsNeedUpdate, alignedLFP[ch], valid, trial);
-        }
-        //			ElectrodePSTHlfpJob *job = new ElectrodePSTHlfpJob(this,ch,&conditionsNeedUpdate,trial, &(alignedLFP[ch]), &valid);
+        channelsPSTHs[ch].updateConditionsWithLFP(conditionsNeedUpdate, &alignedLFP[ch * binTime.size()], numValidBins, trial);
     }
-    tictoc.Toc(7);
-
-    tictoc.Toc(6);
-
 }
 
 /****************************************/
@@ -831,61 +790,77 @@ SmartContinuousCircularBuffer::SmartContinuousCircularBuffer(int NumCh, float Sa
     }
 }
 
-bool SmartContinuousCircularBuffer::getAlignedData(std::vector<int> channels, Trial* trial, std::vector<float>* timeBins,
-                                                   TrialCircularBufferParams params,
-                                                   std::vector<std::vector<float> >& output,
-                                                   std::vector<bool>& valid)
+bool SmartContinuousCircularBuffer::findTrialStart(int trialID, int& index) const
 {
-    if (!params.approximate)
+    // instead of searching the entire buffer, query when did the trial started....
+    for (int k=0; k<numTrials; k++)
     {
-        // use this for buffers with gaps
-        return getAlignedDataInterp(channels, trial, timeBins, params.preSec, params.postSec, output, valid);
+        if (smartPointerTrialID[k] == trialID)
+        {
+            index = smartPointerIndex[k];
+            return true;
+        }
     }
+    // couldn't find the trial !?!?!? buffer overrun?
+    return false;
+}
 
-    // fast code.
-    if (numSamplesInBuf <= 1)
-        return false;
-
-    int numTimeBins = timeBins->size();
-
-    output.resize(channels.size());
-    valid.resize(numTimeBins);
+void SmartContinuousCircularBuffer::interpolateChannels(const std::vector<int>& channels, const int* index, const float* frac,
+                                                        int numBins, int rowLength, float* output) const
+{
+    // channel by channel, so every channel's ring is walked in order.
+    // index[i] + 1 may point one past the ring, which is covered by its mirror.
     for (int ch=0; ch<channels.size(); ch++)
     {
-        output[ch].resize(numTimeBins);
+        const float* ring = getChannelWindow(channels[ch], 0);
+        float* out = output + ch * rowLength;
 
-        for (int j=0; j<numTimeBins; j++)
-            output[ch][j] = 0;
+        for (int i = 0; i < numBins; i++)
+        {
+            const float a = ring[index[i]];
+            out[i] = a + frac[i] * (ring[index[i] + 1] - a);
+        }
     }
-    for (int i=0; i<numTimeBins; i++)
+}
+
+bool SmartContinuousCircularBuffer::getAlignedData(const std::vector<int>& channels, Trial* trial, const std::vector<float>& timeBins,
+                                                   const TrialCircularBufferParams& params,
+                                                   std::vector<float>& output,
+                                                   int& numValidBins)
+{
+    if (!params.approximate)
     {
-        valid[i] = false;
+        // use this for buffers with gaps
+        return getAlignedDataInterp(channels, trial, timeBins, params.preSec, params.postSec, output, numValidBins);
     }
 
+    // pairs with the release in ContinuousCircularBuffer::finishWrite
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    numValidBins = 0;
+
+    // fast code.
+    if (numSamplesInBuf <= 1)
+        return false;
+
+    const int numTimeBins = timeBins.size();
+    const int numChannels = channels.size();
+
+    if (numTimeBins < 2)
+        return false;
 
+    output.resize(numChannels * numTimeBins);
+    FloatVectorOperations::clear(&output[0], output.size());
 
     // 1. instead of searching the entire buffer, query when did the trial started....
-    int k = 0;
-    bool found = false;
-    for (; k<numTrials; k++)
-    {
-        if (smartPointerTrialID[k] == trial->trialID)
-        {
-            found = true;
-            break;
-        }
-    }
-    if (!found)
+    int p;
+    if (!findTrialStart(trial->trialID, p))
     {
-        //jassertfalse;
-        // couldn't find the trial !?!?!? buffer overrun?
         return false;
     }
 
     // now we have a handle where to search the data...
 
-    int p=smartPointerIndex[k];
-
     // go backward and find the find time stamp we will need.
     int search_back_ptr = p;
     if (!trial->hardwareAlignment)
@@ -893,9 +868,7 @@ bool SmartContinuousCircularBuffer::getAlignedData(std::vector<int> channels, Tr
         // software alignment is slightly harder. We actually need to search in the array (either forward / backward).
         // usually, this won't be more than a couple of samples....
 
-        int next_index = search_back_ptr+1;
-        if (next_index >= bufLen)
-            next_index-=bufLen;
+        int next_index = (search_back_ptr+1) & mask;
 
         if (softwareTS[search_back_ptr] < trial->alignTS && softwareTS[next_index] > trial->alignTS)
         {
@@ -911,9 +884,7 @@ bool SmartContinuousCircularBuffer::getAlignedData(std::vector<int> channels, Tr
                     // we found the first sample prior to required trial alignment
                     break;
                 }
-                search_back_ptr++;
-                if (search_back_ptr >= bufLen)
-                    search_back_ptr=0;
+                search_back_ptr = (search_back_ptr+1) & mask;
             }
         }
         else
@@ -926,9 +897,7 @@ bool SmartContinuousCircularBuffer::getAlignedData(std::vector<int> channels, Tr
                     // we found the first sample prior to required trial alignment
                     break;
                 }
-                search_back_ptr--;
-                if (search_back_ptr < 0)
-                    search_back_ptr=bufLen-1;
+                search_back_ptr = (search_back_ptr-1) & mask;
             }
         }
     }
@@ -943,16 +912,10 @@ bool SmartContinuousCircularBuffer::getAlignedData(std::vector<int> channels, Tr
             // buffer overrun ?!?!?
             return false;
         }
-        search_back_ptr += move_indx;
-        if (search_back_ptr < 0)
-            search_back_ptr += bufLen;
-        if (search_back_ptr >= bufLen)
-            search_back_ptr -= bufLen;
-        jassert(search_back_ptr >= 0 && search_back_ptr < bufLen);
+        search_back_ptr = (search_back_ptr + move_indx) & mask;
     }
 
     // consider search_back_ptr the buffer index pointing at time t=0
-    //float t0 = hardwareTS[search_back_ptr];
     int t0_indx = search_back_ptr;
 
     float trial_length_sec = float(trial->endTS-trial->alignTS)/numTicksPerSecond;
@@ -960,151 +923,82 @@ bool SmartContinuousCircularBuffer::getAlignedData(std::vector<int> channels, Tr
     // and that hardware timestamp difference is always fixed....
 
     // now assign values....
-    float timeBindx = (*timeBins)[1]-(*timeBins)[0];
+    float timeBindx = timeBins[1]-timeBins[0];
     if (fabs(timeBindx-buffer_dx) < 1e-5)
     {
-        // easiest & fastest. No interpolation needed!
+        // easiest & fastest. No interpolation needed, every channel's window
+        // is a single contiguous run in the ring.
         float dx = params.binResolutionMS / 1000.0f;
         int numPosBins = ceil((params.postSec + trial_length_sec) / dx);
         int numNegBins = ceil(params.preSec / dx);
-        int numBinsToUpdate = 1 + numPosBins + numNegBins; // include bin "0"
+        numValidBins = jmin(numTimeBins, bufLen, 1 + numPosBins + numNegBins); // include bin "0"
         int start_index = t0_indx-numNegBins;
-        if (start_index < 0)
-            start_index += bufLen;
 
-        for (int index=0; index<numBinsToUpdate; index++)
+        for (int ch=0; ch<numChannels; ch++)
         {
-            valid[index] = true;
-            int actual_index = start_index+index;
-            if (actual_index>=bufLen)
-                actual_index-=bufLen;
-
-            for (int ch=0; ch<channels.size(); ch++)
-            {
-                float value = Buf[channels[ch]][actual_index];
-                output[ch][index] =  value;
-            }
+            FloatVectorOperations::copy(&output[ch * numTimeBins], getChannelWindow(channels[ch], start_index), numValidBins);
         }
-
     }
     else
     {
         // the desired time bins do not have a time difference that match the buffer time difference.
-        // need to use bilinear interpolation.
+        // need to use linear interpolation. The sample positions are the same for all channels.
+        HeapBlock<int> index(numTimeBins);
+        HeapBlock<float> frac(numTimeBins);
+
         for (int i = 0; i < numTimeBins; i++)
         {
-            float tSamlple = (*timeBins)[i];
+            float tSamlple = timeBins[i];
             if (tSamlple > trial_length_sec + params.postSec)
             {
                 // do not update  after trial ended
                 break;
             }
-            valid[i] = true;
 
             float wanted_index = t0_indx + tSamlple / buffer_dx;
             int index1 = floor(wanted_index);
-            float frac = wanted_index-index1;
-
-            if (index1 < 0)
-                index1 += bufLen;
-            if (index1 >= bufLen)
-                index1 -= bufLen;
-
-            int index2 = index1+1;
-            if (index2 < 0)
-                index2 += bufLen;
-            if (index2 >= bufLen)
-                index2 -= bufLen;
-
-            for (int ch=0; ch<channels.size(); ch++)
-            {
-                output[ch][i] =  Buf[channels[ch]][index1] * (1-frac) +  Buf[channels[ch]][index2] * (frac);
-            }
-
+            frac[i] = wanted_index-index1;
+            index[i] = index1 & mask;
+            numValidBins++;
         }
+
+        interpolateChannels(channels, index, frac, numValidBins, numTimeBins, &output[0]);
     }
     return true;
 }
 
 
-bool SmartContinuousCircularBuffer::getAlignedDataInterp(std::vector<int> channels, Trial* trial, std::vector<float>* timeBins,
+bool SmartContinuousCircularBuffer::getAlignedDataInterp(const std::vector<int>& channels, Trial* trial, const std::vector<float>& timeBins,
                                                          float preSec, float postSec,
-                                                         std::vector<std::vector<float> >& output,
-                                                         std::vector<bool>& valid)
+                                                         std::vector<float>& output,
+                                                         int& numValidBins)
 {
     // to update a condition's continuous data psth, we will first find
     // data samples in the vicinity of the trial, and then interpolate at the
     // needed time bins.
-    if (numSamplesInBuf <= 1)
-        return false;
-
-
-
-    // Debugging code
-    /*
-    int64 min_hard=MAXINT64, max_hard=0, min_soft=MAXINT64, max_soft=0;
-    for (int k=0;k<softwareTS.size();k++)
-    {
-    	if (softwareTS[k] <= min_soft)
-    		min_soft = softwareTS[k];
-
-    	if (hardwareTS[k] <= min_hard)
-    		min_hard = hardwareTS[k];
+    std::atomic_thread_fence(std::memory_order_acquire);
 
-    if (softwareTS[k] >= max_soft)
-    		max_soft = softwareTS[k];
+    numValidBins = 0;
 
-    	if (hardwareTS[k] >= max_hard)
-    		max_hard = hardwareTS[k];
-
-    }
-    int64 time_span_min = min_soft-trial->alignTS;
-    int64 time_span_max = max_soft-trial->alignTS;
-
-    int64 time_span_min_h = min_hard-trial->alignTS_hardware;
-    int64 time_span_max_h = max_hard-trial->alignTS_hardware;
-    */
+    if (numSamplesInBuf <= 1)
+        return false;
 
-    int numTimeBins = timeBins->size();
+    const int numTimeBins = timeBins.size();
 
-    output.resize(channels.size());
-    valid.resize(numTimeBins);
-    for (int ch=0; ch<channels.size(); ch++)
-    {
-        output[ch].resize(numTimeBins);
+    if (numTimeBins == 0)
+        return false;
 
-        for (int j=0; j<numTimeBins; j++)
-            output[ch][j] = 0;
-    }
-    for (int i=0; i<numTimeBins; i++)
-    {
-        valid[i] = false;
-    }
+    output.resize(channels.size() * numTimeBins);
+    FloatVectorOperations::clear(&output[0], output.size());
 
     // 1. instead of searching the entire buffer, query when did the trial started....
-    int k = 0;
-    bool found = false;
-    for (; k<numTrials; k++)
+    int p;
+    if (!findTrialStart(trial->trialID, p))
     {
-        if (smartPointerTrialID[k] == trial->trialID)
-        {
-            found = true;
-            break;
-        }
-    }
-    if (!found)
-    {
-        //jassertfalse;
-        // couldn't find the trial !?!?!? buffer overrun?
         return false;
     }
 
-    // now we have a handle where to search the data...
-
-    int p=smartPointerIndex[k];
-
     // go backward and find the find time stamp we will need.
-    //int nSamples = 1;
     int search_back_ptr = p;
     for (int q=0; q<numSamplesInBuf; q++)
     {
@@ -1114,30 +1008,9 @@ bool SmartContinuousCircularBuffer::getAlignedDataInterp(std::vector<int> channe
             // we found the first sample prior to required trial alignment
             break;
         }
-        search_back_ptr--;
-        //nSamples++;
-        if (search_back_ptr < 0)
-            search_back_ptr=bufLen-1;
+        search_back_ptr = (search_back_ptr-1) & mask;
     }
 
-    // go forward and find the last time stamp we will need.
-    /*
-    int nSamples = 0;
-    int search_forward_ptr = p;
-    for (int q=0;q<numSamplesInBuf;q++)
-    {
-    	if (softwareTS[search_forward_ptr] > trial->endTS + int64(postSec*numTicksPerSecond))
-    	{
-    		// we found the first sample prior to required trial alignment
-    		break;
-    	}
-    	nSamples++;
-    	search_forward_ptr++;
-    	if (search_forward_ptr == bufLen)
-    		search_forward_ptr=0;
-    }
-    */
-
     // we would like to return the lfp, sampled at specific time bins
     // (typically, 1 ms resolution, which is an overkill).
     //
@@ -1146,10 +1019,7 @@ bool SmartContinuousCircularBuffer::getAlignedDataInterp(std::vector<int> channe
     // and that softwareTS[search_back_ptr+1]-trialAlign > preSec.
 
     int index=search_back_ptr;
-
-    int index_next=index+1;
-    if (index_next >= bufLen)
-        index_next = 0;
+    int index_next=(index+1) & mask;
 
     float tA,tB;
     float trial_length_sec = float(trial->endTS-trial->alignTS)/numTicksPerSecond;
@@ -1165,10 +1035,14 @@ bool SmartContinuousCircularBuffer::getAlignedDataInterp(std::vector<int> channe
         tB = float(softwareTS[index_next]-trial->alignTS)/numTicksPerSecond;
     }
 
+    // first work out the ring positions and weights of every bin (shared by all
+    // channels), then interpolate the channels in one pass each.
+    HeapBlock<int> binIndex(numTimeBins);
+    HeapBlock<float> binFrac(numTimeBins);
 
     for (int i = 0; i < numTimeBins; i++)
     {
-        float tSamlple = (*timeBins)[i];
+        float tSamlple = timeBins[i];
         if (tSamlple > trial_length_sec + postSec)
         {
             // do not update  after trial ended
@@ -1176,31 +1050,25 @@ bool SmartContinuousCircularBuffer::getAlignedDataInterp(std::vector<int> channe
         }
         float dA = tSamlple-tA;
         float dB = tB-tSamlple;
-        float fracA = dA/(dA+dB);
-        valid[i] = true;
-        for (int ch=0; ch<channels.size(); ch++)
-        {
-            output[ch][i] =  Buf[channels[ch]][index] * (1-fracA) +  Buf[channels[ch]][index_next] * (fracA);
-        }
+        binIndex[i] = index;
+        binFrac[i] = dA/(dA+dB);
+        numValidBins++;
+
         // now advance pointers if needed
         if (i < numTimeBins-1)
         {
-            float tSamlple_next = (*timeBins)[i+1];
+            float tSamlple_next = timeBins[i+1];
             int cnt = 0;
             while (cnt < bufLen)
             {
-                if (tA <= tSamlple_next & tB > tSamlple_next)
+                if (tA <= tSamlple_next && tB > tSamlple_next)
                 {
                     break;
                 }
                 else
                 {
-                    index++;
-                    if (index >= bufLen)
-                        index = 0;
-                    index_next=index+1;
-                    if (index_next >= bufLen)
-                        index_next = 0;
+                    index = (index+1) & mask;
+                    index_next = (index+1) & mask;
 
                     if (trial->hardwareAlignment)
                     {
@@ -1220,10 +1088,14 @@ bool SmartContinuousCircularBuffer::getAlignedDataInterp(std::vector<int> channe
             if (cnt == bufLen)
             {
                 // missing data. This can happen when we just add a channel and a trial is in progress?!?!?
+                numValidBins = 0;
                 return false;
             }
         }
     }
+
+    interpolateChannels(channels, binIndex, binFrac, numValidBins, numTimeBins, &output[0]);
+
     return true;
 }
 
@@ -1421,14 +1293,14 @@ TrialCircularBuffer::TrialCircularBuffer()
     lastSimulatedTrialTS = 0;
     lastTrialID = 0;
     uniqueIntervalID = 0;
-    useThreads = true;
+    useThreads = false;
 }
 
 TrialCircularBuffer::TrialCircularBuffer(TrialCircularBufferParams params_) : params(params_)
 {
     Time t;
     numTicksPerSecond = t.getHighResolutionTicksPerSecond();
-    useThreads = false;
+    useThreads = SystemStats::getNumCpus() > 1;
     conditionCounter = 0;
     firstTime = true;
     trialCounter = 0;
@@ -1450,9 +1322,8 @@ TrialCircularBuffer::TrialCircularBuffer(TrialCircularBufferParams params_) : pa
         lastTTLts[k] = 0;
     }
     int numCpus = SystemStats::getNumCpus();
-    // create a thead pool to analyze incoming trials
-    if (useThreads)
-        threadpool = new ThreadPool(numCpus);
+    // create a thead pool to analyze incoming trials (always, since thread usage can be toggled)
+    threadpool = new ThreadPool(numCpus);
 
     clearDesign();
 }
@@ -2098,7 +1969,7 @@ bool TrialCircularBuffer::parseMessage(StringTS msg)
     return   redrawNeeded ;
 }
 
-void TrialCircularBuffer::addSpikeToSpikeBuffer(SpikeObject newSpike)
+void TrialCircularBuffer::addSpikeToSpikeBuffer(const SpikeObject& newSpike)
 {
     //lockPSTH();
     const ScopedLock myScopedLock(psthMutex);
@@ -2124,7 +1995,7 @@ void TrialCircularBuffer::addSpikeToSpikeBuffer(SpikeObject newSpike)
 }
 
 
-bool TrialCircularBuffer::contains(std::vector<int> v, int x)
+bool TrialCircularBuffer::contains(const std::vector<int>& v, int x)
 {
     for (int k = 0; k < v.size(); k++)
         if (v[k] == x)
@@ -2132,14 +2003,16 @@ bool TrialCircularBuffer::contains(std::vector<int> v, int x)
     return false;
 }
 
-void TrialCircularBuffer::updateLFPwithTrial(int electrodeIndex, std::vector<int>* conditionsNeedUpdate, Trial* trial)
+void TrialCircularBuffer::updateElectrodeWithTrial(int electrodeIndex, const std::vector<int>& conditionsNeedUpdate, Trial* trial)
 {
-    electrodesPSTH[electrodeIndex].updateChannelsConditionsWithLFP(*conditionsNeedUpdate,trial, lfpBuffer);
-}
+    ElectrodePSTH& electrode = electrodesPSTH[electrodeIndex];
 
-void TrialCircularBuffer::updateSpikeswithTrial(int electrodeIndex, int unitIndex, std::vector<int>* conditionsNeedUpdate, Trial* trial)
-{
-    electrodesPSTH[electrodeIndex].unitsPSTHs[unitIndex].updateConditionsWithSpikes(*conditionsNeedUpdate,trial);
+    electrode.updateChannelsConditionsWithLFP(conditionsNeedUpdate, trial, lfpBuffer);
+
+    for (int u = 0; u < electrode.unitsPSTHs.size(); u++)
+    {
+        electrode.unitsPSTHs[u].updateConditionsWithSpikes(conditionsNeedUpdate, trial);
+    }
 }
 
 void TrialCircularBuffer::updatePSTHwithTrial(Trial* trial)
@@ -2176,62 +2049,35 @@ void TrialCircularBuffer::updatePSTHwithTrial(Trial* trial)
 
 
 
-    if (!useThreads)
-    {
-        //std::cout << "Updating without threads..." << std::endl;
-        // these two parts can be fully distributed along several threads because they are completely independent.
-        //printf("Calling updatePSTHwithTrial::update without threads\n");
+    const int numElectrodes = electrodesPSTH.size();
 
+    if (!useThreads || threadpool == nullptr || numElectrodes < 2)
+    {
         tictoc.Tic(23);
-        for (int i = 0; i < electrodesPSTH.size(); i++)
-        {
-            electrodesPSTH[i].updateChannelsConditionsWithLFP(conditionsNeedUpdating,trial, lfpBuffer); // timer 6 -> 7,18
-        }
-        // update both spikes and LFP PSTHs
-        for (int i = 0; i < electrodesPSTH.size(); i++)
+        for (int i = 0; i < numElectrodes; i++)
         {
-            for (int u = 0; u < electrodesPSTH[i].unitsPSTHs.size(); u++)
-            {
-                electrodesPSTH[i].unitsPSTHs[u].updateConditionsWithSpikes(conditionsNeedUpdating,trial); // timer 14,15
-            }
+            updateElectrodeWithTrial(i, conditionsNeedUpdating, trial);
         }
         tictoc.Toc(23);
-        //printf("Finished updatePSTHwithTrial::update without threads\n");
-
     }
     else
     {
-
-        //std::cout << "Updating with threads..." << std::endl;
+        // electrodes own all of their PSTHs and only read the shared lfp and
+        // spike buffers, so each one can be updated on its own thread.
         tictoc.Tic(24);
-        int cnt = 0;
-        int numElectrodes = electrodesPSTH.size();
-        //printf("Calling updatePSTHwithTrial::update with threads\n");
+        OwnedArray<TrialCircularBufferThread> jobs;
 
         for (int i = 0; i < numElectrodes; i++)
         {
-            TrialCircularBufferThread* job = new TrialCircularBufferThread(this,&conditionsNeedUpdating,trial,cnt++,0,i,-1);
-            threadpool->addJob(job, true);
-            for (int u=0; u<electrodesPSTH[i].unitsPSTHs.size(); u++)
-            {
-                TrialCircularBufferThread* job = new TrialCircularBufferThread(this,&conditionsNeedUpdating,trial,cnt++,1,i,u);
-                threadpool->addJob(job, true);
-            }
+            TrialCircularBufferThread* job = jobs.add(new TrialCircularBufferThread(this, &conditionsNeedUpdating, trial, i));
+            threadpool->addJob(job, false);
         }
 
-        //printf("Calling updatePSTHwithTrial::Waiting for jobs\n");
-
-        while (threadpool->getNumJobs() > 0)
+        for (int i = 0; i < jobs.size(); i++)
         {
-#if JUCE_WINDOWS
-            Sleep(2); // sleep 2 ms
-#else
-            usleep(2000);
-#endif
+            threadpool->waitForJobToFinish(jobs[i], -1);
         }
         tictoc.Toc(24);
-        //printf("Finished updatePSTHwithTrial::Waiting for jobs\n");
-
     }
 
     //unlockPSTH();
@@ -3333,22 +3179,15 @@ void TrialCircularBuffer::process(AudioSampleBuffer& buffer, int nSamples, int64
 }
 
 
-TrialCircularBufferThread::TrialCircularBufferThread(TrialCircularBuffer* tcb_,  std::vector<int>* conditions, Trial* trial_, int jobID_, int jobType_, int electrodeID_, int subID_) : ThreadPoolJob("Job "+String(jobID)),
-    tcb(tcb_), trial(trial_), conditionsNeedUpdate(conditions), jobID(jobID_), jobType(jobType_), electrodeID(electrodeID_), subID(subID_)
+TrialCircularBufferThread::TrialCircularBufferThread(TrialCircularBuffer* tcb_, const std::vector<int>* conditions, Trial* trial_, int electrodeIndex_) : ThreadPoolJob("Electrode "+String(electrodeIndex_)),
+    tcb(tcb_), trial(trial_), conditionsNeedUpdate(conditions), electrodeIndex(electrodeIndex_)
 {
 
 }
 
 juce::ThreadPoolJob::JobStatus TrialCircularBufferThread::runJob()
 {
-    if (jobType == 0)
-    {
-        tcb->updateLFPwithTrial(electrodeID,conditionsNeedUpdate,trial);
-    }
-    else if (jobType == 1)
-    {
-        tcb->updateSpikeswithTrial(electrodeID,subID,conditionsNeedUpdate,trial);
-    }
+    tcb->updateElectrodeWithTrial(electrodeIndex,*conditionsNeedUpdate,trial);
     return jobHasFinished;
 }
 
@@ -134,15 +134,19 @@ class SmartContinuousCircularBuffer : public ContinuousCircularBuffer
 {
 public:
     SmartContinuousCircularBuffer(int NumCh, float SamplingRate, int SubSampling, float NumSecInBuffer);
-    bool getAlignedData(std::vector<int> channels, Trial* trial, std::vector<float>* timeBins,
-                        TrialCircularBufferParams params,
-                        std::vector<std::vector<float> >& output,
-                        std::vector<bool>& valid);
 
-    bool getAlignedDataInterp(std::vector<int> channels, Trial* trial, std::vector<float>* timeBins,
+    /** Samples the given channels at timeBins (relative to the trial alignment).
+        output is resized to channels.size() rows of timeBins.size() values, row-major;
+        the first numValidBins bins of every row hold data, the rest are zero. */
+    bool getAlignedData(const std::vector<int>& channels, Trial* trial, const std::vector<float>& timeBins,
+                        const TrialCircularBufferParams& params,
+                        std::vector<float>& output,
+                        int& numValidBins);
+
+    bool getAlignedDataInterp(const std::vector<int>& channels, Trial* trial, const std::vector<float>& timeBins,
                               float preSec, float postSec,
-                              std::vector<std::vector<float> >& output,
-                              std::vector<bool>& valid);
+                              std::vector<float>& output,
+                              int& numValidBins);
 
     void addTrialStartToSmartBuffer(int trialID);
     int trialptr;
@@ -150,6 +154,13 @@ public:
     std::vector<int> smartPointerIndex;
     std::vector<int> smartPointerTrialID;
 
+private:
+    bool findTrialStart(int trialID, int& index) const;
+
+    /** output[ch][i] = linear interpolation between ring positions index[i] and index[i] + 1 */
+    void interpolateChannels(const std::vector<int>& channels, const int* index, const float* frac,
+                             int numBins, int rowLength, float* output) const;
+
 };
 
 
@@ -161,8 +172,13 @@ public:
     PSTH(const PSTH& c);
     double getDx();
     void clear();
-    void updatePSTH(SmartSpikeCircularBuffer* spikeBuffer, Trial* trial);
-    void updatePSTH(std::vector<float> alignedLFP,std::vector<bool> valid);
+
+    /** Bins the spikes of a trial into spikeCounts (numBins entries) and returns the
+        number of leading bins covered by the trial. The result does not depend on the
+        condition, so a unit computes it once and feeds it to all of its PSTHs. */
+    int binTrialSpikes(SmartSpikeCircularBuffer* spikeBuffer, Trial* trial, float* spikeCounts, float& lastUpdateTS) const;
+    void updatePSTH(const float* spikeCounts, int numBinsToUpdate, float lastUpdateTS);
+    void updatePSTH(const float* alignedLFP, int numValidBins);
 
     std::vector<float> getAverageTrialResponse();
     std::vector<float> getLastTrial();
@@ -181,12 +197,17 @@ public:
     TrialCircularBufferParams params;
 
 private:
+    /** Adds one trial to the running mean over the first numBinsToUpdate bins. */
+    void accumulate(const float* trialResponse, int numBinsToUpdate, float scale);
+    void storeTrial(const float* trialResponse);
+
     double dx,mod_pre_sec, mod_post_sec;
-    std::list<std::vector<float>> prevTrials;
     std::vector<float> avgResponse; // either firing rate or lfp
 
-
-    std::vector<int64> getAlignSpikes(SmartSpikeCircularBuffer* spikeBuffer, Trial* t);
+    // the last maxTrialsInMemory trials, one row of numBins per trial, used as a ring
+    std::vector<float> trialHistory;
+    int numStoredTrials;
+    int lastTrialRow;
 
 };
 
@@ -194,7 +215,7 @@ class UnitPSTHs
 {
 public:
     UnitPSTHs(int ID,TrialCircularBufferParams params,uint8 R, uint8 G, uint8 B);
-    void updateConditionsWithSpikes(std::vector<int> conditionsNeedUpdating, Trial* trial);
+    void updateConditionsWithSpikes(const std::vector<int>& conditionsNeedUpdating, Trial* trial);
     void addSpikeToBuffer(int64 spikeTimestampSoftware,int64 spikeTimestampHardware);
     void addTrialStartToSmartBuffer(Trial* t);
     void clearStatistics();
@@ -216,13 +237,16 @@ public:
     int numTrials;
     TrialCircularBufferParams params;
 
+private:
+    std::vector<float> trialSpikeCounts; // scratch histogram, shared by all conditions
+
 };
 
 class ChannelPSTHs
 {
 public:
     ChannelPSTHs(int channelID, TrialCircularBufferParams params);
-    void updateConditionsWithLFP(std::vector<int> conditionsNeedUpdating, std::vector<float> lfpData, std::vector<bool> valid, Trial* trial);
+    void updateConditionsWithLFP(const std::vector<int>& conditionsNeedUpdating, const float* alignedLFP, int numValidBins, Trial* trial);
     void clearStatistics();
     void getRange(float& xmin, float& xmax, float& ymin, float& ymax);
     bool isNewDataAvailable();
@@ -255,8 +279,7 @@ public:
     ElectrodePSTH();
     ElectrodePSTH(int ID, String name);
     ~ElectrodePSTH();
-    void updateChannelsConditionsWithLFP(std::vector<int> conditionsNeedUpdate, Trial* trial, SmartContinuousCircularBuffer* lfpBuffer);
-    void UpdateChannelConditionWithLFP(int ch, std::vector<int>* conditionsNeedUpdate, Trial* trial, std::vector<float>* alignedLFP,std::vector<bool>* valid);
+    void updateChannelsConditionsWithLFP(const std::vector<int>& conditionsNeedUpdate, Trial* trial, SmartContinuousCircularBuffer* lfpBuffer);
     int electrodeID;
     String electrodeName;
     std::vector<int> channels;
@@ -264,21 +287,10 @@ public:
     std::vector<ChannelPSTHs> channelsPSTHs;
     std::vector<TTL_PSTHs> ttlPSTHs;
 
-    ThreadPool* threadpool; // used for multi-channel electrodes only
-};
-
-class ElectrodePSTHlfpJob : public ThreadPoolJob
-{
-public:
-    ElectrodePSTHlfpJob(ElectrodePSTH* psth_, int ch_, std::vector<int>* conditionsNeedUpdate_, Trial* trial_, std::vector<float>* alignedLFP_, std::vector<bool>* valid_);
-    JobStatus runJob();
-
-    ElectrodePSTH* psth;
-    int ch;
-    std::vector<int>* conditionsNeedUpdate;
-    Trial* trial;
-    std::vector<float>* alignedLFP;
-    std::vector<bool>* valid;
+private:
+    // scratch space for the trial aligned lfp of all channels (one row per channel),
+    // reused between trials
+    std::vector<float> alignedLFP;
 };
 
 
@@ -296,12 +308,12 @@ public:
     TrialCircularBuffer(TrialCircularBufferParams param_);
     ~TrialCircularBuffer();
     void updatePSTHwithTrial(Trial* trial);
-    bool contains(std::vector<int> v, int x);
+    bool contains(const std::vector<int>& v, int x);
     void toggleConditionVisibility(int cond);
     void modifyConditionVisibility(int cond, bool newstate);
     void modifyConditionVisibilityusingConditionID(int condID, bool newstate);
     bool parseMessage(StringTS s);
-    void addSpikeToSpikeBuffer(SpikeObject newSpike);
+    void addSpikeToSpikeBuffer(const SpikeObject& newSpike);
     void process(AudioSampleBuffer& buffer,int nSamples,int64 hardware_timestamp,int64 software_timestamp);
     void simulateHardwareTrial(int64 ttl_timestamp_software,int64 ttl_timestamp_hardware, int trialType, float lengthSec);
     //void simulateTrial(int64 ttl_timestamp_software, int trialType, float lengthSec);
@@ -369,9 +381,8 @@ public:
     int getLastTrialID();
     int getNumberAliveTrials();
 
-    // thread job functions
-    void updateLFPwithTrial(int electrodeIndex, std::vector<int>* conditionsNeedUpdate, Trial* trial);
-    void updateSpikeswithTrial(int electrodeIndex, int unitIndex, std::vector<int>* conditionsNeedUpdate, Trial* trial);
+    // thread job function: updates the lfp and unit PSTHs of one electrode
+    void updateElectrodeWithTrial(int electrodeIndex, const std::vector<int>& conditionsNeedUpdate, Trial* trial);
 
     CriticalSection psthMutex;//conditionMutex
 private:
@@ -409,15 +420,12 @@ private:
 class TrialCircularBufferThread : public ThreadPoolJob
 {
 public:
-    TrialCircularBufferThread(TrialCircularBuffer* tcb_, std::vector<int>* conditions, Trial* trial_, int jobID_, int jobType_, int electrodeID_, int subID_);
+    TrialCircularBufferThread(TrialCircularBuffer* tcb_, const std::vector<int>* conditions, Trial* trial_, int electrodeIndex_);
     JobStatus runJob();
     TrialCircularBuffer* tcb;
     Trial* trial;
-    std::vector<int>* conditionsNeedUpdate;
-    int jobID;
-    int jobType;
-    int electrodeID;
-    int subID;
+    const std::vector<int>* conditionsNeedUpdate;
+    int electrodeIndex;
 };
 
 
@@ -0,0 +1,131 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ParameterStore.h"
+
+
+ParameterStore::ParameterStore()
+{
+    blocks.publish(createBlock(0, 0));
+}
+
+
+ParameterStore::~ParameterStore()
+{
+
+}
+
+
+ParameterStore::Block* ParameterStore::createBlock(int numParameters, int numChannels)
+{
+    Block* block = new Block();
+    block->numParameters = numParameters;
+    block->numChannels = numChannels;
+    block->values.calloc(jmax(1, numParameters * numChannels));
+
+    return block;
+}
+
+
+void ParameterStore::update(Array<Parameter>& parameters, int numChannels)
+{
+    const ScopedLock sl(writeLock);
+
+    Block* block = createBlock(parameters.size(), numChannels);
+
+    for (int p = 0; p < parameters.size(); p++)
+    {
+        Parameter& parameter = parameters.getReference(p);
+        const float defaultValue = float(parameter.getDefaultValue());
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            const var value = parameter.getValue(ch);
+            block->values[p * numChannels + ch] = value.isVoid() ? defaultValue : float(value);
+        }
+    }
+
+    // no ramps across a change of layout
+    previous.malloc(jmax(1, parameters.size() * numChannels));
+    memcpy(previous, block->values, sizeof(float) * parameters.size() * numChannels);
+
+    blocks.publish(block);
+}
+
+
+void ParameterStore::setValue(int parameter, int channel, float value)
+{
+    const ScopedLock sl(writeLock);
+
+    const Block* last = blocks.getLatest();
+
+    if (parameter < 0 || parameter >= last->numParameters || channel < 0 || channel >= last->numChannels)
+        return;
+
+    Block* block = createBlock(last->numParameters, last->numChannels);
+    memcpy(block->values, last->values, sizeof(float) * last->numParameters * last->numChannels);
+    block->values[parameter * block->numChannels + channel] = value;
+
+    blocks.publish(block);
+}
+
+
+void ParameterStore::setValueForAllChannels(int parameter, float value)
+{
+    const ScopedLock sl(writeLock);
+
+    const Block* last = blocks.getLatest();
+
+    if (parameter < 0 || parameter >= last->numParameters)
+        return;
+
+    Block* block = createBlock(last->numParameters, last->numChannels);
+    memcpy(block->values, last->values, sizeof(float) * last->numParameters * last->numChannels);
+
+    for (int ch = 0; ch < block->numChannels; ch++)
+        block->values[parameter * block->numChannels + ch] = value;
+
+    blocks.publish(block);
+}
+
+
+const ParameterStore::Block* ParameterStore::acquire()
+{
+    return blocks.acquire();
+}
+
+
+void ParameterStore::getRamp(const Block* block, int parameter, int channel, float& start, float& end)
+{
+    end = block->get(parameter, channel);
+
+    if (parameter < 0 || parameter >= block->numParameters || channel < 0 || channel >= block->numChannels)
+    {
+        start = end;
+        return;
+    }
+
+    float& last = previous[parameter * block->numChannels + channel];
+    start = last;
+    last = end;
+}
@@ -0,0 +1,118 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PARAMETERSTORE_H_INCLUDED
+#define PARAMETERSTORE_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "Parameter.h"
+#include "PublishedObject.h"
+
+/**
+
+  Publishes the values of a processor's Parameters to its process() method
+  without locks or allocations on the audio thread.
+
+  The values live in an immutable Block of floats, one per parameter and channel.
+  Every change copies the current Block, modifies the copy and publishes it through
+  a PublishedObject. The audio thread calls acquire() once per buffer and reads plain
+  floats from the Block it gets.
+
+  There must be a single reader, the processor's process() method. update() changes
+  the layout and may only be called while acquisition is stopped; setValue() and
+  setValueForAllChannels() may be called from any other thread at any time, and
+  are serialised by a lock that the reader never takes.
+
+  @see Parameter, GenericProcessor
+
+*/
+
+class ParameterStore
+{
+public:
+    ParameterStore();
+    ~ParameterStore();
+
+    struct Block
+    {
+        int numParameters;
+        int numChannels;
+
+        /** values[parameter * numChannels + channel] */
+        HeapBlock<float> values;
+
+        /** Returns 0 for out-of-range indices. */
+        float get(int parameter, int channel) const
+        {
+            if (parameter < 0 || parameter >= numParameters || channel < 0 || channel >= numChannels)
+                return 0.0f;
+
+            return values[parameter * numChannels + channel];
+        }
+
+        /** Returns the values of one parameter for every channel. */
+        const float* getChannelValues(int parameter) const
+        {
+            return values + parameter * numChannels;
+        }
+    };
+
+    /** Rebuilds the store from the processor's Parameters, for numChannels channels.
+        Values that were never set take the Parameter's default.
+    */
+    void update(Array<Parameter>& parameters, int numChannels);
+
+    /** Changes the value of one parameter for one channel and publishes it. */
+    void setValue(int parameter, int channel, float value);
+
+    /** Changes the value of one parameter for every channel and publishes it. */
+    void setValueForAllChannels(int parameter, float value);
+
+    /** Called by the audio thread at the start of each buffer. The Block stays
+        valid until the next call.
+    */
+    const Block* acquire();
+
+    /** Audio thread: returns the value this channel had at the previous getRamp() in start,
+        and its value in block in end, so that a change can be applied as a linear ramp
+        over the buffer instead of a step.
+    */
+    void getRamp(const Block* block, int parameter, int channel, float& start, float& end);
+
+private:
+
+    Block* createBlock(int numParameters, int numChannels);
+
+    PublishedObject<Block> blocks;
+
+    CriticalSection writeLock;
+
+    /** Values seen by the last getRamp() calls; owned by the audio thread */
+    HeapBlock<float> previous;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterStore);
+
+};
+
+
+#endif  // PARAMETERSTORE_H_INCLUDED
@@ -0,0 +1,111 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PUBLISHEDOBJECT_H_INCLUDED
+#define PUBLISHEDOBJECT_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Hands objects built by a writer thread to a single reader (usually the audio
+  thread) without locks or allocations on the reader's side.
+
+  The writer builds a complete object and publish()es it with an atomic pointer
+  exchange. The reader calls acquire() once per buffer and uses what it gets until
+  its next call; it marks the object it holds as in use, and the writer only frees
+  a replaced object once the reader has moved on to a newer one.
+
+  There must be a single writer at a time (callers lock if several threads write)
+  and a single reader.
+
+  @see ParameterStore
+
+*/
+
+template <class ObjectType>
+class PublishedObject
+{
+public:
+    PublishedObject()
+    {
+        current = nullptr;
+        inUse = nullptr;
+    }
+
+    ~PublishedObject()
+    {
+        delete current.get();
+    }
+
+    /** Writer: swaps in a new object, which may be null, and takes ownership of it.
+        Replaced objects are freed here once the reader doesn't hold them any more. */
+    void publish(ObjectType* object)
+    {
+        ObjectType* replaced = current.exchange(object);
+
+        if (replaced != nullptr)
+            retired.add(replaced);
+
+        // anything the reader isn't holding can't be reached by it any more
+        for (int i = retired.size(); --i >= 0;)
+        {
+            if (retired[i] != inUse.get())
+                retired.remove(i);
+        }
+    }
+
+    /** Writer: the object published last. */
+    ObjectType* getLatest() const
+    {
+        return current.get();
+    }
+
+    /** Reader: returns the object published last, which stays valid until the next call. */
+    ObjectType* acquire()
+    {
+        ObjectType* object;
+
+        // if the object was replaced before it was marked, the writer may have freed it: try again
+        do
+        {
+            object = current.get();
+            inUse = object;
+        }
+        while (object != current.get());
+
+        return object;
+    }
+
+private:
+    Atomic<ObjectType*> current;
+    Atomic<ObjectType*> inUse;
+
+    /** Replaced objects that the reader may still be using */
+    OwnedArray<ObjectType> retired;
+
+    JUCE_DECLARE_NON_COPYABLE(PublishedObject);
+};
+
+
+#endif  // PUBLISHEDOBJECT_H_INCLUDED
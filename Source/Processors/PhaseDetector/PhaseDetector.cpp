@@ -24,9 +24,12 @@
 #include <stdio.h>
 #include "PhaseDetector.h"
 #include "PhaseDetectorEditor.h"
+#include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
 
 PhaseDetector::PhaseDetector()
-    : GenericProcessor("Phase Detector"), activeModule(-1),
+    : GenericProcessor("Phase Detector"), lastEstimator(nullptr),
+      lowCut(4.0f), highCut(12.0f), latencyMs(0.0f), activeModule(-1),
       risingPos(false), risingNeg(false), fallingPos(false), fallingNeg(false)
 
 {
@@ -54,13 +57,13 @@ void PhaseDetector::addModule()
     m.outputChan = -1;
     m.gateChan = -1;
     m.isActive = true;
-    m.lastSample = 0.0f;
+    m.lastOffset = 0.0f;
     m.type = NONE;
     m.samplesSinceTrigger = 5000;
     m.wasTriggered = false;
-    m.phase = NO_PHASE;
 
     modules.add(m);
+    updateEstimator();
 }
 
 void PhaseDetector::setActiveModule(int i)
@@ -73,6 +76,27 @@ void PhaseDetector::setActiveModule(int i)
 void PhaseDetector::setParameter(int parameterIndex, float newValue)
 {
 
+    if (parameterIndex == LOW_CUT)
+    {
+        lowCut = newValue;
+        updateEstimator();
+        return;
+    }
+    else if (parameterIndex == HIGH_CUT)
+    {
+        highCut = newValue;
+        updateEstimator();
+        return;
+    }
+    else if (parameterIndex == LATENCY)
+    {
+        latencyMs = newValue;
+        return;
+    }
+
+    if (activeModule < 0 || activeModule >= modules.size())
+        return;
+
     DetectorModule& module = modules.getReference(activeModule);
 
     if (parameterIndex == 1) // module type
@@ -104,6 +128,7 @@ void PhaseDetector::setParameter(int parameterIndex, float newValue)
     else if (parameterIndex == 2)   // inputChan
     {
         module.inputChan = (int) newValue;
+        updateEstimator();
     }
     else if (parameterIndex == 3)   // outputChan
     {
@@ -126,14 +151,53 @@ void PhaseDetector::setParameter(int parameterIndex, float newValue)
 
 void PhaseDetector::updateSettings()
 {
-
+    updateEstimator();
 }
 
 bool PhaseDetector::enable()
 {
+    updateEstimator();
+
+    for (int i = 0; i < modules.size(); i++)
+    {
+        DetectorModule& module = modules.getReference(i);
+        module.lastOffset = 0.0f;
+        module.samplesSinceTrigger = 5000;
+        module.wasTriggered = false;
+    }
+
     return true;
 }
 
+void PhaseDetector::updateEstimator()
+{
+    ScopedPointer<EstimatorSetup> newSetup = new EstimatorSetup();
+    PhaseEstimator& estimator = newSetup->estimator;
+
+    Array<int> inputChannels;
+
+    for (int i = 0; i < modules.size(); i++)
+    {
+        const int channel = modules[i].inputChan;
+
+        if (channel >= 0 && channel < getNumInputs())
+            inputChannels.addIfNotAlreadyThere(channel);
+    }
+
+    estimator.setChannels(inputChannels);
+
+    if (getSampleRate() > 0)
+        estimator.setBand(lowCut, highCut, getSampleRate());
+
+    if (AccessClass::getAudioComponent() != nullptr)
+        estimator.setMaxBlockSize(AccessClass::getAudioComponent()->getBufferSize());
+
+    for (int i = 0; i < modules.size(); i++)
+        newSetup->moduleIndices.add(estimator.indexOf(modules[i].inputChan));
+
+    estimatorSetup.publish(newSetup.release());
+}
+
 void PhaseDetector::handleEvent(int eventType, MidiMessage& event, int sampleNum)
 {
     // MOVED GATING TO PULSE PAL OUTPUT!
@@ -172,91 +236,101 @@ void PhaseDetector::process(AudioSampleBuffer& buffer,
 
     checkForEvents(events);
 
+    EstimatorSetup* setup = estimatorSetup.acquire();
+
+    if (setup == nullptr)
+        return;
+
+    // a new estimator starts from cleared filters, so the detectors start over too
+    if (setup != lastEstimator)
+    {
+        for (int i = 0; i < modules.size(); i++)
+            modules.getReference(i).lastOffset = 0.0f;
+
+        lastEstimator = setup;
+    }
+
+    PhaseEstimator& estimator = setup->estimator;
+    const Array<int>& moduleIndices = setup->moduleIndices;
+
+    if (estimator.getNumChannels() == 0)
+        return;
+
+    // detectors added since the setup was built aren't followed yet
+    const int numModules = jmin(modules.size(), moduleIndices.size());
+
+    // followed channels all come through the same chain, so share one block length
+    int numSamples = 0;
+
+    for (int i = 0; i < numModules && numSamples == 0; i++)
+    {
+        if (moduleIndices[i] >= 0)
+            numSamples = getNumSamples(modules[i].inputChan);
+    }
+
+    estimator.process(buffer, numSamples);
+
+    const float lowFrequency = float(estimator.getLowFrequency());
+    const float highFrequency = float(estimator.getHighFrequency());
+    const float latencySamples = latencyMs * getSampleRate() / 1000.0f;
+
     // loop through the modules
-    for (int i = 0; i < modules.size(); i++)
+    for (int i = 0; i < numModules; i++)
     {
         DetectorModule& module = modules.getReference(i);
+        const int estimatorIndex = moduleIndices[i];
+
+        if (estimatorIndex < 0)
+            continue;
 
-        // check to see if it's active and has a channel
-        if (module.isActive && module.outputChan >= 0 &&
-            module.inputChan >= 0 &&
-            module.inputChan < buffer.getNumChannels())
+        float target;
+
+        switch (module.type)
         {
-            for (int i = 0; i < getNumSamples(module.inputChan); i++)
-            {
-                const float sample = *buffer.getReadPointer(module.inputChan, i);
-
-                if (sample < module.lastSample && sample > 0 && module.phase != FALLING_POS)
-                {
-
-                    if (module.type == PEAK)
-                    {
-                        addEvent(events, TTL, i, 1, module.outputChan);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
-                    }
-
-                    module.phase = FALLING_POS;
-
-                }
-                else if (sample < 0 && module.lastSample >= 0 && module.phase != FALLING_NEG)
-                {
-
-                    if (module.type == FALLING_ZERO)
-                    {
-                        addEvent(events, TTL, i, 1, module.outputChan);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
-                    }
-
-                    module.phase = FALLING_NEG;
-
-                }
-                else if (sample > module.lastSample && sample < 0 && module.phase != RISING_NEG)
-                {
-
-                    if (module.type == TROUGH)
-                    {
-                        addEvent(events, TTL, i, 1, module.outputChan);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
-                    }
-
-                    module.phase = RISING_NEG;
-
-                }
-                else if (sample > 0 && module.lastSample <= 0 && module.phase != RISING_POS)
-                {
-
-                    if (module.type == RISING_ZERO)
-                    {
-                        addEvent(events, TTL, i, 1, module.outputChan);
-                        module.samplesSinceTrigger = 0;
-                        module.wasTriggered = true;
-                    }
-
-                    module.phase = RISING_POS;
-
-                }
-
-                module.lastSample = sample;
-
-                if (module.wasTriggered)
-                {
-                    if (module.samplesSinceTrigger > 1000)
-                    {
-                        addEvent(events, TTL, i, 0, module.outputChan);
-                        module.wasTriggered = false;
-                    }
-                    else
-                    {
-                        module.samplesSinceTrigger++;
-                    }
-                }
+            case PEAK:
+                target = 0.0f;
+                break;
+            case FALLING_ZERO:
+                target = float_Pi / 2.0f;
+                break;
+            case TROUGH:
+                target = float_Pi;
+                break;
+            case RISING_ZERO:
+                target = -float_Pi / 2.0f;
+                break;
+            default:
+                continue;
+        }
 
+        const float* phases = estimator.getPhases(estimatorIndex);
+        const float* frequencies = estimator.getFrequencies(estimatorIndex);
+
+        for (int n = 0; n < numSamples; n++)
+        {
+            // the phase the signal will have once the latency has passed, relative to the target
+            float offset = phases[n] + frequencies[n] * latencySamples - target;
+            offset -= 2.0f * float_Pi * std::floor((offset + float_Pi) / (2.0f * float_Pi));
+
+            // a crossing only counts while the band holds an oscillation, at most once per cycle
+            if (module.lastOffset < 0 && offset >= 0 && offset - module.lastOffset < float_Pi
+                && frequencies[n] > lowFrequency && frequencies[n] < highFrequency
+                && module.samplesSinceTrigger > float_Pi / frequencies[n]
+                && module.isActive && module.outputChan >= 0)
+            {
+                addEvent(events, TTL, n, 1, module.outputChan);
+                module.samplesSinceTrigger = 0;
+                module.wasTriggered = true;
             }
 
+            module.lastOffset = offset;
+            module.samplesSinceTrigger++;
 
+            if (module.wasTriggered && module.samplesSinceTrigger > 1000)
+            {
+                addEvent(events, TTL, n, 0, module.outputChan);
+                module.wasTriggered = false;
+            }
         }
 
     }
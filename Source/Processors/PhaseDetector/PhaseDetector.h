@@ -27,12 +27,20 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "../Parameter/PublishedObject.h"
+#include "PhaseEstimator.h"
 
 #define NUM_INTERVALS 5
 
 /**
 
-  Uses peaks to estimate the phase of a continuous signal.
+  Sends a TTL event when a continuous signal reaches a given phase.
+
+  The phase of every input channel is estimated causally within one band (see
+  PhaseEstimator), all channels at once, so several detectors can follow several
+  channels without splitting the signal chain. Each detector triggers when its
+  channel's phase, predicted ahead by the latency to compensate, crosses the
+  phase of its type: peak, falling zero crossing, trough or rising zero crossing.
 
   @see GenericProcessor, PhaseDetectorEditor
 
@@ -56,6 +64,11 @@ public:
         return false;
     }
 
+    bool supportsInlineProcessing()
+    {
+        return true;
+    }
+
     bool enable();
 
     void updateSettings();
@@ -63,6 +76,14 @@ public:
     void addModule();
     void setActiveModule(int);
 
+    /** Processor parameters, next to the per-detector ones (1 to 4) */
+    enum Parameter
+    {
+        LOW_CUT = 5,
+        HIGH_CUT = 6,
+        LATENCY = 7
+    };
+
 private:
 
     enum ModuleType
@@ -70,11 +91,6 @@ private:
         NONE, PEAK, FALLING_ZERO, TROUGH, RISING_ZERO
     };
 
-    enum PhaseType
-    {
-        NO_PHASE, RISING_POS, FALLING_POS, FALLING_NEG, RISING_NEG
-    };
-
     struct DetectorModule
     {
 
@@ -82,15 +98,35 @@ private:
         int gateChan;
         int outputChan;
         bool isActive;
-        float lastSample;
+        float lastOffset;
         int samplesSinceTrigger;
         bool wasTriggered;
         ModuleType type;
-        PhaseType phase;
     };
 
     Array<DetectorModule> modules;
 
+    /** An estimator and, per detector, the index of its input channel among the
+        estimator's channels (or -1); built on the message thread and swapped in whole */
+    struct EstimatorSetup
+    {
+        PhaseEstimator estimator;
+        Array<int> moduleIndices;
+    };
+
+    /** Message thread: builds an estimator for the detectors' input channels and the band,
+        and publishes it to the audio thread, which starts from a cleared state */
+    void updateEstimator();
+
+    PublishedObject<EstimatorSetup> estimatorSetup;
+
+    /** Audio thread: the setup of the last block, to notice when a new one is taken */
+    const EstimatorSetup* lastEstimator;
+
+    float lowCut;
+    float highCut;
+    float latencyMs;
+
     int activeModule;
 
     void handleEvent(int eventType, MidiMessage& event, int sampleNum);
@@ -31,10 +31,11 @@
 
 
 PhaseDetectorEditor::PhaseDetectorEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors=true)
-    : GenericEditor(parentNode, useDefaultParameterEditors), previousChannelCount(-1)
+    : GenericEditor(parentNode, useDefaultParameterEditors),
+      lastLowCutString("4"), lastHighCutString("12"), lastLatencyString("0"), previousChannelCount(-1)
 
 {
-    desiredWidth = 220;
+    desiredWidth = 295;
 
     // intputChannelLabel = new Label("input", "Input channel:");
     // intputChannelLabel->setBounds(15,25,180,20);
@@ -74,6 +75,54 @@ PhaseDetectorEditor::PhaseDetectorEditor(GenericProcessor* parentNode, bool useD
     backgroundColours.add(Colours::magenta);
     backgroundColours.add(Colours::blue);
 
+    lowCutLabel = new Label("low cut label", "Low cut (Hz):");
+    lowCutLabel->setBounds(205,25,85,20);
+    lowCutLabel->setFont(Font("Small Text", 12, Font::plain));
+    lowCutLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(lowCutLabel);
+
+    lowCutValue = new Label("low cut value", lastLowCutString);
+    lowCutValue->setBounds(210,42,60,18);
+    lowCutValue->setFont(Font("Default", 15, Font::plain));
+    lowCutValue->setColour(Label::textColourId, Colours::white);
+    lowCutValue->setColour(Label::backgroundColourId, Colours::grey);
+    lowCutValue->setEditable(true);
+    lowCutValue->addListener(this);
+    lowCutValue->setTooltip("Set the low edge of the band whose phase is followed");
+    addAndMakeVisible(lowCutValue);
+
+    highCutLabel = new Label("high cut label", "High cut (Hz):");
+    highCutLabel->setBounds(205,60,85,20);
+    highCutLabel->setFont(Font("Small Text", 12, Font::plain));
+    highCutLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(highCutLabel);
+
+    highCutValue = new Label("high cut value", lastHighCutString);
+    highCutValue->setBounds(210,77,60,18);
+    highCutValue->setFont(Font("Default", 15, Font::plain));
+    highCutValue->setColour(Label::textColourId, Colours::white);
+    highCutValue->setColour(Label::backgroundColourId, Colours::grey);
+    highCutValue->setEditable(true);
+    highCutValue->addListener(this);
+    highCutValue->setTooltip("Set the high edge of the band whose phase is followed");
+    addAndMakeVisible(highCutValue);
+
+    latencyLabel = new Label("latency label", "Latency (ms):");
+    latencyLabel->setBounds(205,95,85,20);
+    latencyLabel->setFont(Font("Small Text", 12, Font::plain));
+    latencyLabel->setColour(Label::textColourId, Colours::darkgrey);
+    addAndMakeVisible(latencyLabel);
+
+    latencyValue = new Label("latency value", lastLatencyString);
+    latencyValue->setBounds(210,112,60,18);
+    latencyValue->setFont(Font("Default", 15, Font::plain));
+    latencyValue->setColour(Label::textColourId, Colours::white);
+    latencyValue->setColour(Label::backgroundColourId, Colours::grey);
+    latencyValue->setEditable(true);
+    latencyValue->addListener(this);
+    latencyValue->setTooltip("Set the delay between a TTL event and the stimulus it drives; events are sent that much ahead of the phase");
+    addAndMakeVisible(latencyValue);
+
     plusButton->setToggleState(true, sendNotification);
 
     //interfaces.clear();
@@ -122,7 +171,7 @@ void PhaseDetectorEditor::comboBoxChanged(ComboBox* c)
 
 void PhaseDetectorEditor::buttonEvent(Button* button)
 {
-    if (button == plusButton && interfaces.size() < 5)
+    if (button == plusButton && interfaces.size() < 16)
     {
 
         addDetector();
@@ -131,6 +180,41 @@ void PhaseDetectorEditor::buttonEvent(Button* button)
 
 }
 
+void PhaseDetectorEditor::labelTextChanged(Label* label)
+{
+    if (label == lowCutValue)
+    {
+        applyLabel(label, lastLowCutString, PhaseDetector::LOW_CUT, 0.01, lastHighCutString.getDoubleValue());
+    }
+    else if (label == highCutValue)
+    {
+        applyLabel(label, lastHighCutString, PhaseDetector::HIGH_CUT, lastLowCutString.getDoubleValue(), 10000);
+    }
+    else if (label == latencyValue)
+    {
+        applyLabel(label, lastLatencyString, PhaseDetector::LATENCY, 0, 1000);
+    }
+}
+
+void PhaseDetectorEditor::applyLabel(Label* label, String& lastString, int parameterIndex,
+                                     double minValue, double maxValue)
+{
+    Value val = label->getTextValue();
+    double requestedValue = double(val.getValue());
+
+    if (requestedValue < minValue || requestedValue > maxValue)
+    {
+        CoreServices::sendStatusMessage("Value out of range.");
+
+        label->setText(lastString, dontSendNotification);
+        return;
+    }
+
+    lastString = label->getText();
+
+    getProcessor()->setParameter(parameterIndex, (float) requestedValue);
+}
+
 void PhaseDetectorEditor::addDetector()
 {
     std::cout << "Adding detector" << std::endl;
@@ -168,6 +252,11 @@ void PhaseDetectorEditor::saveCustomParameters(XmlElement* xml)
 
     xml->setAttribute("Type", "PhaseDetectorEditor");
 
+    XmlElement* textLabelValues = xml->createNewChildElement("VALUES");
+    textLabelValues->setAttribute("LowCut", lastLowCutString);
+    textLabelValues->setAttribute("HighCut", lastHighCutString);
+    textLabelValues->setAttribute("Latency", lastLatencyString);
+
     for (int i = 0; i < interfaces.size(); i++)
     {
         XmlElement* d = xml->createNewChildElement("DETECTOR");
@@ -185,7 +274,22 @@ void PhaseDetectorEditor::loadCustomParameters(XmlElement* xml)
 
     forEachXmlChildElement(*xml, xmlNode)
     {
-        if (xmlNode->hasTagName("DETECTOR"))
+        if (xmlNode->hasTagName("VALUES"))
+        {
+            // high cut first, so that the low cut is checked against it
+            lastHighCutString = xmlNode->getStringAttribute("HighCut", lastHighCutString);
+            highCutValue->setText(lastHighCutString, dontSendNotification);
+            getProcessor()->setParameter(PhaseDetector::HIGH_CUT, lastHighCutString.getFloatValue());
+
+            lastLowCutString = xmlNode->getStringAttribute("LowCut", lastLowCutString);
+            lowCutValue->setText(lastLowCutString, dontSendNotification);
+            getProcessor()->setParameter(PhaseDetector::LOW_CUT, lastLowCutString.getFloatValue());
+
+            lastLatencyString = xmlNode->getStringAttribute("Latency", lastLatencyString);
+            latencyValue->setText(lastLatencyString, dontSendNotification);
+            getProcessor()->setParameter(PhaseDetector::LATENCY, lastLatencyString.getFloatValue());
+        }
+        else if (xmlNode->hasTagName("DETECTOR"))
         {
 
             if (i > 0)
@@ -43,7 +43,8 @@ class ElectrodeButton;
 */
 
 class PhaseDetectorEditor : public GenericEditor,
-    public ComboBox::Listener
+    public ComboBox::Listener,
+    public Label::Listener
 {
 public:
     PhaseDetectorEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors);
@@ -54,6 +55,8 @@ public:
 
     void comboBoxChanged(ComboBox* c);
 
+    void labelTextChanged(Label* label);
+
     void updateSettings();
 
     void saveCustomParameters(XmlElement* xml);
@@ -67,6 +70,21 @@ private:
 
     void addDetector();
 
+    /** Applies a band or latency label's value, or restores its last valid one */
+    void applyLabel(Label* label, String& lastString, int parameterIndex, double minValue, double maxValue);
+
+    ScopedPointer<Label> lowCutLabel;
+    ScopedPointer<Label> highCutLabel;
+    ScopedPointer<Label> latencyLabel;
+
+    ScopedPointer<Label> lowCutValue;
+    ScopedPointer<Label> highCutValue;
+    ScopedPointer<Label> latencyValue;
+
+    String lastLowCutString;
+    String lastHighCutString;
+    String lastLatencyString;
+
     // ScopedPointer<ComboBox> inputChannelSelectionBox;
     // ScopedPointer<ComboBox> outputChannelSelectionBox;
 
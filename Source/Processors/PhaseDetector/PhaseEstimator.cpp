@@ -0,0 +1,257 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PhaseEstimator.h"
+#include <complex>
+
+
+PhaseEstimator::PhaseEstimator()
+    : b0(0), a1(0), a2(0), centre(0), low(0), high(0),
+      decay(0), resonatorRe(0), resonatorIm(0), smoothing(0),
+      phases(1, 1024), frequencies(1, 1024), arReal(1, 1024), arImag(1, 1024)
+{
+
+}
+
+
+PhaseEstimator::~PhaseEstimator()
+{
+
+}
+
+
+void PhaseEstimator::setChannels(const Array<int>& channels)
+{
+    inputChannels = channels;
+
+    const int numChannels = jmax(1, inputChannels.size());
+
+    input.calloc(numChannels);
+    s1.calloc(numChannels);
+    s2.calloc(numChannels);
+    t1.calloc(numChannels);
+    t2.calloc(numChannels);
+    zRe.calloc(numChannels);
+    zIm.calloc(numChannels);
+    arRe.calloc(numChannels);
+    arIm.calloc(numChannels);
+    correction.calloc(numChannels);
+
+    phases.setSize(numChannels, phases.getNumSamples());
+    frequencies.setSize(numChannels, frequencies.getNumSamples());
+    arReal.setSize(numChannels, arReal.getNumSamples());
+    arImag.setSize(numChannels, arImag.getNumSamples());
+}
+
+
+int PhaseEstimator::getNumChannels() const
+{
+    return inputChannels.size();
+}
+
+
+int PhaseEstimator::indexOf(int channel) const
+{
+    return inputChannels.indexOf(channel);
+}
+
+
+void PhaseEstimator::setMaxBlockSize(int numSamples)
+{
+    const int numChannels = jmax(1, inputChannels.size());
+
+    phases.setSize(numChannels, numSamples);
+    frequencies.setSize(numChannels, numSamples);
+    arReal.setSize(numChannels, numSamples);
+    arImag.setSize(numChannels, numSamples);
+}
+
+
+void PhaseEstimator::setBand(double lowCut, double highCut, double sampleRate)
+{
+    highCut = jmin(highCut, 0.45 * sampleRate);
+    lowCut = jlimit(0.01, highCut * 0.9, lowCut);
+
+    low = 2.0 * double_Pi * lowCut / sampleRate;
+    high = 2.0 * double_Pi * highCut / sampleRate;
+    centre = std::sqrt(low * high);
+
+    // constant-gain bandpass between the band edges (bandwidth in octaves)
+    const double octaves = std::log(highCut / lowCut) / std::log(2.0);
+    const double alpha = std::sin(centre) * std::sinh(std::log(2.0) / 2.0 * octaves * centre / std::sin(centre));
+    const double a0 = 1.0 + alpha;
+
+    b0 = alpha / a0;
+    a1 = -2.0 * std::cos(centre) / a0;
+    a2 = (1.0 - alpha) / a0;
+
+    // a resonator an eighth of the band wide leaves little of the negative frequencies
+    decay = 1.0 - (high - low) / 8.0;
+    resonatorRe = decay * std::cos(centre);
+    resonatorIm = decay * std::sin(centre);
+
+    // the frequency estimate follows changes within about one cycle
+    smoothing = std::exp(-centre / (2.0 * double_Pi));
+
+    reset();
+}
+
+
+double PhaseEstimator::getLowFrequency() const
+{
+    return low;
+}
+
+
+double PhaseEstimator::getHighFrequency() const
+{
+    return high;
+}
+
+
+void PhaseEstimator::reset()
+{
+    const int numChannels = jmax(1, inputChannels.size());
+
+    zeromem(s1, numChannels * sizeof(double));
+    zeromem(s2, numChannels * sizeof(double));
+    zeromem(t1, numChannels * sizeof(double));
+    zeromem(t2, numChannels * sizeof(double));
+    zeromem(zRe, numChannels * sizeof(double));
+    zeromem(zIm, numChannels * sizeof(double));
+    zeromem(arRe, numChannels * sizeof(double));
+    zeromem(arIm, numChannels * sizeof(double));
+    zeromem(correction, numChannels * sizeof(float));
+}
+
+
+void PhaseEstimator::updatePhaseCorrection(int index)
+{
+    typedef std::complex<double> Complex;
+
+    const double w = std::atan2(arIm[index], arRe[index]);
+
+    if (w <= 0)
+    {
+        correction[index] = 0;
+        return;
+    }
+
+    const Complex e1 = std::polar(1.0, -w);
+    const Complex e2 = e1 * e1;
+
+    const Complex bandpass = (b0 - b0 * e2) / (1.0 + a1 * e1 + a2 * e2);
+    const Complex resonator = (1.0 - decay) / (1.0 - decay * std::polar(1.0, centre - w));
+
+    correction[index] = float(-(2.0 * std::arg(bandpass) + std::arg(resonator)));
+}
+
+
+void PhaseEstimator::process(const AudioSampleBuffer& buffer, int numSamples)
+{
+    const int numChannels = inputChannels.size();
+
+    if (numChannels == 0 || numSamples <= 0)
+        return;
+
+    phases.setSize(numChannels, numSamples, false, false, true);
+    frequencies.setSize(numChannels, numSamples, false, false, true);
+    arReal.setSize(numChannels, numSamples, false, false, true);
+    arImag.setSize(numChannels, numSamples, false, false, true);
+
+    // the filters' lag is corrected for the frequency reached at the end of the last block
+    for (int c = 0; c < numChannels; c++)
+        updatePhaseCorrection(c);
+
+    for (int n = 0; n < numSamples; n++)
+    {
+        for (int c = 0; c < numChannels; c++)
+            input[c] = buffer.getReadPointer(inputChannels[c])[n];
+
+        for (int c = 0; c < numChannels; c++)
+        {
+            // two bandpass sections (b1 = 0, b2 = -b0), transposed direct form II
+            const double x = input[c];
+
+            const double y1 = b0 * x + s1[c];
+            s1[c] = s2[c] - a1 * y1;
+            s2[c] = -b0 * x - a2 * y1;
+
+            const double y2 = b0 * y1 + t1[c];
+            t1[c] = t2[c] - a1 * y2;
+            t2[c] = -b0 * y1 - a2 * y2;
+
+            // complex resonator at the centre of the band, with unit gain there
+            const double re = (1.0 - decay) * y2 + resonatorRe * zRe[c] - resonatorIm * zIm[c];
+            const double im = resonatorRe * zIm[c] + resonatorIm * zRe[c];
+
+            // first-order autoregressive fit: the angle of z[n] * conj(z[n-1])
+            arRe[c] = smoothing * arRe[c] + (1.0 - smoothing) * (re * zRe[c] + im * zIm[c]);
+            arIm[c] = smoothing * arIm[c] + (1.0 - smoothing) * (im * zRe[c] - re * zIm[c]);
+
+            zRe[c] = re;
+            zIm[c] = im;
+        }
+
+        for (int c = 0; c < numChannels; c++)
+        {
+            phases.getWritePointer(c)[n] = float(zRe[c]);
+            frequencies.getWritePointer(c)[n] = float(zIm[c]);
+            arReal.getWritePointer(c)[n] = float(arRe[c]);
+            arImag.getWritePointer(c)[n] = float(arIm[c]);
+        }
+    }
+
+    for (int c = 0; c < numChannels; c++)
+    {
+        float* phase = phases.getWritePointer(c);
+        float* frequency = frequencies.getWritePointer(c);
+        const float* ar = arReal.getReadPointer(c);
+        const float* ai = arImag.getReadPointer(c);
+
+        for (int n = 0; n < numSamples; n++)
+        {
+            float p = std::atan2(frequency[n], phase[n]) + correction[c];
+
+            if (p > float_Pi)
+                p -= 2.0f * float_Pi;
+            else if (p <= -float_Pi)
+                p += 2.0f * float_Pi;
+
+            phase[n] = p;
+            frequency[n] = std::atan2(ai[n], ar[n]);
+        }
+    }
+}
+
+
+const float* PhaseEstimator::getPhases(int index) const
+{
+    return phases.getReadPointer(index);
+}
+
+
+const float* PhaseEstimator::getFrequencies(int index) const
+{
+    return frequencies.getReadPointer(index);
+}
@@ -0,0 +1,119 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef PHASEESTIMATOR_H_INCLUDED
+#define PHASEESTIMATOR_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Causal estimate of the instantaneous phase and frequency of several channels
+  within one frequency band.
+
+  Each channel goes through two bandpass biquads and then a complex one-pole
+  resonator tuned to the centre of the band. The resonator passes the positive
+  frequencies of the band and rejects the negative ones, so its output is the
+  analytic signal (the signal plus i times its Hilbert transform) without needing
+  future samples. The instantaneous frequency is the angle of a first-order complex
+  autoregressive fit to that output, updated every sample, and it also serves to
+  predict the phase ahead of time (see PhaseDetector). The phase lag of the filters
+  at the estimated frequency is corrected once per block.
+
+  Phase 0 is the peak of the oscillation, pi/2 its falling zero crossing, pi its
+  trough and -pi/2 its rising zero crossing.
+
+  The filters are recursive, so samples are processed one after the other, but all
+  channels are processed together: their states are kept in contiguous arrays and
+  the inner loop runs across channels, which the compiler can vectorize.
+
+  @see PhaseDetector
+
+*/
+
+class PhaseEstimator
+{
+public:
+    PhaseEstimator();
+    ~PhaseEstimator();
+
+    /** Sets the input channels to follow; their state is reset. */
+    void setChannels(const Array<int>& channels);
+
+    int getNumChannels() const;
+
+    /** Returns the index of an input channel among the followed ones, or -1. */
+    int indexOf(int channel) const;
+
+    void setBand(double lowCut, double highCut, double sampleRate);
+
+    /** Allocates the per-sample buffers, so that blocks up to this length don't allocate. */
+    void setMaxBlockSize(int numSamples);
+
+    /** Clears the filter states. */
+    void reset();
+
+    /** Estimates the phase and frequency at every sample of the block. */
+    void process(const AudioSampleBuffer& buffer, int numSamples);
+
+    /** The phase of a followed channel at each sample of the last block, in radians. */
+    const float* getPhases(int index) const;
+
+    /** The frequency of a followed channel at each sample of the last block, in radians per sample. */
+    const float* getFrequencies(int index) const;
+
+    /** The band edges, in radians per sample. */
+    double getLowFrequency() const;
+    double getHighFrequency() const;
+
+private:
+
+    void updatePhaseCorrection(int index);
+
+    Array<int> inputChannels;
+
+    // biquad coefficients (both sections share them) and the resonator's
+    double b0, a1, a2;
+    double centre, low, high;
+    double decay, resonatorRe, resonatorIm;
+    double smoothing;
+
+    // per-channel states, one array per variable so the channel loop vectorizes
+    HeapBlock<double> input;
+    HeapBlock<double> s1, s2, t1, t2;
+    HeapBlock<double> zRe, zIm;
+    HeapBlock<double> arRe, arIm;
+    HeapBlock<float> correction;
+
+    /** Per channel and sample: the resonator output, then the phase and frequency */
+    AudioSampleBuffer phases;
+    AudioSampleBuffer frequencies;
+    AudioSampleBuffer arReal;
+    AudioSampleBuffer arImag;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PhaseEstimator);
+
+};
+
+
+#endif  // PHASEESTIMATOR_H_INCLUDED
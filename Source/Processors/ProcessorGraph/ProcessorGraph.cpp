@@ -28,9 +28,12 @@
 
 #include "../AudioNode/AudioNode.h"
 #include "../LfpDisplayNode/LfpDisplayNode.h"
+#include "../LfpTriggeredAverageNode/LfpTriggeredAverageNode.h"
 #include "../SpikeDisplayNode/SpikeDisplayNode.h"
 #include "../EventNode/EventNode.h"
 #include "../EventBroadcaster/EventBroadcaster.h"
+#include "../DataStreamer/DataStreamer.h"
+#include "../SharedMemoryExport/SharedMemoryExport.h"
 #include "../FilterNode/FilterNode.h"
 #include "../RecordNode/RecordNode.h"
 #include "../ResamplingNode/ResamplingNode.h"
@@ -55,6 +58,8 @@
 #include "../PSTH/PeriStimulusTimeHistogramNode.h"
 #include "../CAR/CAR.h"
 #include "../Rectifier/Rectifier.h"
+#include "../ExpressionNode/ExpressionNode.h"
+#include "../BandPower/BandPowerNode.h"
 
     
 ProcessorGraph::ProcessorGraph() : currentNodeId(100)
@@ -578,6 +583,16 @@ GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& descrip
             std::cout << "Creating a new rectifier node." << std::endl;
             processor = new Rectifier();
         }
+        else if (subProcessorType.equalsIgnoreCase("Expression"))
+        {
+            std::cout << "Creating a new expression node." << std::endl;
+            processor = new ExpressionNode();
+        }
+        else if (subProcessorType.equalsIgnoreCase("Band Power"))
+        {
+            std::cout << "Creating a new band power node." << std::endl;
+            processor = new BandPowerNode();
+        }
         else if (subProcessorType.equalsIgnoreCase("Spike Detector"))
         {
             std::cout << "Creating a new spike detector." << std::endl;
@@ -593,6 +608,11 @@ GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& descrip
             std::cout << "Creating a new event detector." << std::endl;
             processor = new EventDetector();
         }
+        else if (subProcessorType.equalsIgnoreCase("Resampler"))
+        {
+            std::cout << "Creating a new resampler." << std::endl;
+            processor = new ResamplingNode();
+        }
         else if (subProcessorType.equalsIgnoreCase("Phase Detector"))
         {
             std::cout << "Creating a new phase detector." << std::endl;
@@ -652,6 +672,12 @@ GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& descrip
             processor = new LfpDisplayNode();
         }
 
+        else if (subProcessorType.equalsIgnoreCase("LFP Trig. Avg."))
+        {
+            std::cout << "Creating an LfpTriggeredAverageNode." << std::endl;
+            processor = new LfpTriggeredAverageNode();
+        }
+
         else if (subProcessorType.equalsIgnoreCase("Spike Viewer"))
         {
             std::cout << "Creating a SpikeDisplayNode." << std::endl;
@@ -678,6 +704,16 @@ GenericProcessor* ProcessorGraph::createProcessorFromDescription(String& descrip
             std::cout << "Creating an Event Broadcaster output node." << std::endl;
             processor = new EventBroadcaster();
         }
+        else if (subProcessorType.equalsIgnoreCase("Data Streamer"))
+        {
+            std::cout << "Creating a Data Streamer output node." << std::endl;
+            processor = new DataStreamer();
+        }
+        else if (subProcessorType.equalsIgnoreCase("Shared Memory"))
+        {
+            std::cout << "Creating a Shared Memory output node." << std::endl;
+            processor = new SharedMemoryExport();
+        }
 
 		CoreServices::sendStatusMessage("New sink created.");
     }
@@ -783,6 +819,7 @@ bool ProcessorGraph::enableProcessors()
         if (node->nodeId != OUTPUT_NODE_ID)
         {
             GenericProcessor* p = (GenericProcessor*) node->getProcessor();
+            p->getOutputLatency().reset(); // the latency report covers the current run
             p->enableEditor();
             p->enable();
         }
@@ -28,7 +28,7 @@
 
 
 PulsePalOutput::PulsePalOutput()
-    : GenericProcessor("Pulse Pal"), channelToChange(0)
+    : GenericProcessor("Pulse Pal"), channelToChange(0), dispatcher("Pulse Pal", this, this)
 {
 
     pulsePal.initialize();
@@ -46,6 +46,7 @@ PulsePalOutput::PulsePalOutput()
 
 PulsePalOutput::~PulsePalOutput()
 {
+    dispatcher.stop();
 
     pulsePal.updateDisplay("PULSE PAL v1.0","Click for menu");
 }
@@ -72,7 +73,12 @@ void PulsePalOutput::handleEvent(int eventType, MidiMessage& event, int sampleNu
         {
             if (eventId == 1 && eventChannel == channelTtlTrigger[i] && channelState[i])
             {
-                pulsePal.triggerChannel(i+1);
+                DeviceCommand command;
+                command.channel = i + 1;
+                command.ingestionTicks = getIngestionTicks();
+                command.dueTicks = OutputDispatcher::getTicksForSample(command.ingestionTicks, sampleNum, getSampleRate());
+
+                dispatcher.schedule(command);
             }
 
             if (eventChannel == channelTtlGate[i])
@@ -127,3 +133,33 @@ void PulsePalOutput::process(AudioSampleBuffer& buffer,
     checkForEvents(events);
 
 }
+
+bool PulsePalOutput::enable()
+{
+    dispatcher.start();
+    return true;
+}
+
+bool PulsePalOutput::disable()
+{
+    dispatcher.stop();
+    return true;
+}
+
+void PulsePalOutput::triggerChannel(int channel)
+{
+    DeviceCommand command;
+    command.channel = channel;
+
+    dispatcher.post(command);
+}
+
+void PulsePalOutput::execute(const DeviceCommand& command)
+{
+    pulsePal.triggerChannel((uint8_t) command.channel);
+}
+
+LatencyHistogram* PulsePalOutput::getDispatchJitter()
+{
+    return &dispatcher.getJitter();
+}
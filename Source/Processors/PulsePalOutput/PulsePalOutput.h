@@ -28,17 +28,22 @@
 #include "../GenericProcessor/GenericProcessor.h"
 #include "PulsePalOutputEditor.h"
 #include "../Serial/PulsePal.h"
+#include "../OutputDispatcher/OutputDispatcher.h"
 
 /**
 
   Allows the signal chain to send outputs to the Pulse Pal
   from Lucid Biosystems (www.lucidbiosystems.com)
 
-  @see GenericProcessor, PulsePalOutputEditor, PulsePal
+  Triggers are sent by an OutputDispatcher thread at the time of the
+  sample that caused them.
+
+  @see GenericProcessor, PulsePalOutputEditor, PulsePal, OutputDispatcher
 
 */
 
-class PulsePalOutput : public GenericProcessor
+class PulsePalOutput : public GenericProcessor,
+    public OutputDispatcher::Device
 
 {
 public:
@@ -58,6 +63,22 @@ public:
         return true;
     }
 
+    bool supportsInlineProcessing()
+    {
+        return true;
+    }
+
+    bool enable();
+    bool disable();
+
+    /** Triggers a channel (1-4) from the message thread, e.g. the editor's test buttons. */
+    void triggerChannel(int channel);
+
+    /** Triggers a channel; called by the dispatcher. */
+    void execute(const DeviceCommand& command);
+
+    LatencyHistogram* getDispatchJitter();
+
 private:
 
     Array<int> channelTtlTrigger;
@@ -68,6 +89,8 @@ private:
 
     PulsePal pulsePal;
 
+    OutputDispatcher dispatcher;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PulsePalOutput);
 
 };
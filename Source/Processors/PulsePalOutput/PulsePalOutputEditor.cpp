@@ -150,7 +150,7 @@ void ChannelTriggerInterface::paint(Graphics& g)
 
 void ChannelTriggerInterface::buttonClicked(Button* button)
 {
-    pulsePal->triggerChannel(channelNumber);
+    processor->triggerChannel(channelNumber);
 }
 
 void ChannelTriggerInterface::comboBoxChanged(ComboBox* comboBoxThatHasChanged)
@@ -184,7 +184,10 @@ void HDF5Recording::writeData(AudioSampleBuffer& buffer)
             int index = processorMap[getChannel(i)->recordIndex];
             FloatVectorOperations::copyWithMultiply(scaledBuffer,buffer.getReadPointer(i,0),multFactor,nSamples);
             AudioDataConverters::convertFloatToInt16LE(scaledBuffer,intBuffer,nSamples);
+
+            const int64 startTicks = Time::getHighResolutionTicks();
             fileArray[index]->writeRowData(intBuffer,nSamples);
+            countWrite(2 * nSamples, startTicks);
         }
     }
 //	int64 t2 = Time::getHighResolutionTicks();
@@ -206,7 +209,9 @@ void HDF5Recording::addSpikeElectrode(int index, SpikeRecordInfo* elec)
 }
 void HDF5Recording::writeSpike(const SpikeObject& spike, int electrodeIndex)
 {
+    const int64 startTicks = Time::getHighResolutionTicks();
     spikesFile->writeSpike(electrodeIndex,spike.nSamples,spike.data,spike.timestamp);
+    countWrite(spike.nSamples * spike.nChannels * 2 + 8, startTicks);
 }
 
 void HDF5Recording::startAcquisition()
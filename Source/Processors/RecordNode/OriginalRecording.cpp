@@ -25,8 +25,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../../AccessClass.h"
 #include "../../Audio/AudioComponent.h"
 
+#include <limits>
+
+#if JUCE_LINUX || JUCE_MAC
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 OriginalRecording::OriginalRecording() : separateFiles(false),
-    recordingNumber(0), experimentNumber(0),  zeroBuffer(1, 50000),
+    recordingNumber(0), experimentNumber(0), renameFiles(false),
+    stripeByProcessor(false), preallocationSize(16), zeroBuffer(1, 50000),
     eventFile(nullptr), messageFile(nullptr), lastProcId(0)
 {
     continuousDataIntegerBuffer = new int16[10000];
@@ -69,6 +77,9 @@ void OriginalRecording::addChannel(int index, Channel* chan)
     fileArray.add(nullptr);
     blockIndex.add(0);
     samplesSinceLastTimestamp.add(0);
+    channelVolume.add(0);
+    fileSize.add(0);
+    allocatedSize.add(0);
 }
 
 void OriginalRecording::addSpikeElectrode(int index, SpikeRecordInfo* elec)
@@ -83,6 +94,9 @@ void OriginalRecording::resetChannels()
     blockIndex.clear();
     processorArray.clear();
     samplesSinceLastTimestamp.clear();
+    channelVolume.clear();
+    fileSize.clear();
+    allocatedSize.clear();
 }
 
 void OriginalRecording::openFiles(File rootFolder, int experimentNumber, int recordingNumber)
@@ -93,6 +107,11 @@ void OriginalRecording::openFiles(File rootFolder, int experimentNumber, int rec
     processorArray.clear();
     lastProcId = 0;
 
+    // events, spikes and the session XML always stay in the primary directory
+    recordPath = rootFolder.getFullPathName() + rootFolder.separatorString;
+
+    assignVolumes(rootFolder);
+
     openFile(rootFolder,nullptr);
     openMessageFile(rootFolder);
 
@@ -100,7 +119,7 @@ void OriginalRecording::openFiles(File rootFolder, int experimentNumber, int rec
     {
         if (getChannel(i)->getRecordState())
         {
-            openFile(rootFolder,getChannel(i));
+            openFile(volumeFolders[channelVolume[i]],getChannel(i));
             blockIndex.set(i,0);
             samplesSinceLastTimestamp.set(i,0);
         }
@@ -119,8 +138,6 @@ void OriginalRecording::openFile(File rootFolder, Channel* ch)
     String fullPath(rootFolder.getFullPathName() + rootFolder.separatorString);
     String fileName;
 
-    recordPath = fullPath;
-
     isEvent = (ch == nullptr) ? true : false;
     if (isEvent)
     {
@@ -172,6 +189,8 @@ void OriginalRecording::openFile(File rootFolder, Channel* ch)
     else
     {
         fileArray.set(ch->recordIndex,chFile);
+        fileSize.set(ch->recordIndex, ftell(chFile));
+        allocatedSize.set(ch->recordIndex, fileSize[ch->recordIndex]);
         if (ch->nodeId != lastProcId)
         {
             lastProcId = ch->nodeId;
@@ -182,6 +201,7 @@ void OriginalRecording::openFile(File rootFolder, Channel* ch)
         }
         ChannelInfo* c = new ChannelInfo();
         c->filename = fileName;
+        c->folder = rootFolder.getFullPathName();
         c->name = ch->name;
         c->startPos = ftell(chFile);
         c->bitVolts = ch->bitVolts;
@@ -191,6 +211,152 @@ void OriginalRecording::openFile(File rootFolder, Channel* ch)
 
 }
 
+void OriginalRecording::assignVolumes(File rootFolder)
+{
+    volumeFolders.clear();
+    volumeWeights.clear();
+
+    volumeFolders.add(rootFolder);
+    volumeWeights.add(1.0f);
+
+    StringArray dirs;
+    dirs.addTokens(extraDirectories, ";", "\"");
+    dirs.trim();
+    dirs.removeEmptyStrings();
+
+    for (int i = 0; i < dirs.size(); i++)
+    {
+        String path = dirs[i].unquoted();
+        float weight = 1.0f;
+
+        const int star = path.lastIndexOfChar('*');
+        if (star >= 0)
+        {
+            weight = path.substring(star + 1).getFloatValue();
+            path = path.substring(0, star).trim();
+        }
+
+        File directory(path);
+
+        if (weight <= 0 || !directory.isDirectory())
+        {
+            std::cout << "Skipping data directory " << path << std::endl;
+            continue;
+        }
+
+        // every volume gets a folder with the same name as the primary one
+        File folder = directory.getChildFile(rootFolder.getFileName());
+
+        if (folder == rootFolder || volumeFolders.contains(folder))
+            continue;
+
+        if (!folder.exists() && !folder.createDirectory())
+        {
+            std::cout << "Could not create " << folder.getFullPathName() << std::endl;
+            continue;
+        }
+
+        volumeFolders.add(folder);
+        volumeWeights.add(weight);
+    }
+
+    Array<double> load;
+    load.insertMultiple(0, 0.0, volumeFolders.size());
+
+    std::map<int, int> processorVolume;
+
+    for (int i = 0; i < channelVolume.size(); i++)
+    {
+        Channel* ch = getChannel(i);
+        channelVolume.set(i, 0);
+
+        if (!ch->getRecordState())
+            continue;
+
+        if (stripeByProcessor && processorVolume.count(ch->nodeId) > 0)
+        {
+            channelVolume.set(i, processorVolume[ch->nodeId]);
+            continue;
+        }
+
+        double bandwidth = ch->sampleRate;
+
+        if (stripeByProcessor)
+        {
+            bandwidth = 0;
+
+            for (int j = i; j < channelVolume.size(); j++)
+            {
+                if (getChannel(j)->nodeId == ch->nodeId && getChannel(j)->getRecordState())
+                    bandwidth += getChannel(j)->sampleRate;
+            }
+        }
+
+        int best = 0;
+
+        for (int v = 1; v < volumeFolders.size(); v++)
+        {
+            if ((load[v] + bandwidth) / volumeWeights[v] < (load[best] + bandwidth) / volumeWeights[best])
+                best = v;
+        }
+
+        load.set(best, load[best] + bandwidth);
+        channelVolume.set(i, best);
+        processorVolume[ch->nodeId] = best;
+    }
+}
+
+void OriginalRecording::reserveRecord(int channel)
+{
+    const int64 recordStart = fileSize[channel];
+    fileSize.set(channel, recordStart + RECORD_BYTES);
+
+    if (preallocationSize <= 0 || fileSize[channel] <= allocatedSize[channel])
+        return;
+
+    const int64 extent = jmax((int64) preallocationSize << 20, (int64) RECORD_BYTES);
+
+    if (preallocate(fileArray[channel], recordStart, extent))
+    {
+        allocatedSize.set(channel, recordStart + extent);
+    }
+    else
+    {
+        // the file system can't do it; write this file the usual way
+        allocatedSize.set(channel, std::numeric_limits<int64>::max());
+    }
+}
+
+bool OriginalRecording::preallocate(FILE* file, int64 offset, int64 length)
+{
+#if JUCE_LINUX
+    return fallocate(fileno(file), FALLOC_FL_KEEP_SIZE, (off_t) offset, (off_t) length) == 0;
+#elif JUCE_MAC
+    // F_PEOFPOSMODE allocates from the current physical end of the file
+    fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t) length, 0 };
+
+    if (fcntl(fileno(file), F_PREALLOCATE, &store) == -1)
+    {
+        store.fst_flags = F_ALLOCATEALL;
+        return fcntl(fileno(file), F_PREALLOCATE, &store) != -1;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void OriginalRecording::trimFile(FILE* file)
+{
+#if JUCE_LINUX || JUCE_MAC
+    fflush(file);
+
+    // truncating at the current size frees the blocks reserved past it
+    if (ftruncate(fileno(file), (off_t) ftell(file)) != 0)
+        std::cout << "Could not release the preallocated space of a file." << std::endl;
+#endif
+}
+
 void OriginalRecording::openSpikeFile(File rootFolder, SpikeRecordInfo* elec)
 {
 
@@ -425,6 +591,8 @@ void OriginalRecording::writeTTLEvent(MidiMessage& event, int samplePosition)
 
     int64 eventTimestamp = (*timestamps)[sourceNodeId] + samplePos; // add the sample position to the buffer timestamp
 
+    const int64 startTicks = Time::getHighResolutionTicks();
+
     diskWriteLock.enter();
 
     fwrite(&eventTimestamp,					// ptr
@@ -447,6 +615,8 @@ void OriginalRecording::writeTTLEvent(MidiMessage& event, int samplePosition)
            eventFile);             // ptr to FILE object
 
     diskWriteLock.exit();
+
+    countWrite(16, startTicks);
 }
 
 void OriginalRecording::writeData(AudioSampleBuffer& buffer)
@@ -520,9 +690,14 @@ void OriginalRecording::writeContinuousBuffer(const float* data, int nSamples, i
     }
     AudioDataConverters::convertFloatToInt16BE(continuousDataFloatBuffer, continuousDataIntegerBuffer, nSamples);
 
+    const int64 startTicks = Time::getHighResolutionTicks();
+    int64 numBytes = 2 * nSamples;
+
     if (blockIndex[channel] == 0)
     {
+        reserveRecord(channel);
         writeTimestampAndSampleCount(fileArray[channel], channel);
+        numBytes += 12;
     }
 
     diskWriteLock.enter();
@@ -541,7 +716,10 @@ void OriginalRecording::writeContinuousBuffer(const float* data, int nSamples, i
     if (blockIndex[channel] + nSamples == BLOCK_LENGTH)
     {
         writeRecordMarker(fileArray[channel]);
+        numBytes += 10;
     }
+
+    countWrite(numBytes, startTicks);
 }
 
 void OriginalRecording::writeTimestampAndSampleCount(FILE* file, int channel)
@@ -596,6 +774,8 @@ void OriginalRecording::closeFiles()
                 // fill out the rest of the current buffer
                 writeContinuousBuffer(zeroBuffer.getReadPointer(0), BLOCK_LENGTH - blockIndex[i], i);
                 diskWriteLock.enter();
+                if (allocatedSize[i] > fileSize[i])
+                    trimFile(fileArray[i]);
                 fclose(fileArray[i]);
                 fileArray.set(i,nullptr);
                 diskWriteLock.exit();
@@ -652,6 +832,7 @@ void OriginalRecording::writeSpike(const SpikeObject& spike, int electrodeIndex)
                      spike.nChannels * 2 +            // account for thresholds
                      SPIKE_METADATA_SIZE;             // 42, from SpikeObject.h
 
+    const int64 startTicks = Time::getHighResolutionTicks();
 
     diskWriteLock.enter();
 
@@ -663,6 +844,8 @@ void OriginalRecording::writeSpike(const SpikeObject& spike, int electrodeIndex)
            spikeFileArray[electrodeIndex]); // ptr to FILE object
 
     diskWriteLock.exit();
+
+    countWrite(totalBytes + 2, startTicks);
 }
 
 void OriginalRecording::writeXml()
@@ -700,6 +883,7 @@ void OriginalRecording::writeXml()
             chan->setAttribute("name",c->name);
             chan->setAttribute("bitVolts",c->bitVolts);
             chan->setAttribute("filename",c->filename);
+            chan->setAttribute("folder",c->folder);
             chan->setAttribute("position",(double)(c->startPos)); //As long as the file doesnt exceed 2^53 bytes, this will have integer precission. Better than limiting to 32bits.
             proc->addChildElement(chan);
         }
@@ -714,6 +898,9 @@ void OriginalRecording::setParameter(EngineParameter& parameter)
     boolParameter(0, separateFiles);
     boolParameter(1, renameFiles);
     strParameter(2, renamedPrefix);
+    strParameter(3, extraDirectories);
+    boolParameter(4, stripeByProcessor);
+    intParameter(5, preallocationSize);
 }
 
 RecordEngineManager* OriginalRecording::getEngineManager()
@@ -726,5 +913,11 @@ RecordEngineManager* OriginalRecording::getEngineManager()
     man->addParameter(param);
     param = new EngineParameter(EngineParameter::STR, 2, "Renamed files prefix", "CH");
     man->addParameter(param);
+    param = new EngineParameter(EngineParameter::STR, 3, "Extra data directories (dir1*weight;dir2...)", "");
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::BOOL, 4, "Stripe by processor instead of by channel", false);
+    man->addParameter(param);
+    param = new EngineParameter(EngineParameter::INT, 5, "Preallocation extent (MB, 0 = off)", 16, 0, 1024);
+    man->addParameter(param);
     return man;
 }
\ No newline at end of file
@@ -76,6 +76,28 @@ private:
 
     void writeXml();
 
+    /** Spreads the continuous files over the primary and extra data directories.
+
+        Each channel (or each processor, if stripeByProcessor is set) goes to the
+        directory with the lowest bandwidth per unit of weight once it is added,
+        which is plain round-robin when all weights and sample rates are equal.
+    */
+    void assignVolumes(File rootFolder);
+
+    /** Extends the preallocated space of a channel's file, if the next record needs it. */
+    void reserveRecord(int channel);
+
+    /** Reserves length bytes past offset without changing the file size. */
+    static bool preallocate(FILE* file, int64 offset, int64 length);
+
+    /** Releases the space preallocated past the end of the data. */
+    static void trimFile(FILE* file);
+
+    enum
+    {
+        RECORD_BYTES = 8 + 2 + 2 + 2 * BLOCK_LENGTH + 10
+    };
+
     bool separateFiles;
     Array<int> blockIndex;
     Array<int> samplesSinceLastTimestamp;
@@ -85,6 +107,19 @@ private:
     bool renameFiles;
     String renamedPrefix;
 
+    /** Extra data directories, separated by ';', each optionally followed by '*weight'. */
+    String extraDirectories;
+    bool stripeByProcessor;
+    int preallocationSize; // MB, 0 = no preallocation
+
+    Array<File> volumeFolders;
+    Array<float> volumeWeights;
+    Array<int> channelVolume;
+
+    /** Bytes written to, and bytes reserved for, each continuous file. */
+    Array<int64> fileSize;
+    Array<int64> allocatedSize;
+
     /** Holds data that has been converted from float to int16 before
         saving.
     */
@@ -111,6 +146,7 @@ private:
     {
         String name;
         String filename;
+        String folder;
         float bitVolts;
         long int startPos;
     };
@@ -31,7 +31,7 @@
 #include "OriginalRecording.h"
 
 RecordEngine::RecordEngine()
-    : manager(nullptr)
+    : manager(nullptr), overviewEnabled(false)
 {
 }
 
@@ -85,8 +85,46 @@ void RecordEngine::configureEngine()
     if (!manager)
         return;
 
+    overviewEnabled = false;
+
     for (int i=0; i < manager->getNumParameters(); i++)
-        setParameter(manager->getParameter(i));
+    {
+        EngineParameter& parameter = manager->getParameter(i);
+
+        if (parameter.id == OVERVIEW_PARAMETER)
+        {
+            boolParameter(OVERVIEW_PARAMETER, overviewEnabled);
+        }
+        else
+        {
+            setParameter(parameter);
+        }
+    }
+}
+
+bool RecordEngine::isOverviewEnabled() const
+{
+    return overviewEnabled;
+}
+
+const RecordEngine::WriteCounters& RecordEngine::getWriteCounters() const
+{
+    return writeCounters;
+}
+
+void RecordEngine::countWrite(int64 numBytes, int64 startTicks)
+{
+    static const double microsecondsPerTick = 1.0e6 / double(Time::getHighResolutionTicksPerSecond());
+
+    const int64 microseconds = int64((Time::getHighResolutionTicks() - startTicks) * microsecondsPerTick);
+
+    int bucket = 0;
+    while (bucket < NUM_LATENCY_BUCKETS - 1 && (int64(1) << bucket) <= microseconds)
+        bucket++;
+
+    writeCounters.bytesWritten += numBytes;
+    ++writeCounters.numWrites;
+    ++writeCounters.latencyHistogram[bucket];
 }
 
 //Manager
@@ -256,15 +294,21 @@ int RecordEngineManager::getNumOfBuiltInEngines()
 
 RecordEngineManager* RecordEngineManager::createBuiltInEngineManager(int index)
 {
+    RecordEngineManager* man;
+
     switch (index)
     {
         case 0:
-            return OriginalRecording::getEngineManager();
+            man = OriginalRecording::getEngineManager();
             break;
         case 1:
-            return HDF5Recording::getEngineManager();
+            man = HDF5Recording::getEngineManager();
             break;
         default:
             return nullptr;
     }
+
+    man->addParameter(new EngineParameter(EngineParameter::BOOL, RecordEngine::OVERVIEW_PARAMETER,
+                                          "Write overview file", false));
+    return man;
 }
\ No newline at end of file
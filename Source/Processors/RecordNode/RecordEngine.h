@@ -148,6 +148,29 @@ public:
     void registerManager(RecordEngineManager* engineManager);
     void configureEngine();
 
+    /** Whether RecordNode should write a RecordOverview file next to this engine's files
+    */
+    bool isOverviewEnabled() const;
+
+    /** ID of the "Write overview file" parameter that every built-in engine manager gets
+    */
+    enum { OVERVIEW_PARAMETER = 100 };
+
+    enum { NUM_LATENCY_BUCKETS = 24 };
+
+    /** Counters sampled by RecordHealth from the message thread while the engine writes.
+        Bucket b of the latency histogram counts the writes that took less than
+        2^b microseconds (and at least 2^(b-1)); the last bucket also holds slower ones.
+    */
+    struct WriteCounters
+    {
+        Atomic<int64> bytesWritten;
+        Atomic<int64> numWrites;
+        Atomic<int> latencyHistogram[NUM_LATENCY_BUCKETS];
+    };
+
+    const WriteCounters& getWriteCounters() const;
+
 protected:
     /** Functions to access RecordNode arrays and utilities
     */
@@ -164,11 +187,18 @@ protected:
     */
     String generateDateString();
 
+    /** Counts one write of numBytes to a file, started at startTicks
+        (from Time::getHighResolutionTicks)
+    */
+    void countWrite(int64 numBytes, int64 startTicks);
+
     std::map<uint8, int>* numSamples;
     std::map<uint8, int64>* timestamps;
 
 private:
     RecordEngineManager* manager;
+    bool overviewEnabled;
+    WriteCounters writeCounters;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordEngine);
 };
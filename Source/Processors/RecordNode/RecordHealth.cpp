@@ -0,0 +1,280 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RecordHealth.h"
+
+namespace
+{
+const double bytesPerMegabyte = 1024.0 * 1024.0;
+
+String formatDuration(double seconds)
+{
+    const int minutes = int(seconds / 60.0);
+
+    if (minutes >= 60)
+        return String(minutes / 60) + " h " + String(minutes % 60) + " min";
+    else if (minutes > 0)
+        return String(minutes) + " min";
+    else
+        return String(int(seconds)) + " s";
+}
+}
+
+
+RecordHealth::Status::Status()
+    : megabytesPerSecond(0), writeLoad(0), backlogSeconds(0),
+      bytesFree(0), bytesTotal(0), secondsToFull(-1)
+{
+
+}
+
+
+RecordHealth::RecordHealth()
+    : backlog(0), lastWriteTicks(0), lastBlockMicroseconds(0),
+      lastSampleTime(0), smoothedBytesPerSecond(0)
+{
+
+}
+
+
+RecordHealth::~RecordHealth()
+{
+
+}
+
+
+void RecordHealth::addBlock(int64 ticks, double blockSeconds)
+{
+    static const double microsecondsPerTick = 1.0e6 / double(Time::getHighResolutionTicksPerSecond());
+
+    const int64 blockUs = int64(blockSeconds * 1.0e6);
+
+    // writing slower than real time for a while adds up; catching up pays it back
+    backlog = jmax(int64(0), backlog + int64(ticks * microsecondsPerTick) - blockUs);
+
+    writeTicks += ticks;
+    blockMicroseconds += blockUs;
+    backlogMicroseconds = backlog;
+}
+
+
+bool RecordHealth::update(const OwnedArray<RecordEngine>& engines, const File& dataDirectory,
+                          const File& recordingFolder, bool isRecording)
+{
+    const uint32 now = Time::getMillisecondCounter();
+
+    if (lastSampleTime != 0 && now - lastSampleTime < SAMPLE_INTERVAL_MS)
+        return false;
+
+    const double elapsed = (lastSampleTime != 0) ? (now - lastSampleTime) / 1000.0 : 0.0;
+    lastSampleTime = now;
+
+    Array<const RecordEngine*> newEngines;
+    Array<int64> newBytes;
+    Array<int> newHistograms;
+
+    status.engines.clearQuick();
+    double bytesPerSecond = 0;
+
+    for (int i = 0; i < engines.size(); i++)
+    {
+        const RecordEngine::WriteCounters& counters = engines[i]->getWriteCounters();
+        const bool known = (lastEngines[i] == engines[i]);
+
+        newEngines.add(engines[i]);
+        newBytes.add(counters.bytesWritten.get());
+
+        Array<int> histogram;
+
+        for (int b = 0; b < RecordEngine::NUM_LATENCY_BUCKETS; b++)
+        {
+            const int count = counters.latencyHistogram[b].get();
+            newHistograms.add(count);
+            histogram.add(known ? count - lastHistograms[i * RecordEngine::NUM_LATENCY_BUCKETS + b] : 0);
+        }
+
+        EngineStatus engine;
+        engine.engineID = engines[i]->getEngineID();
+        engine.megabytesPerSecond = 0;
+
+        if (known && elapsed > 0)
+        {
+            const double rate = (newBytes.getLast() - lastBytes[i]) / elapsed;
+            engine.megabytesPerSecond = rate / bytesPerMegabyte;
+            bytesPerSecond += rate;
+        }
+
+        engine.medianLatency = getLatencyPercentile(histogram, 0.5);
+        engine.p99Latency = getLatencyPercentile(histogram, 0.99);
+        engine.maxLatency = getLatencyPercentile(histogram, 1.0);
+
+        status.engines.add(engine);
+    }
+
+    lastEngines.swapWith(newEngines);
+    lastBytes.swapWith(newBytes);
+    lastHistograms.swapWith(newHistograms);
+
+    const int64 ticks = writeTicks.get();
+    const int64 blockUs = blockMicroseconds.get();
+
+    if (blockUs > lastBlockMicroseconds)
+        status.writeLoad = (ticks - lastWriteTicks) / double(Time::getHighResolutionTicksPerSecond())
+                           / ((blockUs - lastBlockMicroseconds) / 1.0e6);
+    else
+        status.writeLoad = 0;
+
+    lastWriteTicks = ticks;
+    lastBlockMicroseconds = blockUs;
+
+    status.backlogSeconds = backlogMicroseconds.get() / 1.0e6;
+    status.megabytesPerSecond = bytesPerSecond / bytesPerMegabyte;
+
+    if (dataDirectory.exists())
+    {
+        status.bytesFree = dataDirectory.getBytesFreeOnVolume();
+        status.bytesTotal = dataDirectory.getVolumeTotalSize();
+    }
+
+    if (isRecording && bytesPerSecond > 0)
+    {
+        smoothedBytesPerSecond = (smoothedBytesPerSecond > 0) ?
+                                 0.7 * smoothedBytesPerSecond + 0.3 * bytesPerSecond : bytesPerSecond;
+        status.secondsToFull = status.bytesFree / smoothedBytesPerSecond;
+    }
+    else
+    {
+        smoothedBytesPerSecond = 0;
+        status.secondsToFull = -1;
+    }
+
+    if (isRecording && elapsed > 0)
+        writeLog(recordingFolder);
+    else if (!isRecording)
+        log = nullptr;
+
+    return true;
+}
+
+
+const RecordHealth::Status& RecordHealth::getStatus() const
+{
+    return status;
+}
+
+
+String RecordHealth::getDescription() const
+{
+    String description;
+
+    description << String(status.bytesFree / (bytesPerMegabyte * 1024.0), 1) << " GB free of "
+                << String(status.bytesTotal / (bytesPerMegabyte * 1024.0), 1) << " GB";
+
+    if (status.secondsToFull >= 0)
+        description << ", full in " << formatDuration(status.secondsToFull);
+
+    description << "\nWriting " << String(status.megabytesPerSecond, 1) << " MB/s, "
+                << String(roundToInt(status.writeLoad * 100.0)) << "% of real time, backlog "
+                << String(roundToInt(status.backlogSeconds * 1000.0)) << " ms";
+
+    for (int i = 0; i < status.engines.size(); i++)
+    {
+        const EngineStatus& engine = status.engines.getReference(i);
+
+        description << "\n" << engine.engineID << ": " << String(engine.megabytesPerSecond, 1)
+                    << " MB/s, write latency p50 " << String(engine.medianLatency, 2)
+                    << " ms, p99 " << String(engine.p99Latency, 2)
+                    << " ms, max " << String(engine.maxLatency, 2) << " ms";
+    }
+
+    return description;
+}
+
+
+void RecordHealth::writeLog(const File& recordingFolder)
+{
+    if (!recordingFolder.isDirectory())
+        return;
+
+    if (log == nullptr || recordingFolder != logFolder)
+    {
+        logFolder = recordingFolder;
+
+        File logFile = recordingFolder.getChildFile("record_health.csv");
+        const bool isNew = !logFile.existsAsFile();
+
+        log = logFile.createOutputStream();
+
+        if (log == nullptr)
+            return;
+
+        if (isNew)
+            *log << "time,engine,megabytes_per_second,latency_p50_ms,latency_p99_ms,latency_max_ms,"
+                 "write_load,backlog_ms,bytes_free,seconds_to_full\n";
+    }
+
+    const String time = Time::getCurrentTime().formatted("%Y-%m-%d %H:%M:%S");
+
+    for (int i = 0; i < status.engines.size(); i++)
+    {
+        const EngineStatus& engine = status.engines.getReference(i);
+
+        *log << time << "," << engine.engineID << ","
+             << String(engine.megabytesPerSecond, 3) << ","
+             << String(engine.medianLatency, 3) << ","
+             << String(engine.p99Latency, 3) << ","
+             << String(engine.maxLatency, 3) << ","
+             << String(status.writeLoad, 3) << ","
+             << String(roundToInt(status.backlogSeconds * 1000.0)) << ","
+             << String(status.bytesFree) << ","
+             << String(roundToInt(status.secondsToFull)) << "\n";
+    }
+
+    log->flush();
+}
+
+
+double RecordHealth::getLatencyPercentile(const Array<int>& histogram, double fraction)
+{
+    int total = 0;
+
+    for (int b = 0; b < histogram.size(); b++)
+        total += histogram[b];
+
+    if (total <= 0)
+        return 0;
+
+    const int target = jmax(1, int(std::ceil(fraction * total)));
+    int cumulative = 0;
+
+    for (int b = 0; b < histogram.size(); b++)
+    {
+        cumulative += histogram[b];
+
+        // the upper edge of the bucket, so the estimate errs on the slow side
+        if (cumulative >= target)
+            return double(int64(1) << b) / 1000.0;
+    }
+
+    return double(int64(1) << (histogram.size() - 1)) / 1000.0;
+}
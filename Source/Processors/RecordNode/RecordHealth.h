@@ -0,0 +1,133 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RECORDHEALTH_H_INCLUDED
+#define RECORDHEALTH_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "RecordEngine.h"
+
+/**
+
+  Keeps track of how well the disk keeps up with a recording.
+
+  The record engines count their writes (see RecordEngine::countWrite) and the
+  RecordNode reports how long each block took to write. update() turns those
+  counters into rates at most once every SAMPLE_INTERVAL_MS, so it can be called
+  from any UI timer: per-engine MB/s, write latency percentiles, the share of
+  real time spent writing, the accumulated backlog and the projected time until
+  the data volume is full.
+
+  While recording, every sample is also appended to record_health.csv in the
+  recording folder, so that a session can be checked afterwards.
+
+  @see RecordNode, RecordEngine, ControlPanel
+
+*/
+
+class RecordHealth
+{
+public:
+    RecordHealth();
+    ~RecordHealth();
+
+    /** Called by the RecordNode, on the audio thread, after each block has been written. */
+    void addBlock(int64 writeTicks, double blockSeconds);
+
+    /** Takes a new sample if the last one is older than SAMPLE_INTERVAL_MS.
+        Returns true if the status was updated. Must be called from the message thread.
+    */
+    bool update(const OwnedArray<RecordEngine>& engines, const File& dataDirectory,
+                const File& recordingFolder, bool isRecording);
+
+    struct EngineStatus
+    {
+        String engineID;
+        double megabytesPerSecond;
+
+        /** Latencies of single file writes over the last sample, in milliseconds */
+        double medianLatency;
+        double p99Latency;
+        double maxLatency;
+    };
+
+    struct Status
+    {
+        Status();
+
+        Array<EngineStatus> engines;
+
+        double megabytesPerSecond;
+        double writeLoad;      // fraction of the data's duration spent writing it
+        double backlogSeconds; // how far the writes have fallen behind real time
+
+        int64 bytesFree;
+        int64 bytesTotal;
+
+        double secondsToFull;  // < 0 if nothing is being written
+    };
+
+    const Status& getStatus() const;
+
+    /** One line per engine, for tooltips. */
+    String getDescription() const;
+
+    enum
+    {
+        SAMPLE_INTERVAL_MS = 1000
+    };
+
+private:
+
+    void writeLog(const File& recordingFolder);
+
+    static double getLatencyPercentile(const Array<int>& histogram, double fraction);
+
+    Status status;
+
+    /** Written by the audio thread only */
+    Atomic<int64> writeTicks;
+    Atomic<int64> blockMicroseconds;
+    Atomic<int64> backlogMicroseconds;
+    int64 backlog;
+
+    /** Counter values at the previous sample */
+    Array<const RecordEngine*> lastEngines;
+    Array<int64> lastBytes;
+    Array<int> lastHistograms;
+    int64 lastWriteTicks;
+    int64 lastBlockMicroseconds;
+    uint32 lastSampleTime;
+
+    /** Write rate averaged over the last few samples, for the time-to-full estimate */
+    double smoothedBytesPerSecond;
+
+    ScopedPointer<FileOutputStream> log;
+    File logFolder;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordHealth);
+
+};
+
+
+#endif  // RECORDHEALTH_H_INCLUDED
@@ -27,6 +27,8 @@
 #include "../../UI/ControlPanel.h"
 #include "../../AccessClass.h"
 #include "RecordEngine.h"
+#include "RecordOverview.h"
+#include "RecordHealth.h"
 
 #define EVERY_ENGINE for(int eng = 0; eng < engineArray.size(); eng++) engineArray[eng]
 
@@ -58,6 +60,9 @@ RecordNode::RecordNode()
     hasRecorded = false;
     settingsNeeded = false;
 
+    overview = new RecordOverview();
+    health = new RecordHealth();
+
     // 128 inputs, 0 outputs
     setPlayConfigDetails(getNumInputs(),getNumOutputs(),44100.0,128);
 
@@ -320,6 +325,15 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
 
         EVERY_ENGINE->openFiles(rootFolder, experimentNumber, recordingNumber);
 
+        for (int eng = 0; eng < engineArray.size(); eng++)
+        {
+            if (engineArray[eng]->isOverviewEnabled())
+            {
+                overview->openFile(rootFolder, experimentNumber, recordingNumber, channelPointers);
+                break;
+            }
+        }
+
         allFilesOpened = true;
 
     }
@@ -375,6 +389,7 @@ void RecordNode::closeAllFiles()
     if (allFilesOpened)
     {
         EVERY_ENGINE->closeFiles();
+        overview->closeFile();
         allFilesOpened = false;
     }
 }
@@ -412,7 +427,22 @@ bool RecordNode::disable()
 
 float RecordNode::getFreeSpace()
 {
-    return 1.0f - float(dataDirectory.getBytesFreeOnVolume())/float(dataDirectory.getVolumeTotalSize());
+    const RecordHealth::Status& status = health->getStatus();
+
+    if (status.bytesTotal <= 0)
+        return 0.0f;
+
+    return 1.0f - float(status.bytesFree)/float(status.bytesTotal);
+}
+
+bool RecordNode::updateHealth()
+{
+    return health->update(engineArray, dataDirectory, rootFolder, isRecording);
+}
+
+const RecordHealth& RecordNode::getHealth() const
+{
+    return *health;
 }
 
 
@@ -445,7 +475,19 @@ void RecordNode::process(AudioSampleBuffer& buffer,
         // SECOND: write channel data
         if (channelPointers.size() > 0)
         {
+            const int64 startTicks = Time::getHighResolutionTicks();
+
             EVERY_ENGINE->writeData(buffer);
+
+            if (overview->isOpen())
+                overview->writeData(buffer, numSamples);
+
+            Channel* ch = channelPointers[0];
+            health->addBlock(Time::getHighResolutionTicks() - startTicks,
+                             numSamples[ch->sourceNodeId] / ch->sampleRate);
+
+            if (numSamples[ch->sourceNodeId] > 0)
+                recordOutputLatency();
         }
 
         //  std::cout << nSamples << " " << samplesWritten << " " << blockIndex << std::endl;
@@ -492,7 +534,7 @@ int RecordNode::addSpikeElectrode(SpikeRecordInfo* elec)
     return spikeElectrodeIndex++;
 }
 
-void RecordNode::writeSpike(SpikeObject& spike, int electrodeIndex)
+void RecordNode::writeSpike(const SpikeObject& spike, int electrodeIndex)
 {
     EVERY_ENGINE->writeSpike(spike,electrodeIndex);
 }
@@ -38,6 +38,8 @@
 struct SpikeRecordInfo;
 struct SpikeObject;
 class RecordEngine;
+class RecordOverview;
+class RecordHealth;
 
 /**
 
@@ -94,11 +96,18 @@ public:
     */
     Channel* getDataChannel(int index);
 
-    /** Called by the ControlPanel to determine the amount of space
-        left in the current dataDirectory.
+    /** Returns the fraction of the dataDirectory's volume that is in use,
+        as of the last RecordHealth sample.
     */
     float getFreeSpace();
 
+    /** Called periodically by the ControlPanel to sample the RecordHealth counters.
+        Returns true if a new sample was taken.
+    */
+    bool updateHealth();
+
+    const RecordHealth& getHealth() const;
+
     /** Selects a channel relative to a particular processor with ID = id
     */
     void setChannel(Channel* ch);
@@ -151,7 +160,7 @@ public:
 
     /** Called by a spike recording source to write a spike to file
     */
-    void writeSpike(SpikeObject& spike, int electrodeIndex);
+    void writeSpike(const SpikeObject& spike, int electrodeIndex);
 
     SpikeRecordInfo* getSpikeElectrode(int index);
 
@@ -244,6 +253,12 @@ private:
     /**RecordEngines loaded**/
     OwnedArray<RecordEngine> engineArray;
 
+    /** Min/max/mean overview of the recorded channels, if an engine asks for one */
+    ScopedPointer<RecordOverview> overview;
+
+    /** Write rates, latencies and disk space of the current recording */
+    ScopedPointer<RecordHealth> health;
+
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordNode);
 
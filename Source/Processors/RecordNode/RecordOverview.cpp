@@ -0,0 +1,309 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RecordOverview.h"
+
+
+RecordOverview::RecordOverview()
+    : file(nullptr), fileOffset(0)
+{
+
+}
+
+
+RecordOverview::~RecordOverview()
+{
+    closeFile();
+}
+
+
+bool RecordOverview::isOpen() const
+{
+    return file != nullptr;
+}
+
+
+bool RecordOverview::openFile(File rootFolder, int experimentNumber, int recordingNumber,
+                              const Array<Channel*>& channels)
+{
+    closeFile();
+
+    overviews.clear();
+
+    for (int i = 0; i < channels.size(); i++)
+    {
+        if (!channels[i]->getRecordState())
+            continue;
+
+        ChannelOverview* c = overviews.add(new ChannelOverview());
+        c->bufferIndex = i;
+        c->sourceNodeId = channels[i]->sourceNodeId;
+
+        for (int l = 0; l < NUM_LEVELS; l++)
+        {
+            Level& level = c->levels[l];
+            level.min = level.max = 0;
+            level.sum = 0;
+            level.count = 0;
+            level.points.malloc(CHUNK_POINTS * 3);
+            level.numBuffered = 0;
+            level.numPoints = 0;
+        }
+    }
+
+    if (overviews.size() == 0)
+        return false;
+
+    String fileName = "overview";
+
+    if (experimentNumber > 1)
+        fileName += "_" + String(experimentNumber);
+
+    fileName += "_" + String(recordingNumber) + ".overview";
+
+    String fullPath = rootFolder.getFullPathName() + rootFolder.separatorString + fileName;
+
+    file = fopen(fullPath.toUTF8(), "wb");
+
+    if (file == nullptr)
+    {
+        std::cout << "Could not open overview file " << fullPath << std::endl;
+        overviews.clear();
+        return false;
+    }
+
+    fileOffset = 0;
+
+    uint8 header[OVERVIEW_HEADER_SIZE];
+    zeromem(header, sizeof(header));
+
+    const uint32 values[6] = { OVERVIEW_VERSION, (uint32) overviews.size(), NUM_LEVELS,
+                               CHUNK_POINTS, BASE_DECIMATION, LEVEL_FACTOR };
+
+    memcpy(header, "OEOVRVW", 8);
+    memcpy(header + 8, values, sizeof(values));
+    write(header, sizeof(header));
+
+    for (int i = 0; i < overviews.size(); i++)
+    {
+        Channel* ch = channels[overviews[i]->bufferIndex];
+
+        uint8 entry[CHANNEL_ENTRY_SIZE];
+        zeromem(entry, sizeof(entry));
+
+        const uint32 recordIndex = (uint32) overviews[i]->bufferIndex;
+        memcpy(entry, &recordIndex, 4);
+        memcpy(entry + 4, &ch->sampleRate, 4);
+        memcpy(entry + 8, &ch->bitVolts, 4);
+        ch->getName().copyToUTF8((CharPointer_UTF8::CharType*) (entry + 12), 52);
+
+        write(entry, sizeof(entry));
+    }
+
+    return true;
+}
+
+
+void RecordOverview::writeData(const AudioSampleBuffer& buffer, std::map<uint8, int>& numSamples)
+{
+    if (file == nullptr)
+        return;
+
+    for (int i = 0; i < overviews.size(); i++)
+    {
+        const ChannelOverview* c = overviews[i];
+
+        if (c->bufferIndex >= buffer.getNumChannels())
+            continue;
+
+        addSamples(i, buffer.getReadPointer(c->bufferIndex), numSamples[c->sourceNodeId]);
+    }
+}
+
+
+void RecordOverview::addSamples(int channel, const float* samples, int numSamples)
+{
+    Level& level = overviews[channel]->levels[0];
+
+    while (numSamples > 0)
+    {
+        const int numToAdd = jmin(numSamples, BASE_DECIMATION - level.count);
+
+        const Range<float> range = FloatVectorOperations::findMinAndMax(samples, numToAdd);
+
+        float sum = 0;
+
+        for (int n = 0; n < numToAdd; n++)
+            sum += samples[n];
+
+        if (level.count == 0)
+        {
+            level.min = range.getStart();
+            level.max = range.getEnd();
+            level.sum = 0;
+        }
+        else
+        {
+            level.min = jmin(level.min, range.getStart());
+            level.max = jmax(level.max, range.getEnd());
+        }
+
+        level.sum += sum;
+        level.count += numToAdd;
+
+        samples += numToAdd;
+        numSamples -= numToAdd;
+
+        if (level.count == BASE_DECIMATION)
+            finishPoint(channel, 0);
+    }
+}
+
+
+void RecordOverview::addPoint(int channel, int levelIndex, float min, float max, float mean)
+{
+    Level& level = overviews[channel]->levels[levelIndex];
+
+    if (level.count == 0)
+    {
+        level.min = min;
+        level.max = max;
+        level.sum = 0;
+    }
+    else
+    {
+        level.min = jmin(level.min, min);
+        level.max = jmax(level.max, max);
+    }
+
+    level.sum += mean;
+    level.count++;
+
+    if (level.count == LEVEL_FACTOR)
+        finishPoint(channel, levelIndex);
+}
+
+
+void RecordOverview::finishPoint(int channel, int levelIndex)
+{
+    Level& level = overviews[channel]->levels[levelIndex];
+
+    const float mean = float(level.sum / level.count);
+
+    float* point = level.points + level.numBuffered * 3;
+    point[0] = level.min;
+    point[1] = level.max;
+    point[2] = mean;
+
+    level.count = 0;
+    level.numBuffered++;
+
+    if (level.numBuffered == CHUNK_POINTS)
+        writeChunk(channel, levelIndex);
+
+    if (levelIndex + 1 < NUM_LEVELS)
+        addPoint(channel, levelIndex + 1, point[0], point[1], mean);
+}
+
+
+void RecordOverview::writeChunk(int channel, int levelIndex)
+{
+    Level& level = overviews[channel]->levels[levelIndex];
+
+    if (level.numBuffered == 0)
+        return;
+
+    level.chunkOffsets.add(fileOffset);
+
+    uint8 header[CHUNK_HEADER_SIZE];
+    zeromem(header, sizeof(header));
+
+    const uint32 ids[2] = { (uint32) channel, (uint32) levelIndex };
+    const uint64 firstPoint = (uint64) level.numPoints;
+    const uint32 numPoints = (uint32) level.numBuffered;
+
+    memcpy(header, ids, sizeof(ids));
+    memcpy(header + 8, &firstPoint, 8);
+    memcpy(header + 16, &numPoints, 4);
+
+    write(header, sizeof(header));
+    write(level.points, level.numBuffered * 3 * sizeof(float));
+
+    level.numPoints += level.numBuffered;
+    level.numBuffered = 0;
+}
+
+
+void RecordOverview::closeFile()
+{
+    if (file == nullptr)
+        return;
+
+    // flush the incomplete points, finest level first so that they still reach the coarser levels
+    for (int i = 0; i < overviews.size(); i++)
+    {
+        for (int l = 0; l < NUM_LEVELS; l++)
+        {
+            if (overviews[i]->levels[l].count > 0)
+                finishPoint(i, l);
+
+            writeChunk(i, l);
+        }
+    }
+
+    const uint64 indexOffset = (uint64) fileOffset;
+
+    for (int i = 0; i < overviews.size(); i++)
+    {
+        for (int l = 0; l < NUM_LEVELS; l++)
+        {
+            const Level& level = overviews[i]->levels[l];
+
+            const uint64 numPoints = (uint64) level.numPoints;
+            write(&numPoints, 8);
+
+            for (int k = 0; k < level.chunkOffsets.size(); k++)
+            {
+                const uint64 offset = (uint64) level.chunkOffsets[k];
+                write(&offset, 8);
+            }
+        }
+    }
+
+    // the index is only referenced once it is complete
+    fflush(file);
+    fseek(file, 32, SEEK_SET);
+    fwrite(&indexOffset, 8, 1, file);
+
+    fclose(file);
+    file = nullptr;
+
+    overviews.clear();
+}
+
+
+void RecordOverview::write(const void* data, size_t numBytes)
+{
+    fwrite(data, 1, numBytes, file);
+    fileOffset += numBytes;
+}
@@ -0,0 +1,149 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RECORDOVERVIEW_H_INCLUDED
+#define RECORDOVERVIEW_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Channel/Channel.h"
+
+#include <stdio.h>
+#include <map>
+
+/**
+
+  Writes a min/max/mean overview of every recorded channel while recording.
+
+  Each point of level 0 summarizes BASE_DECIMATION samples, and each point of
+  level n summarizes LEVEL_FACTOR points of level n-1. A viewer can therefore
+  show any span of a long recording by reading a few thousand points from the
+  coarsest level that still has enough resolution, instead of the raw data.
+
+  The overview of a recording is written next to the record engine's files, as
+  overview[_experiment]_recording.overview. All values are little-endian.
+
+  Header (64 bytes):
+     0  char    magic[8]       "OEOVRVW\0"
+     8  uint32  version        currently 1
+    12  uint32  numChannels
+    16  uint32  numLevels
+    20  uint32  chunkPoints    points per chunk
+    24  uint32  baseDecimation samples per level-0 point
+    28  uint32  levelFactor    points of level n-1 per point of level n
+    32  uint64  indexOffset    byte offset of the chunk index, 0 until the file is closed
+
+  Channel table, numChannels entries of 64 bytes:
+      uint32 recordIndex (index in the RecordNode's channel list), float32 sampleRate,
+      float32 bitVolts, char name[52]
+
+  Chunks, in the order they were completed:
+      uint32 channel, uint32 level, uint64 firstPoint, uint32 numPoints, uint32 reserved,
+      then numPoints x (float32 min, float32 max, float32 mean) in microvolts
+
+  Every chunk except the last one of each channel and level holds chunkPoints points.
+  The last point of a level may summarize fewer samples than the others.
+
+  Chunk index, for every channel and then every level:
+      uint64 numPoints, followed by one uint64 file offset per chunk
+
+  If the index is missing (indexOffset = 0), the chunks can still be found by
+  walking them from the end of the channel table.
+
+  @see RecordNode, RecordEngine
+
+*/
+
+class RecordOverview
+{
+public:
+    RecordOverview();
+    ~RecordOverview();
+
+    /** Creates the overview file of a recording, for the channels whose record state is on. */
+    bool openFile(File rootFolder, int experimentNumber, int recordingNumber,
+                  const Array<Channel*>& channels);
+
+    /** Summarizes the next block of data; channels are laid out as for RecordEngine::writeData(). */
+    void writeData(const AudioSampleBuffer& buffer, std::map<uint8, int>& numSamples);
+
+    /** Writes the incomplete points and the chunk index, then closes the file. */
+    void closeFile();
+
+    bool isOpen() const;
+
+    enum
+    {
+        NUM_LEVELS = 3,
+        BASE_DECIMATION = 1024,
+        LEVEL_FACTOR = 16,
+        CHUNK_POINTS = 256,
+        OVERVIEW_HEADER_SIZE = 64,
+        CHANNEL_ENTRY_SIZE = 64,
+        CHUNK_HEADER_SIZE = 24,
+        OVERVIEW_VERSION = 1
+    };
+
+private:
+
+    struct Level
+    {
+        // point being accumulated
+        float min, max;
+        double sum;
+        int count;
+
+        // completed points not yet written, as (min, max, mean) triplets
+        HeapBlock<float> points;
+        int numBuffered;
+        int64 numPoints;
+
+        Array<int64> chunkOffsets;
+    };
+
+    struct ChannelOverview
+    {
+        int bufferIndex;
+        int sourceNodeId;
+        Level levels[NUM_LEVELS];
+    };
+
+    void addSamples(int channel, const float* samples, int numSamples);
+    void addPoint(int channel, int level, float min, float max, float mean);
+
+    /** Moves the point being accumulated into the level's chunk and on to the next level. */
+    void finishPoint(int channel, int level);
+    void writeChunk(int channel, int level);
+
+    void write(const void* data, size_t numBytes);
+
+    OwnedArray<ChannelOverview> overviews;
+
+    FILE* file;
+    int64 fileOffset;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordOverview);
+
+};
+
+
+#endif  // RECORDOVERVIEW_H_INCLUDED
@@ -23,26 +23,30 @@
 
 #include "ResamplingNode.h"
 #include "ResamplingNodeEditor.h"
+#include "../../AccessClass.h"
+#include "../../Audio/AudioComponent.h"
 
 #include <stdio.h>
 
+// anti-aliasing cutoff, as a fraction of the lower of the two Nyquist frequencies
+#define CUTOFF_RATIO 0.8
+
 ResamplingNode::ResamplingNode()
     : GenericProcessor("Resampler"),
-      targetSampleRate(5000.0f), ratio(1.0)
+      targetSampleRate(5000.0f), sourceBufferSampleRate(0), ratio(1.0),
+      interpolation(1), decimation(1), tapsPerPhase(0), historyChannels(0),
+      lineSize(0), nextOutputPosition(0), pendingOutput(1, 1024), numPending(0),
+      droppedSamples(0), outputSamplesWritten(0),
+      firstOutputTimestamp(0), haveFirstTimestamp(false)
 {
 
-    filter = new Dsp::SmoothedFilterDesign
-    <Dsp::RBJ::Design::LowPass, 1> (1024);
-
     parameters.add(Parameter("Hz",500.0f, 10000.0f, targetSampleRate, 0, true));
 
-    tempBuffer = new AudioSampleBuffer(16, TEMP_BUFFER_WIDTH);
-
 }
 
 ResamplingNode::~ResamplingNode()
 {
-    filter = 0;
+
 }
 
 AudioProcessorEditor* ResamplingNode::createEditor()
@@ -65,31 +69,46 @@ void ResamplingNode::setParameter(int parameterIndex, float newValue)
 
         targetSampleRate = newValue;
 
-        settings.sampleRate = targetSampleRate;
+        updateFilter();
 
-        ratio = sourceBufferSampleRate / targetSampleRate;
+        settings.sampleRate = sourceBufferSampleRate / ratio;
 
         for (int i = 0; i < channels.size(); i++)
         {
-            channels[i]->sampleRate = targetSampleRate;
+            channels[i]->sampleRate = settings.sampleRate;
         }
 
-        updateFilter();
-
         //std::cout << "Got parameter update." << std::endl;
     }
 
-    //std::cout << float(p[0]) << std::endl;
-
 }
 
 bool ResamplingNode::enable()
 {
 
+    updateFilter();
+    allocateBuffers();
 
-    tempBuffer->clear();
+    history.clear(historyChannels * (tapsPerPhase - 1));
 
-    updateFilter();
+    nextOutputPosition = 0;
+    outputSamplesWritten = 0;
+    haveFirstTimestamp = false;
+
+    numPending = 0;
+    pendingEvents.clear();
+    droppedSamples = 0;
+
+    return true;
+
+}
+
+bool ResamplingNode::disable()
+{
+
+    if (droppedSamples > 0)
+        CoreServices::sendStatusMessage("Resampler: " + String(droppedSamples)
+                                        + " samples did not fit the buffer and were dropped");
 
     return true;
 
@@ -99,137 +118,273 @@ void ResamplingNode::updateSettings()
 {
 
     sourceBufferSampleRate = settings.sampleRate;
-    settings.sampleRate = targetSampleRate;
 
-    if (getNumInputs() > 0)
-        tempBuffer->setSize(getNumInputs(), TEMP_BUFFER_WIDTH);
+    updateFilter();
+    allocateBuffers();
 
-    ratio = sourceBufferSampleRate / targetSampleRate;
+    settings.sampleRate = sourceBufferSampleRate / ratio;
 
     for (int i = 0; i < channels.size(); i++)
     {
-        channels[i]->sampleRate = targetSampleRate;
+        channels[i]->sampleRate = settings.sampleRate;
     }
 
-    updateFilter();
+}
+
+
+void ResamplingNode::allocateBuffers()
+{
+    int maxBlock = 1024;
+
+    if (AccessClass::getAudioComponent() != nullptr)
+        maxBlock = jmax(maxBlock, AccessClass::getAudioComponent()->getBufferSize());
 
+    // a buffer's worth of carried outputs plus everything one full block can produce
+    const int maxOutputs = int((int64(maxBlock) * interpolation + decimation - 1) / decimation) + 1;
+
+    pendingOutput.setSize(jmax(1, historyChannels), maxBlock + maxOutputs);
+    numPending = 0;
+
+    if (lineSize < tapsPerPhase - 1 + maxBlock)
+    {
+        lineSize = tapsPerPhase - 1 + maxBlock;
+        line.malloc(lineSize);
+    }
 }
 
 
 void ResamplingNode::updateFilter()
 {
 
-    double cutoffFreq = (ratio > 1.0) ? 2 * targetSampleRate  // downsample
-                        : targetSampleRate / 2; // upsample
+    int sourceRate = roundToInt(sourceBufferSampleRate);
+    int targetRate = roundToInt(targetSampleRate);
+
+    if (sourceRate <= 0 || targetRate <= 0)
+    {
+        sourceRate = 1;
+        targetRate = 1;
+    }
 
-    double sampleFreq = (ratio > 1.0) ? sourceBufferSampleRate // downsample
-                        : targetSampleRate;  // upsample
+    // reduce the ratio to L/M; very awkward ratios are approximated
+    int a = sourceRate, b = targetRate;
 
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
+    while (b != 0)
+    {
+        const int t = a % b;
+        a = b;
+        b = t;
+    }
 
-    filter->setParams(params);
+    interpolation = targetRate / a;
+    decimation = sourceRate / a;
 
-}
+    if (interpolation > MAX_INTERPOLATION)
+    {
+        interpolation = MAX_INTERPOLATION;
+        decimation = jmax(1, roundToInt(double(sourceRate) / targetRate * MAX_INTERPOLATION));
 
-// void ResamplingNode::releaseResources()
-// {
-// 	//fclose(file);
-// }
+        a = interpolation;
+        b = decimation;
+
+        while (b != 0)
+        {
+            const int t = a % b;
+            a = b;
+            b = t;
+        }
+
+        interpolation /= a;
+        decimation /= a;
+    }
+
+    ratio = double(decimation) / interpolation;
+
+    // Blackman-windowed sinc, designed at the upsampled rate (source rate * L)
+    const int factor = jmax(interpolation, decimation);
+    const int numTaps = 2 * ZERO_CROSSINGS * factor + 1;
+    const double cutoff = CUTOFF_RATIO * 0.5 / factor; // cycles per upsampled sample
+    const double centre = (numTaps - 1) / 2.0;
+
+    // pad every phase to a multiple of 8 taps so the dot products vectorize cleanly
+    const int newTapsPerPhase = ((numTaps + interpolation - 1) / interpolation + 7) & ~7;
+
+    coefficients.calloc(interpolation * newTapsPerPhase);
+
+    for (int i = 0; i < numTaps; i++)
+    {
+        const double x = 2.0 * cutoff * (i - centre);
+        const double sinc = (std::abs(x) < 1e-9) ? 1.0 : std::sin(double_Pi * x) / (double_Pi * x);
+        const double window = 0.42 - 0.5 * std::cos(2.0 * double_Pi * i / (numTaps - 1))
+                              + 0.08 * std::cos(4.0 * double_Pi * i / (numTaps - 1));
+
+        // tap i multiplies input sample (n - i / L) for phase i % L
+        const int p = i % interpolation;
+        const int k = i / interpolation;
+
+        coefficients[p * newTapsPerPhase + (newTapsPerPhase - 1 - k)] =
+            (float)(interpolation * 2.0 * cutoff * sinc * window);
+    }
+
+    if (newTapsPerPhase != tapsPerPhase || historyChannels != getNumInputs())
+    {
+        tapsPerPhase = newTapsPerPhase;
+        historyChannels = getNumInputs();
+        history.calloc(jmax(1, historyChannels * (tapsPerPhase - 1)));
+        lineSize = 0;
+    }
+
+}
 
 void ResamplingNode::process(AudioSampleBuffer& buffer,
                              MidiBuffer& midiMessages)
 {
 
-    //std::cout << "Resampling node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
+    if (getNumInputs() == 0 || interpolation == decimation)
+        return;
 
-    // save data at the beginning of each round of processing
-    //writeContinuousBuffer(buffer.getSampleData(0), nSamples, 0);
+    const int nSamples = getNumSamples(0);
+    const int64 inputLength = int64(nSamples) * interpolation;
+    const int numChannels = jmin(buffer.getNumChannels(), historyChannels);
+    const int historyLength = tapsPerPhase - 1;
 
-    int nSamples = 100; // SOME NUMBER
+    // outputs fall on multiples of M in units of 1/L input samples
+    int numOutputs = 0;
 
-    int nSamps = float(nSamples);
-    int valuesNeeded = int(nSamps / ratio);
+    if (nextOutputPosition < inputLength)
+        numOutputs = int((inputLength - nextOutputPosition + decimation - 1) / decimation);
 
-    if (ratio > 1.0001)
+    // outputs that don't fit are carried into the next block, at most a buffer's worth
+    const int capacity = buffer.getNumSamples();
+    const int numTotal = numPending + numOutputs;
+    const int numWritten = jmin(numTotal, capacity);
+    const int numKept = jmin(numTotal - numWritten, capacity);
+
+    // allocateBuffers() leaves room for any block up to the device's buffer size
+    if (numTotal > pendingOutput.getNumSamples() || numChannels > pendingOutput.getNumChannels())
+        pendingOutput.setSize(jmax(numChannels, pendingOutput.getNumChannels()),
+                              jmax(numTotal, pendingOutput.getNumSamples()), true, false, true);
+
+    if (lineSize < historyLength + nSamples)
     {
-        // pre-apply filter before downsampling
-        filter->process(nSamples, buffer.getArrayOfWritePointers());
+        lineSize = historyLength + jmax(nSamples, buffer.getNumSamples());
+        line.malloc(lineSize);
     }
 
-    // initialize variables
-    tempBuffer->clear();
-    int sourceBufferPos = 0;
-    int sourceBufferSize = buffer.getNumSamples();
-    float subSampleOffset = 0.0;
-    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-
-    int tempBufferPos;
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* channelHistory = history + channel * historyLength;
+        float* out = buffer.getWritePointer(channel);
 
-    // code modified from "juce_ResamplingAudioSource.cpp":
+        FloatVectorOperations::copy(line, channelHistory, historyLength);
+        FloatVectorOperations::copy(line + historyLength, out, nSamples);
 
-    for (tempBufferPos = 0; tempBufferPos < valuesNeeded; tempBufferPos++)
-    {
-        float gain = 1.0;
-        float alpha = (float) subSampleOffset;
-        float invAlpha = 1.0f - alpha;
+        float* pending = pendingOutput.getWritePointer(channel);
+        int64 position = nextOutputPosition;
 
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        for (int m = numPending; m < numTotal; m++, position += decimation)
         {
+            const int n = int(position / interpolation);
+            const float* coeff = coefficients + int(position % interpolation) * tapsPerPhase;
+            const float* x = line + n;
 
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,  // destSampleOffset
-                                buffer,			// source
-                                channel,		// sourceChannel
-                                sourceBufferPos,// sourceSampleOffset
-                                1,				// number of samples
-                                invAlpha*gain);      // gain to apply to source
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,   // destSampleOffset
-                                buffer,			// source
-                                channel,			// sourceChannel
-                                nextPos,		 	// sourceSampleOffset
-                                1,				// number of samples
-                                alpha*gain);     	 // gain to apply to source
+            float acc[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
 
-        }
+            for (int k = 0; k < tapsPerPhase; k += 8)
+                for (int l = 0; l < 8; l++)
+                    acc[l] += coeff[k + l] * x[k + l];
 
-        subSampleOffset += ratio;
+            pending[m] = ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+        }
 
-        while (subSampleOffset >= 1.0)
-        {
-            if (++sourceBufferPos >= sourceBufferSize)
-                sourceBufferPos = 0;
+        FloatVectorOperations::copy(out, pending, numWritten);
+        memmove(pending, pending + numWritten, numKept * sizeof(float));
 
-            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-            subSampleOffset -= 1.0;
-        }
+        FloatVectorOperations::copy(channelHistory, line + nSamples, historyLength);
     }
 
-    // std::cout << sourceBufferPos << " " << tempBufferPos << std::endl;
+    updateEvents(midiMessages, numPending, numWritten);
 
+    droppedSamples += numTotal - numWritten - numKept;
+    numPending = numKept;
 
-    if (ratio < 0.9999)
-    {
+    nextOutputPosition += int64(numOutputs) * decimation - inputLength;
+    outputSamplesWritten += numWritten;
 
-        filter->process(tempBufferPos, tempBuffer->getArrayOfWritePointers());
-        // apply the filter after upsampling
-        ///////filter->process (totalSamples, buffer.getArrayOfChannels());
+}
+
+void ResamplingNode::updateEvents(MidiBuffer& midiMessages, int outputOffset, int numOutputSamples)
+{
+    if (!haveFirstTimestamp)
+    {
+        firstOutputTimestamp = getTimestamp(0) * interpolation / decimation;
+        haveFirstTimestamp = true;
     }
-    else if (ratio <= 1.0001)
+
+    MidiBuffer resampled;
+    MidiBuffer carried;
+    const uint8* dataptr;
+    int dataSize;
+    int samplePosition;
+
+    // events of carried outputs first, then this block's, each moved to the first
+    // output sample at or after its input sample; those past the buffer wait too
+    MidiBuffer::Iterator p(pendingEvents);
+
+    while (p.getNextEvent(dataptr, dataSize, samplePosition))
     {
+        if (samplePosition < numOutputSamples)
+            resampled.addEvent(dataptr, dataSize, samplePosition);
+        else
+            carried.addEvent(dataptr, dataSize, samplePosition - numOutputSamples);
+    }
 
-        // no resampling is being applied, no need to filter, BUT...
-        // keep the filter stoked with samples to avoid discontinuities
+    MidiBuffer::Iterator i(midiMessages);
+
+    while (i.getNextEvent(dataptr, dataSize, samplePosition))
+    {
+        const int64 position = int64(samplePosition) * interpolation - nextOutputPosition;
+        const int outputPosition = outputOffset + (position <= 0 ? 0 : int((position + decimation - 1) / decimation));
 
+        if (outputPosition < numOutputSamples || numOutputSamples == 0)
+            resampled.addEvent(dataptr, dataSize, jmax(0, jmin(outputPosition, numOutputSamples - 1)));
+        else
+            carried.addEvent(dataptr, dataSize, outputPosition - numOutputSamples);
     }
 
-    // copy the tempBuffer back into the original buffer
-    buffer = AudioSampleBuffer(tempBuffer->getArrayOfWritePointers(), 2, tempBufferPos);//buffer.getNumSamples());
+    pendingEvents.swapWith(carried);
 
-    nSamples = valuesNeeded;
+    // announce the new buffer size and timestamp on behalf of every source we resample;
+    // these come after the original ones, so they take precedence downstream
+    const int64 timestamp = firstOutputTimestamp + outputSamplesWritten;
+    Array<int> sources;
+
+    for (int ch = 0; ch < getNumInputs(); ch++)
+        sources.addIfNotAlreadyThere(channels[ch]->sourceNodeId);
+
+    for (int s = 0; s < sources.size(); s++)
+    {
+        const uint8 sourceNodeId = (uint8) sources[s];
+        const int16 si = (int16) numOutputSamples;
+
+        uint8 sizeData[4];
+        sizeData[0] = BUFFER_SIZE;
+        sizeData[1] = sourceNodeId;
+        memcpy(sizeData + 2, &si, 2);
+        resampled.addEvent(sizeData, 4, 0);
+
+        const int64 ingestionTicks = getIngestionTicks();
+
+        uint8 timestampData[22];
+        timestampData[0] = TIMESTAMP;
+        timestampData[1] = sourceNodeId;
+        timestampData[2] = sourceNodeId;
+        timestampData[3] = 0;
+        timestampData[4] = 1;
+        timestampData[5] = sourceNodeId;
+        memcpy(timestampData + 6, &timestamp, 8);
+        memcpy(timestampData + 14, &ingestionTicks, 8);
+        resampled.addEvent(timestampData, 22, 0);
+    }
 
+    midiMessages.swapWith(resampled);
 }
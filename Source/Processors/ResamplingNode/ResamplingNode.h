@@ -26,16 +26,28 @@
 
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
-#include "../Dsp/Dsp.h"
 #include "../GenericProcessor/GenericProcessor.h"
 
-#define TEMP_BUFFER_WIDTH 5000
-
 /**
 
   Changes the sample rate of continuous data.
 
-  Code is based on Juce's ResamplingAudioSource class.
+  The conversion ratio is reduced to a fraction L/M (e.g. 30000 Hz -> 2500 Hz
+  is 1/12) and applied with a polyphase FIR filter: only the output samples are
+  computed, each as a dot product of one of L precomputed coefficient phases
+  with the most recent input samples. Every channel keeps the tail of the
+  previous block as history, so blocks join without discontinuities.
+
+  The anti-aliasing filter is a Blackman-windowed sinc with a cutoff at
+  CUTOFF_RATIO times the lower of the two Nyquist frequencies. Its group delay
+  is half its length (ZERO_CROSSINGS input samples when downsampling).
+
+  Downstream processors receive the new buffer size and timestamps (in output
+  samples) for every source feeding the resampler, and event positions are
+  mapped onto the output samples. When upsampling produces more samples than
+  the processing buffer holds, the rest (and their events) are carried into the
+  next block, up to one buffer's worth; beyond that they are dropped and
+  reported when acquisition stops.
 
   @see GenericProcessor
 
@@ -55,9 +67,11 @@ public:
 
     void updateSettings();
 
+    /** Recomputes the conversion ratio and the polyphase coefficient table. */
     void updateFilter();
 
     bool enable();
+    bool disable();
 
     AudioProcessorEditor* createEditor();
     bool hasEditor() const
@@ -67,24 +81,55 @@ public:
 
 private:
 
+    /** Rewrites the buffer size, timestamp and event positions for the output rate.
+        The block's new outputs start at outputOffset, after the carried ones. */
+    void updateEvents(MidiBuffer& midiMessages, int outputOffset, int numOutputSamples);
+
+    /** Sizes the pending outputs and the filter line for the device's buffer size and
+        the current ratio, so that process() doesn't have to allocate. */
+    void allocateBuffers();
+
+    enum
+    {
+        MAX_INTERPOLATION = 256,
+        ZERO_CROSSINGS = 10
+    };
+
     // sample rate, timebase, and ratio info:
     double targetSampleRate;
-    double sourceBufferSampleRate; //, destBufferSampleRate;
-    double ratio; //, lastRatio;
-    //double destBufferTimebaseSecs;
-    //int destBufferWidth;
-
-    // major objects:
-    Dsp::Filter* filter;
-    //ScopedPointer<AudioSampleBuffer> destBuffer;
-    ScopedPointer<AudioSampleBuffer> tempBuffer;
-
-    // is the destBuffer a temp buffer or not?
-    //bool destBufferIsTempBuffer;
-    //bool isTransmitting;
-
-    // indexing objects that persist between rounds:
-    //int destBufferPos;
+    double sourceBufferSampleRate;
+    double ratio;
+
+    /** Upsampling (L) and downsampling (M) factors. */
+    int interpolation;
+    int decimation;
+
+    /** Coefficients per phase; phase p starts at coefficients[p * tapsPerPhase]
+        and is stored in reverse so it lines up with consecutive input samples. */
+    HeapBlock<float> coefficients;
+    int tapsPerPhase;
+
+    /** Last (tapsPerPhase - 1) input samples of every channel. */
+    HeapBlock<float> history;
+    int historyChannels;
+
+    /** History followed by the current block, for one channel at a time. */
+    HeapBlock<float> line;
+    int lineSize;
+
+    /** Position of the next output sample, in units of 1/L input samples,
+        relative to the start of the next block. */
+    int64 nextOutputPosition;
+
+    /** Outputs computed but not yet written, per channel, and the events that go with them */
+    AudioSampleBuffer pendingOutput;
+    int numPending;
+    MidiBuffer pendingEvents;
+    int droppedSamples;
+
+    int64 outputSamplesWritten;
+    int64 firstOutputTimestamp;
+    bool haveFirstTimestamp;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResamplingNode);
 
@@ -28,12 +28,15 @@
 const int SerialInput::BAUDRATES[12] = {300, 1200, 2400, 4800, 9600, 14400, 19200, 28800, 38400, 57600, 115200, 230400};
 
 SerialInput::SerialInput()
-    : GenericProcessor("Serial Port"), baudrate(0)
+    : GenericProcessor("Serial Port"), baudrate(0),
+      reader("Serial Port", this, nullptr, POLL_INTERVAL_MS), fifo(FIFO_SIZE), errorReported(false)
 {
+    fifoData.malloc(FIFO_SIZE);
 }
 
 SerialInput::~SerialInput()
 {
+    reader.stop();
     serial.close();
 }
 
@@ -83,49 +86,117 @@ bool SerialInput::isReady()
     return true;
 }
 
+bool SerialInput::enable()
+{
+    fifo.reset();
+    readError = 0;
+    errorReported = false;
+
+    reader.start();
+    return true;
+}
+
 bool SerialInput::disable()
 {
+    reader.stop();
     serial.close();
     return true;
 }
 
+void SerialInput::execute(const DeviceCommand&)
+{
 
-void SerialInput::process(AudioSampleBuffer&, MidiBuffer& events)
+}
+
+void SerialInput::poll()
 {
+    if (readError.get() != 0)
+        return;
+
     int bytesAvailable = serial.available();
 
     if (bytesAvailable == OF_SERIAL_ERROR)
     {
-        // ToDo: Properly warn about problem here!
-        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SerialInput device access error!", "Could not access serial device.");
+        readError = 1;
         return;
     }
 
-    if (bytesAvailable > 0)
+    while (bytesAvailable > 0)
     {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(bytesAvailable, start1, size1, start2, size2);
+
+        // if the audio thread falls behind, the bytes stay in the driver's buffer
+        if (size1 == 0)
+            return;
 
-        unsigned char buffer[10000];
-        int bytesRead = serial.readBytes(buffer, bytesAvailable);
+        int bytesRead = serial.readBytes(fifoData + start1, size1);
 
-        if (bytesRead > 0)
-        {
-            addEvent(events,    // MidiBuffer
-                     BINARY_MSG,    // eventType
-                     0,         // sampleNum
-                     nodeId,    // eventID
-                     0,         // eventChannel
-                     bytesRead, // numBytes
-                     buffer);   // data
-        }
-        else if (bytesRead < 0)
+        if (bytesRead < 0)
         {
-            // ToDo: Properly warn about problem here!
-            AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SerialInput device read error!", "Could not read serial input, even though data should be available.");
+            readError = 2;
             return;
         }
+
+        fifo.finishedWrite(bytesRead);
+
+        if (bytesRead < size1)
+            return;
+
+        bytesAvailable -= bytesRead;
     }
 }
 
+
+void SerialInput::process(AudioSampleBuffer&, MidiBuffer& events)
+{
+    int error = readError.get();
+
+    if (error != 0 && !errorReported)
+        errorReported = true;
+    else
+        error = 0; // nothing new to report
+
+    if (error == 1)
+    {
+        // ToDo: Properly warn about problem here!
+        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SerialInput device access error!", "Could not access serial device.");
+    }
+    else if (error == 2)
+    {
+        // ToDo: Properly warn about problem here!
+        AlertWindow::showMessageBoxAsync(AlertWindow::WarningIcon, "SerialInput device read error!", "Could not read serial input, even though data should be available.");
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    // the event size field is a single byte, so longer reads are split
+    for (int i = 0; i < size1; i += MAX_EVENT_BYTES)
+    {
+        addEvent(events,    // MidiBuffer
+                 BINARY_MSG,    // eventType
+                 0,         // sampleNum
+                 nodeId,    // eventID
+                 0,         // eventChannel
+                 jmin(int(MAX_EVENT_BYTES), size1 - i), // numBytes
+                 fifoData + start1 + i);   // data
+    }
+
+    for (int i = 0; i < size2; i += MAX_EVENT_BYTES)
+    {
+        addEvent(events,    // MidiBuffer
+                 BINARY_MSG,    // eventType
+                 0,         // sampleNum
+                 nodeId,    // eventID
+                 0,         // eventChannel
+                 jmin(int(MAX_EVENT_BYTES), size2 - i), // numBytes
+                 fifoData + start2 + i);   // data
+    }
+
+    fifo.finishedRead(size1 + size2);
+}
+
 AudioProcessorEditor* SerialInput::createEditor()
 {
     editor = new SerialInputEditor(this);
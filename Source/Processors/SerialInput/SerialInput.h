@@ -33,16 +33,21 @@
 
 #include "SerialInputEditor.h"
 #include "../Serial/ofSerial.h"
+#include "../OutputDispatcher/OutputDispatcher.h"
 
 /**
 
  This source processor allows you to pipe binary serial data input straight to the event cue/buffer.
 
- @see SerialInputEditor
+ The port is read by an OutputDispatcher thread into a lock-free FIFO; process() only
+ turns the bytes that have arrived into BINARY_MSG events of at most 255 bytes each.
+
+ @see SerialInputEditor, OutputDispatcher
 
  */
 
-class SerialInput : public GenericProcessor
+class SerialInput : public GenericProcessor,
+    public OutputDispatcher::Device
 
 {
 public:
@@ -84,6 +89,9 @@ public:
      */
     bool isReady();
 
+    /** Starts reading the port. */
+    bool enable();
+
     /**
      Called immediately after the end of data acquisition by the ProcessorGraph.
 
@@ -105,6 +113,12 @@ public:
      */
     void process(AudioSampleBuffer& buffer, MidiBuffer& events);
 
+    /** No commands are sent to the port. */
+    void execute(const DeviceCommand& command);
+
+    /** Reads whatever the port has into the FIFO; called by the dispatcher. */
+    void poll();
+
     /**
      Returns the Juce GUI component that should be used with this processor.
      */
@@ -124,6 +138,24 @@ private:
     // List of baudrates that are available by default.
     static const int BAUDRATES[12];
 
+    // Reads the port while acquisition is running
+    OutputDispatcher reader;
+
+    // Bytes read from the port and not yet turned into events
+    AbstractFifo fifo;
+    HeapBlock<unsigned char> fifoData;
+
+    // Set by the reader when the port fails (1: access, 2: read); reported once by process()
+    Atomic<int> readError;
+    bool errorReported;
+
+    enum
+    {
+        FIFO_SIZE = 65536,
+        POLL_INTERVAL_MS = 1,
+        MAX_EVENT_BYTES = 255
+    };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SerialInput);
 };
 
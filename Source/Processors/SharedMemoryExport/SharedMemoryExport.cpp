@@ -0,0 +1,357 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SharedMemoryExport.h"
+#include "SharedMemoryExportEditor.h"
+
+#include <atomic>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+
+SharedMemoryExport::SharedMemoryExport()
+    : GenericProcessor("Shared Memory"),
+      segmentName("/open-ephys"),
+      bufferSeconds(2.0f),
+      segment(nullptr),
+      segmentSize(0),
+      segmentFile(-1),
+      generation(0),
+      ringData(nullptr),
+      ringTimestamps(nullptr),
+      ringEvents(nullptr),
+      writeCursor(nullptr),
+      eventWriteCursor(nullptr),
+      writeLimit(nullptr),
+      ringSamples(0),
+      samplesWritten(0),
+      eventsWritten(0),
+      blockTimestamp(0)
+{
+
+}
+
+
+SharedMemoryExport::~SharedMemoryExport()
+{
+    destroySegment();
+}
+
+
+AudioProcessorEditor* SharedMemoryExport::createEditor()
+{
+    editor = new SharedMemoryExportEditor(this, true);
+    return editor;
+}
+
+
+void SharedMemoryExport::setSegmentName(const String& name)
+{
+    String n = name.trim();
+
+    if (!n.startsWithChar('/'))
+        n = "/" + n;
+
+    if (n != segmentName)
+    {
+        destroySegment();
+        segmentName = n;
+    }
+}
+
+
+String SharedMemoryExport::getSegmentName() const
+{
+    return segmentName;
+}
+
+
+void SharedMemoryExport::setBufferSeconds(float seconds)
+{
+    bufferSeconds = jlimit(0.1f, 60.0f, seconds);
+}
+
+
+float SharedMemoryExport::getBufferSeconds() const
+{
+    return bufferSeconds;
+}
+
+
+bool SharedMemoryExport::enable()
+{
+    exportedChannels.clear();
+
+    Array<int> selected = getEditor()->getActiveChannels();
+
+    for (int i = 0; i < selected.size(); i++)
+    {
+        if (selected[i] < getNumInputs())
+            exportedChannels.add(selected[i]);
+    }
+
+    if (!createSegment())
+    {
+        CoreServices::sendStatusMessage("Could not create shared memory " + segmentName);
+        exportedChannels.clear();
+    }
+
+    samplesWritten = 0;
+    eventsWritten = 0;
+
+    return true;
+}
+
+
+bool SharedMemoryExport::disable()
+{
+    if (segment != nullptr)
+    {
+        uint32 active = 0;
+        memcpy(segment + 88, &active, sizeof(active));
+    }
+
+    return true;
+}
+
+
+bool SharedMemoryExport::createSegment()
+{
+#ifdef WIN32
+    std::cout << "Shared memory export is not supported on this platform." << std::endl;
+    return false;
+#else
+    const int numChannels = exportedChannels.size();
+    const double sampleRate = getSampleRate();
+
+    ringSamples = (int) nextPowerOfTwo(jmax(1024, roundToInt(bufferSeconds * sampleRate)));
+
+    // each section starts on a 64-byte boundary so readers can use aligned loads
+    const size_t channelMapOffset = SEGMENT_HEADER_SIZE;
+    const size_t dataOffset = (channelMapOffset + numChannels * CHANNEL_MAP_ENTRY_SIZE + 63) & ~size_t(63);
+    const size_t timestampOffset = dataOffset + size_t(numChannels) * ringSamples * sizeof(float);
+    const size_t eventOffset = timestampOffset + size_t(ringSamples) * sizeof(int64);
+    const size_t totalSize = eventOffset + EVENT_RING_SIZE * EVENT_SIZE;
+
+    if (segment == nullptr || totalSize != segmentSize)
+    {
+        destroySegment();
+
+        segmentFile = shm_open(segmentName.toRawUTF8(), O_CREAT | O_RDWR, 0644);
+
+        if (segmentFile < 0)
+        {
+            std::cout << "shm_open failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        if (ftruncate(segmentFile, totalSize) != 0)
+        {
+            std::cout << "ftruncate failed: " << strerror(errno) << std::endl;
+            destroySegment();
+            return false;
+        }
+
+        void* ptr = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, segmentFile, 0);
+
+        if (ptr == MAP_FAILED)
+        {
+            std::cout << "mmap failed: " << strerror(errno) << std::endl;
+            destroySegment();
+            return false;
+        }
+
+        segment = static_cast<uint8*>(ptr);
+        segmentSize = totalSize;
+    }
+
+    memset(segment, 0, totalSize);
+
+    const uint32 version = LAYOUT_VERSION;
+    const uint32 nChans = (uint32) numChannels;
+    const uint32 nSamps = (uint32) ringSamples;
+    const uint32 nEvents = EVENT_RING_SIZE;
+    const uint64 offsets[5] = { channelMapOffset, dataOffset, timestampOffset, eventOffset, totalSize };
+    const uint32 active = 1;
+    ++generation;
+
+    memcpy(segment, "OESHMEM", 8);
+    memcpy(segment + 8, &version, 4);
+    memcpy(segment + 12, &nChans, 4);
+    memcpy(segment + 16, &nSamps, 4);
+    memcpy(segment + 20, &nEvents, 4);
+    memcpy(segment + 24, &sampleRate, 8);
+    memcpy(segment + 48, offsets, sizeof(offsets));
+    memcpy(segment + 88, &active, 4);
+    memcpy(segment + 92, &generation, 4);
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        uint8* entry = segment + channelMapOffset + i * CHANNEL_MAP_ENTRY_SIZE;
+        Channel* ch = channels[exportedChannels[i]];
+
+        const int32 index = exportedChannels[i];
+        memcpy(entry, &index, 4);
+        memcpy(entry + 4, &ch->bitVolts, 4);
+        ch->getName().copyToUTF8((CharPointer_UTF8::CharType*) (entry + 8), 40);
+    }
+
+    writeCursor = reinterpret_cast<volatile uint64*>(segment + 32);
+    eventWriteCursor = reinterpret_cast<volatile uint64*>(segment + 40);
+    writeLimit = reinterpret_cast<volatile uint64*>(segment + 96);
+    *writeCursor = *eventWriteCursor = *writeLimit = 0;
+    ringData = reinterpret_cast<float*>(segment + dataOffset);
+    ringTimestamps = reinterpret_cast<int64*>(segment + timestampOffset);
+    ringEvents = segment + eventOffset;
+
+    return true;
+#endif
+}
+
+
+void SharedMemoryExport::destroySegment()
+{
+#ifndef WIN32
+    if (segment != nullptr)
+        munmap(segment, segmentSize);
+
+    if (segmentFile >= 0)
+    {
+        close(segmentFile);
+        shm_unlink(segmentName.toRawUTF8());
+    }
+#endif
+
+    segment = nullptr;
+    segmentSize = 0;
+    segmentFile = -1;
+    ringData = nullptr;
+    ringTimestamps = nullptr;
+    ringEvents = nullptr;
+    writeCursor = nullptr;
+    eventWriteCursor = nullptr;
+    writeLimit = nullptr;
+}
+
+
+void SharedMemoryExport::process(AudioSampleBuffer& buffer, MidiBuffer& events)
+{
+    if (segment == nullptr || exportedChannels.size() == 0)
+        return;
+
+    const int nSamples = getNumSamples(exportedChannels[0]);
+    blockTimestamp = getTimestamp(exportedChannels[0]);
+
+    // a block longer than the ring would overwrite its own start: only its last
+    // ringSamples samples are kept, and the ones before count as already overwritten
+    const int skipped = jmax(0, nSamples - ringSamples);
+    const int numToWrite = nSamples - skipped;
+
+    const int mask = ringSamples - 1;
+    const int start = int((samplesWritten + skipped) & mask);
+    const int firstPart = jmin(numToWrite, ringSamples - start);
+
+    // readers must see the limit move before any of the slots it covers change
+    *writeLimit = samplesWritten + nSamples;
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (int i = 0; i < exportedChannels.size(); i++)
+    {
+        const float* src = buffer.getReadPointer(exportedChannels[i]) + skipped;
+        float* ring = ringData + size_t(i) * ringSamples;
+
+        FloatVectorOperations::copy(ring + start, src, firstPart);
+
+        if (firstPart < numToWrite)
+            FloatVectorOperations::copy(ring, src + firstPart, numToWrite - firstPart);
+    }
+
+    for (int n = 0; n < numToWrite; n++)
+        ringTimestamps[(start + n) & mask] = blockTimestamp + skipped + n;
+
+    // TTLs refer to sample positions within this block, so handle them after the data
+    checkForEvents(events);
+
+    samplesWritten += nSamples;
+
+    // publish the data before moving the cursor that readers poll
+    std::atomic_thread_fence(std::memory_order_release);
+    *writeCursor = samplesWritten;
+    *eventWriteCursor = eventsWritten;
+}
+
+
+void SharedMemoryExport::handleEvent(int eventType, MidiMessage& event, int samplePosition)
+{
+    if (eventType != TTL)
+        return;
+
+    const uint8* raw = event.getRawData();
+
+    int64 timestamp = blockTimestamp + samplePosition;
+
+    std::map<uint8, int64>::const_iterator it = timestamps.find(raw[1]);
+    if (it != timestamps.end())
+        timestamp = it->second + samplePosition;
+
+    uint8* slot = ringEvents + (eventsWritten & (EVENT_RING_SIZE - 1)) * EVENT_SIZE;
+
+    memcpy(slot, &timestamp, 8);
+    slot[8] = raw[0];  // type
+    slot[9] = raw[1];  // node ID
+    slot[10] = raw[2]; // event ID (on / off)
+    slot[11] = raw[3]; // channel
+    memset(slot + 12, 0, 4);
+
+    eventsWritten++;
+}
+
+
+void SharedMemoryExport::saveCustomParametersToXml(XmlElement* parentElement)
+{
+    XmlElement* mainNode = parentElement->createNewChildElement("SHAREDMEMORY");
+    mainNode->setAttribute("name", segmentName);
+    mainNode->setAttribute("seconds", bufferSeconds);
+}
+
+
+void SharedMemoryExport::loadCustomParametersFromXml()
+{
+    if (parametersAsXml)
+    {
+        forEachXmlChildElement(*parametersAsXml, mainNode)
+        {
+            if (mainNode->hasTagName("SHAREDMEMORY"))
+            {
+                setSegmentName(mainNode->getStringAttribute("name", segmentName));
+                setBufferSeconds(mainNode->getDoubleAttribute("seconds", bufferSeconds));
+            }
+        }
+    }
+}
@@ -0,0 +1,160 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef SHAREDMEMORYEXPORT_H_INCLUDED
+#define SHAREDMEMORYEXPORT_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../GenericProcessor/GenericProcessor.h"
+
+/**
+
+  Exports continuous data and TTL events into a POSIX shared-memory ring.
+
+  Local analysis processes can shm_open() the segment (default name "/open-ephys"),
+  mmap() it read-only and read the most recent samples in place. The segment
+  is created when acquisition starts and stays mapped until the processor is
+  deleted, so readers can keep it open across acquisition runs.
+
+  All values are little-endian. The segment starts with a 128-byte header:
+
+      0  char    magic[8]          "OESHMEM\0"
+      8  uint32  version           currently 1
+     12  uint32  numChannels
+     16  uint32  ringSamples       samples per channel in the ring (power of two)
+     20  uint32  eventRingSize     number of event slots (power of two)
+     24  float64 sampleRate
+     32  uint64  writeCursor       total samples written since acquisition started
+     40  uint64  eventWriteCursor  total events written since acquisition started
+     48  uint64  channelMapOffset  byte offsets of the sections below
+     56  uint64  dataOffset
+     64  uint64  timestampOffset
+     72  uint64  eventOffset
+     80  uint64  totalSize         size of the whole segment in bytes
+     88  uint32  acquisitionActive 1 while acquisition is running
+     92  uint32  generation        incremented every time the layout is (re)initialised
+     96  uint64  writeLimit        end of the block being written (writeCursor between blocks)
+
+  Channel map: numChannels entries of 48 bytes
+      int32 inputIndex, float32 bitVolts, char name[40]
+
+  Data: float32 samples in microvolts, planar, one ring of ringSamples per channel.
+  Channel c, sample number k lives at data[c * ringSamples + (k & (ringSamples - 1))].
+
+  Timestamps: int64 source timestamp for every sample slot, indexed like the data.
+
+  Events: eventRingSize slots of 16 bytes, event number e at slot (e & (eventRingSize - 1))
+      int64 timestamp, uint8 type, uint8 nodeId, uint8 eventId (1 = on, 0 = off),
+      uint8 channel, uint32 reserved
+
+  Each block is published in this order: writeLimit is raised to the end of the
+  block (release), the samples, timestamps and events are stored, and then
+  writeCursor and eventWriteCursor are raised (release). Until then the block
+  overwrites the oldest slots of the ring (a block longer than the ring keeps only
+  its last ringSamples samples), so a reader copies samples [from, to) like this:
+
+      1. load writeCursor (acquire); to must not exceed it
+      2. copy the samples and timestamps
+      3. load writeLimit (acquire); the copy is intact if from >= writeLimit - ringSamples
+
+  Events are read the same way against eventWriteCursor, keeping at least a
+  block's worth of events away from the oldest slot.
+
+  @see GenericProcessor, DataStreamer
+
+*/
+
+class SharedMemoryExport : public GenericProcessor
+{
+public:
+
+    SharedMemoryExport();
+    ~SharedMemoryExport();
+
+    AudioProcessorEditor* createEditor();
+
+    bool isSink()
+    {
+        return true;
+    }
+
+    void process(AudioSampleBuffer& buffer, MidiBuffer& events);
+    void handleEvent(int eventType, MidiMessage& event, int samplePosition);
+
+    bool enable();
+    bool disable();
+
+    /** The following settings may only be changed while acquisition is stopped. */
+    void setSegmentName(const String& name);
+    String getSegmentName() const;
+
+    void setBufferSeconds(float seconds);
+    float getBufferSeconds() const;
+
+    void saveCustomParametersToXml(XmlElement* parentElement);
+    void loadCustomParametersFromXml();
+
+    enum
+    {
+        SEGMENT_HEADER_SIZE = 128,
+        CHANNEL_MAP_ENTRY_SIZE = 48,
+        EVENT_SIZE = 16,
+        EVENT_RING_SIZE = 4096,
+        LAYOUT_VERSION = 1
+    };
+
+private:
+
+    /** Creates (or resizes) and maps the segment, then writes the header and channel map. */
+    bool createSegment();
+    void destroySegment();
+
+    String segmentName;
+    float bufferSeconds;
+
+    Array<int> exportedChannels;
+
+    uint8* segment;
+    size_t segmentSize;
+    int segmentFile;
+    uint32 generation;
+
+    /** Pointers into the mapped segment. */
+    float* ringData;
+    int64* ringTimestamps;
+    uint8* ringEvents;
+    volatile uint64* writeCursor;
+    volatile uint64* eventWriteCursor;
+    volatile uint64* writeLimit;
+
+    int ringSamples;
+    uint64 samplesWritten;
+    uint64 eventsWritten;
+    int64 blockTimestamp;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedMemoryExport);
+
+};
+
+
+#endif  // SHAREDMEMORYEXPORT_H_INCLUDED
@@ -0,0 +1,103 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SharedMemoryExportEditor.h"
+#include "SharedMemoryExport.h"
+
+
+SharedMemoryExportEditor::SharedMemoryExportEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors)
+    : GenericEditor(parentNode, useDefaultParameterEditors)
+
+{
+    desiredWidth = 200;
+
+    SharedMemoryExport* p = (SharedMemoryExport*)getProcessor();
+
+    nameTitleLabel = new Label("Name", "Name:");
+    nameTitleLabel->setBounds(10,35,70,20);
+    addAndMakeVisible(nameTitleLabel);
+
+    nameLabel = new Label("Name", p->getSegmentName());
+    nameLabel->setBounds(80,37,110,18);
+    nameLabel->setFont(Font("Default", 15, Font::plain));
+    nameLabel->setColour(Label::textColourId, Colours::white);
+    nameLabel->setColour(Label::backgroundColourId, Colours::grey);
+    nameLabel->setEditable(true);
+    nameLabel->addListener(this);
+    addAndMakeVisible(nameLabel);
+
+    secondsTitleLabel = new Label("Seconds", "Buffer (s):");
+    secondsTitleLabel->setBounds(10,65,70,20);
+    addAndMakeVisible(secondsTitleLabel);
+
+    secondsLabel = new Label("Seconds", String(p->getBufferSeconds()));
+    secondsLabel->setBounds(80,67,50,18);
+    secondsLabel->setFont(Font("Default", 15, Font::plain));
+    secondsLabel->setColour(Label::textColourId, Colours::white);
+    secondsLabel->setColour(Label::backgroundColourId, Colours::grey);
+    secondsLabel->setEditable(true);
+    secondsLabel->addListener(this);
+    addAndMakeVisible(secondsLabel);
+}
+
+
+void SharedMemoryExportEditor::labelTextChanged(Label* label)
+{
+    SharedMemoryExport* p = (SharedMemoryExport*)getProcessor();
+
+    if (label == nameLabel)
+    {
+        p->setSegmentName(label->getText());
+        label->setText(p->getSegmentName(), dontSendNotification);
+    }
+    else if (label == secondsLabel)
+    {
+        p->setBufferSeconds(label->getText().getFloatValue());
+        label->setText(String(p->getBufferSeconds()), dontSendNotification);
+    }
+}
+
+
+void SharedMemoryExportEditor::updateSettings()
+{
+    SharedMemoryExport* p = (SharedMemoryExport*)getProcessor();
+
+    nameLabel->setText(p->getSegmentName(), dontSendNotification);
+    secondsLabel->setText(String(p->getBufferSeconds()), dontSendNotification);
+}
+
+
+void SharedMemoryExportEditor::startAcquisition()
+{
+    nameLabel->setEnabled(false);
+    secondsLabel->setEnabled(false);
+    GenericEditor::startAcquisition();
+}
+
+
+void SharedMemoryExportEditor::stopAcquisition()
+{
+    nameLabel->setEnabled(true);
+    secondsLabel->setEnabled(true);
+    GenericEditor::stopAcquisition();
+}
@@ -31,15 +31,44 @@
 #define copysign(x,y) _copysign(x,y)
 #endif
 
+// background noise level in spike train mode, relative to the spike amplitude
+#define SPIKE_NOISE_RATIO 0.1f
+
 SignalGenerator::SignalGenerator()
     : GenericProcessor("Signal Generator"),
       nOut(5), defaultFrequency(10.0), defaultAmplitude(0.5f),
-      previousPhase(1000), spikeDelay(0)
+      laneRotationChannels(0), spikeLength(N_WAVEFORM_SAMPLES), samplesGenerated(0)
 {
     parameters.add(Parameter("Amplitude", 0.0005f, 500.0f, .5f, 0, true));
     parameters.add(Parameter("Frequency", 0.01, 10000.0, 10, 1, true));
     parameters.add(Parameter("Phase", -double_Pi, double_Pi, 0, 2, true));
     parameters.add(Parameter("Waveform Type", waveformParameter, 0, 3, true));
+
+    for (int l = 0; l < OSCILLATOR_LANES; l++)
+        noiseState[l] = 2463534242u + 7919u * l;
+
+    // scale every template so that its largest deviation from baseline is 1
+    spikeTemplates.malloc(NUM_SPIKE_TEMPLATES * spikeLength);
+
+    for (int t = 0; t < NUM_SPIKE_TEMPLATES; t++)
+    {
+        double maxDeviation = 0;
+        spikePeak[t] = 0;
+
+        for (int k = 0; k < spikeLength; k++)
+        {
+            double deviation = std::abs(SPIKE_WAVEFORMS[t][k] - SPIKE_WAVEFORMS[t][0]);
+
+            if (deviation > maxDeviation)
+            {
+                maxDeviation = deviation;
+                spikePeak[t] = k;
+            }
+        }
+
+        for (int k = 0; k < spikeLength; k++)
+            spikeTemplates[t * spikeLength + k] = (float)((SPIKE_WAVEFORMS[t][k] - SPIKE_WAVEFORMS[t][0]) / maxDeviation);
+    }
 }
 
 
@@ -48,14 +77,6 @@ SignalGenerator::~SignalGenerator()
 
 }
 
-/*void SignalGenerator::initializeParameters(){
-    parameters.add(Parameter("Amplitude", 0.0005f, 500.0f, .5f, 1, true));
-    parameters.add(Parameter("Frequency", 0.01, 10000.0, 10, 2, true));
-    parameters.add(Parameter("Phase", -double_Pi, double_Pi, 0, 3, true));
-    parameters.add(Parameter("Waveform Type", waveformParameter, 0, 0, true));
-}
-*/
-
 AudioProcessorEditor* SignalGenerator::createEditor()
 {
     editor = new SignalGeneratorEditor(this, false);
@@ -75,6 +96,20 @@ void SignalGenerator::updateSettings()
         phase.add(0);
         phasePerSample.add(double_Pi * 2.0 / (getSampleRate() / frequency.getLast()));
         currentPhase.add(0);
+        nextSpikeStart.add(0);
+        nextSpikeUnit.add(0);
+        spikeRate.add(0);
+    }
+
+    if (laneRotationChannels < waveformType.size())
+    {
+        laneRotation.realloc(waveformType.size() * 2 * (OSCILLATOR_LANES + 1));
+
+        for (int n = laneRotationChannels; n < waveformType.size(); n++)
+        {
+            laneRotationChannels = n + 1;
+            updateOscillator(n);
+        }
     }
 
     sampleRateRatio = getSampleRate() / 44100.0;
@@ -83,6 +118,20 @@ void SignalGenerator::updateSettings()
 
 }
 
+void SignalGenerator::updateOscillator(int chan)
+{
+    if (chan >= laneRotationChannels)
+        return;
+
+    float* rotation = laneRotation + chan * 2 * (OSCILLATOR_LANES + 1);
+
+    for (int l = 0; l <= OSCILLATOR_LANES; l++)
+    {
+        rotation[2 * l] = (float) std::cos(l * phasePerSample[chan]);
+        rotation[2 * l + 1] = (float) std::sin(l * phasePerSample[chan]);
+    }
+}
+
 void SignalGenerator::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
@@ -102,6 +151,7 @@ void SignalGenerator::setParameter(int parameterIndex, float newValue)
         {
             frequency.set(currentChannel,newValue);
             phasePerSample.set(currentChannel, double_Pi * 2.0 / (getSampleRate() / frequency[currentChannel]));
+            updateOscillator(currentChannel);
             parameterPointer->setValue(newValue, currentChannel);
         }
         else if (parameterIndex == 2)
@@ -114,7 +164,6 @@ void SignalGenerator::setParameter(int parameterIndex, float newValue)
             waveformType.set(currentChannel, (int) newValue);
             parameterPointer->setValue(newValue, currentChannel);
         }
-        //updateWaveform(currentChannel);
     }
 
 }
@@ -125,56 +174,14 @@ bool SignalGenerator::enable()
 
     std::cout << "Signal generator received enable signal." << std::endl;
 
-    // for (int n = 0; n < waveformType.size(); n++)
-    // {
-    // 	updateWaveform(n);
+    samplesGenerated = 0;
 
-    // }
+    for (int n = 0; n < nextSpikeStart.size(); n++)
+        scheduleNextSpike(n, 0);
 
     return true;
 }
 
-// void SignalGenerator::updateWaveform(int n)
-// {
-
-// Array<float> cycleData;
-
-// int cycleLength = int(getSampleRate() / frequency[n]);
-// float phasePerSample = double_Pi * 2.0 / (getSampleRate() / frequency[n]);
-
-// cycleData.ensureStorageAllocated(cycleLength);
-
-// for (int i = 0; i < cycleLength; i++)
-// {
-// 	switch (waveformType[n])
-// 	{
-// 		case SINE:
-// 			cycleData.add(amplitude[n] * std::sin(i*phasePerSample + phase[n]));
-// 			break;
-// 		case SQUARE:
-// 			cycleData.add(amplitude[n] * copysign(1,std::sin(i*phasePerSample + phase[n])));
-// 			break;
-// 		case TRIANGLE:
-// 			cycleData.add(0);
-// 			break;
-// 		case SAW:
-// 			cycleData.add(0);
-// 			break;
-// 		case NOISE:
-// 			cycleData.add(0);
-// 			break;
-// 		default:
-// 			cycleData.set(i, 0);
-// 	}
-
-// }
-
-// waveforms.set(n, cycleData);
-
-// currentSample.set(n,0);
-
-// }
-
 bool SignalGenerator::disable()
 {
 
@@ -189,152 +196,219 @@ void SignalGenerator::process(AudioSampleBuffer& buffer,
 
     int nSamps = int((float) buffer.getNumSamples() * sampleRateRatio);
 
-    for (int i = 0; i < nSamps; ++i)
-    {
-        for (int j = buffer.getNumChannels(); --j >= 0;)
-        {
+    setTimestamp(midiMessages, samplesGenerated);
 
-            float sample;
+    const int numChannels = jmin(buffer.getNumChannels(), waveformType.size());
 
-            switch (waveformType[j])
-            {
-                case SINE:
-                    sample = amplitude[j] * (float) std::sin(currentPhase[j] + phase[j]);
-                    break;
-                case SQUARE:
-                    sample = amplitude[j] * copysign(1,std::sin(currentPhase[j] + phase[j]));
-                    break;
-                case TRIANGLE:
-                    sample = amplitude[j] * ((currentPhase[j] + phase[j]) / double_Pi - 1) *
-                             copysign(2,std::sin(currentPhase[j] + phase[j]));
-                    break;
-                case SAW:
-                    sample = amplitude[j] * ((currentPhase[j] + phase[j]) / double_Pi - 1);
-                    break;
-                case NOISE:
-                    // sample = amplitude[j] * (float(rand()) / float(RAND_MAX)-0.5f);
-                    // break;
-                case SPIKE:
-                    sample = generateSpikeSample(amplitude[j], currentPhase[j], phase[j]);
-                    break;
-                default:
-                    sample = 0;
-            }
-
-            currentPhase.set(j,currentPhase[j] + phasePerSample[j]);
-
-            if (currentPhase[j] > double_Pi*2)
-                currentPhase.set(j,0);
+    for (int j = 0; j < numChannels; ++j)
+    {
+        float* dest = buffer.getWritePointer(j);
 
-            // dereference pointer to one of the buffer's samples
-            *buffer.getWritePointer(j, i) = sample;
+        switch (waveformType[j])
+        {
+            case SINE:
+                generateSine(j, dest, nSamps);
+                FloatVectorOperations::multiply(dest, (float) amplitude[j], nSamps);
+                break;
+            case SQUARE:
+                {
+                    generateSine(j, dest, nSamps);
+                    const float amp = (float) amplitude[j];
+
+                    for (int i = 0; i < nSamps; i++)
+                        dest[i] = copysign(amp, dest[i]);
+                }
+                break;
+            case TRIANGLE:
+            case SAW:
+                generateRamp(j, dest, nSamps);
+                break;
+            case NOISE:
+                generateNoise(dest, (float) amplitude[j], nSamps);
+                break;
+            case SPIKE:
+                generateNoise(dest, (float) amplitude[j] * SPIKE_NOISE_RATIO, nSamps);
+                addSpikes(j, dest, nSamps, midiMessages);
+                break;
+            default:
+                FloatVectorOperations::clear(dest, nSamps);
         }
-    }
-
 
-    // for (int chan = 0; chan < buffer.getNumChannels(); chan++)
-    // {
+        // the oscillators restart from the exact phase at every block
+        currentPhase.set(j, std::fmod(currentPhase[j] + nSamps * phasePerSample[j], double_Pi * 2));
+    }
 
-    // 	int dataSize = waveforms[chan].size();
-    // 	int destSample = -dataSize;
-    // 	int lastSample = dataSize;
+    samplesGenerated += nSamps;
 
-    // 	while (lastSample < nSamps)
-    // 	{
+    setNumSamples(midiMessages, nSamps);
 
-    // 		destSample += dataSize;
+}
 
-    // 		//std::cout << lastSample << " " << destSample << " " << currentSample[chan] << " " << dataSize << std::endl;
+void SignalGenerator::generateSine(int chan, float* dest, int numSamples)
+{
+    const float* rotation = laneRotation + chan * 2 * (OSCILLATOR_LANES + 1);
+    const float stepCos = rotation[2 * OSCILLATOR_LANES];
+    const float stepSin = rotation[2 * OSCILLATOR_LANES + 1];
 
-    // 		// buffer.copyFrom(chan,
-    // 		//  				destSample,
-    // 		//  				waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 		//  				dataSize - currentSample[chan]);
+    const double startPhase = currentPhase[chan] + phase[chan];
+    const float c0 = (float) std::cos(startPhase);
+    const float s0 = (float) std::sin(startPhase);
 
-    // 		lastSample += dataSize;
+    // lane l holds the phasor of sample (i + l), advanced by OSCILLATOR_LANES samples per step
+    float re[OSCILLATOR_LANES];
+    float im[OSCILLATOR_LANES];
 
-    // 		currentSample.set(chan,0);
+    for (int l = 0; l < OSCILLATOR_LANES; l++)
+    {
+        re[l] = c0 * rotation[2 * l] - s0 * rotation[2 * l + 1];
+        im[l] = s0 * rotation[2 * l] + c0 * rotation[2 * l + 1];
+    }
 
-    // 		//std::cout << "DONE" << std::endl;
-    // 	}
+    int i = 0;
 
-    // 	//std::cout << lastSample << " " << destSample << " " << currentSample[chan] << " " << dataSize << std::endl;
+    for (; i + OSCILLATOR_LANES <= numSamples; i += OSCILLATOR_LANES)
+    {
+        for (int l = 0; l < OSCILLATOR_LANES; l++)
+        {
+            dest[i + l] = im[l];
 
-    // 	if (destSample < 0)
-    // 		destSample = 0;
+            const float r = re[l] * stepCos - im[l] * stepSin;
+            im[l] = re[l] * stepSin + im[l] * stepCos;
+            re[l] = r;
+        }
+    }
 
-    // 	int samplesLeft = nSamps - destSample;
+    for (int l = 0; i < numSamples; l++, i++)
+        dest[i] = im[l];
+}
 
-    // 	if (samplesLeft < dataSize - currentSample[chan])
-    // 	{
-    // 	 	// buffer.copyFrom(chan,
-    // 	 	// 			destSample,
-    // 	 	// 			waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 	 	// 			samplesLeft);
+void SignalGenerator::generateRamp(int chan, float* dest, int numSamples)
+{
+    // position within the cycle, from 0 to 1
+    const double start = (currentPhase[chan] + phase[chan]) / (double_Pi * 2);
+    const float t0 = (float)(start - std::floor(start));
+    const float dt = (float)(phasePerSample[chan] / (double_Pi * 2));
+    const float amp = (float) amplitude[chan];
 
-    // 	 	currentSample.set(chan, currentSample[chan] + samplesLeft);
+    if (waveformType[chan] == SAW)
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            float t = t0 + i * dt;
+            t -= std::floor(t);
+            dest[i] = amp * (2.0f * t - 1.0f);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < numSamples; i++)
+        {
+            float t = t0 + i * dt;
+            t -= std::floor(t);
+            dest[i] = amp * (1.0f - 4.0f * std::abs(t - 0.5f));
+        }
+    }
+}
 
-    // 	} else {
+void SignalGenerator::generateNoise(float* dest, float standardDeviation, int numSamples)
+{
+    // the sum of four uniform variables on [0,1) has a mean of 2 and a variance of 1/3
+    const float scale = standardDeviation * 1.7320508f / 65536.0f;
+    const float offset = -2.0f * 65536.0f;
 
-    // 		int samps = dataSize - currentSample[chan];
+    uint32 x[OSCILLATOR_LANES];
 
-    // 		// buffer.copyFrom(chan,
-    // 	 // 				destSample,
-    // 	 // 				waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 	 // 				samps);
+    for (int l = 0; l < OSCILLATOR_LANES; l++)
+        x[l] = noiseState[l];
 
-    // 		destSample += samps;
-    // 		samplesLeft -= samps;
+    for (int i = 0; i < numSamples; i += OSCILLATOR_LANES)
+    {
+        float g[OSCILLATOR_LANES];
 
-    // 		// buffer.copyFrom(chan,
-    // 	 // 				destSample,
-    // 	 // 				waveforms[chan].getRawDataPointer(),
-    // 	 // 				samplesLeft);
+        for (int l = 0; l < OSCILLATOR_LANES; l++)
+        {
+            x[l] ^= x[l] << 13;
+            x[l] ^= x[l] >> 17;
+            x[l] ^= x[l] << 5;
+            const uint32 a = x[l];
+
+            x[l] ^= x[l] << 13;
+            x[l] ^= x[l] >> 17;
+            x[l] ^= x[l] << 5;
+            const uint32 b = x[l];
+
+            const int32 sum = int32(a & 0xffff) + int32(a >> 16) + int32(b & 0xffff) + int32(b >> 16);
+            g[l] = ((float) sum + offset) * scale;
+        }
 
-    // 		currentSample.set(chan, samplesLeft);
-    // 	}
+        const int n = jmin((int) OSCILLATOR_LANES, numSamples - i);
 
-    // }
+        for (int l = 0; l < n; l++)
+            dest[i + l] = g[l];
+    }
 
+    for (int l = 0; l < OSCILLATOR_LANES; l++)
+        noiseState[l] = x[l];
 }
-float SignalGenerator::generateSpikeSample(double amp, double phase, double noise)
+
+void SignalGenerator::addSpikes(int chan, float* dest, int numSamples, MidiBuffer& events)
 {
+    const int64 blockStart = samplesGenerated;
+    const int64 blockEnd = samplesGenerated + numSamples;
+    const float amp = (float) amplitude[chan];
 
+    uint8 groundTruth[3];
+    groundTruth[0] = (uint8)(chan & 0xff);
+    groundTruth[1] = (uint8)(chan >> 8);
 
-    // if the current phase is less than the previous phase we've probably wrapped and its time to select a new spike
-    // if we've delayed long enough then draw a new spike otherwise wait until spikeDelay==0
-    if (phase < previousPhase)
-    {
-        spikeIdx = rand()%5;
+    // a channel switched to spikes during acquisition has a schedule from the past, and
+    // one whose rate changed has a next spike drawn at the old rate: draw it again from
+    // here rather than catching up (a spike already under way is finished first)
+    const int64 scheduled = nextSpikeStart[chan];
 
-        if (spikeDelay <= 0)
-            spikeDelay = rand()%200 + 50;
-        if (spikeDelay > 0)
-            spikeDelay --;
-    }
+    if (scheduled + spikeLength <= blockStart
+        || (scheduled >= blockStart && spikeRate[chan] != frequency[chan]))
+        scheduleNextSpike(chan, blockStart);
+
+    while (nextSpikeStart[chan] < blockEnd)
+    {
+        const int64 start = nextSpikeStart[chan];
+        const int unit = nextSpikeUnit[chan];
+        const int64 first = jmax(start, blockStart);
+        const int64 last = jmin(start + spikeLength, blockEnd);
 
+        FloatVectorOperations::addWithMultiply(dest + (first - blockStart),
+                                               spikeTemplates + unit * spikeLength + (first - start),
+                                               amp,
+                                               int(last - first));
 
-    previousPhase = phase;
+        groundTruth[2] = (uint8) unit;
 
-    int shift = -9500;//1000 + 32768;
-    int gain = 8000;
+        const int64 peak = start + spikePeak[unit];
+        const int64 end = start + spikeLength - 1;
 
-    double r = ((rand() % 201) - 100) / 1000.0; // Generate random number between -.1 and .1
-    noise = r  * noise / (double_Pi * 2); // Shrink the range of r based upon the value of noise
+        if (peak >= blockStart && peak < blockEnd)
+            addEvent(events, TTL, int(peak - blockStart), 1, 0, 3, groundTruth);
 
-    int sampIdx = (int)(phase / (2 * double_Pi) * (N_WAVEFORM_SAMPLES-1));  // bind between 0 and N_SAMP-1, too tired to figure out the proper math
-    //sampIdx = sampIdx + 8;
+        if (end >= blockStart && end < blockEnd)
+            addEvent(events, TTL, int(end - blockStart), 0, 0, 3, groundTruth);
 
-    // Right now only sample from the 3rd waveform. I need to figure out a way to only sample from a single spike until the phase wraps
-    float baseline = shift + gain *  SPIKE_WAVEFORMS[spikeIdx][1] ;
+        if (start + spikeLength > blockEnd)
+            break; // the rest of this spike goes into the next block
 
-    float sample = shift + gain * (SPIKE_WAVEFORMS[spikeIdx][sampIdx] + noise);  // * pow( WAVEFORM_SCALE[sampIdx], amp / 200.0 ) ) ;
-    float dV = sample  - baseline;
-    dV = dV * (1 + amp / 250);
-    sample = baseline + dV;
+        scheduleNextSpike(chan, start + spikeLength);
+    }
+}
 
-    if (spikeDelay==0)
-        return sample;
-    else
-        return baseline;
+void SignalGenerator::scheduleNextSpike(int chan, int64 after)
+{
+    // exponentially distributed intervals give Poisson spike times; spikes on the
+    // same channel never overlap, which acts as a refractory period of one template
+    const double rate = jmax(frequency[chan], 0.001);
+    const double u = 1.0 - spikeRandom.nextDouble(); // in (0, 1]
+    const double interval = -std::log(u) * getSampleRate() / rate;
+
+    nextSpikeStart.set(chan, after + (int64) interval);
+    spikeRate.set(chan, frequency[chan]);
+    nextSpikeUnit.set(chan, spikeRandom.nextInt(NUM_SPIKE_TEMPLATES));
 }
@@ -46,6 +46,13 @@ SignalGeneratorEditor::SignalGeneratorEditor(GenericProcessor* parentNode, bool
         addAndMakeVisible(ws);
     }
 
+    spikeTrainButton = new UtilityButton("SPK", Font("Small Text", 10, Font::plain));
+    spikeTrainButton->setRadioGroupId(299);
+    spikeTrainButton->setClickingTogglesState(true);
+    spikeTrainButton->setBounds(8 + (buttonWidth)*5, 30, buttonWidth, buttonHeight);
+    spikeTrainButton->addListener(this);
+    addAndMakeVisible(spikeTrainButton);
+
     amplitudeSlider = new Slider("Amplitude Slider");
     amplitudeSlider->setBounds(10,60,50,60);
     amplitudeSlider->setRange(0,1,0.1);
@@ -144,6 +151,19 @@ void SignalGeneratorEditor::buttonEvent(Button* button)
         }
     }
 
+    if (button == spikeTrainButton)
+    {
+        Array<int> chans = getActiveChannels();
+
+        GenericProcessor* p = getProcessor();
+
+        for (int n = 0; n < chans.size(); n++)
+        {
+            p->setCurrentChannel(chans[n]);
+            p->setParameter(3, (float) SignalGenerator::SPIKE);
+        }
+    }
+
     int num = numChannelsLabel->getText().getIntValue();
 
     if (button == upButton)
@@ -35,6 +35,8 @@ class WaveformSelector;
   User interface for the SignalGenerator.
 
   Allows the user to edit the waveform type, amplitude, frequency, and phase of individual channels.
+  The SPK button switches the selected channels to spike train mode, in which
+  the frequency sets the mean firing rate.
 
   @see SignalGenerator
 
@@ -61,6 +63,7 @@ private:
     Slider* phaseSlider;
 
     Array<WaveformSelector*> waveformSelectors;
+    UtilityButton* spikeTrainButton;
 
     enum wvfrm
     {
@@ -0,0 +1,223 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "InlineChain.h"
+#include "../GenericProcessor/GenericProcessor.h"
+
+
+InlineChain::InlineChain(GenericProcessor* source_, DataBuffer* input_,
+                         const Array<GenericProcessor*>& processors_)
+    : source(source_), input(input_), processors(processors_),
+      output(input_->getNumChannels(), OUTPUT_BUFFER_SIZE),
+      buffer(input_->getNumChannels(), MAX_BLOCK_SIZE),
+      eventFifo(EVENT_QUEUE_SIZE), stopped(false)
+{
+    eventCodes.malloc(MAX_BLOCK_SIZE);
+    eventQueue.malloc(EVENT_QUEUE_SIZE);
+    events.ensureSize(4096);
+
+    for (int i = 0; i < processors.size(); i++)
+        processors[i]->setInlineActive(true);
+}
+
+
+InlineChain::~InlineChain()
+{
+    stop();
+}
+
+
+Array<GenericProcessor*> InlineChain::findProcessors(GenericProcessor* source)
+{
+    Array<GenericProcessor*> chain;
+
+    const int numChannels = source->getNumOutputs();
+    GenericProcessor* p = source->getDestNode();
+
+    while (p != nullptr && p->getRunsInline() && p->supportsInlineProcessing()
+           && !p->isSplitter() && !p->isMerger() && p->getNumInputs() == numChannels)
+    {
+        chain.add(p);
+
+        if (p->isSink() || p->getNumOutputs() != numChannels)
+            break;
+
+        p = p->getDestNode();
+    }
+
+    return chain;
+}
+
+
+void InlineChain::start()
+{
+    if (!stopped)
+        running = 1;
+}
+
+
+void InlineChain::stop()
+{
+    stopped = true;
+    running = 0;
+
+    for (int i = 0; i < processors.size(); i++)
+        processors[i]->setInlineActive(false);
+}
+
+
+bool InlineChain::isStopped() const
+{
+    return stopped;
+}
+
+
+DataBuffer* InlineChain::getOutputBuffer()
+{
+    return &output;
+}
+
+
+int InlineChain::getNumDroppedEvents() const
+{
+    return droppedEvents.get();
+}
+
+
+void InlineChain::process()
+{
+    if (running.get() == 0)
+        return;
+
+    const uint8 sourceNodeId = (uint8) source->getNodeId();
+
+    for (;;)
+    {
+        // when the graph falls behind, the samples wait in the source's buffer
+        const int numItems = jmin(input->getNumSamples(), output.getFreeSpace(), int(MAX_BLOCK_SIZE));
+
+        if (numItems <= 0)
+            return;
+
+        buffer.setSize(buffer.getNumChannels(), numItems, false, false, true);
+
+        uint64 timestamp;
+        int64 ingestionTicks;
+        const int numRead = input->readAllFromBuffer(buffer, &timestamp, eventCodes, numItems, &ingestionTicks);
+
+        // the same BUFFER_SIZE and TIMESTAMP events the source would send
+        events.clear();
+
+        const int16 numSamples = (int16) numRead;
+        uint8 sizeData[4];
+        sizeData[0] = GenericProcessor::BUFFER_SIZE;
+        sizeData[1] = sourceNodeId;
+        memcpy(sizeData + 2, &numSamples, 2);
+        events.addEvent(sizeData, 4, 0);
+
+        const int64 ts = (int64) timestamp;
+        uint8 timestampData[22];
+        timestampData[0] = GenericProcessor::TIMESTAMP;
+        timestampData[1] = sourceNodeId;
+        timestampData[2] = sourceNodeId;
+        timestampData[3] = 0;
+        timestampData[4] = 1;
+        timestampData[5] = sourceNodeId;
+        memcpy(timestampData + 6, &ts, 8);
+        memcpy(timestampData + 14, &ingestionTicks, 8);
+        events.addEvent(timestampData, 22, 0);
+
+        for (int i = 0; i < processors.size(); i++)
+            processors[i]->processInline(buffer, events);
+
+        output.addToBuffer(buffer, numRead, ts, eventCodes, ingestionTicks);
+
+        queueEvents(ts);
+    }
+}
+
+
+void InlineChain::queueEvents(int64 firstTimestamp)
+{
+    MidiBuffer::Iterator i(events);
+
+    const uint8* dataptr;
+    int dataSize;
+    int samplePosition;
+
+    while (i.getNextEvent(dataptr, dataSize, samplePosition))
+    {
+        if (*dataptr == GenericProcessor::BUFFER_SIZE || *dataptr == GenericProcessor::TIMESTAMP)
+            continue;
+
+        int start1, size1, start2, size2;
+        eventFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 + size2 < 1 || dataSize > MAX_EVENT_SIZE)
+        {
+            ++droppedEvents;
+            continue;
+        }
+
+        QueuedEvent& queued = eventQueue[size1 > 0 ? start1 : start2];
+        queued.sampleTime = firstTimestamp + samplePosition;
+        queued.size = dataSize;
+        memcpy(queued.data, dataptr, dataSize);
+
+        // every event here was added inside the chain, but each processor clears the save
+        // flag of the events it receives: flag them again so the Record Node writes them
+        if (isWritableEvent(*dataptr) && dataSize > 4)
+            queued.data[4] = 1;
+
+        eventFifo.finishedWrite(1);
+    }
+}
+
+
+void InlineChain::addEvents(MidiBuffer& graphEvents, int64 firstTimestamp, int numSamples)
+{
+    if (numSamples <= 0)
+        return;
+
+    int numAdded = 0;
+
+    const int numReady = eventFifo.getNumReady();
+    int start1, size1, start2, size2;
+    eventFifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+    for (int i = 0; i < size1 + size2; i++)
+    {
+        const QueuedEvent& queued = eventQueue[i < size1 ? start1 + i : start2 + i - size1];
+
+        // events are queued in sample order; later ones belong to the next callback
+        if (queued.sampleTime >= firstTimestamp + numSamples)
+            break;
+
+        const int samplePosition = int(jmax(int64(0), queued.sampleTime - firstTimestamp));
+        graphEvents.addEvent(queued.data, queued.size, samplePosition);
+
+        numAdded++;
+    }
+
+    eventFifo.finishedRead(numAdded);
+}
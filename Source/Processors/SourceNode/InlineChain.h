@@ -0,0 +1,121 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef INLINECHAIN_H_INCLUDED
+#define INLINECHAIN_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../DataThreads/DataBuffer.h"
+
+class GenericProcessor;
+
+/**
+
+  Runs the first few processors after a SourceNode on its DataThread, as soon as each
+  hardware block has been decoded, instead of waiting for the audio callback. Closed-loop
+  outputs can then react within one hardware block.
+
+  The chain is made of the processors directly downstream of the source that are marked
+  with GenericProcessor::setRunsInline(), up to the first one that isn't. After every
+  updateBuffer() the DataThread calls process(), which reads the source's DataBuffer, runs
+  the processors and writes their output samples to a second DataBuffer. The SourceNode
+  reads that buffer in the audio callback, and adds the events the chain produced at the
+  samples they belong to. In the graph, the inline processors pass their buffers through,
+  so recording and display see the same data and events as without the chain.
+
+  @see SourceNode, DataThread, GenericProcessor::supportsInlineProcessing
+
+*/
+
+class InlineChain
+{
+public:
+    InlineChain(GenericProcessor* source, DataBuffer* input, const Array<GenericProcessor*>& processors);
+    ~InlineChain();
+
+    /** Returns the processors that would form a chain after the given source, if any. */
+    static Array<GenericProcessor*> findProcessors(GenericProcessor* source);
+
+    /** Audio thread: lets the chain run. Called by the first audio callback, after every
+        processor in the graph has been enabled. */
+    void start();
+
+    /** Stops the chain for good; the processors go back to running in the graph. */
+    void stop();
+
+    bool isStopped() const;
+
+    /** Acquisition thread: processes everything the source has added since the last call. */
+    void process();
+
+    /** Audio thread: the buffer the source should read instead of its own. */
+    DataBuffer* getOutputBuffer();
+
+    /** Audio thread: adds the chain's events for the samples
+        [firstTimestamp, firstTimestamp + numSamples) to the graph's event buffer. */
+    void addEvents(MidiBuffer& events, int64 firstTimestamp, int numSamples);
+
+    int getNumDroppedEvents() const;
+
+    enum
+    {
+        MAX_BLOCK_SIZE = 1024,
+        OUTPUT_BUFFER_SIZE = 10000,
+        EVENT_QUEUE_SIZE = 1024,
+        MAX_EVENT_SIZE = 6 + 256
+    };
+
+private:
+
+    struct QueuedEvent
+    {
+        int64 sampleTime;
+        int size;
+        uint8 data[MAX_EVENT_SIZE];
+    };
+
+    void queueEvents(int64 firstTimestamp);
+
+    GenericProcessor* source;
+    DataBuffer* input;
+    Array<GenericProcessor*> processors;
+
+    DataBuffer output;
+
+    AudioSampleBuffer buffer;
+    MidiBuffer events;
+    HeapBlock<uint64> eventCodes;
+
+    AbstractFifo eventFifo;
+    HeapBlock<QueuedEvent> eventQueue;
+    Atomic<int> droppedEvents;
+
+    Atomic<int> running;
+    bool stopped;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InlineChain);
+
+};
+
+
+#endif  // INLINECHAIN_H_INCLUDED
@@ -318,6 +318,20 @@ bool SourceNode::enable()
 
     if (dataThread != 0)
     {
+        // the thread may have failed to stop last time; then it may still use the old chain
+        if (!dataThread->isThreadRunning())
+        {
+            inlineChain = nullptr;
+
+            Array<GenericProcessor*> inlineProcessors = InlineChain::findProcessors(this);
+
+            if (inlineProcessors.size() > 0 && inputBuffer != nullptr)
+            {
+                inlineChain = new InlineChain(this, inputBuffer, inlineProcessors);
+                std::cout << "Running " << inlineProcessors.size() << " processors on the data thread." << std::endl;
+            }
+        }
+
         dataThread->startAcquisition();
         return true;
     }
@@ -336,6 +350,14 @@ bool SourceNode::disable()
     if (dataThread != 0)
         dataThread->stopAcquisition();
 
+    if (inlineChain != nullptr)
+    {
+        inlineChain->stop();
+
+        if (!dataThread->isThreadRunning())
+            inlineChain = nullptr;
+    }
+
     startTimer(2000); // timer to check for connected source
 
     wasDisabled = true;
@@ -361,6 +383,13 @@ void SourceNode::acquisitionStopped()
 }
 
 
+void SourceNode::processInlineChain()
+{
+    if (inlineChain != nullptr)
+        inlineChain->process();
+}
+
+
 void SourceNode::process(AudioSampleBuffer& buffer,
                          MidiBuffer& events)
 {
@@ -371,10 +400,21 @@ void SourceNode::process(AudioSampleBuffer& buffer,
     events.clear();
     buffer.clear();
 
-    int nSamples = inputBuffer->readAllFromBuffer(buffer, &timestamp, eventCodeBuffer, buffer.getNumSamples());
+    DataBuffer* source = inputBuffer;
+    InlineChain* chain = (inlineChain != nullptr && !inlineChain->isStopped()) ? inlineChain.get() : nullptr;
+
+    if (chain != nullptr)
+    {
+        chain->start(); // every processor has been enabled by now
+        source = chain->getOutputBuffer();
+    }
+
+    int64 ingestionTicks;
+    int nSamples = source->readAllFromBuffer(buffer, &timestamp, eventCodeBuffer, buffer.getNumSamples(),
+                                             &ingestionTicks);
 
     setNumSamples(events, nSamples);
-    setTimestamp(events, timestamp);
+    setTimestamp(events, timestamp, ingestionTicks);
 
     //std::cout << *buffer.getReadPointer(0) << std::endl;
 
@@ -443,6 +483,9 @@ void SourceNode::process(AudioSampleBuffer& buffer,
         }
     }
 
+    if (chain != nullptr)
+        chain->addEvents(events, timestamp, nSamples);
+
 }
 
 
@@ -28,13 +28,17 @@
 #include <stdio.h>
 #include "../DataThreads/DataThread.h"
 #include "../GenericProcessor/GenericProcessor.h"
+#include "InlineChain.h"
 #include "../../UI/UIComponent.h"
 
 /**
 
   Creates and controls a thread for reading data from external sources.
 
-  @see GenericProcessor, SourceNodeEditor, DataThread, IntanThread
+  Processors marked to run inline directly after the source are run on that
+  thread by an InlineChain.
+
+  @see GenericProcessor, SourceNodeEditor, DataThread, IntanThread, InlineChain
 
 */
 
@@ -93,6 +97,9 @@ public:
 
     void acquisitionStopped();
 
+    /** Called by the DataThread after every updateBuffer(). */
+    void processInlineChain();
+
     DataThread* getThread();
 
     void actionListenerCallback(const String& message);
@@ -117,6 +124,9 @@ private:
     ScopedPointer<DataThread> dataThread;
     DataBuffer* inputBuffer;
 
+    /** Only exists while acquisition runs with inline processors */
+    ScopedPointer<InlineChain> inlineChain;
+
     uint64 timestamp;
     //uint64* eventCodeBuffer;
     //int* eventChannelState;
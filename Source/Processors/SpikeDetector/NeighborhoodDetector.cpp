@@ -0,0 +1,317 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "NeighborhoodDetector.h"
+#include "../GenericProcessor/GenericProcessor.h"
+#include "../Channel/Channel.h"
+
+
+NeighborhoodDetector::NeighborhoodDetector()
+    : numProbes(0), window(1, HISTORY_SAMPLES), windowLength(HISTORY_SAMPLES),
+      minima(1, 1024), scratch(2, 1024 + 2 * LOCAL_WINDOW)
+{
+
+}
+
+
+NeighborhoodDetector::~NeighborhoodDetector()
+{
+
+}
+
+
+void NeighborhoodDetector::setChannels(const OwnedArray<Channel>& channels, float radius)
+{
+    const int numChannels = channels.size();
+
+    channelProbes.clearQuick();
+    neighbors.clear();
+
+    Array<int> probeIds;
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        if (channels[i]->type != HEADSTAGE_CHANNEL)
+        {
+            channelProbes.add(-1);
+            continue;
+        }
+
+        if (!probeIds.contains(channels[i]->probeId))
+            probeIds.add(channels[i]->probeId);
+
+        channelProbes.add(probeIds.indexOf(channels[i]->probeId));
+    }
+
+    numProbes = probeIds.size();
+
+    Array<float> x, y, z;
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        x.add(channels[i]->x);
+        y.add(channels[i]->y);
+        z.add(channels[i]->z);
+    }
+
+    // sources that don't know their geometry leave every position at the origin
+    for (int probe = 0; probe < numProbes; probe++)
+    {
+        int first = -1;
+        bool samePosition = true;
+
+        for (int i = 0; i < numChannels && samePosition; i++)
+        {
+            if (channelProbes[i] != probe)
+                continue;
+
+            if (first < 0)
+                first = i;
+            else
+                samePosition = (x[i] == x[first] && y[i] == y[first] && z[i] == z[first]);
+        }
+
+        if (!samePosition)
+            continue;
+
+        int position = 0;
+
+        for (int i = 0; i < numChannels; i++)
+        {
+            if (channelProbes[i] == probe)
+                y.set(i, float(DEFAULT_PITCH * position++));
+        }
+    }
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        Array<int>* neighborhood = new Array<int>();
+        neighbors.add(neighborhood);
+
+        if (channelProbes[i] < 0)
+            continue;
+
+        Array<float> distances;
+
+        for (int j = 0; j < numChannels; j++)
+        {
+            if (channelProbes[j] != channelProbes[i])
+                continue;
+
+            const float dx = x[j] - x[i];
+            const float dy = y[j] - y[i];
+            const float dz = z[j] - z[i];
+            const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+            if (distance > radius && j != i)
+                continue;
+
+            // the channel itself goes first, then by increasing distance
+            int index = distances.size();
+
+            while (index > 0 && (j == i || distances[index - 1] > distance))
+                index--;
+
+            neighborhood->insert(index, j);
+            distances.insert(index, (j == i) ? -1.0f : distance);
+        }
+    }
+
+    needsMinima.calloc(jmax(1, numChannels));
+    candidates.ensureStorageAllocated(numChannels);
+
+    window.setSize(jmax(1, numChannels), HISTORY_SAMPLES);
+    minima.setSize(jmax(1, numChannels), minima.getNumSamples());
+
+    reset();
+}
+
+
+int NeighborhoodDetector::getNumProbes() const
+{
+    return numProbes;
+}
+
+
+int NeighborhoodDetector::getProbe(int channel) const
+{
+    return channelProbes[channel];
+}
+
+
+const Array<int>& NeighborhoodDetector::getNeighbors(int channel) const
+{
+    return *neighbors[channel];
+}
+
+
+void NeighborhoodDetector::reset()
+{
+    windowLength = HISTORY_SAMPLES;
+    window.setSize(window.getNumChannels(), HISTORY_SAMPLES, false, false, true);
+    window.clear();
+}
+
+
+float NeighborhoodDetector::getSample(int channel, int sample) const
+{
+    return window.getSample(channel, HISTORY_SAMPLES + sample);
+}
+
+
+void NeighborhoodDetector::process(const AudioSampleBuffer& buffer, int numSamples, float threshold,
+                                   Array<Peak>& peaks)
+{
+    const int numChannels = channelProbes.size();
+
+    if (numProbes == 0 || numSamples <= 0 || buffer.getNumChannels() < numChannels)
+        return;
+
+    // keep the end of the previous block in front of this one
+    if (windowLength > HISTORY_SAMPLES)
+    {
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            memmove(window.getWritePointer(ch), window.getReadPointer(ch, windowLength - HISTORY_SAMPLES),
+                    HISTORY_SAMPLES * sizeof(float));
+        }
+    }
+
+    windowLength = HISTORY_SAMPLES + numSamples;
+    window.setSize(numChannels, windowLength, true, false, true);
+    minima.setSize(numChannels, numSamples, false, false, true);
+    scratch.setSize(2, numSamples + 2 * LOCAL_WINDOW, false, false, true);
+
+    // the samples searched in this block are those with POST_PEAK_SAMPLES after them
+    const int start = HISTORY_SAMPLES - POST_PEAK_SAMPLES;
+
+    candidates.clearQuick();
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        needsMinima[ch] = false;
+
+        if (channelProbes[ch] >= 0)
+            window.copyFrom(ch, HISTORY_SAMPLES, buffer, ch, 0, numSamples);
+    }
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        if (channelProbes[ch] < 0
+            || FloatVectorOperations::findMinimum(window.getReadPointer(ch, start), numSamples) >= -threshold)
+            continue;
+
+        candidates.add(ch);
+
+        const Array<int>& neighborhood = *neighbors[ch];
+
+        for (int k = 0; k < neighborhood.size(); k++)
+            needsMinima[neighborhood[k]] = true;
+    }
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        if (needsMinima[ch])
+            findMinima(ch, start, numSamples);
+    }
+
+    float* neighborhoodMinimum = scratch.getWritePointer(1);
+
+    for (int c = 0; c < candidates.size(); c++)
+    {
+        const int channel = candidates[c];
+        const Array<int>& neighborhood = *neighbors[channel];
+
+        FloatVectorOperations::copy(neighborhoodMinimum, minima.getReadPointer(channel), numSamples);
+
+        for (int k = 1; k < neighborhood.size(); k++)
+        {
+            const float* m = minima.getReadPointer(neighborhood[k]);
+
+            for (int i = 0; i < numSamples; i++)
+                neighborhoodMinimum[i] = jmin(neighborhoodMinimum[i], m[i]);
+        }
+
+        const float* samples = window.getReadPointer(channel, start);
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            if (samples[i] < -threshold && samples[i] <= neighborhoodMinimum[i]
+                && isFirstMinimum(channel, start + i, samples[i]))
+            {
+                Peak peak;
+                peak.channel = channel;
+                peak.sample = start + i - HISTORY_SAMPLES;
+                peaks.add(peak);
+            }
+        }
+    }
+}
+
+
+void NeighborhoodDetector::findMinima(int channel, int start, int numSamples)
+{
+    const int length = numSamples + 2 * LOCAL_WINDOW;
+
+    float* f = scratch.getWritePointer(0);
+    FloatVectorOperations::copy(f, window.getReadPointer(channel, start - LOCAL_WINDOW), length);
+
+    // f[i] becomes the minimum of the span samples from i on, doubling span each pass
+    int span = 1;
+
+    while (span * 2 <= 2 * LOCAL_WINDOW + 1)
+    {
+        for (int i = 0; i < length - span; i++)
+            f[i] = jmin(f[i], f[i + span]);
+
+        span *= 2;
+    }
+
+    // two overlapping spans cover the LOCAL_WINDOW samples on either side of each sample
+    const int offset = 2 * LOCAL_WINDOW + 1 - span;
+    float* m = minima.getWritePointer(channel);
+
+    for (int i = 0; i < numSamples; i++)
+        m[i] = jmin(f[i], f[i + offset]);
+}
+
+
+bool NeighborhoodDetector::isFirstMinimum(int channel, int sample, float value) const
+{
+    // of equal minima in a neighborhood, only the earliest (then the lowest channel) is a peak
+    const Array<int>& neighborhood = *neighbors[channel];
+
+    for (int k = 0; k < neighborhood.size(); k++)
+    {
+        const int other = neighborhood[k];
+        const float* samples = window.getReadPointer(other);
+
+        for (int dt = -LOCAL_WINDOW; dt <= LOCAL_WINDOW; dt++)
+        {
+            if (samples[sample + dt] == value && (dt < 0 || (dt == 0 && other < channel)))
+                return false;
+        }
+    }
+
+    return true;
+}
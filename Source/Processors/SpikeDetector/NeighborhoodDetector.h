@@ -0,0 +1,132 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef NEIGHBORHOODDETECTOR_H_INCLUDED
+#define NEIGHBORHOODDETECTOR_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+class Channel;
+
+/**
+
+  Finds spikes on high-density probes, where one spike crosses threshold on many
+  neighboring channels at once.
+
+  The channels are grouped into probes by Channel::probeId, and each channel's
+  neighborhood is the set of channels on the same probe within a given radius of it,
+  using the channels' x,y,z positions. A spike is reported only at the sample and
+  channel where the signal reaches its minimum across the neighborhood and across
+  LOCAL_WINDOW samples on either side, so each spike is reported once rather than once
+  per channel it crosses threshold on.
+
+  Each block is searched channel-wide: channels that never cross threshold are skipped
+  with one pass over their samples, then a running minimum over time is computed for the
+  remaining channels and their neighbors, and a candidate only has to be compared with the
+  minimum of its neighbors' running minima at the same sample.
+
+  @see SpikeDetector
+
+*/
+
+class NeighborhoodDetector
+{
+public:
+    NeighborhoodDetector();
+    ~NeighborhoodDetector();
+
+    struct Peak
+    {
+        int channel;
+
+        /** Sample within the current block; negative for a peak in the previous block. */
+        int sample;
+    };
+
+    /** Groups the HEADSTAGE channels into probes and finds their neighbors within
+        radius (in the units of the channel positions, usually micrometres). Channels
+        on a probe whose positions are all the same are assumed to be in a line,
+        DEFAULT_PITCH apart, in channel order. */
+    void setChannels(const OwnedArray<Channel>& channels, float radius);
+
+    int getNumProbes() const;
+
+    /** Returns the probe a channel belongs to, or -1 if it isn't searched. */
+    int getProbe(int channel) const;
+
+    /** Returns a channel's neighbors by increasing distance; the channel itself comes first. */
+    const Array<int>& getNeighbors(int channel) const;
+
+    /** Clears the samples kept from the previous block. */
+    void reset();
+
+    /** Adds a block of samples and appends the peaks below -threshold for which
+        PRE_PEAK_SAMPLES and POST_PEAK_SAMPLES samples are available. Peaks are
+        reported POST_PEAK_SAMPLES samples late, so they may lie in the previous block. */
+    void process(const AudioSampleBuffer& buffer, int numSamples, float threshold, Array<Peak>& peaks);
+
+    /** Returns a sample around a reported peak; sample is relative to the current
+        block and may go back to -HISTORY_SAMPLES. */
+    float getSample(int channel, int sample) const;
+
+    enum
+    {
+        PRE_PEAK_SAMPLES = 8,
+        POST_PEAK_SAMPLES = 32,
+
+        /** Samples on either side of a peak within which it must be the minimum */
+        LOCAL_WINDOW = 8,
+
+        HISTORY_SAMPLES = POST_PEAK_SAMPLES + (PRE_PEAK_SAMPLES > LOCAL_WINDOW ? PRE_PEAK_SAMPLES : LOCAL_WINDOW),
+
+        DEFAULT_PITCH = 20
+    };
+
+private:
+
+    void findMinima(int channel, int start, int numSamples);
+    bool isFirstMinimum(int channel, int sample, float value) const;
+
+    Array<int> channelProbes;
+    OwnedArray<Array<int> > neighbors;
+    int numProbes;
+
+    /** The last HISTORY_SAMPLES samples of the previous block, then the current block */
+    AudioSampleBuffer window;
+    int windowLength;
+
+    /** Per channel: the minimum over +/- LOCAL_WINDOW samples at each sample searched */
+    AudioSampleBuffer minima;
+    HeapBlock<bool> needsMinima;
+
+    /** Running minima while they're computed, and the minimum over a neighborhood */
+    AudioSampleBuffer scratch;
+
+    Array<int> candidates;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NeighborhoodDetector);
+
+};
+
+
+#endif  // NEIGHBORHOODDETECTOR_H_INCLUDED
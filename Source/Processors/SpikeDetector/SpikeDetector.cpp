@@ -30,7 +30,7 @@ SpikeDetector::SpikeDetector()
     : GenericProcessor("Spike Detector"),
       overflowBuffer(2,100), dataBuffer(nullptr),
       overflowBufferSize(100), currentElectrode(-1),
-      uniqueID(0)
+      uniqueID(0), probeMode(false), probeThreshold(50.0f), neighborRadius(50.0f)
 {
     //// the standard form:
     electrodeTypes.add("single electrode");
@@ -64,8 +64,6 @@ SpikeDetector::SpikeDetector()
         electrodeCounter.add(0);
     }
 
-    spikeBuffer = new uint8_t[MAX_SPIKE_BUFFER_LEN]; // MAX_SPIKE_BUFFER_LEN defined in SpikeObject.h
-
 }
 
 SpikeDetector::~SpikeDetector()
@@ -86,6 +84,22 @@ void SpikeDetector::updateSettings()
     if (getNumInputs() > 0)
         overflowBuffer.setSize(getNumInputs(), overflowBufferSize);
 
+    if (probeMode)
+    {
+        neighborhoods.setChannels(channels, neighborRadius);
+
+        for (int i = 0; i < neighborhoods.getNumProbes(); i++)
+        {
+            Channel* ch = new Channel(this, i, ELECTRODE_CHANNEL);
+            ch->name = "PROBE" + String(ch->index);
+            SpikeChannel* spk = new SpikeChannel(SpikeChannel::Plain, MAX_NUMBER_OF_SPIKE_CHANNELS, NULL, 0);
+            ch->extraData = spk;
+            eventChannels.add(ch);
+        }
+
+        return;
+    }
+
     for (int i = 0; i < electrodes.size(); i++)
     {
 
@@ -292,6 +306,26 @@ double SpikeDetector::getChannelThreshold(int electrodeNum, int channelNum)
     return *(electrodes[electrodeNum]->thresholds+channelNum);
 }
 
+void SpikeDetector::setProbeMode(bool enabled)
+{
+    setParameter(97, enabled ? 1.0f : 0.0f);
+}
+
+bool SpikeDetector::getProbeMode()
+{
+    return probeMode;
+}
+
+void SpikeDetector::setProbeThreshold(float threshold)
+{
+    setParameter(96, threshold);
+}
+
+float SpikeDetector::getProbeThreshold()
+{
+    return probeThreshold;
+}
+
 void SpikeDetector::setParameter(int parameterIndex, float newValue)
 {
     //editor->updateParameterButtons(parameterIndex);
@@ -307,6 +341,14 @@ void SpikeDetector::setParameter(int parameterIndex, float newValue)
         else
             *(electrodes[currentElectrode]->isActive+currentChannelIndex) = true;
     }
+    else if (parameterIndex == 97)
+    {
+        probeMode = (newValue != 0.0f);
+    }
+    else if (parameterIndex == 96)
+    {
+        probeThreshold = newValue;
+    }
 }
 
 
@@ -321,6 +363,9 @@ bool SpikeDetector::enable()
     for (int i = 0; i < electrodes.size(); i++)
         useOverflowBuffer.add(false);
 
+    neighborhoods.reset();
+    peaks.ensureStorageAllocated(1024);
+
     return true;
 }
 
@@ -342,12 +387,7 @@ void SpikeDetector::addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int p
 
     s->eventType = SPIKE_EVENT_CODE;
 
-    int numBytes = packSpike(s,                        // SpikeObject
-                             spikeBuffer,              // uint8_t*
-                             MAX_SPIKE_BUFFER_LEN);    // int
-
-    if (numBytes > 0)
-        eventBuffer.addEvent(spikeBuffer, numBytes, peakIndex);
+    spikePool.addHandleEvent(eventBuffer, s, peakIndex);
 
     //std::cout << "Adding spike" << std::endl;
 }
@@ -447,6 +487,12 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
 
     checkForEvents(events); // need to find any timestamp events before extracting spikes
 
+    if (probeMode)
+    {
+        addProbeSpikes(events);
+        return;
+    }
+
     //std::cout << dataBuffer.getMagnitude(0,nSamples) << std::endl;
 
     for (int i = 0; i < electrodes.size(); i++)
@@ -507,7 +553,7 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
 //                        float       gain[MAX_NUMBER_OF_SPIKE_CHANNELS];
 //                        uint16_t    threshold[MAX_NUMBER_OF_SPIKE_CHANNELS];
 
-                        SpikeObject newSpike;
+                        SpikeObject& newSpike = *spikePool.allocate();
                         newSpike.timestamp = 0; //getTimestamp(currentChannel) + peakIndex;
                         newSpike.timestamp_software = -1;
                         newSpike.source = i;
@@ -596,6 +642,60 @@ void SpikeDetector::process(AudioSampleBuffer& buffer,
 
 
 
+}
+
+void SpikeDetector::addProbeSpikes(MidiBuffer& events)
+{
+    const int spikeLength = NeighborhoodDetector::PRE_PEAK_SAMPLES + NeighborhoodDetector::POST_PEAK_SAMPLES;
+
+    peaks.clearQuick();
+    neighborhoods.process(*dataBuffer, getNumSamples(0), probeThreshold, peaks);
+
+    for (int i = 0; i < peaks.size(); i++)
+    {
+        const NeighborhoodDetector::Peak& peak = peaks.getReference(i);
+        const Array<int>& neighborhood = neighborhoods.getNeighbors(peak.channel);
+        const int probe = neighborhoods.getProbe(peak.channel);
+
+        SpikeObject& newSpike = *spikePool.allocate();
+        newSpike.timestamp = getTimestamp(peak.channel) + peak.sample;
+        newSpike.timestamp_software = -1;
+        newSpike.source = probe;
+        newSpike.nChannels = MAX_NUMBER_OF_SPIKE_CHANNELS;
+        newSpike.nSamples = spikeLength;
+        newSpike.sortedId = 0;
+        newSpike.electrodeID = probe + 1;
+        newSpike.channel = 0; // the peak channel always comes first
+        newSpike.samplingFrequencyHz = sampleRateForElectrode;
+
+        int index = 0;
+
+        for (int n = 0; n < MAX_NUMBER_OF_SPIKE_CHANNELS; n++)
+        {
+            // channels at the ends of a probe have fewer neighbors; the rest are left blank,
+            // which in the offset-binary sample format is 32768 rather than 0
+            const int chan = neighborhood[jmin(n, neighborhood.size() - 1)];
+            const float bitVolts = channels[chan]->bitVolts;
+
+            newSpike.gain[n] = (int)(1.0f / bitVolts)*1000;
+            newSpike.threshold[n] = (int) probeThreshold;
+
+            for (int sample = 0; sample < spikeLength; sample++)
+            {
+                if (n < neighborhood.size())
+                {
+                    const int s = peak.sample - NeighborhoodDetector::PRE_PEAK_SAMPLES + sample;
+                    newSpike.data[index++] = uint16(neighborhoods.getSample(chan, s) / bitVolts + 32768);
+                }
+                else
+                {
+                    newSpike.data[index++] = 32768;
+                }
+            }
+        }
+
+        addSpikeEvent(&newSpike, events, jmax(0, peak.sample));
+    }
 }
 
 float SpikeDetector::getNextSample(int& chan)
@@ -677,6 +777,11 @@ bool SpikeDetector::samplesAvailable(int nSamples)
 void SpikeDetector::saveCustomParametersToXml(XmlElement* parentElement)
 {
 
+    XmlElement* probeNode = parentElement->createNewChildElement("PROBES");
+    probeNode->setAttribute("enabled", probeMode);
+    probeNode->setAttribute("threshold", probeThreshold);
+    probeNode->setAttribute("radius", neighborRadius);
+
     for (int i = 0; i < electrodes.size(); i++)
     {
         XmlElement* electrodeNode = parentElement->createNewChildElement("ELECTRODE");
@@ -713,7 +818,13 @@ void SpikeDetector::loadCustomParametersFromXml()
 
         forEachXmlChildElement(*parametersAsXml, xmlNode)
         {
-            if (xmlNode->hasTagName("ELECTRODE"))
+            if (xmlNode->hasTagName("PROBES"))
+            {
+                probeMode = xmlNode->getBoolAttribute("enabled", false);
+                probeThreshold = (float) xmlNode->getDoubleAttribute("threshold", getDefaultThreshold());
+                neighborRadius = (float) xmlNode->getDoubleAttribute("radius", 50.0);
+            }
+            else if (xmlNode->hasTagName("ELECTRODE"))
             {
 
                 electrodeIndex++;
@@ -28,6 +28,7 @@
 
 #include "../GenericProcessor/GenericProcessor.h"
 #include "SpikeDetectorEditor.h"
+#include "NeighborhoodDetector.h"
 
 #include "../Visualization/SpikeObject.h"
 
@@ -91,6 +92,12 @@ public:
     /** Called after acquisition is finished. */
     bool disable();
 
+    /** Detection can run on the acquisition thread, see InlineChain. */
+    bool supportsInlineProcessing()
+    {
+        return true;
+    }
+
     /** Creates the SpikeDetectorEditor. */
     AudioProcessorEditor* createEditor();
 
@@ -153,6 +160,19 @@ public:
 
     double getChannelThreshold(int electrodeNum, int channelNum);
 
+    // PROBE DETECTION //
+
+    /** In probe mode the electrodes are ignored: every probe is searched as a whole,
+        and each spike is sent once, with the waveforms of the channels nearest to
+        its peak (see NeighborhoodDetector). */
+    void setProbeMode(bool enabled);
+
+    bool getProbeMode();
+
+    void setProbeThreshold(float threshold);
+
+    float getProbeThreshold();
+
     void saveCustomParametersToXml(XmlElement* parentElement);
     void loadCustomParametersFromXml();
 
@@ -178,7 +198,6 @@ private:
     int currentChannelIndex;
     int currentIndex;
 
-    uint8_t* spikeBuffer;///[256];
     int64 timestamp;
 
     Array<SimpleElectrode*> electrodes;
@@ -198,9 +217,22 @@ private:
                                   int& currentChannel);
 
     void resetElectrode(SimpleElectrode*);
+
+    void addProbeSpikes(MidiBuffer& events);
+
+    NeighborhoodDetector neighborhoods;
+    Array<NeighborhoodDetector::Peak> peaks;
+
+    bool probeMode;
+    float probeThreshold;
+
+    /** Distance within which channels are neighbors, in the units of the channel positions */
+    float neighborRadius;
     
     uint16_t sampleRateForElectrode;
 
+    SpikePool spikePool;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeDetector);
 
 };
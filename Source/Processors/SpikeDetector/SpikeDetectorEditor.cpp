@@ -105,6 +105,12 @@ SpikeDetectorEditor::SpikeDetectorEditor(GenericProcessor* parentNode, bool useD
     e3->setBounds(130,110,70,10);
     electrodeEditorButtons.add(e3);
 
+    probeButton = new ElectrodeEditorButton("PROBE",font);
+    probeButton->setClickingTogglesState(true);
+    probeButton->addListener(this);
+    addAndMakeVisible(probeButton);
+    probeButton->setBounds(140,80,50,10);
+
     thresholdSlider = new ThresholdSlider(font);
     thresholdSlider->setBounds(200,35,75,75);
     addAndMakeVisible(thresholdSlider);
@@ -149,6 +155,13 @@ SpikeDetectorEditor::~SpikeDetectorEditor()
 
 void SpikeDetectorEditor::sliderEvent(Slider* slider)
 {
+    if (probeButton->getToggleState())
+    {
+        SpikeDetector* processor = (SpikeDetector*) getProcessor();
+        processor->setProbeThreshold(slider->getValue());
+        return;
+    }
+
     int electrodeNum = -1;
 
     for (int i = 0; i < electrodeButtons.size(); i++)
@@ -363,6 +376,25 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
 
         return;
     }
+    else if (button == probeButton)
+    {
+        SpikeDetector* processor = (SpikeDetector*) getProcessor();
+
+        if (acquisitionIsActive)
+        {
+            CoreServices::sendStatusMessage("Stop acquisition before switching to probe detection.");
+            probeButton->setToggleState(processor->getProbeMode(), dontSendNotification);
+            return;
+        }
+
+        processor->setProbeMode(probeButton->getToggleState());
+        updateProbeControls();
+
+		CoreServices::updateSignalChain(this);
+		CoreServices::highlightEditor(this);
+
+        return;
+    }
     else if (button == electrodeEditorButtons[2])   // DELETE
     {
         if (acquisitionIsActive)
@@ -539,12 +571,32 @@ void SpikeDetectorEditor::comboBoxChanged(ComboBox* comboBox)
     }
 
     thresholdSlider->setActive(false);
+    updateProbeControls();
+}
+
+void SpikeDetectorEditor::updateProbeControls()
+{
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
+
+    probeButton->setToggleState(processor->getProbeMode(), dontSendNotification);
+
+    if (processor->getProbeMode())
+    {
+        // a single threshold applies to every channel of every probe
+        thresholdSlider->setActive(true);
+        thresholdSlider->setValue(processor->getProbeThreshold(), dontSendNotification);
+    }
+    else if (!electrodeEditorButtons[0]->getToggleState())
+    {
+        thresholdSlider->setActive(false);
+    }
 }
 
 void SpikeDetectorEditor::checkSettings()
 {
     electrodeList->setSelectedId(0);
     drawElectrodeButtons(0);
+    updateProbeControls();
 
 	CoreServices::updateSignalChain(this);
 	CoreServices::highlightEditor(this);
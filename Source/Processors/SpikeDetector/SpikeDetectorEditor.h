@@ -116,6 +116,11 @@ private:
     OwnedArray<ElectrodeButton> electrodeButtons;
     Array<ElectrodeEditorButton*> electrodeEditorButtons;
 
+    /** Switches between the electrodes and searching whole probes */
+    ElectrodeEditorButton* probeButton;
+
+    void updateProbeControls();
+
     void editElectrode(int index, int chan, int newChan);
 
     int lastId;
@@ -245,51 +245,43 @@ void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int sample
     if (eventType == SPIKE)
     {
 
-        const uint8_t* dataptr = event.getRawData();
-        int bufferSize = event.getRawDataSize();
+        const SpikeObject* spike = getSpikeFromEvent(event);
 
-        if (bufferSize > 0)
+        if (spike != nullptr)
         {
+            const SpikeObject& newSpike = *spike;
 
-            SpikeObject newSpike;
+            int electrodeNum = newSpike.source;
 
-            bool isValid = unpackSpike(&newSpike, dataptr, bufferSize);
+            Electrode& e = electrodes.getReference(electrodeNum);
+            // std::cout << electrodeNum << std::endl;
 
-            if (isValid)
+            bool aboveThreshold = false;
+
+            // update threshold / check threshold
+            for (int i = 0; i < e.numChannels; i++)
             {
-                int electrodeNum = newSpike.source;
+                e.detectorThresholds.set(i, float(newSpike.threshold[i])); // / float(newSpike.gain[i]));
 
-                Electrode& e = electrodes.getReference(electrodeNum);
-                // std::cout << electrodeNum << std::endl;
+                aboveThreshold = aboveThreshold | checkThreshold(i, e.displayThresholds[i], newSpike);
+            }
 
-                bool aboveThreshold = false;
+            if (aboveThreshold)
+            {
 
-                // update threshold / check threshold
-                for (int i = 0; i < e.numChannels; i++)
+                // add to buffer
+                if (e.currentSpikeIndex < displayBufferSize)
                 {
-                    e.detectorThresholds.set(i, float(newSpike.threshold[i])); // / float(newSpike.gain[i]));
-
-                    aboveThreshold = aboveThreshold | checkThreshold(i, e.displayThresholds[i], newSpike);
+                    //  std::cout << "Adding spike " << e.currentSpikeIndex + 1 << std::endl;
+                    e.mostRecentSpikes.set(e.currentSpikeIndex, newSpike);
+                    e.currentSpikeIndex++;
                 }
 
-                if (aboveThreshold)
+                // save spike
+                if (isRecording)
                 {
-
-                    // add to buffer
-                    if (e.currentSpikeIndex < displayBufferSize)
-                    {
-                        //  std::cout << "Adding spike " << e.currentSpikeIndex + 1 << std::endl;
-                        e.mostRecentSpikes.set(e.currentSpikeIndex, newSpike);
-                        e.currentSpikeIndex++;
-                    }
-
-                    // save spike
-                    if (isRecording)
-                    {
-						CoreServices::RecordNode::writeSpike(newSpike,e.recordIndex);
-                    }
+					CoreServices::RecordNode::writeSpike(newSpike,e.recordIndex);
                 }
-
             }
 
         }
@@ -298,7 +290,7 @@ void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int sample
 
 }
 
-bool SpikeDisplayNode::checkThreshold(int chan, float thresh, SpikeObject& s)
+bool SpikeDisplayNode::checkThreshold(int chan, float thresh, const SpikeObject& s)
 {
     int sampIdx = s.nSamples*chan;
 
@@ -77,7 +77,7 @@ public:
     void addSpikePlotForElectrode(SpikePlot* sp, int i);
     void removeSpikePlots();
 
-    bool checkThreshold(int, float, SpikeObject&);
+    bool checkThreshold(int, float, const SpikeObject&);
 
 private:
 
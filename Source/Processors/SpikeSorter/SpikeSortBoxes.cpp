@@ -594,6 +594,7 @@ SpikeSortBoxes::SpikeSortBoxes(UniqueIDgenerator* uniqueIDgenerator_,PCAcomputin
 {
     uniqueIDgenerator = uniqueIDgenerator_;
     computingThread = pth;
+    templateMatcher = new TemplateMatcher(uniqueIDgenerator);
     pc1 = pc2 = nullptr;
     bufferSize = 200;
     spikeBufferIndex = -1;
@@ -839,6 +840,7 @@ SpikeSortBoxes::~SpikeSortBoxes()
     delete pc2;
     pc1 = nullptr;
     pc2 = nullptr;
+    delete templateMatcher;
 }
 
 void SpikeSortBoxes::setSelectedUnitAndBox(int unitID, int boxID)
@@ -1230,6 +1232,11 @@ bool SpikeSortBoxes::sortSpike(SpikeObject* so, bool PCAfirst)
     return false;
 }
 
+bool SpikeSortBoxes::matchTemplates(SpikeObject* so, TemplateThread* thread)
+{
+    return templateMatcher->matchSpike(so, spikeBuffer, spikeBufferIndex, thread);
+}
+
 
 bool  SpikeSortBoxes::removeBoxFromUnit(int unitID, int boxIndex)
 {
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../GenericProcessor/GenericProcessor.h"
 #include "SpikeSorterEditor.h"
 #include "../Visualization/SpikeObject.h"
+#include "TemplateMatcher.h"
 #include <algorithm>    // std::sort
 #include <list>
 #include <queue>
@@ -239,6 +240,9 @@ public:
 
     void projectOnPrincipalComponents(SpikeObject* so);
     bool sortSpike(SpikeObject* so, bool PCAfirst);
+    /** Assigns a spike no drawn unit claimed to a unit learned from the spike buffer;
+        new templates are learned on the given thread. */
+    bool matchTemplates(SpikeObject* so, TemplateThread* thread);
     void RePCA();
     void addPCAunit(PCAUnit unit);
     int addBoxUnit(int channel);
@@ -284,6 +288,7 @@ private:
     Array<SpikeObject> spikeBuffer;
     int bufferSize,spikeBufferIndex;
     PCAcomputingThread* computingThread;
+    TemplateMatcher* templateMatcher;
     bool bPCAJobSubmitted,bPCAcomputed,bRePCA,bPCAjobFinished ;
 
 
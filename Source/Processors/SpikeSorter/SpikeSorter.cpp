@@ -30,6 +30,7 @@
 #include "../PSTH/PeriStimulusTimeHistogramEditor.h"
 #include "../PSTH/PeriStimulusTimeHistogramNode.h"
 #include "../../AccessClass.h" //TO BE REMOVED
+#include <atomic>
 class spikeSorter;
 
 SpikeSorter::SpikeSorter()
@@ -44,12 +45,12 @@ SpikeSorter::SpikeSorter()
     ticksPerSec = (float) timer.getHighResolutionTicksPerSecond();
     electrodeTypes.clear();
     electrodeCounter.clear();
-    spikeBuffer = new uint8_t[MAX_SPIKE_BUFFER_LEN]; // MAX_SPIKE_BUFFER_LEN defined in SpikeObject.h
     channelBuffers=nullptr;
     PCAbeforeBoxes = true;
     autoDACassignment = false;
     syncThresholds = false;
     flipSignal = false;
+    templateMatching = false;
 }
 
 bool SpikeSorter::getFlipSignalState()
@@ -73,6 +74,16 @@ void SpikeSorter::setFlipSignalState(bool state)
 
 }
 
+bool SpikeSorter::getTemplateMatchingState()
+{
+    return templateMatching;
+}
+
+void SpikeSorter::setTemplateMatchingState(bool state)
+{
+    templateMatching = state;
+}
+
 int SpikeSorter::getNumPreSamples()
 {
     return numPreSamples;
@@ -157,9 +168,6 @@ void SpikeSorter::increaseUniqueProbeID(String type)
 
 SpikeSorter::~SpikeSorter()
 {
-    delete spikeBuffer;
-    spikeBuffer = nullptr;
-
     if (channelBuffers != nullptr)
         delete channelBuffers;
 
@@ -652,6 +660,8 @@ bool SpikeSorter::enable()
     SpikeSorterEditor* editor = (SpikeSorterEditor*) getEditor();
     editor->enable();
 
+    templateThread.start();
+
     return true;
 }
 
@@ -671,6 +681,9 @@ bool SpikeSorter::disable()
     }
     //editor->disable();
     mut.exit();
+
+    templateThread.stop();
+
     return true;
 }
 
@@ -690,12 +703,7 @@ void SpikeSorter::addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int pea
 
     s->eventType = SPIKE_EVENT_CODE;
 
-    int numBytes = packSpike(s,                        // SpikeObject
-                             spikeBuffer,              // uint8_t*
-                             MAX_SPIKE_BUFFER_LEN);    // int
-
-    if (numBytes > 0)
-        eventBuffer.addEvent(spikeBuffer, numBytes, peakIndex);
+    spikePool.addHandleEvent(eventBuffer, s, peakIndex);
 
     //std::cout << "Adding spike" << std::endl;
 }
@@ -962,7 +970,7 @@ void SpikeSorter::process(AudioSampleBuffer& buffer,
                         peakIndex = sampleIndex;
                         sampleIndex -= (electrode->prePeakSamples+1);
 
-                        SpikeObject newSpike;
+                        SpikeObject& newSpike = *spikePool.allocate();
                         newSpike.sortedId = 0; // unsorted.
                         newSpike.timestamp = getTimestamp(currentChannel) + peakIndex;
                         newSpike.electrodeID = electrode->electrodeID;
@@ -1001,7 +1009,8 @@ void SpikeSorter::process(AudioSampleBuffer& buffer,
                         electrode->spikeSort->projectOnPrincipalComponents(&newSpike);
 
                         // Add spike to drawing buffer....
-                        electrode->spikeSort->sortSpike(&newSpike, PCAbeforeBoxes);
+                        if (!electrode->spikeSort->sortSpike(&newSpike, PCAbeforeBoxes) && templateMatching)
+                            electrode->spikeSort->matchTemplates(&newSpike, &templateThread);
 
 
                         // transfer buffered spikes to spike plot
@@ -1244,6 +1253,7 @@ void SpikeSorter::saveCustomParametersToXml(XmlElement* parentElement)
     mainNode->setAttribute("syncThresholds",syncThresholds);
     mainNode->setAttribute("uniqueID",uniqueID);
     mainNode->setAttribute("flipSignal",flipSignal);
+    mainNode->setAttribute("templateMatching",templateMatching);
 
     XmlElement* countNode = mainNode->createNewChildElement("ELECTRODE_COUNTER");
 
@@ -1306,6 +1316,7 @@ void SpikeSorter::loadCustomParametersFromXml()
                 syncThresholds = mainNode->getBoolAttribute("syncThresholds");
                 uniqueID = mainNode->getIntAttribute("uniqueID");
                 flipSignal = mainNode->getBoolAttribute("flipSignal");
+                templateMatching = mainNode->getBoolAttribute("templateMatching", false);
 
                 forEachXmlChildElement(*mainNode, xmlNode)
                 {
@@ -1811,14 +1822,7 @@ Histogram::~Histogram()
 void ContinuousCircularBuffer::reallocate(int NumCh)
 {
     numCh =NumCh;
-    Buf.resize(numCh);
-    for (int k=0; k< numCh; k++)
-    {
-        Buf[k].resize(bufLen);
-    }
-    numSamplesInBuf = 0;
-    ptr = 0; // points to a valid position in the buffer.
-
+    allocate();
 }
 
 
@@ -1830,123 +1834,168 @@ ContinuousCircularBuffer::ContinuousCircularBuffer(int NumCh, float SamplingRate
 
     int numSamplesToHoldPerChannel = (int)(SamplingRate * NumSecInBuffer / SubSampling);
     buffer_dx = 1.0 / (SamplingRate / SubSampling);
-    subSampling = SubSampling;
+    subSampling = jmax(1, SubSampling);
     samplingRate = SamplingRate;
     numCh =NumCh;
     leftover_k = 0;
-    Buf.resize(numCh);
 
+    // power-of-two length (at least one cache line) so ring positions are a mask away
+    bufLen = (int) nextPowerOfTwo(jmax(16, numSamplesToHoldPerChannel));
+    mask = bufLen - 1;
+    rowStride = 2 * bufLen;
+
+    hardwareTS.resize(bufLen);
+    softwareTS.resize(bufLen);
+
+    allocate();
+}
+
+
+void ContinuousCircularBuffer::allocate()
+{
+    // one extra cache line so the first row can start on a 64-byte boundary;
+    // rows are a multiple of 16 floats, so every row is aligned.
+    storage.calloc(size_t(jmax(1, numCh)) * rowStride + 16);
+    data = reinterpret_cast<float*>((reinterpret_cast<pointer_sized_int>(storage.getData()) + 63) & ~pointer_sized_int(63));
+
+    conversionBufferSize = jmax(1, bufLen);
+    conversionBuffer.malloc(conversionBufferSize);
 
-    for (int k=0; k< numCh; k++)
+    for (int k = 0; k < bufLen; k++)
     {
-        Buf[k].resize(numSamplesToHoldPerChannel);
+        hardwareTS[k] = 0;
+        softwareTS[k] = 0;
     }
 
-    hardwareTS.resize(numSamplesToHoldPerChannel);
-    softwareTS.resize(numSamplesToHoldPerChannel);
-    valid.resize(numSamplesToHoldPerChannel);
-    bufLen = numSamplesToHoldPerChannel;
     numSamplesInBuf = 0;
     ptr = 0; // points to a valid position in the buffer.
+    leftover_k = 0;
 }
 
 
-void ContinuousCircularBuffer::update(int channel, int64 hardware_ts, int64 software_ts, bool rise)
+int ContinuousCircularBuffer::beginWrite(int64 hardware_ts, int64 software_ts, int numpts, int& firstSample)
 {
-    // used to record ttl pulses as continuous data...
-    mut.enter();
-    valid[ptr] = true;
-    hardwareTS[ptr] = hardware_ts;
-    softwareTS[ptr] = software_ts;
+    // we don't start from zero because of subsampling issues.
+    // previous packet may not have ended exactly at the last given sample.
+    firstSample = leftover_k;
 
-    Buf[channel][ptr] = (rise) ? 1.0 : 0.0;
+    int numSamples = 0;
+    if (firstSample < numpts)
+        numSamples = (numpts - 1 - firstSample) / subSampling + 1;
 
-    ptr++;
-    if (ptr == bufLen)
-    {
-        ptr = 0;
-    }
-    numSamplesInBuf++;
-    if (numSamplesInBuf >= bufLen)
+    leftover_k = firstSample + numSamples * subSampling - numpts;
+
+    const double ticksPerSample = numTicksPerSecond / samplingRate;
+
+    for (int i = 0; i < numSamples; i++)
     {
-        numSamplesInBuf = bufLen;
+        const int k = firstSample + i * subSampling;
+        const int pos = (ptr + i) & mask;
+        hardwareTS[pos] = hardware_ts + k;
+        softwareTS[pos] = software_ts + int64(k * ticksPerSample);
     }
-    mut.exit();
+
+    return numSamples;
 }
 
-void ContinuousCircularBuffer::update(AudioSampleBuffer& buffer, int64 hardware_ts, int64 software_ts, int numpts)
+
+void ContinuousCircularBuffer::writeChannel(int channel, const float* src, int stride, int numSamples)
 {
-    mut.enter();
+    float* row = data + size_t(channel) * rowStride;
 
-    // we don't start from zero because of subsampling issues.
-    // previous packet may not have ended exactly at the last given sample.
-    int k = leftover_k;
-    int lastUsedSample;
-    for (; k < numpts; k+=subSampling)
+    int done = 0;
+
+    while (done < numSamples)
     {
-        lastUsedSample = k;
-        valid[ptr] = true;
-        hardwareTS[ptr] = hardware_ts + k;
-        softwareTS[ptr] = software_ts + int64(float(k) / samplingRate * numTicksPerSecond);
+        const int pos = (ptr + done) & mask;
+        const int n = jmin(numSamples - done, bufLen - pos);
+        const float* s = src + size_t(done) * stride;
+        float* dest = row + pos;
 
-        for (int ch = 0; ch < numCh; ch++)
-        {
-            Buf[ch][ptr] = *(buffer.getReadPointer(ch,k));
-        }
-        ptr++;
-        if (ptr == bufLen)
+        if (stride == 1)
         {
-            ptr = 0;
+            FloatVectorOperations::copy(dest, s, n);
         }
-        numSamplesInBuf++;
-        if (numSamplesInBuf >= bufLen)
+        else
         {
-            numSamplesInBuf = bufLen;
+            for (int i = 0; i < n; i++)
+                dest[i] = s[i * stride];
         }
+
+        // keep the mirror in step, so windows crossing the end stay contiguous
+        FloatVectorOperations::copy(dest + bufLen, dest, n);
+
+        done += n;
     }
+}
 
-    int numMissedSamples = (numpts-1)-lastUsedSample;
-    leftover_k = (subSampling-numMissedSamples-1) % subSampling;
-    mut.exit();
 
+void ContinuousCircularBuffer::finishWrite(int numSamples)
+{
+    // samples and timestamps must be visible before the new write position
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ptr = (ptr + numSamples) & mask;
+    numSamplesInBuf = jmin(bufLen, numSamplesInBuf + numSamples);
 }
 
 
-void ContinuousCircularBuffer::update(std::vector<std::vector<bool>> contdata, int64 hardware_ts, int64 software_ts, int numpts)
+void ContinuousCircularBuffer::update(int channel, int64 hardware_ts, int64 software_ts, bool rise)
 {
-    mut.enter();
+    // used to record ttl pulses as continuous data...
+    hardwareTS[ptr] = hardware_ts;
+    softwareTS[ptr] = software_ts;
 
-    // we don't start from zero because of subsampling issues.
-    // previous packet may not have ended exactly at the last given sample.
-    int k = leftover_k;
-    int lastUsedSample;
-    for (; k < numpts; k+=subSampling)
+    float* row = data + size_t(channel) * rowStride;
+    row[ptr] = row[ptr + bufLen] = (rise) ? 1.0f : 0.0f;
+
+    finishWrite(1);
+}
+
+void ContinuousCircularBuffer::update(AudioSampleBuffer& buffer, int64 hardware_ts, int64 software_ts, int numpts)
+{
+    int firstSample;
+    const int numSamples = beginWrite(hardware_ts, software_ts, numpts, firstSample);
+
+    if (numSamples == 0)
+        return;
+
+    const int numChannels = jmin(numCh, buffer.getNumChannels());
+
+    for (int ch = 0; ch < numChannels; ch++)
     {
-        lastUsedSample = k;
-        valid[ptr] = true;
-        hardwareTS[ptr] = hardware_ts + k;
-        softwareTS[ptr] = software_ts + int64(float(k) / samplingRate * numTicksPerSecond);
+        writeChannel(ch, buffer.getReadPointer(ch, firstSample), subSampling, numSamples);
+    }
 
-        for (int ch = 0; ch < numCh; ch++)
-        {
-            Buf[ch][ptr] = contdata[ch][k];
-        }
-        ptr++;
-        if (ptr == bufLen)
-        {
-            ptr = 0;
-        }
-        numSamplesInBuf++;
-        if (numSamplesInBuf >= bufLen)
-        {
-            numSamplesInBuf = bufLen;
-        }
+    finishWrite(numSamples);
+}
+
+
+void ContinuousCircularBuffer::update(const std::vector<std::vector<bool> >& contdata, int64 hardware_ts, int64 software_ts, int numpts)
+{
+    int firstSample;
+    const int numSamples = beginWrite(hardware_ts, software_ts, numpts, firstSample);
+
+    if (numSamples == 0)
+        return;
+
+    if (numSamples > conversionBufferSize)
+    {
+        conversionBufferSize = numSamples;
+        conversionBuffer.malloc(conversionBufferSize);
     }
 
-    int numMissedSamples = (numpts-1)-lastUsedSample;
-    leftover_k =subSampling-numMissedSamples-1;
-    mut.exit();
+    const int numChannels = jmin(numCh, (int) contdata.size());
+
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        for (int i = 0; i < numSamples; i++)
+            conversionBuffer[i] = contdata[ch][firstSample + i * subSampling] ? 1.0f : 0.0f;
+
+        writeChannel(ch, conversionBuffer, 1, numSamples);
+    }
 
+    finishWrite(numSamples);
 }
 /*
 void ContinuousCircularBuffer::AddDataToBuffer(std::vector<std::vector<double>> lfp, double soft_ts)
@@ -184,30 +184,68 @@ public:
 };
 
 
+/**
+  Sub-sampled history of many continuous channels.
+
+  All channels live in one cache-aligned block, one row per channel. Each row holds
+  a power-of-two ring of bufLen samples followed by a mirror of it, so any window of
+  up to bufLen samples starting anywhere in the ring can be read in place through
+  getChannelWindow() without wrapping.
+
+  There is a single writer (the update() functions). It fills the samples and
+  timestamps first and only then advances ptr and numSamplesInBuf, so readers that
+  run while the writer is idle (or only look at samples behind ptr) need no lock.
+*/
 class ContinuousCircularBuffer
 {
 public:
     ContinuousCircularBuffer(int NumCh, float SamplingRate, int SubSampling, float NumSecInBuffer);
     void reallocate(int N);
-    void update(std::vector<std::vector<bool>> contdata, int64 hardware_ts, int64 software_ts, int numpts);
+    void update(const std::vector<std::vector<bool> >& contdata, int64 hardware_ts, int64 software_ts, int numpts);
     void update(AudioSampleBuffer& buffer, int64 hardware_ts, int64 software_ts, int numpts);
     void update(int channel, int64 hardware_ts, int64 software_ts, bool rise);
     int GetPtr();
-    void addTrialStartToSmartBuffer(int trialID);
+
+    /** Returns the samples of a channel starting at ring position index (taken modulo
+        bufLen). The next bufLen values are contiguous. */
+    const float* getChannelWindow(int channel, int index) const
+    {
+        return data + size_t(channel) * rowStride + (index & mask);
+    }
+
     int numCh;
     int subSampling;
     float samplingRate;
-    CriticalSection mut;
     int numSamplesInBuf;
     double numTicksPerSecond;
     int ptr;
     int bufLen;
+    int mask;
     int leftover_k;
     double buffer_dx;
 
-    std::vector<std::vector<float> > Buf;
-    std::vector<bool> valid;
     std::vector<int64> hardwareTS,softwareTS;
+
+private:
+    void allocate();
+
+    /** Works out which input samples survive sub-sampling and stores their
+        timestamps; returns how many there are and the first one's index. */
+    int beginWrite(int64 hardware_ts, int64 software_ts, int numpts, int& firstSample);
+
+    /** Writes every stride-th value of src into a channel's ring (and its mirror). */
+    void writeChannel(int channel, const float* src, int stride, int numSamples);
+
+    /** Publishes numSamples new samples to readers. */
+    void finishWrite(int numSamples);
+
+    HeapBlock<float> storage;
+    float* data;
+    int rowStride;
+
+    /** Scratch for converting TTL data; sized in allocate(), grown only for longer blocks */
+    HeapBlock<float> conversionBuffer;
+    int conversionBufferSize;
 };
 
 
@@ -356,6 +394,8 @@ public:
     void setThresholdSyncStatus(bool status);
     bool getFlipSignalState();
     void setFlipSignalState(bool state);
+    bool getTemplateMatchingState();
+    void setTemplateMatchingState(bool state);
     void startRecording();
     std::vector<float> getElectrodeVoltageScales(int electrodeID);
     //void getElectrodePCArange(int electrodeID, float &minX,float &maxX,float &minY,float &maxY);
@@ -420,7 +460,6 @@ private:
 
 
     int numPreSamples,numPostSamples;
-    uint8_t* spikeBuffer;///[256];
     //int64 timestamp;
     int64 hardware_timestamp;
     int64 software_timestamp;
@@ -439,6 +478,10 @@ private:
     RHD2000Thread* getRhythmAccess();
     bool flipSignal;
 
+    /** Spikes no drawn unit claims are matched against learned templates */
+    bool templateMatching;
+    TemplateThread templateThread;
+
     Time timer;
 
     void addWaveformToSpikeObject(SpikeObject* s,
@@ -449,6 +492,7 @@ private:
 
     Array<Electrode*> electrodes;
     PCAcomputingThread computingThread;
+    SpikePool spikePool;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikeSorter);
 
 };
@@ -0,0 +1,566 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "TemplateMatcher.h"
+#include "SpikeSorter.h"
+
+/** Spikes correlating at least this well with a template are learned as part of it */
+static const float learnCorrelation = 0.9f;
+
+/** Spikes must correlate at least this well with a template to be assigned to its unit */
+static const float matchCorrelation = 0.8f;
+
+/** A spike may be a template scaled by this much (bursts shrink, drift changes amplitude) */
+static const float minScale = 0.5f;
+static const float maxScale = 2.0f;
+
+/** A refreshed template keeps the unit of an old one that it correlates with this well */
+static const float keepCorrelation = 0.8f;
+
+
+/** n must be a multiple of four; the four partial sums let the compiler vectorize the loop */
+static inline float dotProduct(const float* a, const float* b, int n)
+{
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+    for (int i = 0; i < n; i += 4)
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+
+    return (s0 + s1) + (s2 + s3);
+}
+
+
+int getSpikeMicrovolts(const SpikeObject& so, float* waveform)
+{
+    int index = 0;
+
+    for (int ch = 0; ch < so.nChannels; ch++)
+    {
+        const float scale = 1000.0f / so.gain[ch];
+
+        for (int i = 0; i < so.nSamples; i++)
+        {
+            waveform[index] = float(so.data[index] - 32768) * scale;
+            index++;
+        }
+    }
+
+    return index;
+}
+
+
+/***********************************************/
+
+TemplateSet::TemplateSet(int numTemplates_, int dimension_)
+    : numTemplates(numTemplates_), dimension(dimension_), stride((dimension_ + 3) & ~3)
+{
+    matrix.calloc(jmax(1, numTemplates * stride));
+    norms.calloc(jmax(1, numTemplates));
+    unitIDs.calloc(jmax(1, numTemplates));
+    colors.calloc(jmax(1, numTemplates * 3));
+}
+
+
+float* TemplateSet::getRow(int index)
+{
+    return matrix + index * stride;
+}
+
+
+const float* TemplateSet::getRow(int index) const
+{
+    return matrix + index * stride;
+}
+
+
+int TemplateSet::match(const float* waveform, float minCorrelation) const
+{
+    const float squaredNorm = dotProduct(waveform, waveform, stride);
+
+    if (squaredNorm <= 0)
+        return -1;
+
+    const float norm = std::sqrt(squaredNorm);
+
+    int best = -1;
+    float bestCorrelation = minCorrelation;
+
+    for (int t = 0; t < numTemplates; t++)
+    {
+        const float projection = dotProduct(getRow(t), waveform, stride);
+        const float correlation = projection / norm;
+        const float scale = projection / norms[t];
+
+        if (correlation >= bestCorrelation && scale >= minScale && scale <= maxScale)
+        {
+            best = t;
+            bestCorrelation = correlation;
+        }
+    }
+
+    return best;
+}
+
+
+float TemplateSet::getCorrelation(int index, const TemplateSet& other, int otherIndex) const
+{
+    jassert(other.stride == stride);
+
+    return dotProduct(getRow(index), other.getRow(otherIndex), stride);
+}
+
+
+/***********************************************/
+
+TemplateJob::TemplateJob(int capacity_)
+    : capacity(capacity_), numLoaded(0)
+{
+    spikes.calloc(capacity);
+}
+
+
+void TemplateJob::load(const Array<SpikeObject>& spikeBuffer, int newestIndex)
+{
+    const int size = spikeBuffer.size();
+    numLoaded = jmin(size, capacity);
+
+    // unroll the ring, so that the last spike loaded is the newest
+    for (int i = 0; i < numLoaded; i++)
+    {
+        const int index = ((newestIndex - numLoaded + 1 + i) % size + size) % size;
+        spikes[i] = spikeBuffer.getReference(index);
+    }
+
+    done = 0;
+}
+
+
+void TemplateJob::retire(TemplateSet* oldTemplates)
+{
+    retired = oldTemplates;
+}
+
+
+bool TemplateJob::isDone() const
+{
+    return done.get() != 0;
+}
+
+
+void TemplateJob::setDone()
+{
+    done = 1;
+}
+
+
+TemplateSet* TemplateJob::releaseResult()
+{
+    return result.release();
+}
+
+
+void TemplateJob::learn()
+{
+    retired = nullptr;
+
+    // learn from the spikes shaped like the most recent one; empty slots have no gain
+    int dimension = 0;
+
+    for (int i = numLoaded - 1; i >= 0 && dimension == 0; i--)
+    {
+        if (spikes[i].gain[0] != 0)
+            dimension = spikes[i].nChannels * spikes[i].nSamples;
+    }
+
+    if (dimension == 0)
+        return;
+
+    HeapBlock<float> waveforms(numLoaded * dimension);
+    HeapBlock<float> directions(numLoaded * dimension);
+    int numSpikes = 0;
+
+    for (int i = 0; i < numLoaded; i++)
+    {
+        const SpikeObject& so = spikes[i];
+
+        if (so.gain[0] == 0 || so.nChannels * so.nSamples != dimension)
+            continue;
+
+        float* waveform = waveforms + numSpikes * dimension;
+        getSpikeMicrovolts(so, waveform);
+
+        float squaredNorm = 0;
+
+        for (int k = 0; k < dimension; k++)
+            squaredNorm += waveform[k] * waveform[k];
+
+        if (squaredNorm <= 0)
+            continue;
+
+        const float norm = std::sqrt(squaredNorm);
+        float* direction = directions + numSpikes * dimension;
+
+        for (int k = 0; k < dimension; k++)
+            direction[k] = waveform[k] / norm;
+
+        numSpikes++;
+    }
+
+    if (numSpikes < MIN_SPIKES)
+        return;
+
+    HeapBlock<float> centers(TemplateSet::MAX_TEMPLATES * dimension);
+    HeapBlock<float> sums(TemplateSet::MAX_TEMPLATES * dimension);
+    HeapBlock<int> counts(TemplateSet::MAX_TEMPLATES);
+    HeapBlock<int> assignments(numSpikes);
+    int numCenters = 0;
+
+    // each spike joins the first group it correlates well with, or starts one
+    for (int i = 0; i < numSpikes; i++)
+    {
+        const float* direction = directions + i * dimension;
+        int best = -1;
+        float bestCorrelation = learnCorrelation;
+
+        for (int c = 0; c < numCenters; c++)
+        {
+            float correlation = 0;
+
+            for (int k = 0; k < dimension; k++)
+                correlation += centers[c * dimension + k] * direction[k];
+
+            if (correlation >= bestCorrelation)
+            {
+                best = c;
+                bestCorrelation = correlation;
+            }
+        }
+
+        if (best < 0 && numCenters < TemplateSet::MAX_TEMPLATES)
+        {
+            best = numCenters++;
+            memcpy(centers + best * dimension, direction, dimension * sizeof(float));
+        }
+
+        assignments[i] = jmax(0, best);
+    }
+
+    for (int iteration = 0; ; iteration++)
+    {
+        zeromem(sums, numCenters * dimension * sizeof(float));
+        zeromem(counts, numCenters * sizeof(int));
+
+        for (int i = 0; i < numSpikes; i++)
+        {
+            const float* waveform = waveforms + i * dimension;
+            float* sum = sums + assignments[i] * dimension;
+
+            for (int k = 0; k < dimension; k++)
+                sum[k] += waveform[k];
+
+            counts[assignments[i]]++;
+        }
+
+        if (iteration == NUM_ITERATIONS)
+            break;
+
+        for (int c = 0; c < numCenters; c++)
+        {
+            float squaredNorm = 0;
+
+            for (int k = 0; k < dimension; k++)
+                squaredNorm += sums[c * dimension + k] * sums[c * dimension + k];
+
+            const float norm = (squaredNorm > 0) ? std::sqrt(squaredNorm) : 1.0f;
+
+            for (int k = 0; k < dimension; k++)
+                centers[c * dimension + k] = sums[c * dimension + k] / norm;
+        }
+
+        for (int i = 0; i < numSpikes; i++)
+        {
+            const float* direction = directions + i * dimension;
+            float bestCorrelation = -2.0f;
+
+            for (int c = 0; c < numCenters; c++)
+            {
+                if (counts[c] == 0)
+                    continue;
+
+                float correlation = 0;
+
+                for (int k = 0; k < dimension; k++)
+                    correlation += centers[c * dimension + k] * direction[k];
+
+                if (correlation > bestCorrelation)
+                {
+                    assignments[i] = c;
+                    bestCorrelation = correlation;
+                }
+            }
+        }
+    }
+
+    int numTemplates = 0;
+
+    for (int c = 0; c < numCenters; c++)
+    {
+        if (counts[c] >= MIN_SPIKES)
+            numTemplates++;
+    }
+
+    if (numTemplates == 0)
+        return;
+
+    result = new TemplateSet(numTemplates, dimension);
+
+    int t = 0;
+
+    for (int c = 0; c < numCenters; c++)
+    {
+        if (counts[c] < MIN_SPIKES)
+            continue;
+
+        float* row = result->getRow(t);
+        float squaredNorm = 0;
+
+        for (int k = 0; k < dimension; k++)
+        {
+            row[k] = sums[c * dimension + k] / counts[c];
+            squaredNorm += row[k] * row[k];
+        }
+
+        const float norm = std::sqrt(squaredNorm);
+
+        for (int k = 0; k < dimension; k++)
+            row[k] /= norm;
+
+        result->norms[t] = norm;
+        t++;
+    }
+}
+
+
+/***********************************************/
+
+TemplateThread::TemplateThread()
+    : Thread("Template learning"), jobFifo(MAX_QUEUED_JOBS)
+{
+    queuedJobs.calloc(MAX_QUEUED_JOBS);
+}
+
+
+TemplateThread::~TemplateThread()
+{
+    stop();
+}
+
+
+void TemplateThread::start()
+{
+    if (!isThreadRunning())
+        startThread(3); // learning may take as long as it needs
+}
+
+
+void TemplateThread::stop()
+{
+    if (isThreadRunning())
+    {
+        signalThreadShouldExit();
+        notify();
+        stopThread(2000);
+    }
+
+    for (TemplateJob::Ptr job = nextJob(); job != nullptr; job = nextJob())
+        job->setDone();
+}
+
+
+bool TemplateThread::addJob(TemplateJob* job)
+{
+    int start1, size1, start2, size2;
+    jobFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return false;
+
+    job->incReferenceCount(); // released by nextJob()
+    queuedJobs[start1] = job;
+    jobFifo.finishedWrite(1);
+
+    return true;
+}
+
+
+TemplateJob::Ptr TemplateThread::nextJob()
+{
+    int start1, size1, start2, size2;
+    jobFifo.prepareToRead(1, start1, size1, start2, size2);
+
+    if (size1 == 0)
+        return nullptr;
+
+    TemplateJob::Ptr job = queuedJobs[start1];
+    queuedJobs[start1] = nullptr;
+    jobFifo.finishedRead(1);
+
+    job->decReferenceCount(); // the queue's reference; job still holds one
+
+    return job;
+}
+
+
+void TemplateThread::run()
+{
+    while (!threadShouldExit())
+    {
+        TemplateJob::Ptr job = nextJob();
+
+        if (job == nullptr)
+        {
+            wait(POLL_MS);
+            continue;
+        }
+
+        job->learn();
+        job->setDone();
+    }
+}
+
+
+/***********************************************/
+
+TemplateMatcher::TemplateMatcher(UniqueIDgenerator* uniqueIDgenerator_)
+    : uniqueIDgenerator(uniqueIDgenerator_), jobPending(false), spikesSinceRefresh(0)
+{
+    job = new TemplateJob(REFRESH_SPIKES);
+    waveform.calloc(MAX_NUMBER_OF_SPIKE_CHANNELS * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES + 4);
+}
+
+
+TemplateMatcher::~TemplateMatcher()
+{
+
+}
+
+
+int TemplateMatcher::getNumTemplates() const
+{
+    return (templates != nullptr) ? templates->numTemplates : 0;
+}
+
+
+bool TemplateMatcher::matchSpike(SpikeObject* so, const Array<SpikeObject>& spikeBuffer, int newestIndex,
+                                 TemplateThread* thread)
+{
+    if (jobPending && job->isDone())
+    {
+        TemplateSet* newTemplates = job->releaseResult();
+        jobPending = false;
+
+        if (newTemplates != nullptr)
+            takeTemplates(newTemplates);
+    }
+
+    if (++spikesSinceRefresh >= REFRESH_SPIKES && !jobPending
+        && thread != nullptr && thread->isThreadRunning())
+    {
+        job->load(spikeBuffer, newestIndex);
+
+        if (thread->addJob(job))
+        {
+            spikesSinceRefresh = 0;
+            jobPending = true;
+        }
+    }
+
+    if (templates == nullptr || so->gain[0] == 0)
+        return false;
+
+    const int dimension = getSpikeMicrovolts(*so, waveform);
+
+    if (dimension != templates->dimension)
+        return false;
+
+    for (int k = dimension; k < templates->stride; k++)
+        waveform[k] = 0;
+
+    const int t = templates->match(waveform, matchCorrelation);
+
+    if (t < 0)
+        return false;
+
+    so->sortedId = templates->unitIDs[t];
+    so->color[0] = templates->colors[t * 3];
+    so->color[1] = templates->colors[t * 3 + 1];
+    so->color[2] = templates->colors[t * 3 + 2];
+
+    return true;
+}
+
+
+void TemplateMatcher::takeTemplates(TemplateSet* newTemplates)
+{
+    bool taken[TemplateSet::MAX_TEMPLATES] = { false };
+
+    const bool comparable = (templates != nullptr && templates->dimension == newTemplates->dimension);
+
+    for (int t = 0; t < newTemplates->numTemplates; t++)
+    {
+        int previous = -1;
+        float bestCorrelation = keepCorrelation;
+
+        for (int o = 0; comparable && o < templates->numTemplates; o++)
+        {
+            const float correlation = newTemplates->getCorrelation(t, *templates, o);
+
+            if (!taken[o] && correlation >= bestCorrelation)
+            {
+                previous = o;
+                bestCorrelation = correlation;
+            }
+        }
+
+        if (previous >= 0)
+        {
+            taken[previous] = true;
+            newTemplates->unitIDs[t] = templates->unitIDs[previous];
+            memcpy(newTemplates->colors + t * 3, templates->colors + previous * 3, 3);
+        }
+        else
+        {
+            newTemplates->unitIDs[t] = uniqueIDgenerator->generateUniqueID();
+            BoxUnit::setDefaultColors(newTemplates->colors + t * 3, newTemplates->unitIDs[t]);
+        }
+    }
+
+    // the job is idle until the next refresh, which deletes the old templates
+    job->retire(templates.release());
+    templates = newTemplates;
+}
@@ -0,0 +1,226 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2014 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef TEMPLATEMATCHER_H_INCLUDED
+#define TEMPLATEMATCHER_H_INCLUDED
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "../Visualization/SpikeObject.h"
+
+class UniqueIDgenerator;
+
+/**
+  The templates of one electrode, as a matrix with one row per unit.
+
+  Each row holds a template's waveform (all channels, in microvolts) scaled to unit
+  length and padded with zeros to a multiple of four samples, so that scoring a spike
+  against every template is a run of straight dot products over contiguous memory.
+*/
+class TemplateSet
+{
+public:
+    TemplateSet(int numTemplates, int dimension);
+
+    /** Scores a waveform (in microvolts, zero-padded to stride) against every template.
+        Returns the index of the template with the highest correlation, allowing the spike
+        to be the template scaled by a half to twice, or -1 if none reaches minCorrelation. */
+    int match(const float* waveform, float minCorrelation) const;
+
+    /** Returns the correlation between two templates of the same dimension. */
+    float getCorrelation(int index, const TemplateSet& other, int otherIndex) const;
+
+    float* getRow(int index);
+    const float* getRow(int index) const;
+
+    const int numTemplates;
+    const int dimension;
+
+    /** Row length: dimension rounded up to a multiple of four */
+    const int stride;
+
+    HeapBlock<float> matrix;
+
+    /** Length of each template before it was scaled to unit length */
+    HeapBlock<float> norms;
+
+    HeapBlock<int> unitIDs;
+    HeapBlock<uint8> colors;
+
+    enum
+    {
+        MAX_TEMPLATES = 64
+    };
+
+private:
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TemplateSet);
+};
+
+
+/**
+  Learns templates from a copy of an electrode's spike buffer, on the TemplateThread.
+
+  Spikes are grouped by correlation: each spike joins the template it correlates best
+  with, or starts a new one, and a few passes of k-means then settle the templates.
+  Groups with fewer than MIN_SPIKES spikes are dropped as noise.
+
+  Each TemplateMatcher reuses one job, whose spike buffer is allocated up front, so
+  that starting a job doesn't allocate on the audio thread. The templates a result
+  replaces are handed back to the job and deleted by the next learn().
+*/
+class TemplateJob : public ReferenceCountedObject
+{
+public:
+    TemplateJob(int capacity);
+
+    typedef ReferenceCountedObjectPtr<TemplateJob> Ptr;
+
+    /** Copies up to capacity spikes, oldest first, from a ring whose newest spike is at
+        newestIndex, and clears the done flag; the job must be idle. */
+    void load(const Array<SpikeObject>& spikes, int newestIndex);
+
+    /** Takes ownership of templates that were replaced, to delete them off the audio thread. */
+    void retire(TemplateSet* oldTemplates);
+
+    void learn();
+
+    /** Set once learn() has finished; the result may be null if no templates were found. */
+    bool isDone() const;
+    void setDone();
+
+    TemplateSet* releaseResult();
+
+    enum
+    {
+        MIN_SPIKES = 5,
+        NUM_ITERATIONS = 3
+    };
+
+private:
+    HeapBlock<SpikeObject> spikes;
+    const int capacity;
+    int numLoaded;
+
+    ScopedPointer<TemplateSet> result;
+    ScopedPointer<TemplateSet> retired;
+    Atomic<int> done;
+
+    JUCE_DECLARE_NON_COPYABLE(TemplateJob);
+};
+
+
+/**
+  Runs TemplateJobs in the background while acquisition is running.
+
+  Jobs are queued from the audio thread through a fixed-size FIFO, which holds a
+  reference to each job until it has run. Waking the thread would take a lock, so
+  addJob() doesn't; the thread checks the FIFO every POLL_MS instead.
+*/
+class TemplateThread : public Thread
+{
+public:
+    TemplateThread();
+    ~TemplateThread();
+
+    /** Starts the thread; called when acquisition starts. */
+    void start();
+
+    /** Stops the thread; jobs that haven't run are marked done without a result. */
+    void stop();
+
+    /** Queues a job; returns false if the queue is full. */
+    bool addJob(TemplateJob* job);
+
+    void run() override;
+
+    enum
+    {
+        MAX_QUEUED_JOBS = 256,
+
+        /** How often the idle thread looks for jobs; learning isn't in a hurry */
+        POLL_MS = 10
+    };
+
+private:
+    /** Returns the next queued job, or null if there is none. */
+    TemplateJob::Ptr nextJob();
+
+    AbstractFifo jobFifo;
+    HeapBlock<TemplateJob*> queuedJobs;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TemplateThread);
+};
+
+
+/**
+  Sorts the spikes of one electrode by matching them against templates learned
+  from its recent spikes.
+
+  Audio thread only: every REFRESH_SPIKES spikes the matcher's TemplateJob is restarted
+  from the electrode's spike buffer, and once it is done its templates replace the
+  current ones.
+  A new template takes over the unit ID and color of the old template it correlates
+  with best, so units keep their identity from one refresh to the next.
+
+  @see SpikeSortBoxes
+*/
+class TemplateMatcher
+{
+public:
+    TemplateMatcher(UniqueIDgenerator* uniqueIDgenerator);
+    ~TemplateMatcher();
+
+    /** Assigns the spike to the best matching template's unit. Returns false if no
+        template matches. spikeBuffer is a ring of the electrode's recent spikes, the
+        newest at newestIndex. */
+    bool matchSpike(SpikeObject* so, const Array<SpikeObject>& spikeBuffer, int newestIndex,
+                    TemplateThread* thread);
+
+    int getNumTemplates() const;
+
+    enum
+    {
+        REFRESH_SPIKES = 200
+    };
+
+private:
+
+    void takeTemplates(TemplateSet* newTemplates);
+
+    UniqueIDgenerator* uniqueIDgenerator;
+
+    ScopedPointer<TemplateSet> templates;
+    TemplateJob::Ptr job;
+    bool jobPending;
+    int spikesSinceRefresh;
+
+    HeapBlock<float> waveform;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TemplateMatcher);
+};
+
+
+/** Converts a spike's waveform (all channels) to microvolts; returns the number of values. */
+int getSpikeMicrovolts(const SpikeObject& so, float* waveform);
+
+
+#endif  // TEMPLATEMATCHER_H_INCLUDED
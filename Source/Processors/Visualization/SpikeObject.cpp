@@ -29,6 +29,96 @@
 #define MIN(a,b)((a)<(b)?(a):(b))
 #define MAX(a,b)((a)<(b)?(b):(a))
 
+namespace
+{
+    /** Pools by number, so that a handle can name its pool in one byte */
+    SpikePool* volatile spikePools[MAX_SPIKE_POOLS];
+    CriticalSection spikePoolLock;
+}
+
+SpikePool::SpikePool()
+    : lastSequence(0), number(-1)
+{
+    slots.calloc(SPIKE_POOL_SIZE);
+
+    const ScopedLock sl(spikePoolLock);
+
+    for (int i = 0; i < MAX_SPIKE_POOLS && number < 0; i++)
+    {
+        if (spikePools[i] == nullptr)
+        {
+            number = i;
+            spikePools[i] = this;
+        }
+    }
+
+    jassert(number >= 0); // too many spike sources
+}
+
+SpikePool::~SpikePool()
+{
+    const ScopedLock sl(spikePoolLock);
+
+    if (number >= 0)
+        spikePools[number] = nullptr;
+}
+
+SpikeObject* SpikePool::allocate()
+{
+    // 0 marks a slot that isn't readable
+    if (++lastSequence == 0)
+        ++lastSequence;
+
+    Slot& slot = slots[lastSequence & (SPIKE_POOL_SIZE - 1)];
+    slot.sequence = lastSequence;
+
+    // withdraw the slot's old spike before it is overwritten
+    slot.published = 0;
+    Atomic<uint32>::memoryBarrier();
+
+    return &slot.spike;
+}
+
+void SpikePool::addHandleEvent(MidiBuffer& eventBuffer, const SpikeObject* s, int sampleNum)
+{
+    Slot& slot = *reinterpret_cast<Slot*>(const_cast<SpikeObject*>(s));
+    jassert(&slot >= slots.getData() && &slot < slots.getData() + SPIKE_POOL_SIZE);
+
+    // the spike must be complete before readers can see it
+    Atomic<uint32>::memoryBarrier();
+    slot.published = slot.sequence;
+
+    uint8 data[SPIKE_HANDLE_EVENT_SIZE];
+
+    data[0] = SPIKE_EVENT_CODE;
+    data[1] = (uint8) number;
+    memcpy(data + 2, &slot.sequence, 4);
+
+    eventBuffer.addEvent(data, SPIKE_HANDLE_EVENT_SIZE, sampleNum);
+}
+
+const SpikeObject* getSpikeFromEvent(const MidiMessage& event)
+{
+    if (event.getRawDataSize() < SPIKE_HANDLE_EVENT_SIZE)
+        return nullptr;
+
+    const SpikePool* pool = spikePools[event.getRawData()[1]];
+
+    uint32 sequence;
+    memcpy(&sequence, event.getRawData() + 2, 4);
+
+    if (pool == nullptr)
+        return nullptr;
+
+    // a spike recycled before it was read is dropped
+    const SpikePool::Slot& slot = pool->slots[sequence & (SPIKE_POOL_SIZE - 1)];
+
+    if (slot.published.get() != sequence)
+        return nullptr;
+
+    return &slot.spike;
+}
+
 // Simple method for serializing a SpikeObject into a string of bytes
 int packSpike(const SpikeObject* s, uint8_t* buffer, int bufferSize)
 {
@@ -38,6 +38,9 @@
 #define SPIKE_EVENT_CODE 4;
 #define MAX_SPIKE_BUFFER_LEN 512 // max length of spike buffer in bytes
                                  // the true max calculated from the spike values below is actually 507
+#define SPIKE_POOL_SIZE 4096     // number of SpikeObjects in each spike pool (power of two)
+#define MAX_SPIKE_POOLS 256      // spike pools that can exist at once
+#define SPIKE_HANDLE_EVENT_SIZE 6 // event type + pool number + 32-bit spike handle
 
 /** Class to store spike data in event channels */
 class SpikeChannel : public ChannelExtraData
@@ -60,7 +63,14 @@ String generateSpikeElectrodeName(int numChannels, int index);
 
   Allows spikes to be transmitted between processors.
 
-  For transmission between processors SpikeObjects must be packaged up into buffers that can fit into MidiEvents
+  Within the signal chain, spikes are not copied: a spike source takes a SpikeObject from its own
+  SpikePool, fills it in place and sends it with SpikePool::addHandleEvent(). The event only
+  carries a handle to the pooled spike, which downstream processors read in place with
+  getSpikeFromEvent(). Pool slots are recycled round-robin, so a spike stays valid until its
+  source has allocated SPIKE_POOL_SIZE further spikes -- far longer than the callback it was sent in.
+  Processors that need a spike later must copy it.
+
+  For the network and for disk, SpikeObjects must be serialized into buffers.
   The following two methods can be used to package the above spike object into a buffer and  unpackage a buffer
   into a SpikeObject.
 
@@ -104,6 +114,51 @@ int microVoltsToSpikeDataBin(SpikeObject *s, float uV, int ch = 0);
 float spikeTimeBinToMicrosecond(SpikeObject *s, int bin, int ch=0);
 int microSecondsToSpikeTimeBin(SpikeObject *s, float t, int ch=0);
 
+/**
+  The ring of SpikeObjects of one spike source.
+
+  Each processor that creates spikes owns a pool, and only ever allocates from it
+  on the thread that runs it, so sources running on different threads (see
+  GenericProcessor::processInline()) never hand out the same slot. A slot becomes
+  readable when its handle event is added: the spike is published with a memory
+  barrier after it has been filled in, and allocating the slot again withdraws it
+  before it is overwritten.
+*/
+class SpikePool
+{
+public:
+    SpikePool();
+    ~SpikePool();
+
+    /** Returns the next SpikeObject of the ring, to be filled in and sent with addHandleEvent(). */
+    SpikeObject* allocate();
+
+    /** Publishes a spike obtained from allocate() and adds an event referring to it. */
+    void addHandleEvent(MidiBuffer& eventBuffer, const SpikeObject* s, int sampleNum);
+
+private:
+
+    friend const SpikeObject* getSpikeFromEvent(const MidiMessage& event);
+
+    struct Slot
+    {
+        SpikeObject spike; // must come first, see addHandleEvent()
+        uint32 sequence;
+
+        /** The sequence readers may use the slot for, or 0 while it is being filled */
+        Atomic<uint32> published;
+    };
+
+    HeapBlock<Slot> slots;
+    uint32 lastSequence;
+    int number;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpikePool);
+};
+
+/** Returns the pooled spike a spike event refers to, or nullptr if its slot has been recycled since. */
+const SpikeObject* getSpikeFromEvent(const MidiMessage& event);
+
 /** Simple method for serializing a SpikeObject into a string of bytes, returns true is the packaged spike buffer is valid */
 int packSpike(const SpikeObject* s, uint8_t* buffer, int bufferLength);
 
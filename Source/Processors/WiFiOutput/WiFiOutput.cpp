@@ -25,12 +25,14 @@
 #include "WiFiOutput.h"
 
 WiFiOutput::WiFiOutput()
-    : GenericProcessor("WiFi Output")
+    : GenericProcessor("WiFi Output"), dispatcher("WiFi Output", this, this)
 {
 }
 
 WiFiOutput::~WiFiOutput()
 {
+    dispatcher.stop();
+    cancelPendingUpdate();
 
 }
 
@@ -44,7 +46,11 @@ void WiFiOutput::handleEvent(int eventType, MidiMessage& event, int sampleNum)
 {
     if (eventType == TTL)
     {
-        startTimer((int) float(event.getTimeStamp())/getSampleRate()*1000.0);
+        DeviceCommand command;
+        command.ingestionTicks = getIngestionTicks();
+        command.dueTicks = OutputDispatcher::getTicksForSample(command.ingestionTicks, sampleNum, getSampleRate());
+
+        dispatcher.schedule(command);
     }
 
 }
@@ -65,21 +71,41 @@ void WiFiOutput::process(AudioSampleBuffer& buffer,
 
 }
 
-void WiFiOutput::timerCallback()
+bool WiFiOutput::enable()
 {
-    std::cout << "FIRE!" << std::endl;
+    dispatcher.start();
+    return true;
+}
 
+bool WiFiOutput::disable()
+{
+    dispatcher.stop();
+    return true;
+}
+
+void WiFiOutput::execute(const DeviceCommand& command)
+{
     try
     {
         socket.sendTo("hi",2,"169.254.1.1",2000);
 
-        WiFiOutputEditor* ed = (WiFiOutputEditor*) getEditor();
-        ed->receivedEvent();
+        triggerAsyncUpdate();
     }
     catch (SocketException& e)
     {
         // don't do anything
     }
+}
+
+LatencyHistogram* WiFiOutput::getDispatchJitter()
+{
+    return &dispatcher.getJitter();
+}
 
-    stopTimer();
+void WiFiOutput::handleAsyncUpdate()
+{
+    WiFiOutputEditor* ed = (WiFiOutputEditor*) getEditor();
+
+    if (ed != nullptr)
+        ed->receivedEvent();
 }
@@ -28,6 +28,7 @@
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../GenericProcessor/GenericProcessor.h"
 #include "WiFiOutputEditor.h"
+#include "../OutputDispatcher/OutputDispatcher.h"
 
 #include "../../Network/PracticalSocket.h"  // For UDPSocket and SocketException
 
@@ -37,13 +38,17 @@
   IP address. Used in conjunction with the Arduino WiFly shield, these
   signals can be sent wirelessly.
 
-  @see GenericProcessor, WiFiOutputEditor
+  Packets are sent by an OutputDispatcher thread at the time of the
+  sample that triggered them.
+
+  @see GenericProcessor, WiFiOutputEditor, OutputDispatcher
 
 */
 
 
 class WiFiOutput : public GenericProcessor,
-    public Timer
+    public OutputDispatcher::Device,
+    private AsyncUpdater
 
 {
 public:
@@ -63,11 +68,22 @@ public:
         return true;
     }
 
+    bool enable();
+    bool disable();
+
+    /** Sends a packet; called by the dispatcher. */
+    void execute(const DeviceCommand& command);
+
+    LatencyHistogram* getDispatchJitter();
+
 private:
 
     UDPSocket socket;
 
-    void timerCallback();
+    OutputDispatcher dispatcher;
+
+    /** Flashes the editor's icon on the message thread */
+    void handleAsyncUpdate();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WiFiOutput);
 
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <math.h>
 #include "../AccessClass.h"
 #include "../Processors/RecordNode/RecordEngine.h"
+#include "../CoreServices.h"
 
 PlayButton::PlayButton()
     : DrawableButton("PlayButton", DrawableButton::ImageFitted)
@@ -129,7 +130,7 @@ void CPUMeter::paint(Graphics& g)
 }
 
 
-DiskSpaceMeter::DiskSpaceMeter()
+DiskSpaceMeter::DiskSpaceMeter() : diskFree(0.0f), state(HEALTHY)
 
 {
 
@@ -148,9 +149,44 @@ DiskSpaceMeter::~DiskSpaceMeter()
 {
 }
 
-void DiskSpaceMeter::updateDiskSpace(float percent)
+void DiskSpaceMeter::updateHealth(const RecordHealth& health)
 {
-    diskFree = percent;
+    const RecordHealth::Status& status = health.getStatus();
+
+    if (status.bytesTotal > 0)
+        diskFree = 1.0f - float(status.bytesFree) / float(status.bytesTotal);
+
+    timeToFull = String::empty;
+    state = HEALTHY;
+
+    if (status.secondsToFull >= 0)
+    {
+        const int minutes = int(status.secondsToFull / 60.0);
+
+        if (minutes >= 100 * 60)
+            timeToFull = ">99h";
+        else if (minutes >= 60)
+            timeToFull = String(minutes / 60) + "h" + String(minutes % 60).paddedLeft('0', 2);
+        else
+            timeToFull = String(minutes) + "m";
+
+        if (minutes < 10)
+            state = CRITICAL;
+        else if (minutes < 60)
+            state = WARNING;
+    }
+
+    if (status.backlogSeconds > 0.5)
+        state = CRITICAL;
+    else if (state == HEALTHY && (status.backlogSeconds > 0 || status.writeLoad > 0.8))
+        state = WARNING;
+
+    setTooltip(health.getDescription());
+}
+
+DiskSpaceMeter::State DiskSpaceMeter::getState() const
+{
+    return state;
 }
 
 void DiskSpaceMeter::paint(Graphics& g)
@@ -158,7 +194,13 @@ void DiskSpaceMeter::paint(Graphics& g)
 
     g.fillAll(Colours::grey);
 
-    g.setColour(Colours::lightgrey);
+    if (state == CRITICAL)
+        g.setColour(Colours::red);
+    else if (state == WARNING)
+        g.setColour(Colours::orange);
+    else
+        g.setColour(Colours::lightgrey);
+
     if (diskFree > 0)
         g.fillRect(0.0f,0.0f,getWidth()*diskFree,float(getHeight()));
 
@@ -166,7 +208,11 @@ void DiskSpaceMeter::paint(Graphics& g)
     g.drawRect(0,0,getWidth(),getHeight(),1);
 
     g.setFont(font);
-    g.drawSingleLineText("DF",75,12);
+
+    if (timeToFull.isEmpty())
+        g.drawSingleLineText("DF",75,12);
+    else
+        g.drawText(timeToFull, 0, 0, getWidth() - 4, getHeight(), Justification::centredRight, false);
 
 }
 
@@ -365,7 +411,8 @@ void ControlPanelButton::setState(bool b)
 
 
 ControlPanel::ControlPanel(ProcessorGraph* graph_, AudioComponent* audio_)
-    : graph(graph_), audio(audio_), initialize(true), open(false), lastEngineIndex(-1)
+    : graph(graph_), audio(audio_), initialize(true),
+      lastDiskState(DiskSpaceMeter::HEALTHY), open(false), lastEngineIndex(-1)
 {
 
     if (1)
@@ -944,8 +991,24 @@ void ControlPanel::refreshMeters()
 
     masterClock->repaint();
 
-    diskMeter->updateDiskSpace(graph->getRecordNode()->getFreeSpace());
-    diskMeter->repaint();
+    // RecordHealth samples at most once per second, however often this runs
+    if (graph->getRecordNode()->updateHealth())
+    {
+        diskMeter->updateHealth(graph->getRecordNode()->getHealth());
+        diskMeter->repaint();
+
+        if (diskMeter->getState() == DiskSpaceMeter::CRITICAL && lastDiskState != DiskSpaceMeter::CRITICAL)
+        {
+            const RecordHealth::Status& status = graph->getRecordNode()->getHealth().getStatus();
+
+            if (status.backlogSeconds > 0.5)
+                CoreServices::sendStatusMessage("Disk writes are falling behind the recording!");
+            else
+                CoreServices::sendStatusMessage("Data directory will be full in " + String(int(status.secondsToFull / 60.0)) + " minutes!");
+        }
+
+        lastDiskState = diskMeter->getState();
+    }
 
     if (initialize)
     {
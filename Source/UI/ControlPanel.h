@@ -30,6 +30,7 @@
 #include "../Processors/ProcessorGraph/ProcessorGraph.h"
 #include "../Processors/RecordNode/RecordNode.h"
 #include "../Processors/RecordNode/RecordEngine.h"
+#include "../Processors/RecordNode/RecordHealth.h"
 #include "CustomLookAndFeel.h"
 #include "../AccessClass.h"
 #include "../Processors/Editors/GenericEditor.h" // for UtilityButton
@@ -120,14 +121,15 @@ private:
 
 /**
 
-  Displays the amount of disk space left in the current data directory.
+  Displays the amount of disk space used in the current data directory, and
+  how well the disk keeps up with the recording.
 
-  The DiskSpaceMeter is located in the ControlPanel. When the GUI is launched (or the data directory
-  is changed), a built-in JUCE method is used to find the amount of free space.
+  The DiskSpaceMeter is located in the ControlPanel, which feeds it the
+  RecordNode's RecordHealth samples. While recording, it shows the projected
+  time until the disk is full, and turns orange or red when that time gets
+  short or the writes fall behind. The tooltip has the full details.
 
-  Note that the DiskSpaceMeter currently displays only relative, not absolute disk space.
-
-  @see ControlPanel
+  @see ControlPanel, RecordHealth
 
 */
 
@@ -137,18 +139,29 @@ public:
     DiskSpaceMeter();
     ~DiskSpaceMeter();
 
-    /** Updates the free disk space displayed by the DiskSpaceMeter. Called by
+    /** Updates the values displayed by the DiskSpaceMeter. Called by
     	the ControlPanel. */
-    void updateDiskSpace(float percent);
+    void updateHealth(const RecordHealth& health);
 
     /** Draws the DiskSpaceMeter. */
     void paint(Graphics& g);
 
+    enum State
+    {
+        HEALTHY,
+        WARNING,
+        CRITICAL
+    };
+
+    State getState() const;
+
 private:
 
     Font font;
 
     float diskFree;
+    String timeToFull;
+    State state;
 
 };
 
@@ -399,6 +412,8 @@ private:
     /** Updates the values displayed by the CPUMeter and DiskSpaceMeter.*/
     void refreshMeters();
 
+    DiskSpaceMeter::State lastDiskState;
+
     bool keyPressed(const KeyPress& key);
 
 
@@ -743,6 +743,11 @@ void EditorViewport::mouseDown(const MouseEvent& e)
 
                 m.addItem(1, "Rename", true);
 
+                GenericProcessor* processor = editorArray[i]->getProcessor();
+
+                if (processor->supportsInlineProcessing())
+                    m.addItem(4, "Run on acquisition thread", canEdit, processor->getRunsInline());
+
                 const int result = m.show();
 
                 if (result == 1)
@@ -771,6 +776,11 @@ void EditorViewport::mouseDown(const MouseEvent& e)
                     refreshEditors();
                     return;
                 }
+                else if (result == 4)
+                {
+                    processor->setRunsInline(!processor->getRunsInline());
+                    return;
+                }
             }
 
             // make sure uncollapsed editors don't accept clicks outside their title bar
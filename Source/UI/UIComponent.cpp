@@ -315,6 +315,7 @@ PopupMenu UIComponent::getMenuForIndex(int menuIndex, const String& menuName)
         menu.addCommandItem(commandManager, toggleSignalChain);
         menu.addCommandItem(commandManager, toggleFileInfo);
         menu.addSeparator();
+        menu.addCommandItem(commandManager, showLatency);
         menu.addCommandItem(commandManager, resizeWindow);
 
     }
@@ -357,7 +358,8 @@ void UIComponent::getAllCommands(Array <CommandID>& commands)
                              toggleSignalChain,
                              toggleFileInfo,
                              showHelp,
-                             resizeWindow
+                             resizeWindow,
+                             showLatency
                             };
 
     commands.addArray(ids, numElementsInArray(ids));
@@ -450,6 +452,10 @@ void UIComponent::getCommandInfo(CommandID commandID, ApplicationCommandInfo& re
             result.setInfo("Reset window bounds", "Reset window bounds", "General", 0);
             break;
 
+        case showLatency:
+            result.setInfo("Latency report...", "Show the latency from acquisition to each output.", "General", 0);
+            break;
+
         default:
             break;
     };
@@ -567,6 +573,10 @@ bool UIComponent::perform(const InvocationInfo& info)
             mainWindow->centreWithSize(800, 600);
             break;
 
+        case showLatency:
+            showLatencyReport();
+            break;
+
         default:
             break;
 
@@ -577,6 +587,67 @@ bool UIComponent::perform(const InvocationInfo& info)
 }
 
 
+void UIComponent::showLatencyReport()
+{
+    Array<GenericProcessor*> processors = processorGraph->getListOfProcessors();
+    processors.add((GenericProcessor*) processorGraph->getRecordNode());
+
+    String report;
+    String csv = "processor,lower_us,upper_us,count\n";
+
+    for (int i = 0; i < processors.size(); i++)
+    {
+        GenericProcessor* p = processors[i];
+        LatencyHistogram& latency = p->getOutputLatency();
+
+        if (latency.getCount() == 0)
+            continue;
+
+        const String name = p->getName() + " (" + String(p->getNodeId()) + ")";
+
+        report << name << ": " << latency.getSummary() << "\n";
+
+        if (LatencyHistogram* jitter = p->getDispatchJitter())
+            report << "    dispatch jitter: " << jitter->getSummary() << "\n";
+
+        StringArray lines;
+        lines.addLines(latency.toCsv());
+
+        for (int l = 0; l < lines.size(); l++)
+        {
+            if (lines[l].isNotEmpty())
+                csv << "\"" << name << "\"," << lines[l] << "\n";
+        }
+    }
+
+    if (report.isEmpty())
+    {
+        AlertWindow::showMessageBox(AlertWindow::InfoIcon, "Latency report",
+                                    "No output latencies have been recorded yet. Start acquisition with "
+                                    "a Record Node, Event Broadcaster or hardware output in the signal chain.");
+        return;
+    }
+
+    report << "\nLatencies are measured from the moment the data reached the application.";
+
+    if (AlertWindow::showOkCancelBox(AlertWindow::InfoIcon, "Latency report", report, "Export...", "Close"))
+    {
+        FileChooser fc("Choose the file name...",
+                       File::getCurrentWorkingDirectory().getChildFile("latency.csv"),
+                       "*.csv",
+                       true);
+
+        if (fc.browseForFileToSave(true))
+        {
+            if (fc.getResult().replaceWithText(csv))
+                sendActionMessage("Latency histograms saved to " + fc.getResult().getFullPathName());
+            else
+                sendActionMessage("Could not write " + fc.getResult().getFullPathName());
+        }
+    }
+}
+
+
 void UIComponent::saveStateToXml(XmlElement* xml)
 {
     XmlElement* uiComponentState = xml->createNewChildElement("UICOMPONENT");
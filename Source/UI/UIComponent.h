@@ -210,9 +210,14 @@ private:
         showHelp				= 0x2011,
         resizeWindow            = 0x2012,
         reloadOnStartup         = 0x2013,
-        saveConfigurationAs     = 0x2014
+        saveConfigurationAs     = 0x2014,
+        showLatency             = 0x2015
     };
 
+    /** Shows the ingestion-to-output latencies recorded by the sinks in the signal chain,
+        with the option of exporting their histograms as CSV.*/
+    void showLatencyReport();
+
     File currentConfigFile;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(UIComponent);